@@ -51,6 +51,15 @@ void __udelay(unsigned long usec)
 		os_usleep(usec);
 }
 
+int initjmp(jmp_buf jmp, void __noreturn (*func)(void), void *stack_base,
+	    size_t stack_sz)
+{
+	if (os_initjmp(jmp, func, stack_base, stack_sz))
+		return -EFAULT;
+
+	return 0;
+}
+
 int cleanup_before_linux(void)
 {
 	return 0;
@@ -253,6 +262,7 @@ unsigned long sandbox_read(const void *addr, enum sandboxio_size_t size)
 void sandbox_write(void *addr, unsigned int val, enum sandboxio_size_t size)
 {
 	struct sandbox_state *state = state_get_current();
+	struct sandbox_mmio *mmio;
 
 	if (!state->allow_memio)
 		return;
@@ -271,6 +281,25 @@ void sandbox_write(void *addr, unsigned int val, enum sandboxio_size_t size)
 		*(u64 *)addr = val;
 		break;
 	}
+
+	list_for_each_entry(mmio, &state->mmio_head, sibling_node) {
+		if (addr >= mmio->base && addr < mmio->base + mmio->size) {
+			mmio->write(mmio, addr - mmio->base);
+			break;
+		}
+	}
+}
+
+void sandbox_mmio_add(struct sandbox_mmio *mmio)
+{
+	struct sandbox_state *state = state_get_current();
+
+	list_add_tail(&mmio->sibling_node, &state->mmio_head);
+}
+
+void sandbox_mmio_remove(struct sandbox_mmio *mmio)
+{
+	list_del(&mmio->sibling_node);
 }
 
 void sandbox_set_enable_memio(bool enable)
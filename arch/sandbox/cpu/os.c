@@ -1084,6 +1084,103 @@ void *os_find_text_base(void)
 	return base;
 }
 
+/**
+ * struct os_initjmp_ctx - information passed to a new initjmp() context
+ *
+ * @caller:	context to return to once @jmp is set up
+ * @jmp:	jump buffer to set up
+ * @func:	function to call when @jmp is used
+ */
+struct os_initjmp_ctx {
+	ucontext_t caller;
+	jmp_buf *jmp;
+	void (*func)(void);
+};
+
+static struct os_initjmp_ctx *os_initjmp_ctx;
+
+static void os_initjmp_entry(void)
+{
+	struct os_initjmp_ctx *ctx = os_initjmp_ctx;
+	void (*func)(void) = ctx->func;
+
+	/* record this point on the new stack, then go straight back */
+	if (!setjmp(*ctx->jmp))
+		setcontext(&ctx->caller);
+
+	/* the first longjmp() to the buffer arrives here */
+	func();
+	os_abort();
+}
+
+int os_initjmp(void *jmp, void (*func)(void), void *stack_base,
+	       size_t stack_sz)
+{
+	struct os_initjmp_ctx ctx;
+	ucontext_t uc;
+
+	if (getcontext(&uc))
+		return -1;
+	uc.uc_stack.ss_sp = stack_base;
+	uc.uc_stack.ss_size = stack_sz;
+	uc.uc_link = NULL;
+	makecontext(&uc, os_initjmp_entry, 0);
+
+	ctx.jmp = jmp;
+	ctx.func = func;
+	os_initjmp_ctx = &ctx;
+	if (swapcontext(&ctx.caller, &uc))
+		return -1;
+
+	return 0;
+}
+
+/**
+ * struct os_thread_ctx - information passed to a new host thread
+ *
+ * @func:	function to run
+ * @arg:	argument to pass to @func
+ */
+struct os_thread_ctx {
+	void (*func)(void *arg);
+	void *arg;
+};
+
+static void *os_thread_entry(void *ptr)
+{
+	struct os_thread_ctx ctx = *(struct os_thread_ctx *)ptr;
+
+	os_free(ptr);
+	ctx.func(ctx.arg);
+
+	return NULL;
+}
+
+int os_thread_start(void (*func)(void *arg), void *arg)
+{
+	struct os_thread_ctx *ctx;
+	pthread_attr_t attr;
+	pthread_t tid;
+	int ret;
+
+	ctx = os_malloc(sizeof(*ctx));
+	if (!ctx)
+		return -ENOMEM;
+	ctx->func = func;
+	ctx->arg = arg;
+
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+	ret = pthread_create(&tid, &attr, os_thread_entry, ctx);
+	pthread_attr_destroy(&attr);
+	if (ret) {
+		os_free(ctx);
+		return -ret;
+	}
+
+	return 0;
+}
+
 /**
  * os_unblock_signals() - unblock all signals
  *
@@ -367,6 +367,7 @@ void state_reset_for_test(struct sandbox_state *state)
 	state->sysreset_allowed[SYSRESET_POWER_OFF] = true;
 	state->sysreset_allowed[SYSRESET_COLD] = true;
 	state->allow_memio = false;
+	INIT_LIST_HEAD(&state->mmio_head);
 	sandbox_set_eth_enable(true);
 
 	memset(&state->wdt, '\0', sizeof(state->wdt));
@@ -6,6 +6,17 @@
 #ifndef __SANDBOX_CPU_H
 #define __SANDBOX_CPU_H
 
+#include <linux/types.h>
+
 void cpu_sandbox_set_current(const char *name);
 
+/**
+ * cpu_sandbox_set_jobs() - allow or refuse jobs on secondary CPUs
+ *
+ * This is used in tests, to check what happens when no CPU can take a job.
+ *
+ * @enable: true to run jobs on host threads (the default), false to refuse
+ */
+void cpu_sandbox_set_jobs(bool enable);
+
 #endif /* __SANDBOX_CPU_H */
@@ -7,6 +7,9 @@
 #ifndef _SETJMP_H_
 #define _SETJMP_H_
 
+#include <linux/compiler_attributes.h>
+#include <linux/types.h>
+
 struct jmp_buf_data {
 	/*
 	 * We're not sure how long this should be:
@@ -32,4 +35,19 @@ typedef struct jmp_buf_data jmp_buf[1];
 int setjmp(jmp_buf jmp);
 __noreturn void longjmp(jmp_buf jmp, int ret);
 
+/**
+ * initjmp() - prepare a jump buffer to start a function on a new stack
+ *
+ * A later longjmp() to @jmp calls @func with the stack pointer at the top of
+ * the given stack. @func must not return.
+ *
+ * @jmp:	jump buffer to set up
+ * @func:	function to call
+ * @stack_base:	lowest address of the stack
+ * @stack_sz:	size of the stack in bytes
+ * Return:	0 if OK, -ve on error
+ */
+int initjmp(jmp_buf jmp, void __noreturn (*func)(void), void *stack_base,
+	    size_t stack_sz);
+
 #endif /* _SETJMP_H_ */
@@ -61,6 +61,24 @@ struct sandbox_mapmem_entry {
 	struct list_head sibling_node;
 };
 
+/**
+ * struct sandbox_mmio - a block of emulated memory-mapped registers
+ *
+ * readl() and friends read the memory at @base directly, so the emulator keeps
+ * it up to date. Writes are stored there too, then passed to @write so that
+ * the emulator can act on them.
+ *
+ * @base: Start of the registers
+ * @size: Size of the block in bytes
+ * @write: Called after each write to the block, with the offset written
+ */
+struct sandbox_mmio {
+	void *base;
+	ulong size;
+	void (*write)(struct sandbox_mmio *mmio, ulong offset);
+	struct list_head sibling_node;
+};
+
 /* The complete state of the test system */
 struct sandbox_state {
 	const char *cmd;		/* Command to execute */
@@ -109,6 +127,7 @@ struct sandbox_state {
 	struct list_head mapmem_head;	/* struct sandbox_mapmem_entry */
 	bool hwspinlock;		/* Hardware Spinlock status */
 	bool allow_memio;		/* Allow readl() etc. to work */
+	struct list_head mmio_head;	/* struct sandbox_mmio */
 
 	void *other_fdt_buf;		/* 'other' FDT blob used by tests */
 	int other_size;			/* size of other FDT blob */
@@ -10,6 +10,7 @@
 
 #include <pci_ids.h>
 
+struct sandbox_mmio;
 struct unit_test_state;
 
 /* The sandbox driver always permits an I2C device with this address */
@@ -281,6 +282,36 @@ uint sandbox_pci_read_bar(u32 barval, int type, uint size);
  */
 void sandbox_set_enable_memio(bool enable);
 
+/**
+ * sandbox_mmio_add() - Start emulating a block of registers
+ *
+ * Once this is called, each writel() etc. within the block is passed to the
+ * emulator. Memory I/O must be enabled with sandbox_set_enable_memio().
+ *
+ * @mmio: Registers to emulate
+ */
+void sandbox_mmio_add(struct sandbox_mmio *mmio);
+
+/**
+ * sandbox_mmio_remove() - Stop emulating a block of registers
+ *
+ * @mmio: Registers previously passed to sandbox_mmio_add()
+ */
+void sandbox_mmio_remove(struct sandbox_mmio *mmio);
+
+/**
+ * sandbox_nvme_get_stats() - Find out how the NVMe emulator was used
+ *
+ * @dev: NVMe controller
+ * @io_count: Returns the number of I/O commands handled
+ * @max_batch: Returns the largest number of I/O commands handled for one
+ *	doorbell write
+ * @bad_completes: Returns the number of times the driver's completion hook
+ *	was given a command which had not just completed
+ */
+void sandbox_nvme_get_stats(struct udevice *dev, int *io_count, int *max_batch,
+			    int *bad_completes);
+
 /**
  * sandbox_cros_ec_set_test_flags() - Set behaviour for testing purposes
  *
@@ -25,6 +25,7 @@
 #include <linux/sizes.h>
 #include <tpm-v2.h>
 #include <tpm_tcg2.h>
+#include <video.h>
 #if defined(CONFIG_CMD_USB)
 #include <usb.h>
 #endif
@@ -251,13 +252,21 @@ static void boot_start_lmb(struct bootm_headers *images)
 	lmb_init_and_reserve_range(&images->lmb, mem_start,
 				   mem_size, NULL);
 }
+
+static void boot_stop_lmb(struct bootm_headers *images)
+{
+	lmb_uninit(&images->lmb);
+}
 #else
 #define lmb_reserve(lmb, base, size)
 static inline void boot_start_lmb(struct bootm_headers *images) { }
+static inline void boot_stop_lmb(struct bootm_headers *images) { }
 #endif
 
 static int bootm_start(void)
 {
+	/* the last bootm may have left region arrays on the heap */
+	boot_stop_lmb(&images);
 	memset((void *)&images, 0, sizeof(images));
 	images.verify = env_get_yesno("verify");
 
@@ -616,6 +625,49 @@ static int handle_decomp_error(int comp_type, size_t uncomp_size,
 #endif
 
 #ifndef USE_HOSTCC
+/* OS decompression started early by bootm_start_load_os() */
+static struct image_decomp_job bootm_os_job;
+static bool bootm_os_job_started;
+
+/**
+ * bootm_start_load_os() - start decompressing the OS on another CPU
+ *
+ * This lets the OS be decompressed while the other images are found and
+ * checked. It is not done when the OS might be decompressed over the image it
+ * came from, since the others are likely in there too.
+ *
+ * @images: Images information, with the OS found
+ */
+static void bootm_start_load_os(struct bootm_headers *images)
+{
+	struct image_info *os = &images->os;
+
+	if (!CONFIG_IS_ENABLED(CPU_JOBS) || os->type == IH_TYPE_KERNEL_NOLOAD)
+		return;
+	if (os->load < os->end && os->load + CONFIG_SYS_BOOTM_LEN > os->start)
+		return;
+
+	bootm_os_job_started = !image_decomp_start(&bootm_os_job, os->comp,
+			os->load, os->image_start, os->type,
+			map_sysmem(os->load, 0),
+			map_sysmem(os->image_start, os->image_len),
+			os->image_len, CONFIG_SYS_BOOTM_LEN);
+}
+
+/**
+ * bootm_abort_load_os() - wait for any OS decompression which is not wanted
+ *
+ * The other CPU must be finished with the memory before bootm gives up.
+ */
+static void bootm_abort_load_os(void)
+{
+	if (bootm_os_job_started) {
+		bootm_os_job_started = false;
+		cpu_job_wait(&bootm_os_job.job);
+		free(bootm_os_job.workspace);
+	}
+}
+
 static int bootm_load_os(struct bootm_headers *images, int boot_progress)
 {
 	struct image_info os = images->os;
@@ -651,9 +703,14 @@ static int bootm_load_os(struct bootm_headers *images, int boot_progress)
 
 	load_buf = map_sysmem(load, 0);
 	image_buf = map_sysmem(os.image_start, image_len);
-	err = image_decomp(os.comp, load, os.image_start, os.type,
-			   load_buf, image_buf, image_len,
-			   CONFIG_SYS_BOOTM_LEN, &load_end);
+	if (bootm_os_job_started) {
+		bootm_os_job_started = false;
+		err = image_decomp_wait(&bootm_os_job, &load_end);
+	} else {
+		err = image_decomp(os.comp, load, os.image_start, os.type,
+				   load_buf, image_buf, image_len,
+				   CONFIG_SYS_BOOTM_LEN, &load_end);
+	}
 	if (err) {
 		err = handle_decomp_error(os.comp, load_end - load,
 					  CONFIG_SYS_BOOTM_LEN, err);
@@ -1010,8 +1067,12 @@ int bootm_run_states(struct bootm_info *bmi, int states)
 	if (!ret && (states & BOOTM_STATE_PRE_LOAD))
 		ret = bootm_pre_load(bmi->addr_img);
 
-	if (!ret && (states & BOOTM_STATE_FINDOS))
+	if (!ret && (states & BOOTM_STATE_FINDOS)) {
 		ret = bootm_find_os(bmi->cmd_name, bmi->addr_img);
+		if (!ret && (states & BOOTM_STATE_FINDOTHER) &&
+		    (states & BOOTM_STATE_LOADOS))
+			bootm_start_load_os(images);
+	}
 
 	if (!ret && (states & BOOTM_STATE_FINDOTHER)) {
 		ulong img_addr;
@@ -1026,6 +1087,9 @@ int bootm_run_states(struct bootm_info *bmi, int states)
 	    (states & BOOTM_STATE_MEASURE))
 		bootm_measure(images);
 
+	if (ret)
+		bootm_abort_load_os();
+
 	/* Load the OS */
 	if (!ret && (states & BOOTM_STATE_LOADOS)) {
 		iflag = bootm_disable_interrupts();
@@ -1089,6 +1153,9 @@ int bootm_run_states(struct bootm_info *bmi, int states)
 			ret = CMD_RET_FAILURE;
 			goto err;
 		}
+		/* the OS finds the display at the frame-buffer base */
+		if (IS_ENABLED(CONFIG_VIDEO))
+			video_disable_pan_all();
 		ret = boot_fn(BOOTM_STATE_OS_PREP, bmi);
 	}
 
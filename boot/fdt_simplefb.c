@@ -42,6 +42,8 @@ static int fdt_simplefb_configure_node(void *blob, int off)
 		ret = uclass_first_device_err(UCLASS_VIDEO, &dev);
 		if (ret)
 			return ret;
+		/* the OS expects the display at the start of the memory */
+		video_disable_pan(dev);
 		uc_priv = dev_get_uclass_priv(dev);
 		plat = dev_get_uclass_plat(dev);
 		xsize = uc_priv->xsize;
@@ -1290,7 +1290,8 @@ int calculate_hash(const void *data, int data_len, const char *name,
 }
 
 static int fit_image_check_hash(const void *fit, int noffset, const void *data,
-				size_t size, char **err_msgp)
+				size_t size, struct fit_hash_stream *hs,
+				char **err_msgp)
 {
 	ALLOC_CACHE_ALIGN_BUFFER(uint8_t, value, FIT_MAX_HASH_LEN);
 	int value_len;
@@ -1298,6 +1299,7 @@ static int fit_image_check_hash(const void *fit, int noffset, const void *data,
 	uint8_t *fit_value;
 	int fit_value_len;
 	int ignore;
+	int i;
 
 	*err_msgp = NULL;
 
@@ -1321,7 +1323,19 @@ static int fit_image_check_hash(const void *fit, int noffset, const void *data,
 		return -1;
 	}
 
-	if (calculate_hash(data, size, algo, value, &value_len)) {
+	/* use the value worked out as the data arrived, if there is one */
+	for (i = 0; hs && i < hs->count; i++) {
+		if (hs->hash[i].noffset == noffset)
+			break;
+	}
+	if (hs && i < hs->count) {
+		value_len = hs->hash[i].value_len;
+		if (value_len < 0) {
+			*err_msgp = "Hash calculation failed";
+			return -1;
+		}
+		memcpy(value, hs->hash[i].value, value_len);
+	} else if (calculate_hash(data, size, algo, value, &value_len)) {
 		*err_msgp = "Unsupported hash algorithm";
 		return -1;
 	}
@@ -1337,15 +1351,110 @@ static int fit_image_check_hash(const void *fit, int noffset, const void *data,
 	return 0;
 }
 
-int fit_image_verify_with_data(const void *fit, int image_noffset,
-			       const void *key_blob, const void *data,
-			       size_t size)
+int fit_image_hash_stream_start(struct fit_hash_stream *hs, const void *fit,
+				int image_noffset)
+{
+	int noffset;
+
+	hs->count = 0;
+
+	/* calculate_hash() uses the hash uclass instead */
+	if (!tools_build() && IS_ENABLED(CONFIG_DM_HASH))
+		return -ENOSYS;
+
+	fdt_for_each_subnode(noffset, fit, image_noffset) {
+		const char *name = fit_get_name(fit, noffset, NULL);
+		struct fit_hash_stream_node *node;
+		const char *algo;
+		int ignore = 0;
+
+		if (strncmp(name, FIT_HASH_NODENAME, strlen(FIT_HASH_NODENAME)))
+			continue;
+		if (!tools_build())
+			fit_image_hash_get_ignore(fit, noffset, &ignore);
+		if (ignore)
+			continue;
+
+		/* leave anything unusual to fit_image_verify_with_data() */
+		if (hs->count == FIT_HASH_STREAM_MAX ||
+		    fit_image_hash_get_algo(fit, noffset, &algo))
+			goto err;
+		node = &hs->hash[hs->count];
+		if (hash_progressive_lookup_algo(algo, &node->algo) ||
+		    node->algo->hash_init(node->algo, &node->ctx))
+			goto err;
+		node->noffset = noffset;
+		node->value_len = 0;
+		hs->count++;
+	}
+
+	return 0;
+
+err:
+	fit_image_hash_stream_finish(hs);
+	hs->count = 0;
+
+	return -ENOSYS;
+}
+
+void fit_image_hash_stream_update(struct fit_hash_stream *hs, const void *data,
+				  size_t size)
+{
+	int i;
+
+	while (size) {
+		size_t chunk = size < CHUNKSZ ? size : CHUNKSZ;
+
+		for (i = 0; i < hs->count; i++) {
+			struct fit_hash_stream_node *node = &hs->hash[i];
+
+			if (!node->ctx)
+				continue;
+			/* the context is freed on error */
+			if (node->algo->hash_update(node->algo, node->ctx, data,
+						    chunk, 0)) {
+				node->ctx = NULL;
+				node->value_len = -1;
+			}
+		}
+		data += chunk;
+		size -= chunk;
+#ifndef USE_HOSTCC
+		schedule();
+#endif
+	}
+}
+
+void fit_image_hash_stream_finish(struct fit_hash_stream *hs)
+{
+	int i;
+
+	for (i = 0; i < hs->count; i++) {
+		struct fit_hash_stream_node *node = &hs->hash[i];
+
+		if (!node->ctx)
+			continue;
+		if (node->algo->hash_finish(node->algo, node->ctx, node->value,
+					    sizeof(node->value)))
+			node->value_len = -1;
+		else
+			node->value_len = node->algo->digest_size;
+		node->ctx = NULL;
+	}
+}
+
+int fit_image_verify_stream(const void *fit, int image_noffset,
+			    const void *key_blob, const void *data,
+			    size_t size, struct fit_hash_stream *hs)
 {
 	int		noffset = 0;
 	char		*err_msg = "";
 	int verify_all = 1;
 	int ret;
 
+	if (hs)
+		fit_image_hash_stream_finish(hs);
+
 	/* Verify all required signatures */
 	if (FIT_IMAGE_ENABLE_VERIFY &&
 	    fit_image_verify_required_sigs(fit, image_noffset, data, size,
@@ -1365,7 +1474,7 @@ int fit_image_verify_with_data(const void *fit, int image_noffset,
 		 */
 		if (!strncmp(name, FIT_HASH_NODENAME,
 			     strlen(FIT_HASH_NODENAME))) {
-			if (fit_image_check_hash(fit, noffset, data, size,
+			if (fit_image_check_hash(fit, noffset, data, size, hs,
 						 &err_msg))
 				goto error;
 			puts("+ ");
@@ -1402,6 +1511,22 @@ error:
 	return 0;
 }
 
+int fit_image_verify_with_data(const void *fit, int image_noffset,
+			       const void *key_blob, const void *data,
+			       size_t size)
+{
+	struct fit_hash_stream hs;
+
+	/* work out all the hashes in one pass over the data */
+	if (fit_image_hash_stream_start(&hs, fit, image_noffset))
+		return fit_image_verify_stream(fit, image_noffset, key_blob,
+					       data, size, NULL);
+	fit_image_hash_stream_update(&hs, data, size);
+
+	return fit_image_verify_stream(fit, image_noffset, key_blob, data,
+				       size, &hs);
+}
+
 /**
  * fit_image_verify - verify data integrity
  * @fit: pointer to the FIT format image header
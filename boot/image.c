@@ -539,6 +539,129 @@ int image_decomp(int comp, ulong load, ulong image_start, int type,
 	return 0;
 }
 
+#ifndef USE_HOSTCC
+/* Formats whose decompressor needs no U-Boot services, given a workspace */
+static bool image_decomp_job_ok(int comp)
+{
+	switch (comp) {
+	case IH_COMP_NONE:
+		return true;
+	case IH_COMP_LZO:
+		return CONFIG_IS_ENABLED(LZO);
+	case IH_COMP_LZ4:
+		return CONFIG_IS_ENABLED(LZ4);
+	case IH_COMP_ZSTD:
+		return CONFIG_IS_ENABLED(ZSTD);
+	default:
+		return false;
+	}
+}
+
+/* This runs on another CPU, so must not print, allocate or schedule() */
+static int image_decomp_job_func(void *arg)
+{
+	struct image_decomp_job *dj = arg;
+	size_t size = dj->unc_len;
+	int ret = -ENOSYS;
+
+	switch (dj->comp) {
+	case IH_COMP_NONE:
+		if (dj->image_len > dj->unc_len)
+			return -ENOSPC;
+		memmove(dj->load_buf, dj->image_buf, dj->image_len);
+		return 0;
+	case IH_COMP_LZO:
+		if (CONFIG_IS_ENABLED(LZO))
+			ret = lzop_decompress(dj->image_buf, dj->image_len,
+					      dj->load_buf, &size);
+		break;
+	case IH_COMP_LZ4:
+		if (CONFIG_IS_ENABLED(LZ4))
+			ret = ulz4fn(dj->image_buf, dj->image_len, dj->load_buf,
+				     &size);
+		break;
+	case IH_COMP_ZSTD:
+		if (CONFIG_IS_ENABLED(ZSTD)) {
+			struct abuf in, out;
+			zstd_dctx *ctx;
+
+			ctx = zstd_init_dctx(dj->workspace,
+					     zstd_dctx_workspace_bound());
+			if (!ctx)
+				return -EPERM;
+			abuf_init_set(&in, dj->image_buf, dj->image_len);
+			abuf_init_set(&out, dj->load_buf, dj->unc_len);
+			ret = zstd_decompress_ctx(ctx, &in, &out);
+			if (ret < 0)
+				return ret;
+			size = ret;
+			ret = 0;
+		}
+		break;
+	}
+	dj->image_len = size;
+
+	return ret;
+}
+
+int image_decomp_start(struct image_decomp_job *dj, int comp, ulong load,
+		       ulong image_start, int type, void *load_buf,
+		       void *image_buf, ulong image_len, uint unc_len)
+{
+	int ret;
+
+	dj->comp = comp;
+	dj->load = load;
+	dj->image_start = image_start;
+	dj->type = type;
+	dj->load_buf = load_buf;
+	dj->image_buf = image_buf;
+	dj->image_len = image_len;
+	dj->unc_len = unc_len;
+	dj->workspace = NULL;
+	cpu_job_init(&dj->job, image_decomp_job_func, dj);
+
+	if (!CONFIG_IS_ENABLED(CPU_JOBS) || !image_decomp_job_ok(comp) ||
+	    (comp == IH_COMP_NONE && load == image_start))
+		return -EBUSY;
+
+	if (comp == IH_COMP_ZSTD) {
+		dj->workspace = malloc(zstd_dctx_workspace_bound());
+		if (!dj->workspace)
+			return -ENOMEM;
+	}
+
+	ret = cpu_job_start(&dj->job);
+	if (ret) {
+		free(dj->workspace);
+		dj->workspace = NULL;
+		return ret;
+	}
+
+	return 0;
+}
+
+int image_decomp_wait(struct image_decomp_job *dj, ulong *load_end)
+{
+	int ret;
+
+	if (!dj->job.cpu)
+		return image_decomp(dj->comp, dj->load, dj->image_start,
+				    dj->type, dj->load_buf, dj->image_buf,
+				    dj->image_len, dj->unc_len, load_end);
+
+	print_decomp_msg(dj->comp, dj->type, false, dj->load);
+	ret = cpu_job_wait(&dj->job);
+	free(dj->workspace);
+	dj->workspace = NULL;
+	if (ret && dj->comp == IH_COMP_ZSTD)
+		log_err("%s: failed to decompress: %d\n", __func__, ret);
+	*load_end = dj->load + dj->image_len;
+
+	return ret;
+}
+#endif /* !USE_HOSTCC */
+
 const table_entry_t *get_table_entry(const table_entry_t *table, int id)
 {
 	for (; table->id >= 0; ++table) {
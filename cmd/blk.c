@@ -0,0 +1,124 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Block device benchmark and read-ahead control
+ */
+
+#include <blk.h>
+#include <command.h>
+#include <display_options.h>
+#include <mapmem.h>
+#include <time.h>
+#include <vsprintf.h>
+#include <linux/math64.h>
+
+static struct blk_desc *blk_cmd_get_desc(char *const argv[])
+{
+	struct blk_desc *desc;
+	int devnum;
+
+	devnum = dectoul(argv[2], NULL);
+	desc = blk_get_devnum_by_uclass_idname(argv[1], devnum);
+	if (!desc)
+		printf("Found no device matching \"%s %d\"\n", argv[1], devnum);
+
+	return desc;
+}
+
+static int do_blk_bench(struct cmd_tbl *cmdtp, int flag, int argc,
+			char *const argv[])
+{
+	struct blk_readahead *ra;
+	struct blk_desc *desc;
+	lbaint_t blk, cnt, chunk, done;
+	ulong addr, time;
+	u64 bytes;
+	void *buf;
+
+	if (argc < 6)
+		return CMD_RET_USAGE;
+
+	desc = blk_cmd_get_desc(argv);
+	if (!desc)
+		return CMD_RET_FAILURE;
+	addr = hextoul(argv[3], NULL);
+	blk = hextoul(argv[4], NULL);
+	cnt = hextoul(argv[5], NULL);
+	chunk = argc > 6 ? hextoul(argv[6], NULL) : cnt;
+	if (!cnt || !chunk)
+		return CMD_RET_USAGE;
+
+	/* start cold, so that only this run is measured */
+	blkcache_invalidate(desc->uclass_id, desc->devnum);
+	blk_readahead_invalidate(desc->bdev);
+	ra = blk_readahead_get(desc->bdev);
+	if (ra) {
+		ra->issued = 0;
+		ra->hits = 0;
+	}
+
+	bytes = (u64)cnt * desc->blksz;
+	buf = map_sysmem(addr, bytes);
+	time = get_timer(0);
+	for (done = 0; done < cnt; done += chunk) {
+		lbaint_t count = min(chunk, cnt - done);
+
+		if (blk_dread(desc, blk + done, count,
+			      buf + done * desc->blksz) != count) {
+			unmap_sysmem(buf);
+			printf("Read failed at block " LBAFU "\n", blk + done);
+			return CMD_RET_FAILURE;
+		}
+	}
+	time = get_timer(time);
+	unmap_sysmem(buf);
+
+	printf("%llu bytes read in %lu ms", bytes, time);
+	if (time > 0) {
+		puts(" (");
+		print_size(div_u64(bytes, time) * 1000, "/s");
+		puts(")");
+	}
+	puts("\n");
+	if (ra)
+		printf("read-ahead: window %lu bytes, %lu blocks read ahead, %lu used\n",
+		       ra->size, ra->issued, ra->hits);
+
+	return CMD_RET_SUCCESS;
+}
+
+static int do_blk_readahead(struct cmd_tbl *cmdtp, int flag, int argc,
+			    char *const argv[])
+{
+	struct blk_readahead *ra;
+	struct blk_desc *desc;
+
+	if (argc < 3)
+		return CMD_RET_USAGE;
+
+	desc = blk_cmd_get_desc(argv);
+	if (!desc)
+		return CMD_RET_FAILURE;
+
+	if (argc > 3 &&
+	    blk_readahead_set_size(desc->bdev, hextoul(argv[3], NULL))) {
+		printf("Read-ahead is not available\n");
+		return CMD_RET_FAILURE;
+	}
+
+	ra = blk_readahead_get(desc->bdev);
+	if (!ra) {
+		printf("Read-ahead is not available\n");
+		return CMD_RET_FAILURE;
+	}
+	printf("read-ahead window: %lu bytes\n", ra->size);
+
+	return CMD_RET_SUCCESS;
+}
+
+U_BOOT_CMD_WITH_SUBCMDS(
+	blk, "Block device benchmark and read-ahead control",
+	"bench <interface> <dev> <addr> <blk#> <cnt> [<chunk>] - time reading\n"
+	"    <cnt> blocks to <addr>, <chunk> blocks at a time\n"
+	"blk readahead <interface> <dev> [<size>] - show or set read-ahead window\n",
+	U_BOOT_SUBCMD_MKENT(bench, 7, 1, do_blk_bench),
+	U_BOOT_SUBCMD_MKENT(readahead, 4, 1, do_blk_readahead));
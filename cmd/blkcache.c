@@ -13,37 +13,57 @@
 static int blkc_show(struct cmd_tbl *cmdtp, int flag,
 		     int argc, char *const argv[])
 {
+	struct block_cache_dev_stats dstats;
 	struct block_cache_stats stats;
+	int i;
+
 	blkcache_stats(&stats);
 
 	printf("hits: %u\n"
+	       "partial hits: %u\n"
 	       "misses: %u\n"
 	       "entries: %u\n"
+	       "bytes: %lu\n"
 	       "max blocks/entry: %u\n"
-	       "max cache entries: %u\n",
-	       stats.hits, stats.misses, stats.entries,
-	       stats.max_blocks_per_entry, stats.max_entries);
+	       "max cache entries: %u\n"
+	       "max cache bytes: %lu\n",
+	       stats.hits, stats.partial, stats.misses, stats.entries,
+	       stats.bytes, stats.max_blocks_per_entry, stats.max_entries,
+	       stats.max_bytes);
+
+	for (i = 0; !blkcache_dev_stats(i, &dstats); i++)
+		printf("%s %d: hits %u, partial %u, misses %u, entries %u, bytes %lu\n",
+		       blk_get_uclass_name(dstats.iftype), dstats.devnum,
+		       dstats.hits, dstats.partial, dstats.misses,
+		       dstats.entries, dstats.bytes);
+
 	return 0;
 }
 
 static int blkc_configure(struct cmd_tbl *cmdtp, int flag,
 			  int argc, char *const argv[])
 {
+	struct block_cache_stats stats;
 	unsigned blocks_per_entry, max_entries;
-	if (argc != 3)
+	ulong max_bytes;
+
+	if (argc != 3 && argc != 4)
 		return CMD_RET_USAGE;
 
+	blkcache_stats(&stats);
 	blocks_per_entry = simple_strtoul(argv[1], 0, 0);
 	max_entries = simple_strtoul(argv[2], 0, 0);
-	blkcache_configure(blocks_per_entry, max_entries);
-	printf("changed to max of %u entries of %u blocks each\n",
-	       max_entries, blocks_per_entry);
+	max_bytes = argc > 3 ? simple_strtoul(argv[3], 0, 0) : stats.max_bytes;
+	blkcache_configure(blocks_per_entry, max_entries, max_bytes);
+	blkcache_stats(&stats);
+	printf("changed to max of %u entries of %u blocks each, %lu bytes\n",
+	       stats.max_entries, stats.max_blocks_per_entry, stats.max_bytes);
 	return 0;
 }
 
 static struct cmd_tbl cmd_blkc_sub[] = {
 	U_BOOT_CMD_MKENT(show, 0, 0, blkc_show, "", ""),
-	U_BOOT_CMD_MKENT(configure, 3, 0, blkc_configure, "", ""),
+	U_BOOT_CMD_MKENT(configure, 4, 0, blkc_configure, "", ""),
 };
 
 static int do_blkcache(struct cmd_tbl *cmdtp, int flag,
@@ -67,9 +87,9 @@ static int do_blkcache(struct cmd_tbl *cmdtp, int flag,
 }
 
 U_BOOT_CMD(
-	blkcache, 4, 0, do_blkcache,
+	blkcache, 5, 0, do_blkcache,
 	"block cache diagnostics and control",
 	"show - show and reset statistics\n"
-	"blkcache configure <blocks> <entries> "
-	"- set max blocks per entry and max cache entries\n"
+	"blkcache configure <blocks> <entries> [<bytes>] "
+	"- set max blocks per entry, max cache entries and max cache bytes\n"
 );
@@ -75,10 +75,35 @@ static int do_cyclic_list(struct cmd_tbl *cmdtp, int flag, int argc,
 	return 0;
 }
 
+static int do_cyclic_hist(struct cmd_tbl *cmdtp, int flag, int argc,
+			  char *const argv[])
+{
+	struct cyclic_info *cyclic;
+	int i;
+
+	hlist_for_each_entry(cyclic, cyclic_get_list(), list) {
+		printf("function: %s, calls: %lld\n", cyclic->name,
+		       cyclic->run_cnt);
+		printf("  time (us)   cpu-time    lateness\n");
+		for (i = 0; i < CYCLIC_HIST_BUCKETS; i++) {
+			if (i < CYCLIC_HIST_BUCKETS - 1)
+				printf("  < %-8llu", CYCLIC_HIST_LIMIT(i));
+			else
+				printf("  >= %-7llu", CYCLIC_HIST_LIMIT(i - 1));
+			printf(" %10u  %10u\n", cyclic->cpu_hist[i],
+			       cyclic->late_hist[i]);
+		}
+	}
+
+	return 0;
+}
+
 U_BOOT_LONGHELP(cyclic,
 	"demo <cycletime_ms> <delay_us> - register cyclic demo function\n"
-	"cyclic list - list cyclic functions\n");
+	"cyclic list - list cyclic functions\n"
+	"cyclic hist - show histograms of cpu-time and lateness per call\n");
 
 U_BOOT_CMD_WITH_SUBCMDS(cyclic, "Cyclic", cyclic_help_text,
 	U_BOOT_SUBCMD_MKENT(demo, 3, 1, do_cyclic_demo),
-	U_BOOT_SUBCMD_MKENT(list, 1, 1, do_cyclic_list));
+	U_BOOT_SUBCMD_MKENT(list, 1, 1, do_cyclic_list),
+	U_BOOT_SUBCMD_MKENT(hist, 1, 1, do_cyclic_hist));
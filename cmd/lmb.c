@@ -0,0 +1,112 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Logical memory block dump and benchmark
+ */
+
+#include <command.h>
+#include <lmb.h>
+#include <malloc.h>
+#include <time.h>
+#include <vsprintf.h>
+#include <asm/global_data.h>
+#include <linux/sizes.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+/* Number of allocations made by 'lmb bench' unless given */
+#define LMB_BENCH_COUNT		1000
+
+static u32 lmb_bench_seed;
+
+static phys_size_t lmb_bench_size(int max_pages)
+{
+	lmb_bench_seed = lmb_bench_seed * 1103515245 + 12345;
+
+	return (1 + (lmb_bench_seed >> 16) % max_pages) * SZ_4K;
+}
+
+/*
+ * Allocate @count blocks, free every other one, then allocate @count / 2
+ * larger blocks into the holes left
+ */
+static void lmb_bench_run(bool best_fit, int count, phys_addr_t *addr,
+			  phys_size_t *size)
+{
+	int i, failed = 0;
+	struct lmb lmb;
+	ulong time;
+
+	lmb_init_and_reserve(&lmb, gd->bd, (void *)gd->fdt_blob);
+	lmb.best_fit = best_fit;
+	lmb_bench_seed = 1;
+
+	time = timer_get_us();
+	for (i = 0; i < count; i++) {
+		size[i] = lmb_bench_size(8);
+		addr[i] = __lmb_alloc_base(&lmb, size[i], SZ_4K, 0);
+		if (!addr[i])
+			failed++;
+	}
+	for (i = 0; i < count; i += 2) {
+		if (addr[i])
+			lmb_free(&lmb, addr[i], size[i]);
+	}
+	for (i = 0; i < count; i += 2) {
+		if (!__lmb_alloc_base(&lmb, lmb_bench_size(16), SZ_4K, 0))
+			failed++;
+	}
+	time = timer_get_us() - time;
+
+	printf("%-9s %d allocations, %d frees in %lu us, %d failed, %lu reserved regions\n",
+	       best_fit ? "best-fit:" : "top-down:", count + (count + 1) / 2,
+	       (count + 1) / 2, time, failed, lmb.reserved.cnt);
+	lmb_uninit(&lmb);
+}
+
+static int do_lmb_bench(struct cmd_tbl *cmdtp, int flag, int argc,
+			char *const argv[])
+{
+	int count = LMB_BENCH_COUNT;
+	phys_size_t *size;
+	phys_addr_t *addr;
+
+	if (argc > 1)
+		count = dectoul(argv[1], NULL);
+	if (count <= 0)
+		return CMD_RET_USAGE;
+
+	addr = calloc(count, sizeof(*addr));
+	size = calloc(count, sizeof(*size));
+	if (!addr || !size) {
+		free(addr);
+		free(size);
+		printf("Out of memory\n");
+		return CMD_RET_FAILURE;
+	}
+
+	lmb_bench_run(false, count, addr, size);
+	lmb_bench_run(true, count, addr, size);
+	free(addr);
+	free(size);
+
+	return CMD_RET_SUCCESS;
+}
+
+static int do_lmb_dump(struct cmd_tbl *cmdtp, int flag, int argc,
+		       char *const argv[])
+{
+	struct lmb lmb;
+
+	lmb_init_and_reserve(&lmb, gd->bd, (void *)gd->fdt_blob);
+	lmb_dump_all_force(&lmb);
+	lmb_uninit(&lmb);
+
+	return CMD_RET_SUCCESS;
+}
+
+U_BOOT_CMD_WITH_SUBCMDS(
+	lmb, "Logical memory block dump and benchmark",
+	"bench [<count>] - time <count> allocations, top-down and best-fit\n"
+	"lmb dump - show memory and reserved regions\n",
+	U_BOOT_SUBCMD_MKENT(bench, 2, 1, do_lmb_bench),
+	U_BOOT_SUBCMD_MKENT(dump, 1, 1, do_lmb_dump));
@@ -13,7 +13,9 @@
 #include <part.h>
 #include <sparse_format.h>
 #include <image-sparse.h>
+#include <time.h>
 #include <vsprintf.h>
+#include <linux/math64.h>
 
 static int curr_device = -1;
 
@@ -57,6 +59,7 @@ static void print_mmcinfo(struct mmc *mmc)
 
 	printf("Bus Width: %d-bit%s\n", mmc->bus_width,
 			mmc->ddr_mode ? " DDR" : "");
+	printf("CMD23: %s\n", mmc->cmd23 ? "Yes" : "No");
 
 #if CONFIG_IS_ENABLED(MMC_WRITE)
 	puts("Erase Group Size: ");
@@ -344,11 +347,24 @@ static int do_mmcrpmb(struct cmd_tbl *cmdtp, int flag,
 }
 #endif
 
+/* Show how long a transfer took and the data rate achieved */
+static void print_mmc_rate(struct mmc *mmc, u32 cnt, ulong time)
+{
+	u64 bytes = (u64)cnt * mmc_get_blk_desc(mmc)->blksz;
+
+	printf(" in %lu ms", time);
+	if (time) {
+		puts(" (");
+		print_size(div_u64(bytes * 1000, time), "/s)");
+	}
+}
+
 static int do_mmc_read(struct cmd_tbl *cmdtp, int flag,
 		       int argc, char *const argv[])
 {
 	struct mmc *mmc;
 	u32 blk, cnt, n;
+	ulong time;
 	void *addr;
 
 	if (argc != 4)
@@ -365,8 +381,13 @@ static int do_mmc_read(struct cmd_tbl *cmdtp, int flag,
 	printf("\nMMC read: dev # %d, block # %d, count %d ... ",
 	       curr_device, blk, cnt);
 
+	time = get_timer(0);
 	n = blk_dread(mmc_get_blk_desc(mmc), blk, cnt, addr);
-	printf("%d blocks read: %s\n", n, (n == cnt) ? "OK" : "ERROR");
+	time = get_timer(time);
+	printf("%d blocks read: %s", n, (n == cnt) ? "OK" : "ERROR");
+	if (n == cnt)
+		print_mmc_rate(mmc, n, time);
+	puts("\n");
 
 	return (n == cnt) ? CMD_RET_SUCCESS : CMD_RET_FAILURE;
 }
@@ -442,6 +463,7 @@ static int do_mmc_write(struct cmd_tbl *cmdtp, int flag,
 {
 	struct mmc *mmc;
 	u32 blk, cnt, n;
+	ulong time;
 	void *addr;
 
 	if (argc != 4)
@@ -462,12 +484,37 @@ static int do_mmc_write(struct cmd_tbl *cmdtp, int flag,
 		printf("Error: card is write protected!\n");
 		return CMD_RET_FAILURE;
 	}
+	time = get_timer(0);
 	n = blk_dwrite(mmc_get_blk_desc(mmc), blk, cnt, addr);
-	printf("%d blocks written: %s\n", n, (n == cnt) ? "OK" : "ERROR");
+	time = get_timer(time);
+	printf("%d blocks written: %s", n, (n == cnt) ? "OK" : "ERROR");
+	if (n == cnt)
+		print_mmc_rate(mmc, n, time);
+	puts("\n");
 
 	return (n == cnt) ? CMD_RET_SUCCESS : CMD_RET_FAILURE;
 }
 
+static int do_mmc_reliable(struct cmd_tbl *cmdtp, int flag,
+			   int argc, char *const argv[])
+{
+	struct mmc *mmc;
+
+	mmc = init_mmc_device(curr_device, false);
+	if (!mmc)
+		return CMD_RET_FAILURE;
+
+	if (argc > 1) {
+		if (mmc_set_rel_write(mmc, !strcmp(argv[1], "on"))) {
+			printf("Reliable write is not supported\n");
+			return CMD_RET_FAILURE;
+		}
+	}
+	printf("Reliable write: %s\n", mmc->rel_write ? "on" : "off");
+
+	return CMD_RET_SUCCESS;
+}
+
 static int do_mmc_erase(struct cmd_tbl *cmdtp, int flag,
 			int argc, char *const argv[])
 {
@@ -1204,6 +1251,7 @@ static struct cmd_tbl cmd_mmc[] = {
 #if CONFIG_IS_ENABLED(MMC_WRITE)
 	U_BOOT_CMD_MKENT(write, 4, 0, do_mmc_write, "", ""),
 	U_BOOT_CMD_MKENT(erase, 3, 0, do_mmc_erase, "", ""),
+	U_BOOT_CMD_MKENT(reliable, 2, 0, do_mmc_reliable, "", ""),
 #endif
 #if CONFIG_IS_ENABLED(CMD_MMC_SWRITE)
 	U_BOOT_CMD_MKENT(swrite, 3, 0, do_mmc_sparse_write, "", ""),
@@ -1271,6 +1319,7 @@ U_BOOT_CMD(
 	"mmc swrite addr blk#\n"
 #endif
 	"mmc erase blk# cnt\n"
+	"mmc reliable [on|off] - show or set reliable writes (eMMC, CMD23)\n"
 	"mmc rescan [mode]\n"
 	"mmc part - lists available partition on current mmc device\n"
 	"mmc dev [dev] [part] [mode] - show or set current mmc device [partition] and set mode\n"
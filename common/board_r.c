@@ -232,6 +232,7 @@ static int initr_dm(void)
 
 	/* Drop the pre-reloc driver model and start a new one */
 	gd->dm_root = NULL;
+	gd_set_dm_compat_hash(NULL);
 #ifdef CONFIG_TIMER
 	gd->timer = NULL;
 #endif
@@ -12,7 +12,9 @@
 #include <log.h>
 #include <malloc.h>
 #include <time.h>
+#include <linux/bitops.h>
 #include <linux/errno.h>
+#include <linux/kernel.h>
 #include <linux/list.h>
 #include <asm/global_data.h>
 
@@ -26,6 +28,32 @@ struct hlist_head *cyclic_get_list(void)
 	return (struct hlist_head *)&gd->cyclic_list;
 }
 
+/* Add a cyclic function to the list, after any which are due no later */
+static void cyclic_insert(struct cyclic_info *cyclic)
+{
+	struct cyclic_info *pos, *last = NULL;
+
+	hlist_for_each_entry(pos, cyclic_get_list(), list) {
+		if (time_before64(cyclic->next_call, pos->next_call)) {
+			hlist_add_before(&cyclic->list, &pos->list);
+			return;
+		}
+		last = pos;
+	}
+
+	if (last)
+		hlist_add_after(&last->list, &cyclic->list);
+	else
+		hlist_add_head(&cyclic->list, cyclic_get_list());
+}
+
+static void cyclic_hist_add(u32 *hist, uint64_t time_us)
+{
+	uint bucket = fls64(time_us) / 2;
+
+	hist[min_t(uint, bucket, CYCLIC_HIST_BUCKETS - 1)]++;
+}
+
 void cyclic_register(struct cyclic_info *cyclic, cyclic_func_t func,
 		     uint64_t delay_us, const char *name)
 {
@@ -36,7 +64,7 @@ void cyclic_register(struct cyclic_info *cyclic, cyclic_func_t func,
 	cyclic->name = name;
 	cyclic->delay_us = delay_us;
 	cyclic->start_time_us = timer_get_us();
-	hlist_add_head(&cyclic->list, cyclic_get_list());
+	cyclic_insert(cyclic);
 }
 
 void cyclic_unregister(struct cyclic_info *cyclic)
@@ -46,42 +74,75 @@ void cyclic_unregister(struct cyclic_info *cyclic)
 
 void cyclic_run(void)
 {
+	struct hlist_node *node, *last = NULL;
 	struct cyclic_info *cyclic;
-	struct hlist_node *tmp;
-	uint64_t now, cpu_time;
+	uint64_t now, start, cpu_time;
+	HLIST_HEAD(due);
 
 	/* Prevent recursion */
 	if (gd->flags & GD_FLG_CYCLIC_RUNNING)
 		return;
 
+	/* The list is ordered by next_call, so check the first one only */
+	node = cyclic_get_list()->first;
+	if (!node)
+		return;
+	now = timer_get_us();
+	if (time_before64(now, hlist_entry(node, struct cyclic_info,
+					   list)->next_call))
+		return;
+
 	gd->flags |= GD_FLG_CYCLIC_RUNNING;
-	hlist_for_each_entry_safe(cyclic, tmp, cyclic_get_list(), list) {
-		/*
-		 * Check if this cyclic function needs to get called, e.g.
-		 * do not call the cyclic func too often
-		 */
-		now = timer_get_us();
-		if (time_after_eq64(now, cyclic->next_call)) {
-			/* Call cyclic function and account it's cpu-time */
-			cyclic->next_call = now + cyclic->delay_us;
-			cyclic->func(cyclic);
-			cyclic->run_cnt++;
-			cpu_time = timer_get_us() - now;
-			cyclic->cpu_time_us += cpu_time;
-
-			/* Check if cpu-time exceeds max allowed time */
-			if ((cpu_time > CONFIG_CYCLIC_MAX_CPU_TIME_US) &&
-			    (!cyclic->already_warned)) {
-				pr_err("cyclic function %s took too long: %lldus vs %dus max\n",
-				       cyclic->name, cpu_time,
-				       CONFIG_CYCLIC_MAX_CPU_TIME_US);
-
-				/*
-				 * Don't disable this function, just warn once
-				 * about this exceeding CPU time usage
-				 */
-				cyclic->already_warned = true;
-			}
+
+	/*
+	 * Move the functions which are due to a list of their own, so that
+	 * each is called only once here even if its delay is very short
+	 */
+	while ((node = cyclic_get_list()->first)) {
+		cyclic = hlist_entry(node, struct cyclic_info, list);
+		if (time_before64(now, cyclic->next_call))
+			break;
+		hlist_del(node);
+		if (last)
+			hlist_add_after(last, node);
+		else
+			hlist_add_head(node, &due);
+		last = node;
+	}
+
+	/*
+	 * Each function goes back into the ordered list before it is called,
+	 * so it may unregister itself or others
+	 */
+	while ((node = due.first)) {
+		cyclic = hlist_entry(node, struct cyclic_info, list);
+		hlist_del(node);
+
+		/* Call cyclic function and account it's cpu-time */
+		start = timer_get_us();
+		if (cyclic->run_cnt)
+			cyclic_hist_add(cyclic->late_hist,
+					start - cyclic->next_call);
+		cyclic->next_call = start + cyclic->delay_us;
+		cyclic_insert(cyclic);
+		cyclic->func(cyclic);
+		cyclic->run_cnt++;
+		cpu_time = timer_get_us() - start;
+		cyclic->cpu_time_us += cpu_time;
+		cyclic_hist_add(cyclic->cpu_hist, cpu_time);
+
+		/* Check if cpu-time exceeds max allowed time */
+		if ((cpu_time > CONFIG_CYCLIC_MAX_CPU_TIME_US) &&
+		    (!cyclic->already_warned)) {
+			pr_err("cyclic function %s took too long: %lldus vs %dus max\n",
+			       cyclic->name, cpu_time,
+			       CONFIG_CYCLIC_MAX_CPU_TIME_US);
+
+			/*
+			 * Don't disable this function, just warn once
+			 * about this exceeding CPU time usage
+			 */
+			cyclic->already_warned = true;
 		}
 	}
 	gd->flags &= ~GD_FLG_CYCLIC_RUNNING;
@@ -22,6 +22,7 @@
 #include <linux/errno.h>
 #else
 #include "mkimage.h"
+#include <arpa/inet.h>
 #include <linux/compiler_attributes.h>
 #include <time.h>
 #include <linux/kconfig.h>
@@ -162,10 +163,14 @@ static int hash_update_crc16_ccitt(struct hash_algo *algo, void *ctx,
 static int hash_finish_crc16_ccitt(struct hash_algo *algo, void *ctx,
 				   void *dest_buf, int size)
 {
+	uint16_t crc;
+
 	if (size < algo->digest_size)
 		return -1;
 
-	*((uint16_t *)dest_buf) = *((uint16_t *)ctx);
+	/* big-endian, the same as hash_func_ws() */
+	crc = htons(*((uint16_t *)ctx));
+	memcpy(dest_buf, &crc, sizeof(crc));
 	free(ctx);
 	return 0;
 }
@@ -189,10 +194,14 @@ static int __maybe_unused hash_update_crc32(struct hash_algo *algo, void *ctx,
 static int __maybe_unused hash_finish_crc32(struct hash_algo *algo, void *ctx,
 					    void *dest_buf, int size)
 {
+	uint32_t crc;
+
 	if (size < algo->digest_size)
 		return -1;
 
-	*((uint32_t *)dest_buf) = *((uint32_t *)ctx);
+	/* big-endian, the same as hash_func_ws() */
+	crc = htonl(*((uint32_t *)ctx));
+	memcpy(dest_buf, &crc, sizeof(crc));
 	free(ctx);
 	return 0;
 }
@@ -9,14 +9,18 @@
 #include <gzip.h>
 #include <image.h>
 #include <log.h>
+#include <malloc.h>
 #include <memalign.h>
 #include <mapmem.h>
 #include <spl.h>
 #include <sysinfo.h>
 #include <asm/global_data.h>
 #include <asm/io.h>
+#include <asm/unaligned.h>
 #include <linux/libfdt.h>
 #include <linux/printk.h>
+#include <lzma/LzmaDec.h>
+#include <u-boot/zlib.h>
 
 DECLARE_GLOBAL_DATA_PTR;
 
@@ -186,6 +190,353 @@ static int get_aligned_image_size(struct spl_load_info *info, int data_size,
 	return ALIGN(data_size, spl_get_bl_len(info));
 }
 
+#if CONFIG_IS_ENABLED(FIT_HASH_STREAM)
+/**
+ * spl_fit_read_hashed() - read external image data, hashing it as it arrives
+ *
+ * @info:	points to information about the device to load data from
+ * @offset:	offset to read from, aligned to the block length
+ * @size:	number of bytes to read, aligned to the block length
+ * @buf:	buffer to read into
+ * @overhead:	number of bytes at the start of @buf before the image data
+ * @length:	length of the image data
+ * @hs:		hash stream to add the image data to
+ * Return:	0 on success, -EIO on a read error
+ */
+static int spl_fit_read_hashed(struct spl_load_info *info, ulong offset,
+			       ulong size, void *buf, ulong overhead,
+			       ulong length, struct fit_hash_stream *hs)
+{
+	ulong chunk = ALIGN(CONFIG_VAL(FIT_HASH_STREAM_CHUNK),
+			    spl_get_bl_len(info));
+	ulong end = overhead + length;
+	ulong pos;
+
+	for (pos = 0; pos < size; pos += chunk) {
+		ulong count = min(chunk, size - pos);
+		ulong start = max(pos, overhead);
+		ulong stop = min(end, pos + count);
+
+		/* the read may stop short of the block-aligned size */
+		if (info->read(info, offset + pos, count, buf + pos) <
+		    stop - pos)
+			return -EIO;
+		fit_image_hash_stream_update(hs, buf + start, stop - start);
+	}
+
+	return 0;
+}
+#else
+static int spl_fit_read_hashed(struct spl_load_info *info, ulong offset,
+			       ulong size, void *buf, ulong overhead,
+			       ulong length, struct fit_hash_stream *hs)
+{
+	return -ENOSYS;
+}
+#endif
+
+#if CONFIG_IS_ENABLED(FIT_DECOMP_STREAM)
+/* LZMA header: properties followed by the 64-bit uncompressed size */
+#define SPL_FIT_LZMA_HDR_SIZE	(LZMA_PROPS_SIZE + sizeof(u64))
+
+/**
+ * struct spl_fit_decomp - an image being decompressed as it is read
+ *
+ * @comp:	compression type (IH_COMP_...)
+ * @dst:	buffer to decompress into
+ * @dst_size:	size of @dst
+ * @started:	true once the header has been read and the decoder set up
+ * @done:	true once the end of the compressed data has been reached
+ * @zs:		inflate state, for gzip
+ * @lzma:	decoder state, for LZMA
+ * @lzma_size:	uncompressed size from the LZMA header, or 0 if unknown
+ */
+struct spl_fit_decomp {
+	u8 comp;
+	void *dst;
+	ulong dst_size;
+	bool started;
+	bool done;
+	union {
+		z_stream zs;
+		struct {
+			CLzmaDec lzma;
+			ulong lzma_size;
+		};
+	};
+};
+
+static void *spl_fit_lzma_alloc(void *p, size_t size)
+{
+	return malloc(size);
+}
+
+static void spl_fit_lzma_free(void *p, void *address)
+{
+	free(address);
+}
+
+static ISzAlloc spl_fit_lzma_allocator = {
+	.Alloc = spl_fit_lzma_alloc,
+	.Free = spl_fit_lzma_free,
+};
+
+/**
+ * spl_fit_decomp_start() - read the compression header and set up the decoder
+ *
+ * @dc:		decompression state
+ * @buf:	start of the compressed data
+ * @len:	number of bytes available at @buf
+ * Return:	number of header bytes used, or a negative error number
+ */
+static int spl_fit_decomp_start(struct spl_fit_decomp *dc, const u8 *buf,
+				ulong len)
+{
+	if (IS_ENABLED(CONFIG_SPL_GZIP) && dc->comp == IH_COMP_GZIP) {
+		int offset = gzip_parse_header(buf, len);
+
+		if (offset < 0)
+			return -EINVAL;
+		dc->zs.zalloc = gzalloc;
+		dc->zs.zfree = gzfree;
+		if (inflateInit2(&dc->zs, -MAX_WBITS) != Z_OK)
+			return -ENOMEM;
+		dc->zs.next_out = dc->dst;
+		dc->zs.avail_out = dc->dst_size;
+		dc->started = true;
+
+		return offset;
+	} else if (IS_ENABLED(CONFIG_SPL_LZMA) && dc->comp == IH_COMP_LZMA) {
+		u64 size;
+
+		if (len < SPL_FIT_LZMA_HDR_SIZE)
+			return -EINVAL;
+		size = get_unaligned_le64(buf + LZMA_PROPS_SIZE);
+		if (size == U64_MAX) {
+			dc->lzma_size = 0;
+		} else if (size <= dc->dst_size) {
+			dc->lzma_size = size;
+		} else {
+			puts("Uncompressed image too large\n");
+			return -E2BIG;
+		}
+		LzmaDec_Construct(&dc->lzma);
+		if (LzmaDec_AllocateProbs(&dc->lzma, buf, LZMA_PROPS_SIZE,
+					  &spl_fit_lzma_allocator))
+			return -ENOMEM;
+		dc->lzma.dic = dc->dst;
+		dc->lzma.dicBufSize = dc->lzma_size ?: dc->dst_size;
+		LzmaDec_Init(&dc->lzma);
+		dc->started = true;
+
+		return SPL_FIT_LZMA_HDR_SIZE;
+	}
+
+	return -EPROTONOSUPPORT;
+}
+
+/**
+ * spl_fit_decomp_update() - decompress the next piece of compressed data
+ *
+ * Anything after the end of the compressed data, such as the gzip trailer,
+ * is ignored.
+ *
+ * @dc:		decompression state
+ * @buf:	compressed data
+ * @len:	number of bytes at @buf
+ * Return:	0 on success, -EIO if the data is corrupt or too large for the
+ *		buffer
+ */
+static int spl_fit_decomp_update(struct spl_fit_decomp *dc, const u8 *buf,
+				 ulong len)
+{
+	if (dc->done || !len)
+		return 0;
+
+	if (IS_ENABLED(CONFIG_SPL_GZIP) && dc->comp == IH_COMP_GZIP) {
+		int ret;
+
+		dc->zs.next_in = (u8 *)buf;
+		dc->zs.avail_in = len;
+		ret = inflate(&dc->zs, Z_NO_FLUSH);
+		if (ret == Z_STREAM_END)
+			dc->done = true;
+		/* input is only left over once the buffer is full */
+		else if (ret != Z_OK || dc->zs.avail_in)
+			return -EIO;
+	} else if (IS_ENABLED(CONFIG_SPL_LZMA) && dc->comp == IH_COMP_LZMA) {
+		ELzmaStatus status;
+		SizeT count = len;
+
+		if (LzmaDec_DecodeToDic(&dc->lzma, dc->lzma.dicBufSize, buf,
+					&count, LZMA_FINISH_ANY, &status))
+			return -EIO;
+		if (status == LZMA_STATUS_FINISHED_WITH_MARK ||
+		    (dc->lzma_size && dc->lzma.dicPos == dc->lzma_size))
+			dc->done = true;
+		else if (count < len)
+			return -EIO;
+	}
+
+	return 0;
+}
+
+/**
+ * spl_fit_decomp_finish() - tidy up after decompressing an image
+ *
+ * @dc:		decompression state
+ * @sizep:	returns the number of bytes decompressed
+ * Return:	0 on success, -EIO if the compressed data ended early
+ */
+static int spl_fit_decomp_finish(struct spl_fit_decomp *dc, ulong *sizep)
+{
+	if (!dc->started)
+		return -EIO;
+
+	if (IS_ENABLED(CONFIG_SPL_GZIP) && dc->comp == IH_COMP_GZIP) {
+		*sizep = dc->zs.total_out;
+		inflateEnd(&dc->zs);
+	} else if (IS_ENABLED(CONFIG_SPL_LZMA) && dc->comp == IH_COMP_LZMA) {
+		*sizep = dc->lzma.dicPos;
+		LzmaDec_FreeProbs(&dc->lzma, &spl_fit_lzma_allocator);
+	}
+
+	return dc->done ? 0 : -EIO;
+}
+
+/**
+ * spl_fit_read_decomp() - read compressed image data, decompressing it as it
+ *			   arrives
+ *
+ * Only one chunk of compressed data is held at a time, in a buffer from the
+ * heap. The first chunk is made a block longer than the rest, so that it
+ * holds at least a whole chunk of image data, and with it the compression
+ * header.
+ *
+ * @info:	points to information about the device to load data from
+ * @offset:	offset to read from, aligned to the block length
+ * @size:	number of bytes to read, aligned to the block length
+ * @overhead:	number of bytes at the start of the first block before the
+ *		image data
+ * @length:	length of the compressed image data
+ * @hs:		hash stream to add the compressed data to, or NULL
+ * @comp:	compression type (IH_COMP_...)
+ * @dst:	buffer to decompress into
+ * @dst_sizep:	on entry, size of @dst; on exit, number of bytes decompressed
+ * Return:	0 on success or a negative error number
+ */
+static int spl_fit_read_decomp(struct spl_load_info *info, ulong offset,
+			       ulong size, ulong overhead, ulong length,
+			       struct fit_hash_stream *hs, u8 comp, void *dst,
+			       ulong *dst_sizep)
+{
+	ulong bl_len = spl_get_bl_len(info);
+	ulong chunk = ALIGN(CONFIG_VAL(FIT_DECOMP_STREAM_CHUNK), bl_len);
+	struct spl_fit_decomp dc = {
+		.comp = comp,
+		.dst = dst,
+		.dst_size = *dst_sizep,
+	};
+	ulong end = overhead + length;
+	ulong pos, count;
+	void *buf;
+	int ret = 0;
+
+	buf = malloc_cache_aligned(chunk + bl_len);
+	if (!buf)
+		return -ENOMEM;
+	for (pos = 0; pos < size; pos += count) {
+		ulong start, stop;
+
+		count = min(pos ? chunk : chunk + bl_len, size - pos);
+		start = max(pos, overhead) - pos;
+		stop = min(end, pos + count) - pos;
+
+		/* the read may stop short of the block-aligned size */
+		if (info->read(info, offset + pos, count, buf) < stop) {
+			ret = -EIO;
+			break;
+		}
+		if (hs)
+			fit_image_hash_stream_update(hs, buf + start,
+						     stop - start);
+		if (!dc.started) {
+			ret = spl_fit_decomp_start(&dc, buf + start,
+						   stop - start);
+			if (ret < 0)
+				break;
+			start += ret;
+		}
+		ret = spl_fit_decomp_update(&dc, buf + start, stop - start);
+		if (ret)
+			break;
+	}
+	free(buf);
+
+	if (dc.started) {
+		int err = spl_fit_decomp_finish(&dc, dst_sizep);
+
+		ret = ret ?: err;
+	}
+	if (ret)
+		puts("Uncompressing error\n");
+
+	return ret;
+}
+
+/**
+ * spl_fit_decomp_stream() - check whether an image can be decompressed as it
+ *			     is read
+ *
+ * The compressed data is not kept, so this is only possible if everything
+ * that checks it can be worked out as it arrives: no signatures and only
+ * hashes that fit_image_hash_stream_start() can handle. With signature
+ * verification this is only done if the board opts in, since the data is
+ * decompressed before its hashes are checked.
+ *
+ * @fit:	FIT blob
+ * @node:	image node
+ * @comp:	compression type of the image (IH_COMP_...)
+ * @hs:		hash stream, which is started if the image has hashes to check
+ * Return:	true if the image should be read with spl_fit_read_decomp()
+ */
+static bool spl_fit_decomp_stream(const void *fit, int node, u8 comp,
+				  struct fit_hash_stream *hs)
+{
+	int noffset;
+
+	if ((!IS_ENABLED(CONFIG_SPL_GZIP) || comp != IH_COMP_GZIP) &&
+	    (!IS_ENABLED(CONFIG_SPL_LZMA) || comp != IH_COMP_LZMA))
+		return false;
+	if (!CONFIG_IS_ENABLED(FIT_SIGNATURE))
+		return true;
+	if (!CONFIG_IS_ENABLED(FIT_DECOMP_STREAM_UNVERIFIED))
+		return false;
+
+	fdt_for_each_subnode(noffset, fit, node) {
+		if (!strncmp(fit_get_name(fit, noffset, NULL),
+			     FIT_SIG_NODENAME, strlen(FIT_SIG_NODENAME)))
+			return false;
+	}
+
+	return !fit_image_hash_stream_start(hs, fit, node);
+}
+#else
+static int spl_fit_read_decomp(struct spl_load_info *info, ulong offset,
+			       ulong size, ulong overhead, ulong length,
+			       struct fit_hash_stream *hs, u8 comp, void *dst,
+			       ulong *dst_sizep)
+{
+	return -ENOSYS;
+}
+
+static bool spl_fit_decomp_stream(const void *fit, int node, u8 comp,
+				  struct fit_hash_stream *hs)
+{
+	return false;
+}
+#endif
+
 /**
  * load_simple_fit(): load the image described in a certain FIT node
  * @info:	points to information about the device to load data from
@@ -208,6 +559,7 @@ static int load_simple_fit(struct spl_load_info *info, ulong fit_offset,
 	size_t length;
 	int len;
 	ulong size;
+	ulong unc_size = CONFIG_SYS_BOOTM_LEN;
 	ulong load_addr;
 	void *load_ptr;
 	void *src;
@@ -216,6 +568,8 @@ static int load_simple_fit(struct spl_load_info *info, ulong fit_offset,
 	const void *data;
 	const void *fit = ctx->fit;
 	bool external_data = false;
+	bool streamed = false;
+	struct fit_hash_stream hs, *hsp = NULL;
 
 	if (IS_ENABLED(CONFIG_SPL_FPGA) ||
 	    (IS_ENABLED(CONFIG_SPL_OS_BOOT) && spl_decompression_enabled())) {
@@ -270,15 +624,47 @@ static int load_simple_fit(struct spl_load_info *info, ulong fit_offset,
 		overhead = get_aligned_image_overhead(info, offset);
 		size = get_aligned_image_size(info, length, offset);
 
-		if (info->read(info,
-			       fit_offset +
-			       get_aligned_image_offset(info, offset), size,
-			       src_ptr) < length)
+		if (CONFIG_IS_ENABLED(FIT_DECOMP_STREAM) &&
+		    spl_fit_decomp_stream(fit, node, image_comp, &hs)) {
+			int ret;
+
+			if (CONFIG_IS_ENABLED(FIT_SIGNATURE))
+				hsp = &hs;
+			load_ptr = map_sysmem(load_addr, unc_size);
+			ret = spl_fit_read_decomp(info, fit_offset +
+					get_aligned_image_offset(info, offset),
+					size, overhead, length, hsp, image_comp,
+					load_ptr, &unc_size);
+			if (ret) {
+				if (hsp)
+					fit_image_hash_stream_finish(hsp);
+				return ret;
+			}
+			streamed = true;
+		} else if (CONFIG_IS_ENABLED(FIT_HASH_STREAM) &&
+		    !fit_image_hash_stream_start(&hs, fit, node)) {
+			int ret;
+
+			ret = spl_fit_read_hashed(info, fit_offset +
+					get_aligned_image_offset(info, offset),
+					size, src_ptr, overhead, length, &hs);
+			if (ret) {
+				fit_image_hash_stream_finish(&hs);
+				return ret;
+			}
+			hsp = &hs;
+		} else if (info->read(info,
+				      fit_offset +
+				      get_aligned_image_offset(info, offset),
+				      size, src_ptr) < length) {
 			return -EIO;
+		}
 
 		debug("External data: dst=%p, offset=%x, size=%lx\n",
-		      src_ptr, offset, (unsigned long)length);
-		src = src_ptr + overhead;
+		      streamed ? load_ptr : src_ptr, offset,
+		      (unsigned long)length);
+		/* only the hashes worked out as it was read are left */
+		src = streamed ? NULL : src_ptr + overhead;
 	} else {
 		/* Embedded data */
 		if (fit_image_get_data(fit, node, &data, &length)) {
@@ -291,10 +677,19 @@ static int load_simple_fit(struct spl_load_info *info, ulong fit_offset,
 	}
 
 	if (CONFIG_IS_ENABLED(FIT_SIGNATURE)) {
+		int valid;
+
 		printf("## Checking hash(es) for Image %s ... ",
 		       fit_get_name(fit, node, NULL));
-		if (!fit_image_verify_with_data(fit, node, gd_fdt_blob(), src,
-						length))
+		if (hsp)
+			valid = fit_image_verify_stream(fit, node,
+							gd_fdt_blob(), src,
+							length, hsp);
+		else
+			valid = fit_image_verify_with_data(fit, node,
+							   gd_fdt_blob(), src,
+							   length);
+		if (!valid)
 			return -EPERM;
 		puts("OK\n");
 	}
@@ -303,7 +698,9 @@ static int load_simple_fit(struct spl_load_info *info, ulong fit_offset,
 		board_fit_image_post_process(fit, node, &src, &length);
 
 	load_ptr = map_sysmem(load_addr, length);
-	if (IS_ENABLED(CONFIG_SPL_GZIP) && image_comp == IH_COMP_GZIP) {
+	if (streamed) {
+		length = unc_size;
+	} else if (IS_ENABLED(CONFIG_SPL_GZIP) && image_comp == IH_COMP_GZIP) {
 		size = length;
 		if (gunzip(load_ptr, CONFIG_SYS_BOOTM_LEN, src, &size)) {
 			puts("Uncompressing error\n");
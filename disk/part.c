@@ -8,6 +8,7 @@
 #include <command.h>
 #include <env.h>
 #include <errno.h>
+#include <fs.h>
 #include <ide.h>
 #include <log.h>
 #include <malloc.h>
@@ -284,6 +285,7 @@ void part_init(struct blk_desc *desc)
 	struct part_driver *entry;
 
 	blkcache_invalidate(desc->uclass_id, desc->devnum);
+	fs_invalidate(desc);
 
 	desc->part_type = PART_TYPE_UNKNOWN;
 	for (entry = drv; entry != drv + n_ents; entry++) {
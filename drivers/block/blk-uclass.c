@@ -8,6 +8,7 @@
 
 #include <blk.h>
 #include <dm.h>
+#include <fs.h>
 #include <log.h>
 #include <malloc.h>
 #include <part.h>
@@ -16,8 +17,6 @@
 #include <dm/uclass-internal.h>
 #include <linux/err.h>
 
-#define blk_get_ops(dev)	((struct blk_ops *)(dev)->driver->ops)
-
 static struct {
 	enum uclass_id id;
 	const char *name;
@@ -326,6 +325,8 @@ int blk_select_hwpart(struct udevice *dev, int hwpart)
 	if (!ops->select_hwpart)
 		return 0;
 
+	blk_readahead_invalidate(dev);
+
 	return ops->select_hwpart(dev, hwpart);
 }
 
@@ -431,38 +432,56 @@ long blk_read(struct udevice *dev, lbaint_t start, lbaint_t blkcnt, void *buf)
 {
 	struct blk_desc *desc = dev_get_uclass_plat(dev);
 	const struct blk_ops *ops = blk_get_ops(dev);
+	lbaint_t cached, blk, count;
 	ulong blks_read;
 
 	if (!ops->read)
 		return -ENOSYS;
 
-	if (blkcache_read(desc->uclass_id, desc->devnum,
-			  start, blkcnt, desc->blksz, buf))
+	cached = blkcache_read(desc->uclass_id, desc->devnum,
+			       start, blkcnt, desc->blksz, buf);
+	if (cached < blkcnt)
+		cached += blk_readahead_read(dev, start + cached,
+					     blkcnt - cached,
+					     buf + cached * desc->blksz);
+	if (cached == blkcnt) {
+		blk_readahead_update(dev, start, blkcnt);
 		return blkcnt;
+	}
+
+	/* only read the part which the caches could not supply */
+	blk = start + cached;
+	count = blkcnt - cached;
+	buf += cached * desc->blksz;
 
 	if (IS_ENABLED(CONFIG_BOUNCE_BUFFER) && desc->bb) {
 		struct blk_bounce_buffer bbstate = { .dev = dev };
 		int ret;
 
 		ret = bounce_buffer_start_extalign(&bbstate.state, buf,
-						   blkcnt * desc->blksz,
+						   count * desc->blksz,
 						   GEN_BB_WRITE, desc->blksz,
 						   blk_buffer_aligned);
 		if (ret)
 			return ret;
 
-		blks_read = ops->read(dev, start, blkcnt, bbstate.state.bounce_buffer);
+		blks_read = ops->read(dev, blk, count, bbstate.state.bounce_buffer);
 
 		bounce_buffer_stop(&bbstate.state);
 	} else {
-		blks_read = ops->read(dev, start, blkcnt, buf);
+		blks_read = ops->read(dev, blk, count, buf);
 	}
 
-	if (blks_read == blkcnt)
-		blkcache_fill(desc->uclass_id, desc->devnum, start, blkcnt,
+	if (blks_read == count) {
+		blkcache_fill(desc->uclass_id, desc->devnum, blk, count,
 			      desc->blksz, buf);
+		blk_readahead_update(dev, start, blkcnt);
+	}
+
+	if ((long)blks_read < 0)
+		return blks_read;
 
-	return blks_read;
+	return cached + blks_read;
 }
 
 long blk_write(struct udevice *dev, lbaint_t start, lbaint_t blkcnt,
@@ -476,6 +495,8 @@ long blk_write(struct udevice *dev, lbaint_t start, lbaint_t blkcnt,
 		return -ENOSYS;
 
 	blkcache_invalidate(desc->uclass_id, desc->devnum);
+	blk_readahead_invalidate(dev);
+	fs_invalidate(desc);
 
 	if (IS_ENABLED(CONFIG_BOUNCE_BUFFER) && desc->bb) {
 		struct blk_bounce_buffer bbstate = { .dev = dev };
@@ -508,6 +529,8 @@ long blk_erase(struct udevice *dev, lbaint_t start, lbaint_t blkcnt)
 		return -ENOSYS;
 
 	blkcache_invalidate(desc->uclass_id, desc->devnum);
+	blk_readahead_invalidate(dev);
+	fs_invalidate(desc);
 
 	return ops->erase(dev, start, blkcnt);
 }
@@ -837,6 +860,9 @@ static int part_create_block_devices(struct udevice *blk_dev)
 
 static int blk_post_probe(struct udevice *dev)
 {
+	if (CONFIG_IS_ENABLED(BLK_READAHEAD))
+		blk_readahead_set_size(dev, CONFIG_BLK_READAHEAD_SIZE);
+
 	if (CONFIG_IS_ENABLED(PARTITIONS) && blk_enabled()) {
 		struct blk_desc *desc = dev_get_uclass_plat(dev);
 
@@ -850,9 +876,29 @@ static int blk_post_probe(struct udevice *dev)
 	return 0;
 }
 
+static int blk_pre_remove(struct udevice *dev)
+{
+	struct blk_desc *desc = dev_get_uclass_plat(dev);
+	int ret = 0;
+
+	/* this waits for any read-ahead and frees its buffer */
+	if (CONFIG_IS_ENABLED(BLK_READAHEAD))
+		ret = blk_readahead_set_size(dev, 0);
+
+	/* nothing cached for this device can be trusted once it is gone */
+	blkcache_invalidate(desc->uclass_id, desc->devnum);
+	fs_invalidate(desc);
+
+	return ret;
+}
+
 UCLASS_DRIVER(blk) = {
 	.id		= UCLASS_BLK,
 	.name		= "blk",
 	.post_probe	= blk_post_probe,
+	.pre_remove	= blk_pre_remove,
+#if CONFIG_IS_ENABLED(BLK_READAHEAD)
+	.per_device_auto	= sizeof(struct blk_readahead),
+#endif
 	.per_device_plat_auto	= sizeof(struct blk_desc),
 };
@@ -0,0 +1,170 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Sequential read-ahead for block devices
+ *
+ * When a block device is read sequentially, the blocks following each read are
+ * fetched into a per-device window before they are asked for. With a driver
+ * which supports read_async() this overlaps the device transfer with whatever
+ * the caller does with the previous data, e.g. a filesystem working out where
+ * the next part of a file lives. Without it, runs of small sequential reads
+ * are still turned into fewer, larger device reads.
+ */
+
+#define LOG_CATEGORY UCLASS_BLK
+
+#include <blk.h>
+#include <dm.h>
+#include <log.h>
+#include <malloc.h>
+#include <memalign.h>
+#include <linux/errno.h>
+
+/* Number of back-to-back sequential reads needed to start reading ahead */
+#define BLK_RA_SEQ_THRESHOLD	2
+
+struct blk_readahead *blk_readahead_get(struct udevice *dev)
+{
+	return dev_get_uclass_priv(dev);
+}
+
+/* Wait for an outstanding read, dropping the window if it failed */
+static void blk_readahead_wait(struct udevice *dev, struct blk_readahead *ra)
+{
+	const struct blk_ops *ops = blk_get_ops(dev);
+	long ret;
+
+	if (!ra->pending)
+		return;
+
+	ra->pending = false;
+	ret = ops->read_wait(dev);
+	if (ret != ra->blkcnt) {
+		log_debug("%s: read-ahead of " LBAFU " blocks at " LBAF
+			  " failed (%ld)\n", dev->name, ra->blkcnt, ra->start,
+			  ret);
+		ra->blkcnt = 0;
+	}
+}
+
+void blk_readahead_invalidate(struct udevice *dev)
+{
+	struct blk_readahead *ra = blk_readahead_get(dev);
+
+	if (!ra)
+		return;
+
+	blk_readahead_wait(dev, ra);
+	ra->blkcnt = 0;
+}
+
+lbaint_t blk_readahead_read(struct udevice *dev, lbaint_t start,
+			    lbaint_t blkcnt, void *buffer)
+{
+	struct blk_desc *desc = dev_get_uclass_plat(dev);
+	struct blk_readahead *ra = blk_readahead_get(dev);
+	lbaint_t count;
+
+	if (!ra || !ra->blkcnt)
+		return 0;
+
+	if (start < ra->start || start >= ra->start + ra->blkcnt) {
+		blk_readahead_invalidate(dev);
+		return 0;
+	}
+
+	blk_readahead_wait(dev, ra);
+	if (!ra->blkcnt)
+		return 0;
+
+	count = min(ra->start + ra->blkcnt - start, blkcnt);
+	memcpy(buffer, ra->buf + (start - ra->start) * desc->blksz,
+	       count * desc->blksz);
+	ra->hits += count;
+
+	return count;
+}
+
+void blk_readahead_update(struct udevice *dev, lbaint_t start,
+			  lbaint_t blkcnt)
+{
+	struct blk_desc *desc = dev_get_uclass_plat(dev);
+	struct blk_readahead *ra = blk_readahead_get(dev);
+	const struct blk_ops *ops = blk_get_ops(dev);
+	lbaint_t end = start + blkcnt;
+	lbaint_t count;
+	int ret;
+
+	if (!ra || !ra->size)
+		return;
+
+	if (start == ra->next)
+		ra->seq++;
+	else
+		ra->seq = 0;
+	ra->next = end;
+	if (ra->seq < BLK_RA_SEQ_THRESHOLD)
+		return;
+
+	/* the window still holds (or is fetching) the next blocks */
+	if (ra->blkcnt && end >= ra->start && end < ra->start + ra->blkcnt)
+		return;
+
+	/*
+	 * A synchronous read-ahead only pays off if the caller reads in pieces
+	 * smaller than the window
+	 */
+	if (!ops->read_async && blkcnt * desc->blksz >= ra->size)
+		return;
+
+	/* bounce buffers are only set up for the caller's buffer */
+	if (desc->bb)
+		return;
+
+	count = ra->size / desc->blksz;
+	if (desc->lba) {
+		if (end >= desc->lba)
+			return;
+		count = min(count, desc->lba - end);
+	}
+
+	blk_readahead_invalidate(dev);
+	if (!ra->buf) {
+		ra->buf = memalign(ARCH_DMA_MINALIGN, ra->size);
+		if (!ra->buf)
+			return;
+	}
+
+	ra->start = end;
+	ra->blkcnt = count;
+	if (ops->read_async) {
+		ret = ops->read_async(dev, end, count, ra->buf);
+		if (ret) {
+			log_debug("%s: cannot start read-ahead (%d)\n",
+				  dev->name, ret);
+			ra->blkcnt = 0;
+			return;
+		}
+		ra->pending = true;
+	} else if (ops->read(dev, end, count, ra->buf) != count) {
+		ra->blkcnt = 0;
+		return;
+	}
+	ra->issued += count;
+}
+
+int blk_readahead_set_size(struct udevice *dev, ulong size)
+{
+	struct blk_desc *desc = dev_get_uclass_plat(dev);
+	struct blk_readahead *ra = blk_readahead_get(dev);
+
+	if (!ra)
+		return -ENOSYS;
+
+	blk_readahead_invalidate(dev);
+	free(ra->buf);
+	ra->buf = NULL;
+	ra->size = desc->blksz ? size / desc->blksz * desc->blksz : 0;
+	ra->seq = 0;
+
+	return 0;
+}
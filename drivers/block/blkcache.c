@@ -5,156 +5,366 @@
  *
  */
 #include <blk.h>
+#include <errno.h>
 #include <log.h>
 #include <malloc.h>
 #include <part.h>
 #include <asm/global_data.h>
 #include <linux/ctype.h>
 #include <linux/list.h>
+#include <linux/log2.h>
 
-struct block_cache_node {
+/*
+ * The cache is made up of chunks of max_blocks_per_entry blocks, aligned to
+ * that size on the device. Each chunk holds a single contiguous run of valid
+ * blocks. Chunks are found through a hash table keyed on (device, chunk index)
+ * and evicted in least-recently-used order once either the entry limit or the
+ * byte budget is exceeded.
+ */
+#define BLKCACHE_HASH_BITS	6
+#define BLKCACHE_HASH_SIZE	(1 << BLKCACHE_HASH_BITS)
+
+/*
+ * Reads larger than this fraction of the byte budget are not cached, so that
+ * loading a large image does not flush out filesystem metadata
+ */
+#define BLKCACHE_FILL_DIV	4
+
+/*
+ * Number of devices to keep statistics for. These are not allocated, so that
+ * they can outlast the device without being seen as a leak
+ */
+#define BLKCACHE_MAX_DEVS	8
+
+struct block_cache_dev {
 	struct list_head lh;
-	int iftype;
-	int devnum;
-	lbaint_t start;
-	lbaint_t blkcnt;
+	struct block_cache_dev_stats stats;
+};
+
+struct block_cache_node {
+	struct list_head lh;		/* LRU list, most recently used first */
+	struct hlist_node hn;		/* hash chain */
+	struct block_cache_dev *bdev;
+	lbaint_t chunk;			/* chunk index on the device */
+	lbaint_t start;			/* first valid block */
+	lbaint_t blkcnt;		/* number of valid blocks */
 	unsigned long blksz;
-	char *cache;
+	char *cache;			/* chunk-sized data buffer */
 };
 
 static LIST_HEAD(block_cache);
+static LIST_HEAD(block_cache_devs);
+static struct block_cache_dev block_cache_dev_pool[BLKCACHE_MAX_DEVS];
+static struct hlist_head block_cache_hash[BLKCACHE_HASH_SIZE];
 
 static struct block_cache_stats _stats = {
 	.max_blocks_per_entry = 8,
-	.max_entries = 32
+	.max_entries = 32,
+	.max_bytes = CONFIG_BLOCK_CACHE_SIZE,
 };
 
-static struct block_cache_node *cache_find(int iftype, int devnum,
-					   lbaint_t start, lbaint_t blkcnt,
+static inline uint chunk_shift(void)
+{
+	return ilog2(_stats.max_blocks_per_entry);
+}
+
+static inline ulong chunk_bytes(unsigned long blksz)
+{
+	return (ulong)_stats.max_blocks_per_entry * blksz;
+}
+
+static struct hlist_head *cache_bucket(struct block_cache_dev *bdev,
+				       lbaint_t chunk)
+{
+	u32 key = (u32)chunk ^ (u32)((u64)chunk >> 32) ^
+		  ((u32)bdev->stats.iftype << 24) ^
+		  ((u32)bdev->stats.devnum << 16);
+
+	return &block_cache_hash[(key * 0x9e3779b9) >>
+				 (32 - BLKCACHE_HASH_BITS)];
+}
+
+static void cache_unlink(struct block_cache_node *node)
+{
+	ulong bytes = chunk_bytes(node->blksz);
+
+	list_del(&node->lh);
+	hlist_del(&node->hn);
+	node->bdev->stats.entries--;
+	node->bdev->stats.bytes -= bytes;
+	_stats.entries--;
+	_stats.bytes -= bytes;
+}
+
+static void cache_drop(struct block_cache_node *node)
+{
+	cache_unlink(node);
+	free(node->cache);
+	free(node);
+}
+
+static void cache_drop_dev(struct block_cache_dev *bdev)
+{
+	struct block_cache_node *node, *n;
+
+	list_for_each_entry_safe(node, n, &block_cache, lh) {
+		if (node->bdev == bdev)
+			cache_drop(node);
+	}
+}
+
+static struct block_cache_dev *cache_dev(int iftype, int devnum, bool create)
+{
+	struct block_cache_dev *bdev;
+
+	list_for_each_entry(bdev, &block_cache_devs, lh) {
+		if (bdev->stats.iftype == iftype &&
+		    bdev->stats.devnum == devnum) {
+			/* keep the active device at the front */
+			if (block_cache_devs.next != &bdev->lh)
+				list_move(&bdev->lh, &block_cache_devs);
+			return bdev;
+		}
+	}
+	if (!create)
+		return NULL;
+
+	for (bdev = block_cache_dev_pool;
+	     bdev < block_cache_dev_pool + BLKCACHE_MAX_DEVS; bdev++) {
+		if (!bdev->lh.next)
+			break;
+	}
+	if (bdev == block_cache_dev_pool + BLKCACHE_MAX_DEVS) {
+		/* all in use, so forget the device least recently used */
+		bdev = list_last_entry(&block_cache_devs,
+				       struct block_cache_dev, lh);
+		cache_drop_dev(bdev);
+		list_del(&bdev->lh);
+	}
+	memset(bdev, '\0', sizeof(*bdev));
+	bdev->stats.iftype = iftype;
+	bdev->stats.devnum = devnum;
+	list_add(&bdev->lh, &block_cache_devs);
+
+	return bdev;
+}
+
+static struct block_cache_node *cache_find(struct block_cache_dev *bdev,
+					   lbaint_t chunk,
 					   unsigned long blksz)
 {
 	struct block_cache_node *node;
 
-	list_for_each_entry(node, &block_cache, lh)
-		if ((node->iftype == iftype) &&
-		    (node->devnum == devnum) &&
-		    (node->blksz == blksz) &&
-		    (node->start <= start) &&
-		    (node->start + node->blkcnt >= start + blkcnt)) {
+	hlist_for_each_entry(node, cache_bucket(bdev, chunk), hn)
+		if (node->bdev == bdev && node->chunk == chunk &&
+		    node->blksz == blksz) {
 			if (block_cache.next != &node->lh) {
 				/* maintain MRU ordering */
-				list_del(&node->lh);
-				list_add(&node->lh, &block_cache);
+				list_move(&node->lh, &block_cache);
 			}
 			return node;
 		}
-	return 0;
+
+	return NULL;
 }
 
 int blkcache_read(int iftype, int devnum,
 		  lbaint_t start, lbaint_t blkcnt,
 		  unsigned long blksz, void *buffer)
 {
-	struct block_cache_node *node = cache_find(iftype, devnum, start,
-						   blkcnt, blksz);
-	if (node) {
-		const char *src = node->cache + (start - node->start) * blksz;
-		memcpy(buffer, src, blksz * blkcnt);
+	struct block_cache_dev *bdev;
+	lbaint_t done = 0;
+
+	if (list_empty(&block_cache))
+		goto miss;
+	bdev = cache_dev(iftype, devnum, false);
+	if (!bdev)
+		goto miss;
+
+	while (done < blkcnt) {
+		struct block_cache_node *node;
+		lbaint_t blk = start + done;
+		lbaint_t count;
+
+		node = cache_find(bdev, blk >> chunk_shift(), blksz);
+		if (!node || blk < node->start ||
+		    blk >= node->start + node->blkcnt)
+			break;
+
+		count = min(node->start + node->blkcnt - blk, blkcnt - done);
+		memcpy(buffer + done * blksz,
+		       node->cache + (blk - (node->chunk << chunk_shift())) *
+		       blksz, count * blksz);
+		done += count;
+	}
+
+	if (done == blkcnt) {
 		debug("hit: start " LBAF ", count " LBAFU "\n",
 		      start, blkcnt);
 		++_stats.hits;
-		return 1;
+		++bdev->stats.hits;
+	} else if (done) {
+		debug("partial: start " LBAF ", count " LBAFU ", cached " LBAFU
+		      "\n", start, blkcnt, done);
+		++_stats.partial;
+		++bdev->stats.partial;
+	} else {
+		++bdev->stats.misses;
+		goto miss;
 	}
 
+	return done;
+
+miss:
 	debug("miss: start " LBAF ", count " LBAFU "\n",
 	      start, blkcnt);
 	++_stats.misses;
 	return 0;
 }
 
-void blkcache_fill(int iftype, int devnum,
-		   lbaint_t start, lbaint_t blkcnt,
-		   unsigned long blksz, void const *buffer)
+/* Find room for one more chunk, reusing the LRU entry when at a limit */
+static struct block_cache_node *cache_alloc(unsigned long blksz)
 {
-	lbaint_t bytes;
-	struct block_cache_node *node;
+	ulong bytes = chunk_bytes(blksz);
+	struct block_cache_node *node = NULL;
 
-	/* don't cache big stuff */
-	if (blkcnt > _stats.max_blocks_per_entry)
-		return;
+	if (bytes > _stats.max_bytes)
+		return NULL;
 
-	if (_stats.max_entries == 0)
-		return;
-
-	bytes = blksz * blkcnt;
-	if (_stats.max_entries <= _stats.entries) {
+	while (!list_empty(&block_cache) &&
+	       (_stats.entries >= _stats.max_entries ||
+		_stats.bytes + bytes > _stats.max_bytes)) {
 		/* pop LRU */
-		node = (struct block_cache_node *)block_cache.prev;
-		list_del(&node->lh);
-		_stats.entries--;
+		if (node)
+			cache_drop(node);
+		node = list_last_entry(&block_cache, struct block_cache_node,
+				       lh);
 		debug("drop: start " LBAF ", count " LBAFU "\n",
 		      node->start, node->blkcnt);
-		if (node->blkcnt * node->blksz < bytes) {
+		cache_unlink(node);
+	}
+
+	if (node) {
+		if (node->blksz != blksz) {
 			free(node->cache);
-			node->cache = 0;
+			node->cache = NULL;
 		}
 	} else {
 		node = malloc(sizeof(*node));
 		if (!node)
-			return;
-		node->cache = 0;
+			return NULL;
+		node->cache = NULL;
 	}
 
 	if (!node->cache) {
 		node->cache = malloc(bytes);
 		if (!node->cache) {
 			free(node);
-			return;
+			return NULL;
 		}
 	}
 
+	return node;
+}
+
+void blkcache_fill(int iftype, int devnum,
+		   lbaint_t start, lbaint_t blkcnt,
+		   unsigned long blksz, void const *buffer)
+{
+	struct block_cache_dev *bdev;
+	lbaint_t done;
+
+	if (!_stats.max_entries || !_stats.max_blocks_per_entry)
+		return;
+
+	/* don't cache big stuff */
+	if (blkcnt * blksz > _stats.max_bytes / BLKCACHE_FILL_DIV)
+		return;
+
+	bdev = cache_dev(iftype, devnum, true);
+	if (!bdev)
+		return;
+
 	debug("fill: start " LBAF ", count " LBAFU "\n",
 	      start, blkcnt);
 
-	node->iftype = iftype;
-	node->devnum = devnum;
-	node->start = start;
-	node->blkcnt = blkcnt;
-	node->blksz = blksz;
-	memcpy(node->cache, buffer, bytes);
-	list_add(&node->lh, &block_cache);
-	_stats.entries++;
+	for (done = 0; done < blkcnt;) {
+		struct block_cache_node *node;
+		lbaint_t blk = start + done;
+		lbaint_t chunk = blk >> chunk_shift();
+		lbaint_t base = chunk << chunk_shift();
+		lbaint_t count;
+
+		count = min(base + _stats.max_blocks_per_entry - blk,
+			    blkcnt - done);
+
+		node = cache_find(bdev, chunk, blksz);
+		if (node && blk <= node->start + node->blkcnt &&
+		    blk + count >= node->start) {
+			/* overlapping or adjacent: extend the valid run */
+			lbaint_t end = max(node->start + node->blkcnt,
+					   blk + count);
+
+			node->start = min(node->start, blk);
+			node->blkcnt = end - node->start;
+		} else if (node) {
+			/* disjoint: the new data replaces the old run */
+			node->start = blk;
+			node->blkcnt = count;
+		} else {
+			node = cache_alloc(blksz);
+			if (!node)
+				return;
+			node->bdev = bdev;
+			node->chunk = chunk;
+			node->start = blk;
+			node->blkcnt = count;
+			node->blksz = blksz;
+			list_add(&node->lh, &block_cache);
+			hlist_add_head(&node->hn, cache_bucket(bdev, chunk));
+			bdev->stats.entries++;
+			bdev->stats.bytes += chunk_bytes(blksz);
+			_stats.entries++;
+			_stats.bytes += chunk_bytes(blksz);
+		}
+
+		memcpy(node->cache + (blk - base) * blksz,
+		       buffer + done * blksz, count * blksz);
+		done += count;
+	}
 }
 
 void blkcache_invalidate(int iftype, int devnum)
 {
-	struct list_head *entry, *n;
-	struct block_cache_node *node;
+	struct block_cache_node *node, *n;
 
-	list_for_each_safe(entry, n, &block_cache) {
-		node = (struct block_cache_node *)entry;
+	/* the device's statistics are kept until they are read */
+	list_for_each_entry_safe(node, n, &block_cache, lh) {
 		if (iftype == -1 ||
-		    (node->iftype == iftype && node->devnum == devnum)) {
-			list_del(entry);
-			free(node->cache);
-			free(node);
-			--_stats.entries;
-		}
+		    (node->bdev->stats.iftype == iftype &&
+		     node->bdev->stats.devnum == devnum))
+			cache_drop(node);
 	}
 }
 
-void blkcache_configure(unsigned blocks, unsigned entries)
+void blkcache_configure(unsigned blocks, unsigned entries, ulong max_bytes)
 {
+	if (blocks)
+		blocks = roundup_pow_of_two(blocks);
+
 	/* invalidate cache if there is a change */
 	if ((blocks != _stats.max_blocks_per_entry) ||
-	    (entries != _stats.max_entries))
+	    (entries != _stats.max_entries) ||
+	    (max_bytes != _stats.max_bytes))
 		blkcache_invalidate(-1, 0);
 
 	_stats.max_blocks_per_entry = blocks;
 	_stats.max_entries = entries;
+	_stats.max_bytes = max_bytes;
 
 	_stats.hits = 0;
 	_stats.misses = 0;
+	_stats.partial = 0;
 }
 
 void blkcache_stats(struct block_cache_stats *stats)
@@ -162,9 +372,29 @@ void blkcache_stats(struct block_cache_stats *stats)
 	memcpy(stats, &_stats, sizeof(*stats));
 	_stats.hits = 0;
 	_stats.misses = 0;
+	_stats.partial = 0;
+}
+
+int blkcache_dev_stats(int index, struct block_cache_dev_stats *stats)
+{
+	struct block_cache_dev *bdev;
+
+	list_for_each_entry(bdev, &block_cache_devs, lh) {
+		if (index--)
+			continue;
+		memcpy(stats, &bdev->stats, sizeof(*stats));
+		bdev->stats.hits = 0;
+		bdev->stats.misses = 0;
+		bdev->stats.partial = 0;
+		return 0;
+	}
+
+	return -ENOENT;
 }
 
 void blkcache_free(void)
 {
 	blkcache_invalidate(-1, 0);
+	INIT_LIST_HEAD(&block_cache_devs);
+	memset(block_cache_dev_pool, '\0', sizeof(block_cache_dev_pool));
 }
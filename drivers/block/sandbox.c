@@ -17,6 +17,17 @@
 
 DECLARE_GLOBAL_DATA_PTR;
 
+/**
+ * struct host_blk_priv - private data for a host block device
+ *
+ * @async_pending: true if a read has been started by read_async()
+ * @async_result: Result of that read, returned by read_wait()
+ */
+struct host_blk_priv {
+	bool async_pending;
+	long async_result;
+};
+
 static unsigned long host_block_read(struct udevice *dev,
 				     unsigned long start, lbaint_t blkcnt,
 				     void *buffer)
@@ -55,13 +66,44 @@ static unsigned long host_block_write(struct udevice *dev,
 	return -EIO;
 }
 
+/*
+ * The host file is read straight away; the result is held until read_wait() so
+ * that the asynchronous path of the uclass is exercised
+ */
+static int host_block_read_async(struct udevice *dev, lbaint_t start,
+				 lbaint_t blkcnt, void *buffer)
+{
+	struct host_blk_priv *priv = dev_get_priv(dev);
+
+	if (priv->async_pending)
+		return -EBUSY;
+	priv->async_pending = true;
+	priv->async_result = host_block_read(dev, start, blkcnt, buffer);
+
+	return 0;
+}
+
+static long host_block_read_wait(struct udevice *dev)
+{
+	struct host_blk_priv *priv = dev_get_priv(dev);
+
+	if (!priv->async_pending)
+		return -EINVAL;
+	priv->async_pending = false;
+
+	return priv->async_result;
+}
+
 static const struct blk_ops sandbox_host_blk_ops = {
 	.read	= host_block_read,
 	.write	= host_block_write,
+	.read_async	= host_block_read_async,
+	.read_wait	= host_block_read_wait,
 };
 
 U_BOOT_DRIVER(sandbox_host_blk) = {
 	.name		= "sandbox_host_blk",
 	.id		= UCLASS_BLK,
 	.ops		= &sandbox_host_blk_ops,
+	.priv_auto	= sizeof(struct host_blk_priv),
 };
@@ -33,6 +33,7 @@
 #include <linux/err.h>
 #include <linux/list.h>
 #include <power-domain.h>
+#include <uthread.h>
 #include <linux/printk.h>
 
 DECLARE_GLOBAL_DATA_PTR;
@@ -616,6 +617,76 @@ fail:
 	return ret;
 }
 
+/**
+ * struct device_probe_job - a device being probed in its own thread
+ *
+ * @uthr: Thread doing the probe
+ * @dev: Device to probe
+ * @ret: Result of device_probe()
+ */
+struct device_probe_job {
+	struct uthread uthr;
+	struct udevice *dev;
+	int ret;
+};
+
+static void device_probe_thread(void *arg)
+{
+	struct device_probe_job *job = arg;
+
+	job->ret = device_probe(job->dev);
+}
+
+int device_probe_parallel(struct udevice **devs, int count)
+{
+	struct device_probe_job *jobs = NULL;
+	unsigned int grp_id;
+	int ret = 0;
+	int i;
+
+	if (CONFIG_IS_ENABLED(UTHREAD) && count > 1)
+		jobs = calloc(count, sizeof(*jobs));
+	if (!jobs) {
+		for (i = 0; i < count; i++) {
+			int err = device_probe(devs[i]);
+
+			if (err && !ret)
+				ret = err;
+		}
+		return ret;
+	}
+
+	grp_id = uthread_grp_new_id();
+	for (i = 0; i < count; i++) {
+		struct device_probe_job *job = &jobs[i];
+
+		job->dev = devs[i];
+		/*
+		 * Parents may be shared, so probe them here rather than have
+		 * two threads activate the same device
+		 */
+		if (devs[i]->parent) {
+			job->ret = device_probe(devs[i]->parent);
+			if (job->ret)
+				continue;
+		}
+		if (uthread_create(&job->uthr, device_probe_thread, job, 0,
+				   grp_id))
+			job->ret = device_probe(devs[i]);
+	}
+
+	while (!uthread_grp_done(grp_id))
+		uthread_schedule();
+
+	for (i = 0; i < count; i++) {
+		if (jobs[i].ret && !ret)
+			ret = jobs[i].ret;
+	}
+	free(jobs);
+
+	return ret;
+}
+
 void *dev_get_plat(const struct udevice *dev)
 {
 	if (!dev) {
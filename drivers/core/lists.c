@@ -18,7 +18,13 @@
 #include <dm/uclass.h>
 #include <dm/util.h>
 #include <fdtdec.h>
+#include <malloc.h>
+#include <asm/global_data.h>
 #include <linux/compiler.h>
+#include <linux/err.h>
+#include <linux/log2.h>
+
+DECLARE_GLOBAL_DATA_PTR;
 
 struct driver *lists_driver_lookup_name(const char *name)
 {
@@ -196,11 +202,148 @@ static int driver_check_compatible(const struct udevice_id *of_match,
 	return -ENOENT;
 }
 
-int lists_bind_fdt(struct udevice *parent, ofnode node, struct udevice **devp,
-		   struct driver *drv, bool pre_reloc_only)
+#define COMPAT_HASH_NONE	0xffff
+
+/*
+ * struct dm_compat_hash - index of driver compatible strings
+ *
+ * Entries refer to drivers and of_match entries by index rather than by
+ * pointer, to keep the table small enough for the pre-relocation heap. Each
+ * chain lists entries in linker-list order, so the first match found is the
+ * same driver which a linear search would find.
+ *
+ * @mask: number of buckets - 1
+ * @heads: index of the first entry in each bucket, or COMPAT_HASH_NONE
+ * @ents: all entries
+ */
+struct dm_compat_hash {
+	uint mask;
+	u16 *heads;
+	struct dm_compat_hash_ent {
+		u16 drv;	/* index in the driver linker list */
+		u16 id;		/* index in the driver's of_match table */
+		u16 next;	/* next entry in the bucket */
+	} *ents;
+};
+
+static uint compat_hash_key(const char *compat)
+{
+	uint hash = 2166136261U;	/* FNV-1a */
+
+	while (*compat)
+		hash = (hash ^ (u8)*compat++) * 16777619U;
+
+	return hash;
+}
+
+static struct dm_compat_hash *compat_hash_build(void)
+{
+	struct driver *driver = ll_entry_start(struct driver, driver);
+	const int n_ents = ll_entry_count(struct driver, driver);
+	const struct udevice_id *of_match;
+	struct dm_compat_hash *hash;
+	uint count = 0, buckets, i;
+	size_t size;
+	int drv;
+
+	for (drv = 0; drv < n_ents; drv++) {
+		for (of_match = driver[drv].of_match;
+		     of_match && of_match->compatible; of_match++)
+			count++;
+	}
+	if (!count || count >= COMPAT_HASH_NONE || n_ents >= COMPAT_HASH_NONE)
+		return NULL;
+
+	buckets = roundup_pow_of_two(count);
+	size = sizeof(*hash) + buckets * sizeof(u16) +
+		count * sizeof(struct dm_compat_hash_ent);
+#if CONFIG_IS_ENABLED(SYS_MALLOC_F)
+	/* leave most of the early heap for the devices themselves */
+	if (!(gd->flags & GD_FLG_FULL_MALLOC_INIT) &&
+	    size > (gd->malloc_limit - gd->malloc_ptr) / 4) {
+		log_debug("No room for compatible hash (%zx bytes)\n", size);
+		return NULL;
+	}
+#endif
+	hash = malloc(size);
+	if (!hash)
+		return NULL;
+	hash->mask = buckets - 1;
+	hash->ents = (void *)(hash + 1);
+	hash->heads = (void *)(hash->ents + count);
+	memset(hash->heads, 0xff, buckets * sizeof(u16));
+
+	/* add in reverse, at the head of each chain, to keep linker order */
+	i = count;
+	for (drv = n_ents - 1; drv >= 0; drv--) {
+		int id;
+
+		of_match = driver[drv].of_match;
+		if (!of_match)
+			continue;
+		for (id = 0; of_match[id].compatible; id++)
+			;
+		while (id--) {
+			uint bucket = compat_hash_key(of_match[id].compatible) &
+				      hash->mask;
+
+			i--;
+			hash->ents[i].drv = drv;
+			hash->ents[i].id = id;
+			hash->ents[i].next = hash->heads[bucket];
+			hash->heads[bucket] = i;
+		}
+	}
+	log_debug("Compatible hash: %u strings, %u buckets, %zx bytes\n",
+		  count, buckets, size);
+
+	return hash;
+}
+
+struct driver *lists_driver_lookup_compat(const char *compat,
+					  const struct udevice_id **idp)
 {
 	struct driver *driver = ll_entry_start(struct driver, driver);
 	const int n_ents = ll_entry_count(struct driver, driver);
+	struct dm_compat_hash *hash = gd_dm_compat_hash();
+	struct driver *entry;
+	uint i;
+
+	if (CONFIG_IS_ENABLED(DM_COMPAT_HASH) && !hash) {
+		hash = compat_hash_build();
+		/* on failure, don't try again until relocation drops it */
+		if (!hash)
+			hash = ERR_PTR(-ENOMEM);
+		gd_set_dm_compat_hash(hash);
+	}
+
+	if (!IS_ERR_OR_NULL(hash)) {
+		for (i = hash->heads[compat_hash_key(compat) & hash->mask];
+		     i != COMPAT_HASH_NONE; i = hash->ents[i].next) {
+			const struct dm_compat_hash_ent *ent = &hash->ents[i];
+			const struct udevice_id *id;
+
+			id = &driver[ent->drv].of_match[ent->id];
+			if (!strcmp(id->compatible, compat)) {
+				*idp = id;
+				return &driver[ent->drv];
+			}
+		}
+
+		return NULL;
+	}
+
+	for (entry = driver; entry != driver + n_ents; entry++) {
+		if (!driver_check_compatible(entry->of_match, idp, compat))
+			return entry;
+	}
+
+	return NULL;
+}
+
+int lists_bind_fdt(struct udevice *parent, ofnode node, struct udevice **devp,
+		   struct driver *drv, bool pre_reloc_only)
+{
 	const struct udevice_id *id;
 	struct driver *entry;
 	struct udevice *dev;
@@ -238,20 +381,17 @@ int lists_bind_fdt(struct udevice *parent, ofnode node, struct udevice **devp,
 			  compat);
 
 		id = NULL;
-		for (entry = driver; entry != driver + n_ents; entry++) {
-			if (drv) {
-				if (drv != entry)
-					continue;
-				if (!entry->of_match)
-					break;
-			}
-			ret = driver_check_compatible(entry->of_match, &id,
-						      compat);
-			if (!ret)
-				break;
+		if (drv) {
+			entry = drv;
+			if (entry->of_match &&
+			    driver_check_compatible(entry->of_match, &id,
+						    compat))
+				continue;
+		} else {
+			entry = lists_driver_lookup_compat(compat, &id);
+			if (!entry)
+				continue;
 		}
-		if (entry == driver + n_ents)
-			continue;
 
 		if (pre_reloc_only) {
 			if (!ofnode_pre_reloc(node) &&
@@ -21,6 +21,7 @@
 
 #include <log.h>
 #include <malloc.h>
+#include <of_live.h>
 #include <asm/global_data.h>
 #include <linux/bug.h>
 #include <linux/libfdt.h>
@@ -131,7 +132,7 @@ struct property *of_find_property(const struct device_node *np,
 	if (!np)
 		return NULL;
 
-	for (pp = np->properties; pp; pp = pp->next) {
+	for (pp = of_live_get_props(np); pp; pp = pp->next) {
 		if (strcmp(pp->name, name) == 0) {
 			if (lenp)
 				*lenp = pp->length;
@@ -179,7 +180,7 @@ const struct property *of_get_first_property(const struct device_node *np)
 	if (!np)
 		return NULL;
 
-	return  np->properties;
+	return of_live_get_props(np);
 }
 
 const struct property *of_get_next_property(const struct device_node *np,
@@ -341,7 +342,7 @@ static struct device_node *__of_find_node_by_path(struct device_node *parent,
 }
 
 #define for_each_property_of_node(dn, pp) \
-	for (pp = dn->properties; pp != NULL; pp = pp->next)
+	for (pp = of_live_get_props(dn); pp != NULL; pp = pp->next)
 
 struct device_node *of_find_node_opts_by_path(struct device_node *root,
 					      const char *path,
@@ -945,7 +946,7 @@ int of_write_prop(struct device_node *np, const char *propname, int len,
 	if (!np)
 		return -EINVAL;
 
-	for (pp = np->properties; pp; pp = pp->next) {
+	for (pp = of_live_get_props(np); pp; pp = pp->next) {
 		if (strcmp(pp->name, propname) == 0) {
 			/* Property exists -> change value */
 			pp->value = (void *)value;
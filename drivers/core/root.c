@@ -8,6 +8,7 @@
 
 #define LOG_CATEGORY UCLASS_ROOT
 
+#include <bootstage.h>
 #include <errno.h>
 #include <fdtdec.h>
 #include <log.h>
@@ -325,7 +326,9 @@ static int dm_scan(bool pre_reloc_only)
 	}
 
 	if (CONFIG_IS_ENABLED(OF_REAL)) {
+		bootstage_start(BOOTSTAGE_ID_ACCUM_DM_BIND, "dm_bind");
 		ret = dm_extended_scan(pre_reloc_only);
+		bootstage_accum(BOOTSTAGE_ID_ACCUM_DM_BIND);
 		if (ret) {
 			dm_warn("dm_extended_scan() failed: %d\n", ret);
 			return ret;
@@ -0,0 +1,100 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Jobs run on secondary CPUs
+ */
+
+#define LOG_CATEGORY UCLASS_CPU
+
+#include <cpu.h>
+#include <cpu_job.h>
+#include <dm.h>
+#include <log.h>
+#include <watchdog.h>
+#include <linux/errno.h>
+#include <linux/list.h>
+
+/* Jobs which have been started on another CPU but not yet waited for */
+static LIST_HEAD(cpu_jobs);
+
+static bool cpu_job_busy(struct udevice *cpu)
+{
+	struct cpu_job *job;
+
+	list_for_each_entry(job, &cpu_jobs, sibling) {
+		if (job->cpu == cpu &&
+		    !__atomic_load_n(&job->done, __ATOMIC_ACQUIRE))
+			return true;
+	}
+
+	return false;
+}
+
+int cpu_job_start(struct cpu_job *job)
+{
+	struct udevice *cpu;
+	int ret;
+
+	job->done = false;
+	job->cpu = NULL;
+	uclass_foreach_dev_probe(UCLASS_CPU, cpu) {
+		struct cpu_ops *ops = cpu_get_ops(cpu);
+
+		if (!ops->start_job || cpu_is_current(cpu) > 0 ||
+		    cpu_job_busy(cpu))
+			continue;
+
+		/* the job may finish before start_job() returns */
+		job->cpu = cpu;
+		list_add_tail(&job->sibling, &cpu_jobs);
+		ret = ops->start_job(cpu, job);
+		if (!ret) {
+			log_debug("Started job on %s\n", cpu->name);
+			return 0;
+		}
+		list_del(&job->sibling);
+		job->cpu = NULL;
+		log_debug("Cannot start job on %s (err=%d)\n", cpu->name, ret);
+	}
+
+	return -EBUSY;
+}
+
+int cpu_job_wait(struct cpu_job *job)
+{
+	if (!job->cpu) {
+		if (!job->done)
+			cpu_job_run(job);
+		return job->ret;
+	}
+
+	while (!__atomic_load_n(&job->done, __ATOMIC_ACQUIRE))
+		schedule();
+	list_del(&job->sibling);
+	job->cpu = NULL;
+
+	return job->ret;
+}
+
+int cpu_run_jobs(struct cpu_job *jobs, int count)
+{
+	int ret = 0;
+	int i;
+
+	for (i = 0; i < count; i++)
+		cpu_job_start(&jobs[i]);
+
+	/* jobs which did not find a CPU run here, while the others proceed */
+	for (i = 0; i < count; i++) {
+		if (!jobs[i].cpu)
+			cpu_job_run(&jobs[i]);
+	}
+
+	for (i = 0; i < count; i++) {
+		int err = cpu_job_wait(&jobs[i]);
+
+		if (err && !ret)
+			ret = err;
+	}
+
+	return ret;
+}
@@ -6,6 +6,9 @@
 
 #include <dm.h>
 #include <cpu.h>
+#include <cpu_job.h>
+#include <os.h>
+#include <asm/cpu.h>
 
 static int cpu_sandbox_get_desc(const struct udevice *dev, char *buf, int size)
 {
@@ -52,12 +55,34 @@ static int cpu_sandbox_is_current(struct udevice *dev)
 	return 0;
 }
 
+static bool cpu_jobs_enabled = true;
+
+void cpu_sandbox_set_jobs(bool enable)
+{
+	cpu_jobs_enabled = enable;
+}
+
+static void cpu_sandbox_job(void *arg)
+{
+	cpu_job_run(arg);
+}
+
+/* Each CPU's jobs run on a host thread of their own */
+static int cpu_sandbox_start_job(struct udevice *dev, struct cpu_job *job)
+{
+	if (!cpu_jobs_enabled)
+		return -ENOSYS;
+
+	return os_thread_start(cpu_sandbox_job, job);
+}
+
 static const struct cpu_ops cpu_sandbox_ops = {
 	.get_desc = cpu_sandbox_get_desc,
 	.get_info = cpu_sandbox_get_info,
 	.get_count = cpu_sandbox_get_count,
 	.get_vendor = cpu_sandbox_get_vendor,
 	.is_current = cpu_sandbox_is_current,
+	.start_job = cpu_sandbox_start_job,
 };
 
 static int cpu_sandbox_bind(struct udevice *dev)
@@ -77,12 +77,24 @@ static int i2c_setup_offset(struct dm_i2c_chip *chip, uint offset,
 	return 0;
 }
 
+/* Run a transfer, keeping other threads off the bus while it waits */
+static int i2c_bus_xfer(struct udevice *bus, struct i2c_msg *msg, int nmsgs)
+{
+	struct dm_i2c_bus *i2c = dev_get_uclass_priv(bus);
+	int ret;
+
+	uthread_mutex_lock(&i2c->lock);
+	ret = i2c_get_ops(bus)->xfer(bus, msg, nmsgs);
+	uthread_mutex_unlock(&i2c->lock);
+
+	return ret;
+}
+
 static int i2c_read_bytewise(struct udevice *dev, uint offset,
 			     uint8_t *buffer, int len)
 {
 	struct dm_i2c_chip *chip = dev_get_parent_plat(dev);
 	struct udevice *bus = dev_get_parent(dev);
-	struct dm_i2c_ops *ops = i2c_get_ops(bus);
 	struct i2c_msg msg[2], *ptr;
 	uint8_t offset_buf[I2C_MAX_OFFSET_LEN];
 	int ret;
@@ -98,7 +110,7 @@ static int i2c_read_bytewise(struct udevice *dev, uint offset,
 		ptr->buf = &buffer[i];
 		ptr++;
 
-		ret = ops->xfer(bus, msg, ptr - msg);
+		ret = i2c_bus_xfer(bus, msg, ptr - msg);
 		if (ret)
 			return ret;
 	}
@@ -111,7 +123,6 @@ static int i2c_write_bytewise(struct udevice *dev, uint offset,
 {
 	struct dm_i2c_chip *chip = dev_get_parent_plat(dev);
 	struct udevice *bus = dev_get_parent(dev);
-	struct dm_i2c_ops *ops = i2c_get_ops(bus);
 	struct i2c_msg msg[1];
 	uint8_t buf[I2C_MAX_OFFSET_LEN + 1];
 	int ret;
@@ -122,7 +133,7 @@ static int i2c_write_bytewise(struct udevice *dev, uint offset,
 			return -EINVAL;
 		buf[msg->len++] = buffer[i];
 
-		ret = ops->xfer(bus, msg, 1);
+		ret = i2c_bus_xfer(bus, msg, 1);
 		if (ret)
 			return ret;
 	}
@@ -157,7 +168,7 @@ int dm_i2c_read(struct udevice *dev, uint offset, uint8_t *buffer, int len)
 	}
 	msg_count = ptr - msg;
 
-	return ops->xfer(bus, msg, msg_count);
+	return i2c_bus_xfer(bus, msg, msg_count);
 }
 
 int dm_i2c_write(struct udevice *dev, uint offset, const uint8_t *buffer,
@@ -204,7 +215,7 @@ int dm_i2c_write(struct udevice *dev, uint offset, const uint8_t *buffer,
 	msg->len += len;
 	memcpy(buf + chip->offset_len, buffer, len);
 
-	ret = ops->xfer(bus, msg, 1);
+	ret = i2c_bus_xfer(bus, msg, 1);
 	if (buf != _buf)
 		free(buf);
 	return ret;
@@ -218,7 +229,7 @@ int dm_i2c_xfer(struct udevice *dev, struct i2c_msg *msg, int nmsgs)
 	if (!ops->xfer)
 		return -ENOSYS;
 
-	return ops->xfer(bus, msg, nmsgs);
+	return i2c_bus_xfer(bus, msg, nmsgs);
 }
 
 int dm_i2c_reg_read(struct udevice *dev, uint offset)
@@ -272,7 +283,11 @@ static int i2c_probe_chip(struct udevice *bus, uint chip_addr,
 	int ret;
 
 	if (ops->probe_chip) {
+		struct dm_i2c_bus *i2c = dev_get_uclass_priv(bus);
+
+		uthread_mutex_lock(&i2c->lock);
 		ret = ops->probe_chip(bus, chip_addr, chip_flags);
+		uthread_mutex_unlock(&i2c->lock);
 		if (ret != -ENOSYS)
 			return ret;
 	}
@@ -286,7 +301,7 @@ static int i2c_probe_chip(struct udevice *bus, uint chip_addr,
 	msg->len = 0;
 	msg->buf = NULL;
 
-	return ops->xfer(bus, msg, 1);
+	return i2c_bus_xfer(bus, msg, 1);
 }
 
 static int i2c_bind_driver(struct udevice *bus, uint chip_addr, uint offset_len,
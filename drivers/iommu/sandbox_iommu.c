@@ -60,6 +60,15 @@ static int sandbox_iommu_probe(struct udevice *dev)
 	return 0;
 }
 
+static int sandbox_iommu_remove(struct udevice *dev)
+{
+	struct sandbox_iommu_priv *priv = dev_get_priv(dev);
+
+	lmb_uninit(&priv->lmb);
+
+	return 0;
+}
+
 static const struct udevice_id sandbox_iommu_ids[] = {
 	{ .compatible = "sandbox,iommu" },
 	{ /* sentinel */ }
@@ -72,4 +81,5 @@ U_BOOT_DRIVER(sandbox_iommu) = {
 	.priv_auto = sizeof(struct sandbox_iommu_priv),
 	.ops = &sandbox_iommu_ops,
 	.probe = sandbox_iommu_probe,
+	.remove = sandbox_iommu_remove,
 };
@@ -420,11 +420,29 @@ int mmc_send_stop_transmission(struct mmc *mmc, bool write)
 	return mmc_send_cmd(mmc, &cmd, NULL);
 }
 
+int mmc_set_blockcount(struct mmc *mmc, unsigned int blockcount,
+		       bool is_rel_write)
+{
+	struct mmc_cmd cmd = {0};
+
+	cmd.cmdidx = MMC_CMD_SET_BLOCK_COUNT;
+	cmd.cmdarg = blockcount & 0x0000FFFF;
+	if (is_rel_write)
+		cmd.cmdarg |= 1 << 31;
+	cmd.resp_type = MMC_RSP_R1;
+
+	return mmc_send_cmd(mmc, &cmd, NULL);
+}
+
 static int mmc_read_blocks(struct mmc *mmc, void *dst, lbaint_t start,
 			   lbaint_t blkcnt)
 {
 	struct mmc_cmd cmd;
 	struct mmc_data data;
+	bool sbc = blkcnt > 1 && mmc_use_cmd23(mmc);
+
+	if (sbc && mmc_set_blockcount(mmc, blkcnt, false))
+		return 0;
 
 	if (blkcnt > 1)
 		cmd.cmdidx = MMC_CMD_READ_MULTIPLE_BLOCK;
@@ -446,7 +464,7 @@ static int mmc_read_blocks(struct mmc *mmc, void *dst, lbaint_t start,
 	if (mmc_send_cmd(mmc, &cmd, &data))
 		return 0;
 
-	if (blkcnt > 1) {
+	if (blkcnt > 1 && !sbc) {
 		if (mmc_send_stop_transmission(mmc, false)) {
 #if !defined(CONFIG_SPL_BUILD) || defined(CONFIG_SPL_LIBCOMMON_SUPPORT)
 			pr_err("mmc fail to send stop cmd\n");
@@ -512,6 +530,9 @@ ulong mmc_bread(struct blk_desc *block_dev, lbaint_t start, lbaint_t blkcnt,
 	}
 
 	b_max = mmc_get_b_max(mmc, dst, blkcnt);
+	/* the CMD23 block count is 16 bits */
+	if (mmc_use_cmd23(mmc))
+		b_max = min(b_max, 0xffffU);
 
 	do {
 		cur = (blocks_todo > b_max) ? b_max : blocks_todo;
@@ -1390,6 +1411,9 @@ static int sd_get_capabilities(struct mmc *mmc)
 	if (mmc->scr[0] & SD_DATA_4BIT)
 		mmc->card_caps |= MMC_MODE_4BIT;
 
+	if (mmc->scr[0] & SD_CMD23_SUPPORT)
+		mmc->cmd23 = true;
+
 	/* Version 1.0 doesn't support switching */
 	if (mmc->version == SD_VERSION_1_0)
 		return 0;
@@ -2471,6 +2495,13 @@ static int mmc_startup_v4(struct mmc *mmc)
 	mmc->can_trim =
 		!!(ext_csd[EXT_CSD_SEC_FEATURE] & EXT_CSD_SEC_FEATURE_TRIM_EN);
 
+	/* CMD23 is mandatory from v3.1 */
+	mmc->cmd23 = true;
+#if CONFIG_IS_ENABLED(MMC_WRITE)
+	mmc->can_rel_write =
+		!!(ext_csd[EXT_CSD_WR_REL_PARAM] & EXT_CSD_EN_REL_WR);
+#endif
+
 	return 0;
 error:
 	if (mmc->ext_csd) {
@@ -2490,6 +2521,13 @@ static int mmc_startup(struct mmc *mmc)
 	struct mmc_cmd cmd;
 	struct blk_desc *bdesc;
 
+	/* set again below if the new card supports them */
+	mmc->cmd23 = false;
+#if CONFIG_IS_ENABLED(MMC_WRITE)
+	mmc->can_rel_write = false;
+	mmc->rel_write = false;
+#endif
+
 #ifdef CONFIG_MMC_SPI_CRC_ON
 	if (mmc_host_is_spi(mmc)) { /* enable CRC check for spi */
 		cmd.cmdidx = MMC_CMD_SPI_CRC_ON_OFF;
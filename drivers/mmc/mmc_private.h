@@ -17,6 +17,19 @@ int mmc_poll_for_busy(struct mmc *mmc, int timeout);
 
 int mmc_set_blocklen(struct mmc *mmc, int len);
 
+/**
+ * mmc_use_cmd23() - check whether multi-block transfers use SET_BLOCK_COUNT
+ *
+ * @mmc:	MMC device
+ * Return: true to send CMD23 ahead of multi-block transfers instead of
+ *	ending them with STOP_TRANSMISSION
+ */
+static inline bool mmc_use_cmd23(struct mmc *mmc)
+{
+	return IS_ENABLED(CONFIG_MMC_CMD23) && mmc->cmd23 &&
+		!mmc_host_is_spi(mmc);
+}
+
 #if CONFIG_IS_ENABLED(BLK)
 ulong mmc_bread(struct udevice *dev, lbaint_t start, lbaint_t blkcnt,
 		void *dst);
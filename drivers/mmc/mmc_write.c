@@ -144,6 +144,7 @@ static ulong mmc_write_blocks(struct mmc *mmc, lbaint_t start,
 	struct mmc_cmd cmd;
 	struct mmc_data data;
 	int timeout_ms = 1000;
+	bool sbc;
 
 	if ((start + blkcnt) > mmc_get_blk_desc(mmc)->lba) {
 		printf("MMC: block number 0x" LBAF " exceeds max(0x" LBAF ")\n",
@@ -153,7 +154,15 @@ static ulong mmc_write_blocks(struct mmc *mmc, lbaint_t start,
 
 	if (blkcnt == 0)
 		return 0;
-	else if (blkcnt == 1)
+
+	/* a reliable write is always a pre-defined multiple-block write */
+	sbc = mmc_use_cmd23(mmc) && (blkcnt > 1 || mmc->rel_write);
+	if (sbc && mmc_set_blockcount(mmc, blkcnt, mmc->rel_write)) {
+		printf("mmc fail to set block count\n");
+		return 0;
+	}
+
+	if (blkcnt == 1 && !sbc)
 		cmd.cmdidx = MMC_CMD_WRITE_SINGLE_BLOCK;
 	else
 		cmd.cmdidx = MMC_CMD_WRITE_MULTIPLE_BLOCK;
@@ -178,7 +187,7 @@ static ulong mmc_write_blocks(struct mmc *mmc, lbaint_t start,
 	/* SPI multiblock writes terminate using a special
 	 * token, not a STOP_TRANSMISSION request.
 	 */
-	if (!mmc_host_is_spi(mmc) && blkcnt > 1) {
+	if (!mmc_host_is_spi(mmc) && blkcnt > 1 && !sbc) {
 		cmd.cmdidx = MMC_CMD_STOP_TRANSMISSION;
 		cmd.cmdarg = 0;
 		cmd.resp_type = MMC_RSP_R1b;
@@ -208,6 +217,7 @@ ulong mmc_bwrite(struct blk_desc *block_dev, lbaint_t start, lbaint_t blkcnt,
 #endif
 	int dev_num = block_dev->devnum;
 	lbaint_t cur, blocks_todo = blkcnt;
+	uint b_max;
 	int err;
 
 	struct mmc *mmc = find_mmc_device(dev_num);
@@ -221,9 +231,13 @@ ulong mmc_bwrite(struct blk_desc *block_dev, lbaint_t start, lbaint_t blkcnt,
 	if (mmc_set_blocklen(mmc, mmc->write_bl_len))
 		return 0;
 
+	b_max = mmc->cfg->b_max;
+	/* the CMD23 block count is 16 bits */
+	if (mmc_use_cmd23(mmc))
+		b_max = min(b_max, 0xffffU);
+
 	do {
-		cur = (blocks_todo > mmc->cfg->b_max) ?
-			mmc->cfg->b_max : blocks_todo;
+		cur = (blocks_todo > b_max) ? b_max : blocks_todo;
 		if (mmc_write_blocks(mmc, start, cur, src) != cur)
 			return 0;
 		blocks_todo -= cur;
@@ -233,3 +247,13 @@ ulong mmc_bwrite(struct blk_desc *block_dev, lbaint_t start, lbaint_t blkcnt,
 
 	return blkcnt;
 }
+
+int mmc_set_rel_write(struct mmc *mmc, bool enable)
+{
+	if (enable && (!mmc->can_rel_write || !mmc_use_cmd23(mmc)))
+		return -EOPNOTSUPP;
+
+	mmc->rel_write = enable;
+
+	return 0;
+}
@@ -30,6 +30,8 @@ struct sandbox_mmc_priv {
 	char *buf;
 	int csize;	/* CSIZE value to report */
 	int size;
+	uint blkcnt;	/* block count set by CMD23, 0 if none */
+	bool predefined;	/* last transfer ended by itself after CMD23 */
 };
 
 /**
@@ -77,17 +79,30 @@ static int sandbox_mmc_send_cmd(struct udevice *dev, struct mmc_cmd *cmd,
 			resp[4] = (cmd->cmdarg & 0xF) << 24;
 		break;
 	}
+	case MMC_CMD_SET_BLOCK_COUNT:
+		priv->blkcnt = cmd->cmdarg & 0xffff;
+		break;
 	case MMC_CMD_READ_SINGLE_BLOCK:
 	case MMC_CMD_READ_MULTIPLE_BLOCK:
-		memcpy(data->dest, &priv->buf[cmd->cmdarg * data->blocksize],
-		       data->blocks * data->blocksize);
-		break;
 	case MMC_CMD_WRITE_SINGLE_BLOCK:
 	case MMC_CMD_WRITE_MULTIPLE_BLOCK:
-		memcpy(&priv->buf[cmd->cmdarg * data->blocksize], data->src,
-		       data->blocks * data->blocksize);
+		/* a pre-defined transfer must match the block count */
+		priv->predefined = priv->blkcnt != 0;
+		if (priv->blkcnt && priv->blkcnt != data->blocks)
+			return -EINVAL;
+		priv->blkcnt = 0;
+		if (data->flags & MMC_DATA_READ)
+			memcpy(data->dest,
+			       &priv->buf[cmd->cmdarg * data->blocksize],
+			       data->blocks * data->blocksize);
+		else
+			memcpy(&priv->buf[cmd->cmdarg * data->blocksize],
+			       data->src, data->blocks * data->blocksize);
 		break;
 	case MMC_CMD_STOP_TRANSMISSION:
+		/* the card is already back in transfer state */
+		if (priv->predefined)
+			return -EILSEQ;
 		break;
 	case SD_CMD_ERASE_WR_BLK_START:
 		erase_start = cmd->cmdarg;
@@ -117,7 +132,8 @@ static int sandbox_mmc_send_cmd(struct udevice *dev, struct mmc_cmd *cmd,
 	case SD_CMD_APP_SEND_SCR: {
 		u32 *scr = (u32 *)data->dest;
 
-		scr[0] = cpu_to_be32(2 << 24 | 1 << 15);  /* SD version 3 */
+		/* SD version 3, with CMD23 */
+		scr[0] = cpu_to_be32(2 << 24 | 1 << 15 | SD_CMD23_SUPPORT);
 		break;
 	}
 	default:
@@ -1021,13 +1021,18 @@ int phy_modify(struct phy_device *phydev, int devad, int regnum, u16 mask,
 int phy_read(struct phy_device *phydev, int devad, int regnum)
 {
 	struct mii_dev *bus = phydev->bus;
+	int ret;
 
 	if (!bus || !bus->read) {
 		debug("%s: No bus configured\n", __func__);
 		return -1;
 	}
 
-	return bus->read(bus, phydev->addr, devad, regnum);
+	uthread_mutex_lock(&bus->lock);
+	ret = bus->read(bus, phydev->addr, devad, regnum);
+	uthread_mutex_unlock(&bus->lock);
+
+	return ret;
 }
 
 /**
@@ -1041,13 +1046,18 @@ int phy_read(struct phy_device *phydev, int devad, int regnum)
 int phy_write(struct phy_device *phydev, int devad, int regnum, u16 val)
 {
 	struct mii_dev *bus = phydev->bus;
+	int ret;
 
 	if (!bus || !bus->write) {
 		debug("%s: No bus configured\n", __func__);
 		return -1;
 	}
 
-	return bus->write(bus, phydev->addr, devad, regnum, val);
+	uthread_mutex_lock(&bus->lock);
+	ret = bus->write(bus, phydev->addr, devad, regnum, val);
+	uthread_mutex_unlock(&bus->lock);
+
+	return ret;
 }
 
 /**
@@ -1081,6 +1091,7 @@ void phy_mmd_start_indirect(struct phy_device *phydev, int devad, int regnum)
 int phy_read_mmd(struct phy_device *phydev, int devad, int regnum)
 {
 	struct phy_driver *drv = phydev->drv;
+	int ret;
 
 	if (regnum > (u16)~0 || devad > 32)
 		return -EINVAL;
@@ -1094,11 +1105,18 @@ int phy_read_mmd(struct phy_device *phydev, int devad, int regnum)
 	    devad == MDIO_DEVAD_NONE || !devad)
 		return phy_read(phydev, devad, regnum);
 
-	/* indirect C22 access */
+	if (!phydev->bus)
+		return -1;
+
+	/* indirect C22 access, which another thread must not split */
+	uthread_mutex_lock(&phydev->bus->lock);
 	phy_mmd_start_indirect(phydev, devad, regnum);
 
 	/* Read the content of the MMD's selected register */
-	return phy_read(phydev, MDIO_DEVAD_NONE, MII_MMD_DATA);
+	ret = phy_read(phydev, MDIO_DEVAD_NONE, MII_MMD_DATA);
+	uthread_mutex_unlock(&phydev->bus->lock);
+
+	return ret;
 }
 
 /**
@@ -1113,6 +1131,7 @@ int phy_read_mmd(struct phy_device *phydev, int devad, int regnum)
 int phy_write_mmd(struct phy_device *phydev, int devad, int regnum, u16 val)
 {
 	struct phy_driver *drv = phydev->drv;
+	int ret;
 
 	if (regnum > (u16)~0 || devad > 32)
 		return -EINVAL;
@@ -1126,11 +1145,18 @@ int phy_write_mmd(struct phy_device *phydev, int devad, int regnum, u16 val)
 	    devad == MDIO_DEVAD_NONE || !devad)
 		return phy_write(phydev, devad, regnum, val);
 
-	/* indirect C22 access */
+	if (!phydev->bus)
+		return -1;
+
+	/* indirect C22 access, which another thread must not split */
+	uthread_mutex_lock(&phydev->bus->lock);
 	phy_mmd_start_indirect(phydev, devad, regnum);
 
 	/* Write the data into MMD's selected register */
-	return phy_write(phydev, MDIO_DEVAD_NONE, MII_MMD_DATA, val);
+	ret = phy_write(phydev, MDIO_DEVAD_NONE, MII_MMD_DATA, val);
+	uthread_mutex_unlock(&phydev->bus->lock);
+
+	return ret;
 }
 
 /**
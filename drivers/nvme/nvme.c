@@ -17,7 +17,7 @@
 #include <linux/compat.h>
 #include "nvme.h"
 
-#define NVME_Q_DEPTH		2
+#define NVME_Q_DEPTH		CONFIG_VAL(NVME_QUEUE_DEPTH)
 #define NVME_AQ_DEPTH		2
 #define NVME_SQ_SIZE(depth)	(depth * sizeof(struct nvme_command))
 #define NVME_CQ_SIZE(depth)	(depth * sizeof(struct nvme_completion))
@@ -25,7 +25,6 @@
 				      ARCH_DMA_MINALIGN)
 #define ADMIN_TIMEOUT		60
 #define IO_TIMEOUT		30
-#define MAX_PRP_POOL		512
 
 static int nvme_wait_csts(struct nvme_dev *dev, u32 mask, u32 val)
 {
@@ -44,16 +43,29 @@ static int nvme_wait_csts(struct nvme_dev *dev, u32 mask, u32 val)
 	return -ETIME;
 }
 
-static int nvme_setup_prps(struct nvme_dev *dev, u64 *prp2,
-			   int total_len, u64 dma_addr)
+/**
+ * nvme_setup_prps() - set up the PRP entries for a transfer
+ *
+ * Each I/O queue slot has its own PRP list page, allocated when first needed,
+ * so commands which are in flight at the same time never share a list.
+ * nvme_blk_rw() limits each command to what a single list page can describe.
+ *
+ * @dev:	NVMe device
+ * @slot:	Queue slot which the command will use
+ * @prp2:	Returns the value for the PRP2 field of the command
+ * @total_len:	Number of bytes to transfer
+ * @dma_addr:	Address of the buffer
+ * Return: 0 if OK, -EINVAL if the transfer does not fit in one list page,
+ * -ENOMEM if the list page cannot be allocated
+ */
+static int nvme_setup_prps(struct nvme_dev *dev, struct nvme_slot *slot,
+			   u64 *prp2, int total_len, u64 dma_addr)
 {
 	u32 page_size = dev->page_size;
 	int offset = dma_addr & (page_size - 1);
-	u64 *prp_pool;
+	u64 *prp_list;
 	int length = total_len;
 	int i, nprps;
-	u32 prps_per_page = page_size >> 3;
-	u32 num_pages;
 
 	length -= (page_size - offset);
 
@@ -71,39 +83,23 @@ static int nvme_setup_prps(struct nvme_dev *dev, u64 *prp2,
 	}
 
 	nprps = DIV_ROUND_UP(length, page_size);
-	num_pages = DIV_ROUND_UP(nprps - 1, prps_per_page - 1);
+	if (nprps > dev->prp_entry_num)
+		return -EINVAL;
 
-	if (nprps > dev->prp_entry_num) {
-		free(dev->prp_pool);
-		/*
-		 * Always increase in increments of pages.  It doesn't waste
-		 * much memory and reduces the number of allocations.
-		 */
-		dev->prp_pool = memalign(page_size, num_pages * page_size);
-		if (!dev->prp_pool) {
-			printf("Error: malloc prp_pool fail\n");
+	if (!slot->prp_list) {
+		slot->prp_list = memalign(page_size, page_size);
+		if (!slot->prp_list)
 			return -ENOMEM;
-		}
-		dev->prp_entry_num = num_pages * (prps_per_page - 1) + 1;
 	}
-
-	prp_pool = dev->prp_pool;
-	i = 0;
-	while (nprps) {
-		if ((i == (prps_per_page - 1)) && nprps > 1) {
-			*(prp_pool + i) = cpu_to_le64((ulong)prp_pool +
-					page_size);
-			i = 0;
-			prp_pool += page_size;
-		}
-		*(prp_pool + i++) = cpu_to_le64(dma_addr);
+	prp_list = slot->prp_list;
+	for (i = 0; i < nprps; i++) {
+		prp_list[i] = cpu_to_le64(dma_addr);
 		dma_addr += page_size;
-		nprps--;
 	}
-	*prp2 = (ulong)dev->prp_pool;
+	*prp2 = (ulong)prp_list;
 
-	flush_dcache_range((ulong)dev->prp_pool, (ulong)dev->prp_pool +
-			   num_pages * page_size);
+	flush_dcache_range((ulong)prp_list, (ulong)prp_list +
+			   roundup(nprps * sizeof(u64), ARCH_DMA_MINALIGN));
 
 	return 0;
 }
@@ -132,30 +128,97 @@ static u16 nvme_read_completion_status(struct nvme_queue *nvmeq, u16 index)
 }
 
 /**
- * nvme_submit_cmd() - copy a command into a queue and ring the doorbell
+ * nvme_queue_cmd() - copy a command into a queue without ringing the doorbell
+ *
+ * This allows several commands to be handed to the controller with a single
+ * doorbell write, see nvme_ring_sq()
  *
  * @nvmeq:	The queue to use
  * @cmd:	The command to send
  */
-static void nvme_submit_cmd(struct nvme_queue *nvmeq, struct nvme_command *cmd)
+static void nvme_queue_cmd(struct nvme_queue *nvmeq, struct nvme_command *cmd)
 {
-	struct nvme_ops *ops;
 	u16 tail = nvmeq->sq_tail;
 
 	memcpy(&nvmeq->sq_cmds[tail], cmd, sizeof(*cmd));
 	flush_dcache_range((ulong)&nvmeq->sq_cmds[tail],
 			   (ulong)&nvmeq->sq_cmds[tail] + sizeof(*cmd));
 
+	if (++tail == nvmeq->q_depth)
+		tail = 0;
+	nvmeq->sq_tail = tail;
+}
+
+/**
+ * nvme_ring_sq() - tell the controller about all queued commands
+ *
+ * @nvmeq:	The queue to use
+ */
+static void nvme_ring_sq(struct nvme_queue *nvmeq)
+{
+	writel(nvmeq->sq_tail, nvmeq->q_db);
+}
+
+/**
+ * nvme_submit_cmd() - copy a command into a queue and ring the doorbell
+ *
+ * @nvmeq:	The queue to use
+ * @cmd:	The command to send
+ */
+static void nvme_submit_cmd(struct nvme_queue *nvmeq, struct nvme_command *cmd)
+{
+	struct nvme_ops *ops;
+	u16 tail = nvmeq->sq_tail;
+
 	ops = (struct nvme_ops *)nvmeq->dev->udev->driver->ops;
 	if (ops && ops->submit_cmd) {
+		memcpy(&nvmeq->sq_cmds[tail], cmd, sizeof(*cmd));
+		flush_dcache_range((ulong)&nvmeq->sq_cmds[tail],
+				   (ulong)&nvmeq->sq_cmds[tail] + sizeof(*cmd));
 		ops->submit_cmd(nvmeq, cmd);
 		return;
 	}
 
-	if (++tail == nvmeq->q_depth)
-		tail = 0;
-	writel(tail, nvmeq->q_db);
-	nvmeq->sq_tail = tail;
+	nvme_queue_cmd(nvmeq, cmd);
+	nvme_ring_sq(nvmeq);
+}
+
+/**
+ * nvme_reap_cq() - retire all new entries in a completion queue
+ *
+ * The entries are copied out and the head doorbell is written once for the
+ * whole batch.
+ *
+ * @nvmeq:	The queue to check
+ * @cqes:	Returns the completed entries
+ * @max:	Maximum number of entries to retire
+ * Return: number of entries retired
+ */
+static int nvme_reap_cq(struct nvme_queue *nvmeq, struct nvme_completion *cqes,
+			int max)
+{
+	u16 head = nvmeq->cq_head;
+	u16 phase = nvmeq->cq_phase;
+	int count = 0;
+
+	/* this invalidates the whole queue, so the entries below are fresh */
+	if ((nvme_read_completion_status(nvmeq, head) & 0x01) != phase)
+		return 0;
+
+	while (count < max &&
+	       (readw(&nvmeq->cqes[head].status) & 0x01) == phase) {
+		memcpy(&cqes[count++], &nvmeq->cqes[head], sizeof(*cqes));
+		if (++head == nvmeq->q_depth) {
+			head = 0;
+			phase = !phase;
+		}
+	}
+
+	writel(head, nvmeq->q_db + nvmeq->dev->db_stride);
+	nvmeq->cq_head = head;
+	nvmeq->cq_phase = phase;
+
+	return count;
 }
 
 static int nvme_submit_sync_cmd(struct nvme_queue *nvmeq,
@@ -243,6 +306,14 @@ static struct nvme_queue *nvme_alloc_queue(struct nvme_dev *dev,
 		goto free_queue;
 	memset((void *)nvmeq->sq_cmds, 0, NVME_SQ_SIZE(depth));
 
+	if (qid != NVME_ADMIN_Q) {
+		nvmeq->slots = calloc(depth, sizeof(*nvmeq->slots));
+		nvmeq->free_slots = calloc(depth, sizeof(*nvmeq->free_slots));
+		nvmeq->reaped = calloc(depth, sizeof(*nvmeq->reaped));
+		if (!nvmeq->slots || !nvmeq->free_slots || !nvmeq->reaped)
+			goto free_slots;
+	}
+
 	nvmeq->dev = dev;
 
 	nvmeq->cq_head = 0;
@@ -259,6 +330,11 @@ static struct nvme_queue *nvme_alloc_queue(struct nvme_dev *dev,
 
 	return nvmeq;
 
+ free_slots:
+	free(nvmeq->slots);
+	free(nvmeq->free_slots);
+	free(nvmeq->reaped);
+	free(nvmeq->sq_cmds);
  free_queue:
 	free((void *)nvmeq->cqes);
  free_nvmeq:
@@ -317,6 +393,15 @@ static int nvme_shutdown_ctrl(struct nvme_dev *dev)
 
 static void nvme_free_queue(struct nvme_queue *nvmeq)
 {
+	int i;
+
+	if (nvmeq->slots) {
+		for (i = 0; i < nvmeq->q_depth; i++)
+			free(nvmeq->slots[i].prp_list);
+	}
+	free(nvmeq->slots);
+	free(nvmeq->free_slots);
+	free(nvmeq->reaped);
 	free((void *)nvmeq->cqes);
 	free(nvmeq->sq_cmds);
 	free(nvmeq);
@@ -650,15 +735,9 @@ static int nvme_get_info_from_identify(struct nvme_dev *dev)
 		 * and is reported as a power of two (2^n).
 		 *
 		 * The spec also says: a value of 0h indicates no restrictions
-		 * on transfer size. But in nvme_blk_read/write() below we have
-		 * the following algorithm for maximum number of logic blocks
-		 * per transfer:
-		 *
-		 * u16 lbas = 1 << (dev->max_transfer_shift - ns->lba_shift);
-		 *
-		 * In order for lbas not to overflow, the maximum number is 15
-		 * which means dev->max_transfer_shift = 15 + 9 (ns->lba_shift).
-		 * Let's use 20 which provides 1MB size.
+		 * on transfer size. nvme_blk_rw() below still splits requests
+		 * at this size so that several commands can be in flight at
+		 * once. Let's use 20 which provides 1MB size.
 		 */
 		dev->max_transfer_shift = 20;
 	}
@@ -746,60 +825,132 @@ static ulong nvme_blk_rw(struct udevice *udev, lbaint_t blknr,
 {
 	struct nvme_ns *ns = dev_get_priv(udev);
 	struct nvme_dev *dev = ns->dev;
-	struct nvme_command c;
+	struct nvme_queue *nvmeq = dev->queues[NVME_IO_Q];
+	struct nvme_slot *slots = nvmeq->slots;
+	u16 *free_slots = nvmeq->free_slots;
+	struct nvme_ops *ops;
 	struct blk_desc *desc = dev_get_uclass_plat(udev);
-	int status;
 	u64 prp2;
 	u64 total_len = blkcnt << desc->log2blksz;
-	u64 temp_len = total_len;
 	uintptr_t temp_buffer = (uintptr_t)buffer;
+	lbaint_t slba = blknr;
+	lbaint_t end = blknr + blkcnt;
+	lbaint_t fail = end;
+	u32 lbas;
+	int depth, inflight, nfree, i, ret;
+	ulong timeout_us = IO_TIMEOUT * 100000;
+	ulong start_time;
 
-	u64 slba = blknr;
-	u16 lbas = 1 << (dev->max_transfer_shift - ns->lba_shift);
-	u64 total_lbas = blkcnt;
+	/*
+	 * Split the transfer at the Maximum Data Transfer Size, the 16-bit
+	 * block count and what one page of PRP list can describe
+	 */
+	lbas = 1 << min_t(u32, dev->max_transfer_shift - ns->lba_shift, 16);
+	lbas = min_t(u64, lbas, ((u64)dev->prp_entry_num * dev->page_size) >>
+		     ns->lba_shift);
+
+	/*
+	 * Controllers with their own submission scheme complete commands
+	 * strictly in order, so keep to one command in flight for them
+	 */
+	ops = (struct nvme_ops *)udev->parent->driver->ops;
+	depth = ops && ops->submit_cmd ? 1 : nvmeq->q_depth - 1;
+	for (i = 0; i < depth; i++) {
+		free_slots[i] = i;
+		slots[i].lba = end;
+	}
+	nfree = depth;
+	inflight = 0;
 
 	flush_dcache_range((unsigned long)buffer,
 			   (unsigned long)buffer + total_len);
 
-	c.rw.opcode = read ? nvme_cmd_read : nvme_cmd_write;
-	c.rw.flags = 0;
-	c.rw.nsid = cpu_to_le32(ns->ns_id);
-	c.rw.control = 0;
-	c.rw.dsmgmt = 0;
-	c.rw.reftag = 0;
-	c.rw.apptag = 0;
-	c.rw.appmask = 0;
-	c.rw.metadata = 0;
-
-	while (total_lbas) {
-		if (total_lbas < lbas) {
-			lbas = (u16)total_lbas;
-			total_lbas = 0;
-		} else {
-			total_lbas -= lbas;
+	while (inflight || (slba < end && fail == end)) {
+		int queued = 0;
+		int count;
+
+		/* fill the queue, then ring the doorbell once for the batch */
+		while (nfree && slba < end && fail == end) {
+			u16 slot = free_slots[--nfree];
+			u32 n = min_t(lbaint_t, lbas, end - slba);
+			struct nvme_command *c = &slots[slot].cmd;
+
+			ret = nvme_setup_prps(dev, &slots[slot], &prp2,
+					      n << ns->lba_shift, temp_buffer);
+			if (ret) {
+				free_slots[nfree++] = slot;
+				/* slots in flight come back with their lists */
+				if (ret != -ENOMEM || !inflight)
+					fail = slba;
+				break;
+			}
+			/* keep the command, for the completion hook */
+			memset(c, '\0', sizeof(*c));
+			c->rw.opcode = read ? nvme_cmd_read : nvme_cmd_write;
+			c->rw.nsid = cpu_to_le32(ns->ns_id);
+			c->rw.command_id = cpu_to_le16(slot);
+			c->rw.slba = cpu_to_le64(slba);
+			c->rw.length = cpu_to_le16(n - 1);
+			c->rw.prp1 = cpu_to_le64(temp_buffer);
+			c->rw.prp2 = cpu_to_le64(prp2);
+			if (depth == 1) {
+				nvme_submit_cmd(nvmeq, c);
+			} else {
+				nvme_queue_cmd(nvmeq, c);
+				queued++;
+			}
+			slots[slot].lba = slba;
+			slba += n;
+			temp_buffer += (ulong)n << ns->lba_shift;
+			inflight++;
 		}
+		if (queued)
+			nvme_ring_sq(nvmeq);
+		if (!inflight)
+			break;
 
-		if (nvme_setup_prps(dev, &prp2,
-				    lbas << ns->lba_shift, temp_buffer))
-			return -EIO;
-		c.rw.slba = cpu_to_le64(slba);
-		slba += lbas;
-		c.rw.length = cpu_to_le16(lbas - 1);
-		c.rw.prp1 = cpu_to_le64(temp_buffer);
-		c.rw.prp2 = cpu_to_le64(prp2);
-		status = nvme_submit_sync_cmd(dev->queues[NVME_IO_Q],
-				&c, NULL, IO_TIMEOUT);
-		if (status)
+		start_time = timer_get_us();
+		while (!(count = nvme_reap_cq(nvmeq, nvmeq->reaped,
+					      inflight))) {
+			if (timer_get_us() - start_time >= timeout_us)
+				break;
+		}
+		if (!count) {
+			log_debug("%s: I/O timed out\n", udev->name);
+			/* every slot still in use holds an unfinished command */
+			for (i = 0; i < depth; i++)
+				fail = min(fail, slots[i].lba);
 			break;
-		temp_len -= (u32)lbas << ns->lba_shift;
-		temp_buffer += lbas << ns->lba_shift;
+		}
+
+		for (i = 0; i < count; i++) {
+			u16 slot = le16_to_cpu(nvmeq->reaped[i].command_id);
+			u16 status = le16_to_cpu(nvmeq->reaped[i].status) >> 1;
+
+			if (slot >= depth) {
+				log_debug("%s: bad command id %x\n", udev->name,
+					  slot);
+				continue;
+			}
+			if (ops && ops->complete_cmd)
+				ops->complete_cmd(nvmeq, &slots[slot].cmd);
+			if (status) {
+				printf("ERROR: status = %x, LBA " LBAF "\n",
+				       status, slots[slot].lba);
+				fail = min(fail, slots[slot].lba);
+			}
+			slots[slot].lba = end;
+			free_slots[nfree++] = slot;
+			inflight--;
+		}
 	}
 
 	if (read)
 		invalidate_dcache_range((unsigned long)buffer,
 					(unsigned long)buffer + total_len);
 
-	return (total_len - temp_len) >> desc->log2blksz;
+	/* report only the blocks before the first failed command */
+	return fail - blknr;
 }
 
 static ulong nvme_blk_read(struct udevice *udev, lbaint_t blknr,
@@ -860,14 +1011,8 @@ int nvme_init(struct udevice *udev)
 		goto free_queue;
 	}
 
-	/* Allocate after the page size is known */
-	ndev->prp_pool = memalign(ndev->page_size, MAX_PRP_POOL);
-	if (!ndev->prp_pool) {
-		ret = -ENOMEM;
-		printf("Error: %s: Out of memory!\n", udev->name);
-		goto free_nvme;
-	}
-	ndev->prp_entry_num = MAX_PRP_POOL >> 3;
+	/* each I/O slot allocates its PRP list page when it first needs one */
+	ndev->prp_entry_num = ndev->page_size >> 3;
 
 	ret = nvme_setup_io_queues(ndev);
 	if (ret) {
@@ -7,6 +7,7 @@
 #ifndef __DRIVER_NVME_H__
 #define __DRIVER_NVME_H__
 
+#include <blk.h>
 #include <asm/io.h>
 
 struct nvme_id_power_state {
@@ -618,7 +619,6 @@ struct nvme_dev {
 	u32 stripe_size;
 	u32 page_size;
 	u8 vwc;
-	u64 *prp_pool;
 	u32 prp_entry_num;
 	u32 nn;
 };
@@ -630,6 +630,17 @@ enum nvme_queue_id {
 	NVME_Q_NUM,
 };
 
+/*
+ * A slot of an I/O queue, holding a command which may be in flight. The
+ * command is kept for the completion hook and the PRP list page is allocated
+ * the first time a command in this slot needs one.
+ */
+struct nvme_slot {
+	struct nvme_command cmd;
+	lbaint_t lba;
+	u64 *prp_list;
+};
+
 /*
  * An NVM Express queue. Each device has at least two (one for admin
  * commands and one for I/O commands).
@@ -638,6 +649,10 @@ struct nvme_queue {
 	struct nvme_dev *dev;
 	struct nvme_command *sq_cmds;
 	struct nvme_completion *cqes;
+	/* only for I/O queues: per-slot state, free slots and reaped entries */
+	struct nvme_slot *slots;
+	u16 *free_slots;
+	struct nvme_completion *reaped;
 	u32 __iomem *q_db;
 	u16 q_depth;
 	s16 cq_vector;
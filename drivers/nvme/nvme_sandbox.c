@@ -0,0 +1,360 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Emulation of a simple NVMe controller, for testing
+ */
+
+#define LOG_CATEGORY UCLASS_NVME
+
+#include <dm.h>
+#include <log.h>
+#include <malloc.h>
+#include <memalign.h>
+#include <asm/state.h>
+#include <asm/test.h>
+#include <linux/kernel.h>
+#include "nvme.h"
+
+enum {
+	SANDBOX_NVME_PAGE_SIZE	= 4096,
+	SANDBOX_NVME_LBA_SHIFT	= 9,
+	SANDBOX_NVME_BLOCKS	= 2048,
+
+	/* 16KiB per command, so that large transfers need several */
+	SANDBOX_NVME_MDTS	= 2,
+	SANDBOX_NVME_MQES	= 63,
+	SANDBOX_NVME_QUEUES	= 2,
+
+	/* registers, then the doorbells of the two queues */
+	SANDBOX_NVME_DBS	= 0x1000,
+	SANDBOX_NVME_REGS_SIZE	= SANDBOX_NVME_DBS + SANDBOX_NVME_QUEUES * 8,
+};
+
+/**
+ * struct sandbox_nvme_queue - a queue pair, as seen by the controller
+ *
+ * @sq: Submission queue, NULL if not created
+ * @cq: Completion queue, NULL if not created
+ * @depth: Number of entries in each queue
+ * @sq_head: Next submission-queue entry to handle
+ * @cq_tail: Next completion-queue entry to fill in
+ * @phase: Phase tag for the entries being filled in
+ */
+struct sandbox_nvme_queue {
+	struct nvme_command *sq;
+	struct nvme_completion *cq;
+	u16 depth;
+	u16 sq_head;
+	u16 cq_tail;
+	u8 phase;
+};
+
+/**
+ * struct sandbox_nvme_priv - private data for the emulator
+ *
+ * @ndev: NVMe device, used by the driver (must be first)
+ * @mmio: Emulated registers
+ * @data: Contents of the namespace
+ * @queues: Admin and I/O queues
+ * @pending: true for each I/O command ID completed but not yet seen by
+ *	the driver's completion hook
+ * @io_count: Number of I/O commands handled
+ * @max_batch: Largest number of I/O commands handled for one doorbell write
+ * @bad_completes: Number of calls to the completion hook with a command which
+ *	was not pending
+ */
+struct sandbox_nvme_priv {
+	struct nvme_dev ndev;
+	struct sandbox_mmio mmio;
+	u8 *data;
+	struct sandbox_nvme_queue queues[SANDBOX_NVME_QUEUES];
+	bool pending[SANDBOX_NVME_MQES + 1];
+	int io_count;
+	int max_batch;
+	int bad_completes;
+};
+
+static void sandbox_nvme_identify(struct sandbox_nvme_priv *priv,
+				  struct nvme_command *cmd)
+{
+	void *buf = (void *)(ulong)le64_to_cpu(cmd->identify.prp1);
+
+	if (le32_to_cpu(cmd->identify.cns)) {
+		struct nvme_id_ctrl *ctrl = buf;
+
+		memset(ctrl, '\0', sizeof(*ctrl));
+		memcpy(ctrl->sn, "sandbox", 7);
+		memcpy(ctrl->mn, "Sandbox NVMe", 12);
+		memcpy(ctrl->fr, "1.0", 3);
+		ctrl->mdts = SANDBOX_NVME_MDTS;
+		ctrl->nn = cpu_to_le32(1);
+	} else {
+		struct nvme_id_ns *id = buf;
+
+		/* only namespace 1 is active */
+		memset(id, '\0', sizeof(*id));
+		if (le32_to_cpu(cmd->identify.nsid) == 1) {
+			id->nsze = cpu_to_le64(SANDBOX_NVME_BLOCKS);
+			id->ncap = id->nsze;
+			id->nuse = id->nsze;
+			id->lbaf[0].ds = SANDBOX_NVME_LBA_SHIFT;
+		}
+	}
+}
+
+static int sandbox_nvme_admin(struct sandbox_nvme_priv *priv,
+			      struct nvme_command *cmd, u32 *result)
+{
+	struct sandbox_nvme_queue *q;
+	u16 qid;
+
+	switch (cmd->common.opcode) {
+	case nvme_admin_identify:
+		sandbox_nvme_identify(priv, cmd);
+		break;
+	case nvme_admin_set_features:
+		if (le32_to_cpu(cmd->features.fid) != NVME_FEAT_NUM_QUEUES)
+			return NVME_SC_INVALID_FIELD;
+		/* one submission and one completion queue */
+		*result = 0;
+		break;
+	case nvme_admin_create_cq:
+		qid = le16_to_cpu(cmd->create_cq.cqid);
+		if (!qid || qid >= SANDBOX_NVME_QUEUES)
+			return NVME_SC_QID_INVALID;
+		q = &priv->queues[qid];
+		q->cq = (void *)(ulong)le64_to_cpu(cmd->create_cq.prp1);
+		q->depth = le16_to_cpu(cmd->create_cq.qsize) + 1;
+		q->cq_tail = 0;
+		q->phase = 1;
+		break;
+	case nvme_admin_create_sq:
+		qid = le16_to_cpu(cmd->create_sq.sqid);
+		if (!qid || qid >= SANDBOX_NVME_QUEUES)
+			return NVME_SC_QID_INVALID;
+		q = &priv->queues[qid];
+		q->sq = (void *)(ulong)le64_to_cpu(cmd->create_sq.prp1);
+		q->sq_head = 0;
+		break;
+	case nvme_admin_delete_sq:
+	case nvme_admin_delete_cq:
+		break;
+	default:
+		return NVME_SC_INVALID_OPCODE;
+	}
+
+	return NVME_SC_SUCCESS;
+}
+
+static int sandbox_nvme_rw(struct sandbox_nvme_priv *priv,
+			   struct nvme_command *cmd)
+{
+	u64 slba = le64_to_cpu(cmd->rw.slba);
+	ulong len = (le16_to_cpu(cmd->rw.length) + 1) << SANDBOX_NVME_LBA_SHIFT;
+	ulong addr = le64_to_cpu(cmd->rw.prp1);
+	u64 *prp_list = NULL;
+	u8 *data;
+
+	if (le32_to_cpu(cmd->rw.nsid) != 1)
+		return NVME_SC_INVALID_NS;
+	if (slba + (len >> SANDBOX_NVME_LBA_SHIFT) > SANDBOX_NVME_BLOCKS)
+		return NVME_SC_LBA_RANGE;
+
+	/*
+	 * The first entry may start part-way through a page. PRP2 is then the
+	 * second page, or a list of the remaining pages if there are more
+	 */
+	data = priv->data + (slba << SANDBOX_NVME_LBA_SHIFT);
+	if (len > 2 * SANDBOX_NVME_PAGE_SIZE -
+	    (addr & (SANDBOX_NVME_PAGE_SIZE - 1)))
+		prp_list = (u64 *)(ulong)le64_to_cpu(cmd->rw.prp2);
+	while (len) {
+		ulong chunk = SANDBOX_NVME_PAGE_SIZE -
+			(addr & (SANDBOX_NVME_PAGE_SIZE - 1));
+
+		chunk = min(chunk, len);
+		if (cmd->rw.opcode == nvme_cmd_read)
+			memcpy((void *)addr, data, chunk);
+		else
+			memcpy(data, (void *)addr, chunk);
+		data += chunk;
+		len -= chunk;
+		if (prp_list)
+			addr = le64_to_cpu(*prp_list++);
+		else
+			addr = le64_to_cpu(cmd->rw.prp2);
+	}
+
+	return NVME_SC_SUCCESS;
+}
+
+static void sandbox_nvme_post(struct sandbox_nvme_queue *q, u16 qid,
+			      u16 command_id, u16 status, u32 result)
+{
+	struct nvme_completion *cqe = &q->cq[q->cq_tail];
+
+	cqe->result = cpu_to_le32(result);
+	cqe->sq_head = cpu_to_le16(q->sq_head);
+	cqe->sq_id = cpu_to_le16(qid);
+	cqe->command_id = command_id;
+	cqe->status = cpu_to_le16(status << 1 | q->phase);
+	if (++q->cq_tail == q->depth) {
+		q->cq_tail = 0;
+		q->phase = !q->phase;
+	}
+}
+
+/*
+ * Handle everything up to the new tail of a submission queue. Commands are
+ * completed in the reverse order, as a real controller is free to do.
+ */
+static void sandbox_nvme_run(struct sandbox_nvme_priv *priv, u16 qid, u16 tail)
+{
+	struct sandbox_nvme_queue *q = &priv->queues[qid];
+	struct nvme_command *done[SANDBOX_NVME_MQES + 1];
+	u16 status[SANDBOX_NVME_MQES + 1];
+	u32 result[SANDBOX_NVME_MQES + 1];
+	int count = 0;
+
+	if (!q->sq || !q->cq)
+		return;
+	while (q->sq_head != tail && count < ARRAY_SIZE(done)) {
+		struct nvme_command *cmd = &q->sq[q->sq_head];
+
+		result[count] = 0;
+		if (qid)
+			status[count] = sandbox_nvme_rw(priv, cmd);
+		else
+			status[count] = sandbox_nvme_admin(priv, cmd,
+							   &result[count]);
+		done[count++] = cmd;
+		if (++q->sq_head == q->depth)
+			q->sq_head = 0;
+	}
+	if (qid) {
+		priv->io_count += count;
+		priv->max_batch = max(priv->max_batch, count);
+	}
+
+	while (count--) {
+		u16 id = done[count]->common.command_id;
+
+		if (qid && id < ARRAY_SIZE(priv->pending))
+			priv->pending[id] = true;
+		sandbox_nvme_post(q, qid, id, status[count], result[count]);
+	}
+}
+
+static void sandbox_nvme_write(struct sandbox_mmio *mmio, ulong offset)
+{
+	struct sandbox_nvme_priv *priv = container_of(mmio,
+						      struct sandbox_nvme_priv,
+						      mmio);
+	struct nvme_bar *bar = priv->ndev.bar;
+	struct sandbox_nvme_queue *q = &priv->queues[NVME_ADMIN_Q];
+
+	if (offset == offsetof(struct nvme_bar, cc)) {
+		bar->csts &= ~(NVME_CSTS_RDY | NVME_CSTS_SHST_MASK);
+		if (bar->cc & NVME_CC_SHN_MASK)
+			bar->csts |= NVME_CSTS_SHST_CMPLT;
+		if (!(bar->cc & NVME_CC_ENABLE)) {
+			memset(priv->queues, '\0', sizeof(priv->queues));
+			return;
+		}
+		bar->csts |= NVME_CSTS_RDY;
+		q->sq = (void *)(ulong)bar->asq;
+		q->cq = (void *)(ulong)bar->acq;
+		q->depth = (bar->aqa & 0xfff) + 1;
+		q->sq_head = 0;
+		q->cq_tail = 0;
+		q->phase = 1;
+	} else if (offset >= SANDBOX_NVME_DBS) {
+		u32 *db = mmio->base + offset;
+		int idx = (offset - SANDBOX_NVME_DBS) / sizeof(u32);
+
+		/* completion-queue doorbells need no action */
+		if (!(idx & 1))
+			sandbox_nvme_run(priv, idx / 2, *db);
+	}
+}
+
+static void sandbox_nvme_complete_cmd(struct nvme_queue *nvmeq,
+				      struct nvme_command *cmd)
+{
+	struct sandbox_nvme_priv *priv = container_of(nvmeq->dev,
+						      struct sandbox_nvme_priv,
+						      ndev);
+	u16 id = cmd->common.command_id;
+
+	if (!nvmeq->qid)
+		return;
+	if (id >= ARRAY_SIZE(priv->pending) || !priv->pending[id])
+		priv->bad_completes++;
+	else
+		priv->pending[id] = false;
+}
+
+void sandbox_nvme_get_stats(struct udevice *dev, int *io_count, int *max_batch,
+			    int *bad_completes)
+{
+	struct sandbox_nvme_priv *priv = dev_get_priv(dev);
+
+	*io_count = priv->io_count;
+	*max_batch = priv->max_batch;
+	*bad_completes = priv->bad_completes;
+}
+
+static int sandbox_nvme_probe(struct udevice *dev)
+{
+	struct sandbox_nvme_priv *priv = dev_get_priv(dev);
+	struct nvme_bar *bar;
+	int ret;
+
+	priv->data = calloc(SANDBOX_NVME_BLOCKS, 1 << SANDBOX_NVME_LBA_SHIFT);
+	bar = memalign(SANDBOX_NVME_PAGE_SIZE, SANDBOX_NVME_REGS_SIZE);
+	if (!priv->data || !bar)
+		return log_msg_ret("mem", -ENOMEM);
+	memset(bar, '\0', SANDBOX_NVME_REGS_SIZE);
+
+	/* 500ms timeout, 4KiB pages only, no doorbell stride */
+	bar->cap = SANDBOX_NVME_MQES | 1 << 24;
+	bar->vs = NVME_VS(1, 3);
+	priv->ndev.bar = bar;
+
+	priv->mmio.base = bar;
+	priv->mmio.size = SANDBOX_NVME_REGS_SIZE;
+	priv->mmio.write = sandbox_nvme_write;
+	sandbox_mmio_add(&priv->mmio);
+
+	ret = nvme_init(dev);
+	if (ret) {
+		sandbox_mmio_remove(&priv->mmio);
+		return log_msg_ret("init", ret);
+	}
+
+	return 0;
+}
+
+static int sandbox_nvme_remove(struct udevice *dev)
+{
+	struct sandbox_nvme_priv *priv = dev_get_priv(dev);
+
+	nvme_shutdown(dev);
+	sandbox_mmio_remove(&priv->mmio);
+	free(priv->ndev.bar);
+	free(priv->data);
+
+	return 0;
+}
+
+static const struct nvme_ops sandbox_nvme_ops = {
+	.complete_cmd	= sandbox_nvme_complete_cmd,
+};
+
+U_BOOT_DRIVER(sandbox_nvme) = {
+	.name		= "sandbox_nvme",
+	.id		= UCLASS_NVME,
+	.probe		= sandbox_nvme_probe,
+	.remove		= sandbox_nvme_remove,
+	.ops		= &sandbox_nvme_ops,
+	.priv_auto	= sizeof(struct sandbox_nvme_priv),
+};
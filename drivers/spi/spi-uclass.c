@@ -56,7 +56,9 @@ int dm_spi_claim_bus(struct udevice *dev)
 	struct dm_spi_bus *spi = dev_get_uclass_priv(bus);
 	struct spi_slave *slave = dev_get_parent_priv(dev);
 	uint speed, mode;
+	int ret;
 
+	uthread_mutex_lock(&spi->lock);
 	speed = slave->max_hz;
 	mode = slave->mode;
 
@@ -70,25 +72,35 @@ int dm_spi_claim_bus(struct udevice *dev)
 		speed = SPI_DEFAULT_SPEED_HZ;
 
 	if (speed != spi->speed || mode != spi->mode) {
-		int ret = spi_set_speed_mode(bus, speed, slave->mode);
-
+		ret = spi_set_speed_mode(bus, speed, slave->mode);
 		if (ret)
-			return log_ret(ret);
+			goto err;
 
 		spi->speed = speed;
 		spi->mode = mode;
 	}
 
-	return log_ret(ops->claim_bus ? ops->claim_bus(dev) : 0);
+	ret = ops->claim_bus ? ops->claim_bus(dev) : 0;
+	if (ret)
+		goto err;
+
+	return 0;
+
+err:
+	uthread_mutex_unlock(&spi->lock);
+
+	return log_ret(ret);
 }
 
 void dm_spi_release_bus(struct udevice *dev)
 {
 	struct udevice *bus = dev->parent;
 	struct dm_spi_ops *ops = spi_get_ops(bus);
+	struct dm_spi_bus *spi = dev_get_uclass_priv(bus);
 
 	if (ops->release_bus)
 		ops->release_bus(dev);
+	uthread_mutex_unlock(&spi->lock);
 }
 
 int dm_spi_xfer(struct udevice *dev, unsigned int bitlen,
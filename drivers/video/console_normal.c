@@ -18,7 +18,7 @@ static int console_set_row(struct udevice *dev, uint row, int clr)
 	struct video_priv *vid_priv = dev_get_uclass_priv(dev->parent);
 	struct console_simple_priv *priv = dev_get_priv(dev);
 	struct video_fontdata *fontdata = priv->fontdata;
-	void *line, *dst, *end;
+	void *line, *dst;
 	int pixels = fontdata->height * vid_priv->xsize;
 	int ret;
 	int i;
@@ -33,11 +33,8 @@ static int console_set_row(struct udevice *dev, uint row, int clr)
 	pbytes = VNBYTES(vid_priv->bpix);
 	for (i = 0; i < pixels; i++)
 		fill_pixel_and_goto_next(&dst, clr, pbytes, pbytes);
-	end = dst;
-
-	ret = vidconsole_sync_copy(dev, line, end);
-	if (ret)
-		return ret;
+	video_damage(dev->parent, 0, row * fontdata->height, vid_priv->xsize,
+		     fontdata->height);
 
 	return 0;
 }
@@ -90,10 +87,7 @@ static int console_putc_xy(struct udevice *dev, uint x_frac, uint y, int cp)
 	ret = fill_char_vertically(pfont, &line, vid_priv, fontdata, NORMAL_DIRECTION);
 	if (ret)
 		return ret;
-
-	ret = vidconsole_sync_copy(dev, start, line);
-	if (ret)
-		return ret;
+	video_damage(vid, x, linenum, fontdata->width, fontdata->height);
 
 	return VID_TO_POS(fontdata->width);
 }
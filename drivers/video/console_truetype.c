@@ -121,6 +121,36 @@ struct pos_info {
 	int ypos;
 };
 
+/*
+ * Characters are cached at this many positions within a pixel, each drawn
+ * at the nearest one
+ */
+#define GLYPH_SUBPIXELS		4
+
+/**
+ * struct console_tt_glyph - A character image in the glyph cache
+ *
+ * @bits:	8-bit alpha image of the character, or NULL if it is empty
+ * @cp:		Unicode code point of the character
+ * @sub:	Position within a pixel it was drawn at, in units of
+ *		1 / GLYPH_SUBPIXELS pixels
+ * @used:	true if this slot holds a character
+ * @width:	Width of the image in pixels
+ * @height:	Height of the image in pixels
+ * @xoff:	X offset of the image from the cursor position
+ * @yoff:	Y offset of the image from the baseline
+ */
+struct console_tt_glyph {
+	u8 *bits;
+	int cp;
+	u8 sub;
+	bool used;
+	short width;
+	short height;
+	short xoff;
+	short yoff;
+};
+
 /*
  * Allow one for each character on the command line plus one for each newline.
  * This is just an estimate, but it should not be exceeded.
@@ -145,6 +175,11 @@ struct pos_info {
  * @scale:	Scale of the font. This is calculated from the pixel height
  *		of the font. It is used by the STB library to generate images
  *		of the correct size.
+ * @glyphs:	Cache of characters drawn in this font / size, with
+ *		CONFIG_CONSOLE_TRUETYPE_GLYPH_CACHE slots, or NULL if not
+ *		allocated yet
+ * @glyph_hits:	Number of characters found in the cache
+ * @glyph_misses: Number of characters which had to be rendered
  */
 struct console_tt_metrics {
 	const char *font_name;
@@ -153,6 +188,9 @@ struct console_tt_metrics {
 	stbtt_fontinfo font;
 	int baseline;
 	double scale;
+	struct console_tt_glyph *glyphs;
+	uint glyph_hits;
+	uint glyph_misses;
 };
 
 /**
@@ -193,7 +231,6 @@ static int console_truetype_set_row(struct udevice *dev, uint row, int clr)
 	struct console_tt_priv *priv = dev_get_priv(dev);
 	struct console_tt_metrics *met = priv->cur_met;
 	void *end, *line;
-	int ret;
 
 	line = vid_priv->fb + row * met->font_size * vid_priv->line_length;
 	end = line + met->font_size * vid_priv->line_length;
@@ -229,9 +266,8 @@ static int console_truetype_set_row(struct udevice *dev, uint row, int clr)
 	default:
 		return -ENOSYS;
 	}
-	ret = vidconsole_sync_copy(dev, line, end);
-	if (ret)
-		return ret;
+	video_damage(dev->parent, 0, row * met->font_size, vid_priv->xsize,
+		     met->font_size);
 
 	return 0;
 }
@@ -261,6 +297,79 @@ static int console_truetype_move_rows(struct udevice *dev, uint rowdst,
 	return 0;
 }
 
+/**
+ * get_glyph() - Get the image of a character, from the cache if possible
+ *
+ * The cache is direct-mapped, so code points which are close together, as
+ * in most text, do not evict each other.
+ *
+ * @met:	Font / size to use
+ * @cp:		Unicode code point of the character
+ * @x_shift:	Fraction of a pixel to move the character right by
+ * @glyph:	Returns the character image and its position
+ * Return: true if the caller must free @glyph->bits, false if it is cached
+ */
+static bool get_glyph(struct console_tt_metrics *met, int cp, double x_shift,
+		      struct console_tt_glyph *glyph)
+{
+	struct console_tt_glyph *slot;
+	int width, height, xoff, yoff;
+	bool carry;
+	int sub;
+
+	if (!CONFIG_CONSOLE_TRUETYPE_GLYPH_CACHE)
+		goto render;
+
+	if (!met->glyphs) {
+		met->glyphs = calloc(CONFIG_CONSOLE_TRUETYPE_GLYPH_CACHE,
+				     sizeof(*met->glyphs));
+		if (!met->glyphs)
+			goto render;
+	}
+
+	/* rounding up may reach the next whole pixel */
+	sub = (int)(x_shift * GLYPH_SUBPIXELS + 0.5);
+	carry = sub == GLYPH_SUBPIXELS;
+	if (carry)
+		sub = 0;
+
+	slot = &met->glyphs[(cp * GLYPH_SUBPIXELS + sub) %
+			    CONFIG_CONSOLE_TRUETYPE_GLYPH_CACHE];
+	if (slot->used && slot->cp == cp && slot->sub == sub) {
+		met->glyph_hits++;
+	} else {
+		met->glyph_misses++;
+		free(slot->bits);
+		slot->bits = stbtt_GetCodepointBitmapSubpixel(&met->font,
+				met->scale, met->scale,
+				(double)sub / GLYPH_SUBPIXELS, 0, cp,
+				&width, &height, &xoff, &yoff);
+		slot->cp = cp;
+		slot->sub = sub;
+		slot->used = true;
+		slot->width = width;
+		slot->height = height;
+		slot->xoff = xoff;
+		slot->yoff = yoff;
+	}
+	*glyph = *slot;
+	glyph->xoff += carry;
+
+	return false;
+
+render:
+	glyph->bits = stbtt_GetCodepointBitmapSubpixel(&met->font, met->scale,
+						       met->scale, x_shift, 0,
+						       cp, &width, &height,
+						       &xoff, &yoff);
+	glyph->width = width;
+	glyph->height = height;
+	glyph->xoff = xoff;
+	glyph->yoff = yoff;
+
+	return true;
+}
+
 static int console_truetype_putc_xy(struct udevice *dev, uint x, uint y,
 				    int cp)
 {
@@ -270,6 +379,7 @@ static int console_truetype_putc_xy(struct udevice *dev, uint x, uint y,
 	struct console_tt_priv *priv = dev_get_priv(dev);
 	struct console_tt_metrics *met = priv->cur_met;
 	stbtt_fontinfo *font = &met->font;
+	struct console_tt_glyph glyph;
 	int width, height, xoff, yoff;
 	double xpos, x_shift;
 	int lsb;
@@ -278,7 +388,8 @@ static int console_truetype_putc_xy(struct udevice *dev, uint x, uint y,
 	u8 *bits, *data;
 	int advance;
 	void *start, *end, *line;
-	int row, ret;
+	bool owned;
+	int row;
 
 	/* First get some basic metrics about this character */
 	stbtt_GetCodepointHMetrics(font, cp, &advance, &lsb);
@@ -319,11 +430,14 @@ static int console_truetype_putc_xy(struct udevice *dev, uint x, uint y,
 	 * image of the character. For empty characters, like ' ', data will
 	 * return NULL;
 	 */
-	data = stbtt_GetCodepointBitmapSubpixel(font, met->scale, met->scale,
-						x_shift, 0, cp, &width, &height,
-						&xoff, &yoff);
+	owned = get_glyph(met, cp, x_shift, &glyph);
+	data = glyph.bits;
 	if (!data)
 		return width_frac;
+	width = glyph.width;
+	height = glyph.height;
+	xoff = glyph.xoff;
+	yoff = glyph.yoff;
 
 	/* Figure out where to write the character in the frame buffer */
 	bits = data;
@@ -412,16 +526,17 @@ static int console_truetype_putc_xy(struct udevice *dev, uint x, uint y,
 			break;
 		}
 		default:
-			free(data);
+			if (owned)
+				free(data);
 			return -ENOSYS;
 		}
 
 		line += vid_priv->line_length;
 	}
-	ret = vidconsole_sync_copy(dev, start, line);
-	if (ret)
-		return ret;
-	free(data);
+	if (owned)
+		free(data);
+	video_damage(vid, VID_TO_PIXEL(x) + xoff, y + max(linenum, 0), width,
+		     height);
 
 	return width_frac;
 }
@@ -948,6 +1063,21 @@ static int truetype_set_cursor_visible(struct udevice *dev, bool visible,
 	return video_sync(vid, true);
 }
 
+int console_truetype_glyph_stats(struct udevice *dev, uint *hitsp,
+				 uint *missesp)
+{
+	struct console_tt_priv *priv = dev_get_priv(dev);
+	struct console_tt_metrics *met = priv->cur_met;
+	int i, count = 0;
+
+	*hitsp = met->glyph_hits;
+	*missesp = met->glyph_misses;
+	for (i = 0; met->glyphs && i < CONFIG_CONSOLE_TRUETYPE_GLYPH_CACHE; i++)
+		count += met->glyphs[i].used;
+
+	return count;
+}
+
 const char *console_truetype_get_font_size(struct udevice *dev, uint *sizep)
 {
 	struct console_tt_priv *priv = dev_get_priv(dev);
@@ -990,6 +1120,24 @@ static int console_truetype_probe(struct udevice *dev)
 	return 0;
 }
 
+static int console_truetype_remove(struct udevice *dev)
+{
+	struct console_tt_priv *priv = dev_get_priv(dev);
+	int i, j;
+
+	for (i = 0; i < priv->num_metrics; i++) {
+		struct console_tt_metrics *met = &priv->metrics[i];
+
+		for (j = 0; met->glyphs && j < CONFIG_CONSOLE_TRUETYPE_GLYPH_CACHE;
+		     j++)
+			free(met->glyphs[j].bits);
+		free(met->glyphs);
+		met->glyphs = NULL;
+	}
+
+	return 0;
+}
+
 struct vidconsole_ops console_truetype_ops = {
 	.putc_xy	= console_truetype_putc_xy,
 	.move_rows	= console_truetype_move_rows,
@@ -1011,5 +1159,6 @@ U_BOOT_DRIVER(vidconsole_truetype) = {
 	.id	= UCLASS_VIDEO_CONSOLE,
 	.ops	= &console_truetype_ops,
 	.probe	= console_truetype_probe,
+	.remove	= console_truetype_remove,
 	.priv_auto	= sizeof(struct console_tt_priv),
 };
@@ -127,6 +127,16 @@ static int sandbox_sdl_bind(struct udevice *dev)
 	return ret;
 }
 
+static int sandbox_sdl_set_offset(struct udevice *dev, uint line)
+{
+	/* Nothing to do, since each sync shows the display from uc_priv->fb */
+	return 0;
+}
+
+static const struct video_ops sandbox_sdl_ops = {
+	.set_offset	= sandbox_sdl_set_offset,
+};
+
 static const struct udevice_id sandbox_sdl_ids[] = {
 	{ .compatible = "sandbox,lcd-sdl" },
 	{ }
@@ -139,5 +149,6 @@ U_BOOT_DRIVER(sandbox_lcd_sdl) = {
 	.bind	= sandbox_sdl_bind,
 	.probe	= sandbox_sdl_probe,
 	.remove	= sandbox_sdl_remove,
+	.ops	= &sandbox_sdl_ops,
 	.plat_auto	= sizeof(struct sandbox_sdl_plat),
 };
@@ -95,7 +95,12 @@ static void vidconsole_newline(struct udevice *dev)
 
 	/* Check if we need to scroll the terminal */
 	if ((priv->ycur + priv->y_charsize) / priv->y_charsize > priv->rows) {
-		vidconsole_move_rows(dev, 0, rows, priv->rows - rows);
+		/* panning is quicker, if the rows run down the display */
+		ret = -ENOSYS;
+		if (!vid_priv->rot)
+			ret = video_pan(vid_dev, rows * priv->y_charsize);
+		if (ret == -ENOSYS)
+			vidconsole_move_rows(dev, 0, rows, priv->rows - rows);
 		for (i = 0; i < rows; i++)
 			vidconsole_set_row(dev, priv->rows - i - 1,
 					   vid_priv->colour_bg);
@@ -759,7 +764,6 @@ UCLASS_DRIVER(vidconsole) = {
 	.per_device_auto	= sizeof(struct vidconsole_priv),
 };
 
-#ifdef CONFIG_VIDEO_COPY
 int vidconsole_sync_copy(struct udevice *dev, void *from, void *to)
 {
 	struct udevice *vid = dev_get_parent(dev);
@@ -773,7 +777,6 @@ int vidconsole_memmove(struct udevice *dev, void *dst, const void *src,
 	memmove(dst, src, size);
 	return vidconsole_sync_copy(dev, dst, dst + size);
 }
-#endif
 
 int vidconsole_clear_and_reset(struct udevice *dev)
 {
@@ -49,6 +49,11 @@
  * video_post_probe(). This function also clears the frame buffer and
  * allocates a suitable text console device. This can then be used to write
  * text to the video device.
+ *
+ * With CONFIG_VIDEO_DAMAGE, drawing code reports what it changes through
+ * video_damage() and video_sync() copies and flushes only that area. If
+ * the driver provides set_offset() and plat->size leaves room, the console
+ * scrolls by moving priv->fb forward through the memory (see video_pan()).
  */
 DECLARE_GLOBAL_DATA_PTR;
 
@@ -152,7 +157,7 @@ int video_fill_part(struct udevice *dev, int xstart, int ystart, int xend,
 	struct video_priv *priv = dev_get_uclass_priv(dev);
 	void *start, *line;
 	int pixels = xend - xstart;
-	int row, i, ret;
+	int row, i;
 
 	start = priv->fb + ystart * priv->line_length;
 	start += xstart * VNBYTES(priv->bpix);
@@ -191,9 +196,7 @@ int video_fill_part(struct udevice *dev, int xstart, int ystart, int xend,
 		}
 		line += priv->line_length;
 	}
-	ret = video_sync_copy(dev, start, line);
-	if (ret)
-		return ret;
+	video_damage(dev, xstart, ystart, pixels, yend - ystart);
 
 	return 0;
 }
@@ -346,6 +349,96 @@ void video_set_default_colors(struct udevice *dev, bool invert)
 	priv->colour_bg = video_index_to_colour(priv, back);
 }
 
+/* Add a rectangle, already clipped to the display, to the damaged area */
+static void video_add_damage(struct video_priv *priv, int x0, int y0, int x1,
+			     int y1)
+{
+	struct video_bbox *damage = &priv->damage;
+
+	if (damage->x0 >= damage->x1) {
+		damage->x0 = x0;
+		damage->y0 = y0;
+		damage->x1 = x1;
+		damage->y1 = y1;
+	} else {
+		damage->x0 = min(damage->x0, x0);
+		damage->y0 = min(damage->y0, y0);
+		damage->x1 = max(damage->x1, x1);
+		damage->y1 = max(damage->y1, y1);
+	}
+}
+
+void video_damage(struct udevice *vid, int x, int y, int width, int height)
+{
+	struct video_priv *priv = dev_get_uclass_priv(vid);
+	int xend = min(x + width, (int)priv->xsize);
+	int yend = min(y + height, (int)priv->ysize);
+	int pbytes = VNBYTES(priv->bpix);
+
+	x = max(x, 0);
+	y = max(y, 0);
+	if (x >= xend || y >= yend)
+		return;
+
+	if (IS_ENABLED(CONFIG_VIDEO_DAMAGE))
+		video_add_damage(priv, x, y, xend, yend);
+	else
+		video_sync_copy(vid, priv->fb + y * priv->line_length +
+				x * pbytes, priv->fb + (yend - 1) *
+				priv->line_length + xend * pbytes);
+}
+
+/*
+ * Copy the damaged area to the copy frame buffer and flush it from the data
+ * cache, then start collecting damage again
+ */
+static void video_flush_damage(struct udevice *vid)
+{
+	struct video_priv *priv = dev_get_uclass_priv(vid);
+	struct video_bbox *damage = &priv->damage;
+	int pbytes = VNBYTES(priv->bpix);
+	int start = damage->x0 * pbytes;
+	int len = (damage->x1 - damage->x0) * pbytes;
+	int y;
+
+	if (damage->x0 >= damage->x1)
+		return;
+
+	if (IS_ENABLED(CONFIG_VIDEO_COPY) && priv->copy_fb) {
+		for (y = damage->y0; y < damage->y1; y++) {
+			int offset = y * priv->line_length + start;
+
+			memcpy(priv->copy_fb + offset, priv->fb + offset, len);
+		}
+	}
+
+#if defined(CONFIG_ARM) && !CONFIG_IS_ENABLED(SYS_DCACHE_OFF)
+	if (priv->flush_dcache) {
+		ulong base = (ulong)priv->fb + start;
+
+		/* flush a line at a time if that avoids most of each line */
+		if (len * 2 < priv->line_length) {
+			for (y = damage->y0; y < damage->y1; y++) {
+				ulong addr = base + y * priv->line_length;
+
+				flush_dcache_range(ALIGN_DOWN(addr,
+						CONFIG_SYS_CACHELINE_SIZE),
+						   ALIGN(addr + len,
+						CONFIG_SYS_CACHELINE_SIZE));
+			}
+		} else {
+			flush_dcache_range(ALIGN_DOWN(base + damage->y0 *
+						      priv->line_length,
+						      CONFIG_SYS_CACHELINE_SIZE),
+					   ALIGN(base + (damage->y1 - 1) *
+						 priv->line_length + len,
+						 CONFIG_SYS_CACHELINE_SIZE));
+		}
+	}
+#endif
+	memset(damage, '\0', sizeof(*damage));
+}
+
 /* Flush video activity to the caches */
 int video_sync(struct udevice *vid, bool force)
 {
@@ -358,6 +451,9 @@ int video_sync(struct udevice *vid, bool force)
 			return ret;
 	}
 
+	if (IS_ENABLED(CONFIG_VIDEO_DAMAGE))
+		video_flush_damage(vid);
+
 	/*
 	 * flush_dcache_range() is declared in common.h but it seems that some
 	 * architectures do not actually implement it. Is there a way to find
@@ -366,7 +462,11 @@ int video_sync(struct udevice *vid, bool force)
 #if defined(CONFIG_ARM) && !CONFIG_IS_ENABLED(SYS_DCACHE_OFF)
 	struct video_priv *priv = dev_get_uclass_priv(vid);
 
-	if (priv->flush_dcache) {
+	/*
+	 * Not everything which draws reports damage, so a forced sync still
+	 * flushes the whole frame buffer
+	 */
+	if (priv->flush_dcache && (force || !IS_ENABLED(CONFIG_VIDEO_DAMAGE))) {
 		flush_dcache_range((ulong)priv->fb,
 				   ALIGN((ulong)priv->fb + priv->fb_size,
 					 CONFIG_SYS_CACHELINE_SIZE));
@@ -383,6 +483,104 @@ int video_sync(struct udevice *vid, bool force)
 	return 0;
 }
 
+/*
+ * Work out how far the display can pan within the frame-buffer memory. It is
+ * not worth panning unless there is room for at least two displays.
+ */
+static int video_pan_space(struct udevice *dev)
+{
+	struct video_uc_plat *plat = dev_get_uclass_plat(dev);
+	struct video_priv *priv = dev_get_uclass_priv(dev);
+	struct video_ops *ops = video_get_ops(dev);
+	ulong space = plat->size;
+
+	if (!ops || !ops->set_offset)
+		return 0;
+
+	/*
+	 * The size of a separate copy frame buffer is not known, so only pan
+	 * when the copy follows the frame buffer in the same memory
+	 */
+	if (priv->copy_fb) {
+		if (plat->copy_base <= plat->base ||
+		    plat->copy_base >= plat->base + plat->size)
+			return 0;
+		space = plat->copy_base - plat->base;
+	}
+
+	return space >= 2 * priv->fb_size ? space : 0;
+}
+
+int video_pan(struct udevice *vid, int lines)
+{
+	struct video_priv *priv = dev_get_uclass_priv(vid);
+	struct video_ops *ops = video_get_ops(vid);
+	struct video_bbox *damage = &priv->damage;
+	int move = lines * priv->line_length;
+	int ret;
+
+	if (!priv->fb_space || lines <= 0 || lines >= priv->ysize)
+		return -ENOSYS;
+
+	if (priv->fb_offset + move + priv->fb_size <= priv->fb_space) {
+		priv->fb += move;
+		if (priv->copy_fb)
+			priv->copy_fb += move;
+		priv->fb_offset += move;
+
+		/* damage not yet synced moves up with the display */
+		damage->y0 = max(damage->y0 - lines, 0);
+		damage->y1 -= lines;
+		if (damage->y1 <= damage->y0)
+			memset(damage, '\0', sizeof(*damage));
+	} else {
+		/* out of room, so go back to the start of the memory */
+		memmove(priv->fb - priv->fb_offset, priv->fb + move,
+			priv->fb_size - move);
+		priv->fb -= priv->fb_offset;
+		if (priv->copy_fb)
+			priv->copy_fb -= priv->fb_offset;
+		priv->fb_offset = 0;
+		video_damage(vid, 0, 0, priv->xsize, priv->ysize);
+	}
+	ret = video_fill_part(vid, 0, priv->ysize - lines, priv->xsize,
+			      priv->ysize, priv->colour_bg);
+	if (ret)
+		return ret;
+
+	return ops->set_offset(vid, priv->fb_offset / priv->line_length);
+}
+
+void video_disable_pan(struct udevice *vid)
+{
+	struct video_priv *priv = dev_get_uclass_priv(vid);
+	struct video_ops *ops = video_get_ops(vid);
+
+	if (priv->fb_offset) {
+		memmove(priv->fb - priv->fb_offset, priv->fb, priv->fb_size);
+		priv->fb -= priv->fb_offset;
+		if (priv->copy_fb)
+			priv->copy_fb -= priv->fb_offset;
+		priv->fb_offset = 0;
+		video_damage(vid, 0, 0, priv->xsize, priv->ysize);
+		ops->set_offset(vid, 0);
+		video_sync(vid, false);
+	}
+	priv->fb_space = 0;
+}
+
+void video_disable_pan_all(void)
+{
+	struct udevice *dev;
+
+	for (uclass_find_first_device(UCLASS_VIDEO, &dev);
+	     dev;
+	     uclass_find_next_device(&dev)) {
+		if (device_active(dev))
+			video_disable_pan(dev);
+	}
+}
+
 void video_sync_all(void)
 {
 	struct udevice *dev;
@@ -431,12 +629,12 @@ int video_get_ysize(struct udevice *dev)
 	return priv->ysize;
 }
 
-#ifdef CONFIG_VIDEO_COPY
+#if defined(CONFIG_VIDEO_COPY) || defined(CONFIG_VIDEO_DAMAGE)
 int video_sync_copy(struct udevice *dev, void *from, void *to)
 {
 	struct video_priv *priv = dev_get_uclass_priv(dev);
 
-	if (priv->copy_fb) {
+	if (priv->copy_fb || IS_ENABLED(CONFIG_VIDEO_DAMAGE)) {
 		long offset, size;
 
 		/* Find the offset of the first byte to copy */
@@ -477,7 +675,17 @@ int video_sync_copy(struct udevice *dev, void *from, void *to)
 			offset = 0;
 		}
 
-		memcpy(priv->copy_fb + offset, priv->fb + offset, size);
+		/* with damage tracking, the copy waits until video_sync() */
+		if (IS_ENABLED(CONFIG_VIDEO_DAMAGE)) {
+			if (size > 0)
+				video_add_damage(priv, 0,
+						 offset / priv->line_length,
+						 priv->xsize,
+						 DIV_ROUND_UP(offset + size,
+							      priv->line_length));
+		} else {
+			memcpy(priv->copy_fb + offset, priv->fb + offset, size);
+		}
 	}
 
 	return 0;
@@ -544,6 +752,7 @@ static int video_post_probe(struct udevice *dev)
 		priv->line_length = priv->xsize * VNBYTES(priv->bpix);
 
 	priv->fb_size = priv->line_length * priv->ysize;
+	priv->fb_offset = 0;
 
 	/*
 	 * Set up video handoff fields for passing video blob to next stage
@@ -567,6 +776,7 @@ static int video_post_probe(struct udevice *dev)
 
 	if (IS_ENABLED(CONFIG_VIDEO_COPY) && plat->copy_base)
 		priv->copy_fb = map_sysmem(plat->copy_base, plat->size);
+	priv->fb_space = video_pan_space(dev);
 
 	/* Set up colors  */
 	video_set_default_colors(dev, false);
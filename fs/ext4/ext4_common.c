@@ -46,6 +46,43 @@ int ext4fs_indir3_blkno = -1;
 struct ext2_inode *g_parent_inode;
 static int symlinknest;
 
+/* Extents longer than this are uninitialised and read back as zeroes */
+#define EXT4_EXT_INIT_MAX_LEN	(1 << 15)
+
+/* Largest number of extents kept for the inode being read */
+#define EXT4_EXTENT_CACHE_MAX	8192
+
+/**
+ * struct ext4_extent_map - a run of file blocks which is contiguous on disk
+ *
+ * @block: First file block
+ * @len: Number of blocks
+ * @start: Filesystem block holding @block, or 0 if the run reads as zeroes
+ */
+struct ext4_extent_map {
+	uint32_t block;
+	uint32_t len;
+	uint64_t start;
+};
+
+/**
+ * struct ext4_extent_cache - the extents of an inode, sorted by file block
+ *
+ * Leaves of the extent tree are added as they are walked, so that reading a
+ * file in pieces only visits each leaf once.
+ *
+ * @ino: Inode the extents belong to, 0 if none
+ * @map: Extents, sorted by @block
+ * @count: Number of entries in @map
+ * @max: Number of entries allocated in @map
+ */
+static struct ext4_extent_cache {
+	int ino;
+	struct ext4_extent_map *map;
+	int count;
+	int max;
+} ext4fs_extents;
+
 #if defined(CONFIG_EXT4_WRITE)
 struct ext2_block_group *ext4fs_get_group_descriptor
 	(const struct ext_filesystem *fs, uint32_t bg_idx)
@@ -1523,16 +1560,23 @@ void ext4fs_allocate_blocks(struct ext2_inode *file_inode,
 
 #endif
 
+/*
+ * Walk the extent tree down to the leaf holding @fileblock. If @leaf_end is
+ * not NULL it is set to the first file block which is not covered by the
+ * leaf, or 0 if the leaf runs to the end of the file.
+ */
 static struct ext4_extent_header *ext4fs_get_extent_block
 	(struct ext2_data *data, struct ext_block_cache *cache,
 		struct ext4_extent_header *ext_block,
-		uint32_t fileblock, int log2_blksz)
+		uint32_t fileblock, int log2_blksz, uint32_t *leaf_end)
 {
 	struct ext4_extent_idx *index;
 	unsigned long long block;
 	int blksz = EXT2_BLOCK_SIZE(data);
 	int i;
 
+	if (leaf_end)
+		*leaf_end = 0;
 	while (1) {
 		index = (struct ext4_extent_idx *)(ext_block + 1);
 
@@ -1555,6 +1599,13 @@ static struct ext4_extent_header *ext4fs_get_extent_block
 		if (i > 0)
 			i--;
 
+		if (leaf_end && i + 1 < le16_to_cpu(ext_block->eh_entries)) {
+			uint32_t next = le32_to_cpu(index[i + 1].ei_block);
+
+			if (!*leaf_end || next < *leaf_end)
+				*leaf_end = next;
+		}
+
 		block = le16_to_cpu(index[i].ei_leaf_hi);
 		block = (block << 32) + le32_to_cpu(index[i].ei_leaf_lo);
 		block <<= log2_blksz;
@@ -1673,7 +1724,7 @@ long int read_allocated_block(struct ext2_inode *inode, int fileblock,
 			ext4fs_get_extent_block(ext4fs_root, c,
 						(struct ext4_extent_header *)
 						inode->b.blocks.dir_blocks,
-						fileblock, log2_blksz);
+						fileblock, log2_blksz, NULL);
 		if (!ext_block) {
 			printf("invalid extent block\n");
 			if (!cache)
@@ -1993,6 +2044,178 @@ long int read_allocated_block(struct ext2_inode *inode, int fileblock,
 	return blknr;
 }
 
+void ext4fs_extents_drop(void)
+{
+	free(ext4fs_extents.map);
+	memset(&ext4fs_extents, '\0', sizeof(ext4fs_extents));
+}
+
+/* Find the cached extent holding @fileblock, or the one which follows it */
+static int ext4fs_extents_find(uint32_t fileblock)
+{
+	int lo = 0, hi = ext4fs_extents.count;
+
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+		struct ext4_extent_map *map = &ext4fs_extents.map[mid];
+
+		if (fileblock < map->block)
+			hi = mid;
+		else if (fileblock - map->block >= map->len)
+			lo = mid + 1;
+		else
+			return mid;
+	}
+
+	return lo;
+}
+
+static int ext4fs_extents_add(uint32_t block, uint32_t len, uint64_t start)
+{
+	struct ext4_extent_cache *ec = &ext4fs_extents;
+	struct ext4_extent_map *map;
+	int i;
+
+	i = ext4fs_extents_find(block);
+	if (i < ec->count && ec->map[i].block <= block)
+		return 0;
+
+	if (ec->count == ec->max) {
+		int max = ec->max ? ec->max * 2 : 16;
+
+		if (ec->max >= EXT4_EXTENT_CACHE_MAX)
+			return -ENOSPC;
+		map = realloc(ec->map, max * sizeof(*map));
+		if (!map)
+			return -ENOMEM;
+		ec->map = map;
+		ec->max = max;
+	}
+	map = &ec->map[i];
+	memmove(map + 1, map, (ec->count - i) * sizeof(*map));
+	map->block = block;
+	map->len = len;
+	map->start = start;
+	ec->count++;
+
+	return 0;
+}
+
+/* Add all the extents in a leaf of the extent tree to the cache */
+static int ext4fs_extents_add_leaf(struct ext4_extent_header *ext_block)
+{
+	struct ext4_extent *extent = (struct ext4_extent *)(ext_block + 1);
+	bool restarted = false;
+	int i;
+
+	for (i = 0; i < le16_to_cpu(ext_block->eh_entries); i++) {
+		uint32_t len = le16_to_cpu(extent[i].ee_len);
+		uint64_t start = 0;
+		int ret;
+
+		if (len > EXT4_EXT_INIT_MAX_LEN) {
+			len -= EXT4_EXT_INIT_MAX_LEN;
+		} else {
+			start = le16_to_cpu(extent[i].ee_start_hi);
+			start = (start << 32) +
+				le32_to_cpu(extent[i].ee_start_lo);
+		}
+		if (!len)
+			continue;
+		ret = ext4fs_extents_add(le32_to_cpu(extent[i].ee_block), len,
+					 start);
+		if (ret == -ENOSPC && !restarted) {
+			/* start again, keeping only the leaf being read */
+			log_debug("Extent cache full\n");
+			ext4fs_extents.count = 0;
+			restarted = true;
+			i = -1;
+			continue;
+		}
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
+/* Look up a run of blocks in an inode which uses extents */
+static int ext4fs_map_extents(struct ext2fs_node *node, uint32_t fileblock,
+			      uint32_t *count, uint64_t *start,
+			      struct ext_block_cache *cache)
+{
+	struct ext4_extent_cache *ec = &ext4fs_extents;
+	struct ext4_extent_header *ext_block;
+	struct ext4_extent_map *map;
+	uint32_t leaf_end = 0, len;
+	int i, ret;
+
+	if (ec->ino != node->ino) {
+		ec->count = 0;
+		ec->ino = node->ino;
+	}
+
+	i = ext4fs_extents_find(fileblock);
+	if (i == ec->count || ec->map[i].block > fileblock) {
+		ext_block = ext4fs_get_extent_block(ext4fs_root, cache,
+				(struct ext4_extent_header *)
+				node->inode.b.blocks.dir_blocks,
+				fileblock, LOG2_BLOCK_SIZE(ext4fs_root) -
+				get_fs()->dev_desc->log2blksz, &leaf_end);
+		if (!ext_block) {
+			printf("invalid extent block\n");
+			return -EINVAL;
+		}
+		ret = ext4fs_extents_add_leaf(ext_block);
+		if (ret)
+			return ret;
+		i = ext4fs_extents_find(fileblock);
+	}
+
+	map = i < ec->count ? &ec->map[i] : NULL;
+	if (map && map->block <= fileblock) {
+		len = map->len - (fileblock - map->block);
+		*start = map->start ? map->start + fileblock - map->block : 0;
+	} else {
+		/* sparse, up to the next extent or the end of the leaf */
+		len = map ? map->block - fileblock : *count;
+		if (leaf_end > fileblock)
+			len = min(len, leaf_end - fileblock);
+		*start = 0;
+	}
+	*count = min(*count, len);
+
+	return 0;
+}
+
+int ext4fs_map_blocks(struct ext2fs_node *node, uint32_t fileblock,
+		      uint32_t *count, uint64_t *start,
+		      struct ext_block_cache *cache)
+{
+	long int blknr;
+	uint32_t n;
+
+	if (!*count)
+		return -EINVAL;
+	if (le32_to_cpu(node->inode.flags) & EXT4_EXTENTS_FL)
+		return ext4fs_map_extents(node, fileblock, count, start, cache);
+
+	/* indirect blocks: gather those which are adjacent on disk */
+	for (n = 0; n < *count; n++) {
+		blknr = read_allocated_block(&node->inode, fileblock + n,
+					     cache);
+		if (blknr < 0)
+			return blknr;
+		if (!n)
+			*start = blknr;
+		else if (*start ? blknr != *start + n : blknr)
+			break;
+	}
+	*count = n;
+
+	return 0;
+}
+
 /**
  * ext4fs_reinit_global() - Reinitialize values of ext4 write implementation's
  *			    global pointers
@@ -2007,6 +2230,7 @@ long int read_allocated_block(struct ext2_inode *inode, int fileblock,
  */
 void ext4fs_reinit_global(void)
 {
+	ext4fs_extents_drop();
 	if (ext4fs_indir1_block != NULL) {
 		free(ext4fs_indir1_block);
 		ext4fs_indir1_block = NULL;
@@ -2044,6 +2268,8 @@ int ext4fs_iterate_dir(struct ext2fs_node *dir, char *name,
 				struct ext2fs_node **fnode, int *ftype)
 {
 	unsigned int fpos = 0;
+	unsigned int fend;
+	bool hashed = false, more = false;
 	int status;
 	loff_t actread;
 	struct ext2fs_node *diro = (struct ext2fs_node *) dir;
@@ -2057,8 +2283,22 @@ int ext4fs_iterate_dir(struct ext2fs_node *dir, char *name,
 		if (status == 0)
 			return 0;
 	}
+	fend = le32_to_cpu(diro->inode.size);
+
+	/* Only the block the name hashes to needs searching, if indexed */
+	if (IS_ENABLED(CONFIG_EXT4_HTREE) && name && fnode && ftype) {
+		int blk = ext4fs_htree_lookup(diro, name, &more);
+
+		if (blk >= 0) {
+			fpos = blk * EXT2_BLOCK_SIZE(diro->data);
+			fend = min(fend, fpos + EXT2_BLOCK_SIZE(diro->data));
+			hashed = true;
+		}
+	}
+
+search:
 	/* Search the file.  */
-	while (fpos < le32_to_cpu(diro->inode.size)) {
+	while (fpos < fend) {
 		struct ext2_dirent dirent;
 
 		status = ext4fs_read_file(diro, fpos,
@@ -2172,6 +2412,15 @@ int ext4fs_iterate_dir(struct ext2fs_node *dir, char *name,
 		}
 		fpos += le16_to_cpu(dirent.direntlen);
 	}
+
+	/* Fall back to searching the whole directory on a hash collision */
+	if (hashed && more) {
+		fpos = 0;
+		fend = le32_to_cpu(diro->inode.size);
+		hashed = false;
+		goto search;
+	}
+
 	return 0;
 }
 
@@ -2338,7 +2587,11 @@ int ext4fs_open(const char *filename, loff_t *len)
 	if (ext4fs_root == NULL)
 		return -1;
 
-	ext4fs_file = NULL;
+	/* the filesystem may be left open from an earlier operation */
+	if (ext4fs_file) {
+		ext4fs_free_node(ext4fs_file, &ext4fs_root->diropen);
+		ext4fs_file = NULL;
+	}
 	status = ext4fs_find_file(filename, &ext4fs_root->diropen, &fdiro,
 				  FILETYPE_REG);
 	if (status == 0)
@@ -58,6 +58,42 @@ int ext4fs_find_file1(const char *currpath, struct ext2fs_node *currroot,
 		      struct ext2fs_node **currfound, int *foundtype);
 int ext4fs_iterate_dir(struct ext2fs_node *dir, char *name,
 			struct ext2fs_node **fnode, int *ftype);
+void ext4fs_extents_drop(void);
+
+/* Hash algorithms for directory indexes, as stored in the index root */
+enum {
+	DX_HASH_LEGACY,
+	DX_HASH_HALF_MD4,
+	DX_HASH_TEA,
+	DX_HASH_LEGACY_UNSIGNED,
+	DX_HASH_HALF_MD4_UNSIGNED,
+	DX_HASH_TEA_UNSIGNED,
+};
+
+/**
+ * ext4fs_dirhash() - hash a name as ext4 does for directory indexes
+ *
+ * @name: Name to hash
+ * @len: Length of @name
+ * @version: Hash algorithm (DX_HASH_...)
+ * @seed: Seed from the superblock, or NULL to use the default
+ * @hashp: Returns the hash
+ * Return: 0 if OK, -EPROTONOSUPPORT if @version is not supported
+ */
+int ext4fs_dirhash(const char *name, int len, int version,
+		   const __le32 seed[4], u32 *hashp);
+
+/**
+ * ext4fs_htree_lookup() - find the directory block which may hold a name
+ *
+ * @dir: Directory to look in
+ * @name: Name to look for
+ * @more: Returns true if entries with the same hash carry on into another
+ *	block, so the name might not be in the block returned
+ * Return: file block within @dir to search, -ENOENT if @dir has no index,
+ *	other -ve value if the index cannot be used
+ */
+int ext4fs_htree_lookup(struct ext2fs_node *dir, const char *name, bool *more);
 
 #if defined(CONFIG_EXT4_WRITE)
 uint32_t ext4fs_div_roundup(uint32_t size, uint32_t n);
@@ -0,0 +1,328 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Hashed directory (htree / dir_index) lookup for ext4
+ *
+ * The hash functions are based on fs/ext4/hash.c from Linux:
+ * Copyright (C) 2002 by Theodore Ts'o
+ */
+
+#define LOG_CATEGORY LOGC_FS
+
+#include <blk.h>
+#include <ext_common.h>
+#include <ext4fs.h>
+#include <log.h>
+#include <malloc.h>
+#include <linux/bitops.h>
+#include <linux/errno.h>
+#include "ext4_common.h"
+
+#define EXT4_FEATURE_COMPAT_DIR_INDEX	0x0020
+#define EXT4_FEATURE_INCOMPAT_LARGEDIR	0x4000
+#define EXT4_CASEFOLD_FL		0x40000000
+
+#define EXT2_FLAGS_UNSIGNED_HASH	0x0002
+
+#define DX_HTREE_EOF_32BIT	0x7fffffff
+
+/* Offsets of the index in the root block, after the '.' and '..' entries */
+#define DX_ROOT_INFO_OFFSET	24
+#define DX_NODE_ENTRIES_OFFSET	8
+
+struct dx_root_info {
+	__le32 reserved_zero;
+	u8 hash_version;
+	u8 info_length;
+	u8 indirect_levels;
+	u8 unused_flags;
+};
+
+/* The first entry of each block holds the limit and count in its hash field */
+struct dx_entry {
+	__le32 hash;
+	__le32 block;
+};
+
+struct dx_countlimit {
+	__le16 limit;
+	__le16 count;
+};
+
+#define TEA_DELTA	0x9e3779b9
+
+static void tea_transform(u32 buf[4], const u32 in[])
+{
+	u32 sum = 0;
+	u32 b0 = buf[0], b1 = buf[1];
+	u32 a = in[0], b = in[1], c = in[2], d = in[3];
+	int n = 16;
+
+	do {
+		sum += TEA_DELTA;
+		b0 += ((b1 << 4) + a) ^ (b1 + sum) ^ ((b1 >> 5) + b);
+		b1 += ((b0 << 4) + c) ^ (b0 + sum) ^ ((b0 >> 5) + d);
+	} while (--n);
+
+	buf[0] += b0;
+	buf[1] += b1;
+}
+
+#define F(x, y, z)	((z) ^ ((x) & ((y) ^ (z))))
+#define G(x, y, z)	(((x) & (y)) + (((x) ^ (y)) & (z)))
+#define H(x, y, z)	((x) ^ (y) ^ (z))
+
+#define MD4_ROUND(f, a, b, c, d, x, s)	\
+	(a += f(b, c, d) + (x), a = rol32(a, s))
+#define K1	0
+#define K2	013240474631UL
+#define K3	015666365641UL
+
+/* Cut-down MD4, as used by ext4: three rounds and no length padding */
+static void half_md4_transform(u32 buf[4], const u32 in[8])
+{
+	u32 a = buf[0], b = buf[1], c = buf[2], d = buf[3];
+
+	/* Round 1 */
+	MD4_ROUND(F, a, b, c, d, in[0] + K1,  3);
+	MD4_ROUND(F, d, a, b, c, in[1] + K1,  7);
+	MD4_ROUND(F, c, d, a, b, in[2] + K1, 11);
+	MD4_ROUND(F, b, c, d, a, in[3] + K1, 19);
+	MD4_ROUND(F, a, b, c, d, in[4] + K1,  3);
+	MD4_ROUND(F, d, a, b, c, in[5] + K1,  7);
+	MD4_ROUND(F, c, d, a, b, in[6] + K1, 11);
+	MD4_ROUND(F, b, c, d, a, in[7] + K1, 19);
+
+	/* Round 2 */
+	MD4_ROUND(G, a, b, c, d, in[1] + K2,  3);
+	MD4_ROUND(G, d, a, b, c, in[3] + K2,  5);
+	MD4_ROUND(G, c, d, a, b, in[5] + K2,  9);
+	MD4_ROUND(G, b, c, d, a, in[7] + K2, 13);
+	MD4_ROUND(G, a, b, c, d, in[0] + K2,  3);
+	MD4_ROUND(G, d, a, b, c, in[2] + K2,  5);
+	MD4_ROUND(G, c, d, a, b, in[4] + K2,  9);
+	MD4_ROUND(G, b, c, d, a, in[6] + K2, 13);
+
+	/* Round 3 */
+	MD4_ROUND(H, a, b, c, d, in[3] + K3,  3);
+	MD4_ROUND(H, d, a, b, c, in[7] + K3,  9);
+	MD4_ROUND(H, c, d, a, b, in[2] + K3, 11);
+	MD4_ROUND(H, b, c, d, a, in[6] + K3, 15);
+	MD4_ROUND(H, a, b, c, d, in[1] + K3,  3);
+	MD4_ROUND(H, d, a, b, c, in[5] + K3,  9);
+	MD4_ROUND(H, c, d, a, b, in[0] + K3, 11);
+	MD4_ROUND(H, b, c, d, a, in[4] + K3, 15);
+
+	buf[0] += a;
+	buf[1] += b;
+	buf[2] += c;
+	buf[3] += d;
+}
+
+/* The original hash, used before half-MD4 became the default */
+static u32 dx_hack_hash(const char *name, int len, bool is_unsigned)
+{
+	u32 hash, hash0 = 0x12a3fe2d, hash1 = 0x37abe8f9;
+
+	while (len--) {
+		int c = is_unsigned ? (unsigned char)*name : (signed char)*name;
+
+		hash = hash1 + (hash0 ^ (c * 7152373));
+		if (hash & 0x80000000)
+			hash -= 0x7fffffff;
+		hash1 = hash0;
+		hash0 = hash;
+		name++;
+	}
+
+	return hash0 << 1;
+}
+
+/* Pack up to @num words of a name into @buf, padding with its length */
+static void str2hashbuf(const char *msg, int len, u32 *buf, int num,
+			bool is_unsigned)
+{
+	u32 pad, val;
+	int i;
+
+	pad = (u32)len | ((u32)len << 8);
+	pad |= pad << 16;
+
+	val = pad;
+	if (len > num * 4)
+		len = num * 4;
+	for (i = 0; i < len; i++) {
+		int c = is_unsigned ? (unsigned char)msg[i] :
+			(signed char)msg[i];
+
+		val = c + (val << 8);
+		if ((i % 4) == 3) {
+			*buf++ = val;
+			val = pad;
+			num--;
+		}
+	}
+	if (--num >= 0)
+		*buf++ = val;
+	while (--num >= 0)
+		*buf++ = pad;
+}
+
+int ext4fs_dirhash(const char *name, int len, int version,
+		   const __le32 seed[4], u32 *hashp)
+{
+	u32 buf[4] = { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476 };
+	bool is_unsigned = false;
+	u32 in[8], hash;
+	int i;
+
+	for (i = 0; seed && i < 4; i++) {
+		if (seed[i]) {
+			for (i = 0; i < 4; i++)
+				buf[i] = le32_to_cpu(seed[i]);
+			break;
+		}
+	}
+
+	switch (version) {
+	case DX_HASH_LEGACY_UNSIGNED:
+		is_unsigned = true;
+		fallthrough;
+	case DX_HASH_LEGACY:
+		hash = dx_hack_hash(name, len, is_unsigned);
+		break;
+	case DX_HASH_HALF_MD4_UNSIGNED:
+		is_unsigned = true;
+		fallthrough;
+	case DX_HASH_HALF_MD4:
+		for (; len > 0; len -= 32, name += 32) {
+			str2hashbuf(name, len, in, 8, is_unsigned);
+			half_md4_transform(buf, in);
+		}
+		hash = buf[1];
+		break;
+	case DX_HASH_TEA_UNSIGNED:
+		is_unsigned = true;
+		fallthrough;
+	case DX_HASH_TEA:
+		for (; len > 0; len -= 16, name += 16) {
+			str2hashbuf(name, len, in, 4, is_unsigned);
+			tea_transform(buf, in);
+		}
+		hash = buf[0];
+		break;
+	default:
+		return -EPROTONOSUPPORT;
+	}
+
+	hash &= ~1;
+	if (hash == DX_HTREE_EOF_32BIT << 1)
+		hash = (DX_HTREE_EOF_32BIT - 1) << 1;
+	*hashp = hash;
+
+	return 0;
+}
+
+/*
+ * Find the entry covering @hash in an index block. Entries after the first
+ * are sorted by hash; the first covers everything below the second.
+ */
+static struct dx_entry *dx_search(struct dx_entry *entries, int count,
+				  u32 hash)
+{
+	struct dx_entry *p = entries + 1, *q = entries + count - 1;
+
+	while (p <= q) {
+		struct dx_entry *m = p + (q - p) / 2;
+
+		if (le32_to_cpu(m->hash) > hash)
+			q = m - 1;
+		else
+			p = m + 1;
+	}
+
+	return p - 1;
+}
+
+int ext4fs_htree_lookup(struct ext2fs_node *dir, const char *name, bool *more)
+{
+	struct ext2_sblock *sblock = &dir->data->sblock;
+	int blksz = EXT2_BLOCK_SIZE(dir->data);
+	struct dx_root_info *info;
+	struct dx_countlimit *cl;
+	struct dx_entry *entries, *at;
+	int levels, version, count, limit, ret;
+	loff_t actread;
+	u32 block = 0;
+	char *buf;
+	u32 hash;
+
+	/* these are only in the first block, which is not indexed */
+	if (!strcmp(name, ".") || !strcmp(name, ".."))
+		return -ENOENT;
+	if (!(le32_to_cpu(sblock->feature_compatibility) &
+	      EXT4_FEATURE_COMPAT_DIR_INDEX) ||
+	    !(le32_to_cpu(dir->inode.flags) & EXT4_INDEX_FL) ||
+	    (le32_to_cpu(dir->inode.flags) & EXT4_CASEFOLD_FL))
+		return -ENOENT;
+
+	buf = malloc(blksz);
+	if (!buf)
+		return -ENOMEM;
+
+	ret = -EINVAL;
+	if (ext4fs_read_file(dir, 0, blksz, buf, &actread) || actread != blksz)
+		goto out;
+	info = (struct dx_root_info *)(buf + DX_ROOT_INFO_OFFSET);
+	version = info->hash_version;
+	levels = info->indirect_levels;
+	if (info->reserved_zero || info->info_length != sizeof(*info) ||
+	    levels >= (le32_to_cpu(sblock->feature_incompat) &
+		       EXT4_FEATURE_INCOMPAT_LARGEDIR ? 3 : 2)) {
+		log_debug("Bad htree root in inode %d\n", dir->ino);
+		goto out;
+	}
+	if (version <= DX_HASH_TEA &&
+	    (le32_to_cpu(sblock->flags) & EXT2_FLAGS_UNSIGNED_HASH))
+		version += DX_HASH_LEGACY_UNSIGNED;
+	ret = ext4fs_dirhash(name, strlen(name), version, sblock->hash_seed,
+			     &hash);
+	if (ret)
+		goto out;
+
+	entries = (struct dx_entry *)((char *)info + info->info_length);
+	*more = false;
+	while (1) {
+		cl = (struct dx_countlimit *)entries;
+		count = le16_to_cpu(cl->count);
+		limit = le16_to_cpu(cl->limit);
+		if (!count || count > limit ||
+		    (char *)(entries + limit) > buf + blksz) {
+			log_debug("Bad htree node in inode %d\n", dir->ino);
+			ret = -EINVAL;
+			goto out;
+		}
+
+		at = dx_search(entries, count, hash);
+		block = le32_to_cpu(at->block) & 0x0fffffff;
+
+		/* a name with this hash may carry on into the next leaf */
+		if (at + 1 < entries + count &&
+		    (le32_to_cpu(at[1].hash) & ~1) == hash)
+			*more = true;
+
+		if (!levels--)
+			break;
+		if (ext4fs_read_file(dir, (loff_t)block * blksz, blksz, buf,
+				     &actread) || actread != blksz) {
+			ret = -EIO;
+			goto out;
+		}
+		entries = (struct dx_entry *)(buf + DX_NODE_ENTRIES_OFFSET);
+	}
+	ret = block;
+
+out:
+	free(buf);
+
+	return ret;
+}
@@ -28,6 +28,7 @@
 #include <malloc.h>
 #include <part.h>
 #include <uuid.h>
+#include <linux/sizes.h>
 
 int ext4fs_symlinknest;
 struct ext_filesystem ext_fs;
@@ -44,29 +45,21 @@ void ext4fs_free_node(struct ext2fs_node *node, struct ext2fs_node *currroot)
 }
 
 /*
- * Taken from openmoko-kernel mailing list: By Andy green
- * Optimized read file API : collects and defers contiguous sector
- * reads into one potentially more efficient larger sequential read action
+ * Read a file one run of blocks at a time, where a run is a set of blocks
+ * which are contiguous on disk (e.g. an extent) or which are all sparse
  */
 int ext4fs_read_file(struct ext2fs_node *node, loff_t pos,
 		loff_t len, char *buf, loff_t *actread)
 {
 	struct ext_filesystem *fs = get_fs();
-	int i;
-	lbaint_t blockcnt;
 	int log2blksz = fs->dev_desc->log2blksz;
 	int log2_fs_blocksize = LOG2_BLOCK_SIZE(node->data) - log2blksz;
 	int blocksize = (1 << (log2_fs_blocksize + log2blksz));
 	unsigned int filesize = le32_to_cpu(node->inode.size);
-	lbaint_t previous_block_number = -1;
-	lbaint_t delayed_start = 0;
-	lbaint_t delayed_extent = 0;
-	lbaint_t delayed_skipfirst = 0;
-	lbaint_t delayed_next = 0;
-	char *delayed_buf = NULL;
-	char *start_buf = buf;
-	short status;
+	/* keep each read within the range of ext4fs_devread() */
+	uint32_t max_blocks = SZ_1G / blocksize;
 	struct ext_block_cache cache;
+	loff_t end;
 
 	ext_cache_init(&cache);
 
@@ -79,102 +72,33 @@ int ext4fs_read_file(struct ext2fs_node *node, loff_t pos,
 		return -1;
 	}
 
-	blockcnt = lldiv(((len + pos) + blocksize - 1), blocksize);
-
-	for (i = lldiv(pos, blocksize); i < blockcnt; i++) {
-		long int blknr;
-		int blockoff = pos - (blocksize * i);
-		int blockend = blocksize;
-		int skipfirst = 0;
-		blknr = read_allocated_block(&node->inode, i, &cache);
-		if (blknr < 0) {
+	for (end = pos + len; pos < end;) {
+		uint32_t fileblock = lldiv(pos, blocksize);
+		int skipfirst = pos - (loff_t)fileblock * blocksize;
+		uint32_t count;
+		uint64_t start;
+		loff_t size;
+
+		count = lldiv(end - pos + skipfirst + blocksize - 1, blocksize);
+		count = min(count, max_blocks);
+		if (ext4fs_map_blocks(node, fileblock, &count, &start,
+				      &cache)) {
 			ext_cache_fini(&cache);
 			return -1;
 		}
 
-		blknr = blknr << log2_fs_blocksize;
-
-		/* Last block.  */
-		if (i == blockcnt - 1) {
-			blockend = (len + pos) - (blocksize * i);
-
-			/* The last portion is exactly blocksize. */
-			if (!blockend)
-				blockend = blocksize;
-		}
-
-		/* First block. */
-		if (i == lldiv(pos, blocksize)) {
-			skipfirst = blockoff;
-			blockend -= skipfirst;
-		}
-		if (blknr) {
-			int status;
-
-			if (previous_block_number != -1) {
-				if (delayed_next == blknr) {
-					delayed_extent += blockend;
-					delayed_next += blockend >> log2blksz;
-				} else {	/* spill */
-					status = ext4fs_devread(delayed_start,
-							delayed_skipfirst,
-							delayed_extent,
-							delayed_buf);
-					if (status == 0) {
-						ext_cache_fini(&cache);
-						return -1;
-					}
-					previous_block_number = blknr;
-					delayed_start = blknr;
-					delayed_extent = blockend;
-					delayed_skipfirst = skipfirst;
-					delayed_buf = buf;
-					delayed_next = blknr +
-						(blockend >> log2blksz);
-				}
-			} else {
-				previous_block_number = blknr;
-				delayed_start = blknr;
-				delayed_extent = blockend;
-				delayed_skipfirst = skipfirst;
-				delayed_buf = buf;
-				delayed_next = blknr +
-					(blockend >> log2blksz);
+		size = min((loff_t)count * blocksize - skipfirst, end - pos);
+		if (start) {
+			if (!ext4fs_devread((lbaint_t)start << log2_fs_blocksize,
+					    skipfirst, size, buf)) {
+				ext_cache_fini(&cache);
+				return -1;
 			}
 		} else {
-			int n;
-			int n_left;
-			if (previous_block_number != -1) {
-				/* spill */
-				status = ext4fs_devread(delayed_start,
-							delayed_skipfirst,
-							delayed_extent,
-							delayed_buf);
-				if (status == 0) {
-					ext_cache_fini(&cache);
-					return -1;
-				}
-				previous_block_number = -1;
-			}
-			/* Zero no more than `len' bytes. */
-			n = blocksize - skipfirst;
-			n_left = len - ( buf - start_buf );
-			if (n > n_left)
-				n = n_left;
-			memset(buf, 0, n);
-		}
-		buf += blocksize - skipfirst;
-	}
-	if (previous_block_number != -1) {
-		/* spill */
-		status = ext4fs_devread(delayed_start,
-					delayed_skipfirst, delayed_extent,
-					delayed_buf);
-		if (status == 0) {
-			ext_cache_fini(&cache);
-			return -1;
+			memset(buf, 0, size);
 		}
-		previous_block_number = -1;
+		buf += size;
+		pos += size;
 	}
 
 	*actread  = len;
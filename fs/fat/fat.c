@@ -12,6 +12,7 @@
 
 #include <blk.h>
 #include <config.h>
+#include <div64.h>
 #include <exports.h>
 #include <fat.h>
 #include <fs.h>
@@ -45,6 +46,51 @@ static void downcase(char *str, size_t len)
 static struct blk_desc *cur_dev;
 static struct disk_partition cur_part_info;
 
+/**
+ * struct fat_extent - a run of contiguous clusters in a file
+ *
+ * @file_clust:	index within the file of the first cluster in the run
+ * @clust:	first cluster of the run on disk
+ * @count:	number of clusters in the run
+ */
+struct fat_extent {
+	__u32 file_clust;
+	__u32 clust;
+	__u32 count;
+};
+
+/**
+ * struct fat_extent_cache - cluster chain of the file being accessed
+ *
+ * The chain is walked lazily, only as far as the clusters which have been
+ * asked for, so that seeking within a file does not re-read the FAT from the
+ * start of the chain each time. It is dropped when the FAT changes, when the
+ * block device changes and when the file is closed.
+ *
+ * @start:	first cluster of the file, 0 if the cache is empty
+ * @next:	next cluster in the chain after the last extent
+ * @nr_clust:	number of clusters covered by the extents
+ * @complete:	true if the end of the chain has been reached
+ * @ext:	extents, in file order
+ * @count:	number of extents
+ * @max:	number of extents allocated
+ */
+static struct fat_extent_cache {
+	__u32 start;
+	__u32 next;
+	__u32 nr_clust;
+	bool complete;
+	struct fat_extent *ext;
+	int count;
+	int max;
+} fat_extents;
+
+static void fat_extents_drop(void)
+{
+	free(fat_extents.ext);
+	memset(&fat_extents, '\0', sizeof(fat_extents));
+}
+
 #define DOS_BOOT_MAGIC_OFFSET	0x1fe
 #define DOS_FS_TYPE_OFFSET	0x36
 #define DOS_FS32_TYPE_OFFSET	0x52
@@ -68,6 +114,9 @@ int fat_set_blk_dev(struct blk_desc *dev_desc, struct disk_partition *info)
 {
 	ALLOC_CACHE_ALIGN_BUFFER(unsigned char, buffer, dev_desc->blksz);
 
+	/* this may be called directly, not through the filesystem layer */
+	fs_invalidate(NULL);
+	fat_extents_drop();
 	cur_dev = dev_desc;
 	cur_part_info = *info;
 
@@ -308,6 +357,84 @@ get_cluster(fsdata *mydata, __u32 clustnum, __u8 *buffer, unsigned long size)
 	return 0;
 }
 
+/**
+ * fat_extent_find() - find the run of clusters holding a cluster of a file
+ *
+ * The cluster chain is followed as far as the end of the run containing
+ * cluster @idx, unless that has already been done for this file.
+ *
+ * @mydata:	file system description
+ * @start:	first cluster of the file
+ * @idx:	index of the cluster within the file
+ * @extp:	returns the extent holding cluster @idx, valid until the next
+ *		call
+ * Return:	0 if OK, -ENOENT if the file has fewer than @idx + 1 clusters,
+ *		-EINVAL if the chain is corrupt, -ENOMEM if out of memory
+ */
+static int fat_extent_find(fsdata *mydata, __u32 start, __u32 idx,
+			   struct fat_extent **extp)
+{
+	struct fat_extent_cache *cache = &fat_extents;
+	struct fat_extent *ext;
+	int lo, hi;
+
+	if (cache->start != start) {
+		fat_extents_drop();
+		cache->start = start;
+		cache->next = start;
+	}
+
+	/* walk on to the end of the run holding idx */
+	while (!cache->complete) {
+		__u32 clust = cache->next;
+
+		ext = cache->count ? &cache->ext[cache->count - 1] : NULL;
+		if (cache->nr_clust > idx && clust != ext->clust + ext->count)
+			break;
+		if (CHECK_CLUST(clust, mydata->fatsize)) {
+			debug("curclust: 0x%x\n", clust);
+			return -EINVAL;
+		}
+		if (ext && clust == ext->clust + ext->count) {
+			ext->count++;
+		} else {
+			if (cache->count == cache->max) {
+				int max = cache->max ? cache->max * 2 : 16;
+
+				ext = realloc(cache->ext, max * sizeof(*ext));
+				if (!ext)
+					return -ENOMEM;
+				cache->ext = ext;
+				cache->max = max;
+			}
+			ext = &cache->ext[cache->count++];
+			ext->file_clust = cache->nr_clust;
+			ext->clust = clust;
+			ext->count = 1;
+		}
+		cache->nr_clust++;
+		cache->next = get_fatent(mydata, clust);
+		if (IS_LAST_CLUST(cache->next, mydata->fatsize))
+			cache->complete = true;
+	}
+	if (idx >= cache->nr_clust)
+		return -ENOENT;
+
+	lo = 0;
+	hi = cache->count - 1;
+	while (lo < hi) {
+		int mid = (lo + hi + 1) / 2;
+
+		if (cache->ext[mid].file_clust <= idx)
+			lo = mid;
+		else
+			hi = mid - 1;
+	}
+	*extp = &cache->ext[lo];
+
+	return 0;
+}
+
 /**
  * get_contents() - read from file
  *
@@ -315,6 +442,8 @@ get_cluster(fsdata *mydata, __u32 clustnum, __u8 *buffer, unsigned long size)
  * into 'buffer'. Update the number of bytes read in *gotsize or return -1 on
  * fatal errors.
  *
+ * Each run of contiguous clusters is read with a single disk access.
+ *
  * @mydata:	file system description
  * @dentprt:	directory entry pointer
  * @pos:	position from where to read
@@ -328,9 +457,9 @@ static int get_contents(fsdata *mydata, dir_entry *dentptr, loff_t pos,
 {
 	loff_t filesize = FAT2CPU32(dentptr->size);
 	unsigned int bytesperclust = mydata->clust_size * mydata->sect_size;
-	__u32 curclust = START(dentptr);
-	__u32 endclust, newclust;
-	loff_t actsize;
+	struct fat_extent *ext;
+	__u32 idx, clust;
+	loff_t actsize, ofs;
 
 	*gotsize = 0;
 	debug("Filesize: %llu bytes\n", filesize);
@@ -345,101 +474,54 @@ static int get_contents(fsdata *mydata, dir_entry *dentptr, loff_t pos,
 
 	debug("%llu bytes\n", filesize);
 
-	actsize = bytesperclust;
+	idx = lldiv(pos, bytesperclust);
+	ofs = pos - (loff_t)idx * bytesperclust;
+	filesize -= pos;
 
-	/* go to cluster at pos */
-	while (actsize <= pos) {
-		curclust = get_fatent(mydata, curclust);
-		if (CHECK_CLUST(curclust, mydata->fatsize)) {
-			debug("curclust: 0x%x\n", curclust);
+	while (filesize) {
+		if (fat_extent_find(mydata, START(dentptr), idx, &ext)) {
 			printf("Invalid FAT entry\n");
 			return -1;
 		}
-		actsize += bytesperclust;
-	}
-
-	/* actsize > pos */
-	actsize -= bytesperclust;
-	filesize -= actsize;
-	pos -= actsize;
+		clust = ext->clust + idx - ext->file_clust;
 
-	/* align to beginning of next cluster if any */
-	if (pos) {
-		__u8 *tmp_buffer;
+		/* read up to the beginning of the next cluster if any */
+		if (ofs) {
+			__u8 *tmp_buffer;
 
-		actsize = min(filesize, (loff_t)bytesperclust);
-		tmp_buffer = malloc_cache_aligned(actsize);
-		if (!tmp_buffer) {
-			debug("Error: allocating buffer\n");
-			return -1;
-		}
+			actsize = min(filesize + ofs, (loff_t)bytesperclust);
+			tmp_buffer = malloc_cache_aligned(actsize);
+			if (!tmp_buffer) {
+				debug("Error: allocating buffer\n");
+				return -1;
+			}
 
-		if (get_cluster(mydata, curclust, tmp_buffer, actsize) != 0) {
-			printf("Error reading cluster\n");
+			if (get_cluster(mydata, clust, tmp_buffer, actsize)) {
+				printf("Error reading cluster\n");
+				free(tmp_buffer);
+				return -1;
+			}
+			actsize -= ofs;
+			memcpy(buffer, tmp_buffer + ofs, actsize);
 			free(tmp_buffer);
-			return -1;
-		}
-		filesize -= actsize;
-		actsize -= pos;
-		memcpy(buffer, tmp_buffer + pos, actsize);
-		free(tmp_buffer);
-		*gotsize += actsize;
-		if (!filesize)
-			return 0;
-		buffer += actsize;
-
-		curclust = get_fatent(mydata, curclust);
-		if (CHECK_CLUST(curclust, mydata->fatsize)) {
-			debug("curclust: 0x%x\n", curclust);
-			printf("Invalid FAT entry\n");
-			return -1;
-		}
-	}
-
-	actsize = bytesperclust;
-	endclust = curclust;
-
-	do {
-		/* search for consecutive clusters */
-		while (actsize < filesize) {
-			newclust = get_fatent(mydata, endclust);
-			if ((newclust - 1) != endclust)
-				goto getit;
-			if (CHECK_CLUST(newclust, mydata->fatsize)) {
-				debug("curclust: 0x%x\n", newclust);
-				printf("Invalid FAT entry\n");
+			idx++;
+			ofs = 0;
+		} else {
+			actsize = (loff_t)(ext->file_clust + ext->count - idx) *
+				bytesperclust;
+			actsize = min(actsize, filesize);
+			if (get_cluster(mydata, clust, buffer, actsize) != 0) {
+				printf("Error reading cluster\n");
 				return -1;
 			}
-			endclust = newclust;
-			actsize += bytesperclust;
-		}
-
-		/* get remaining bytes */
-		actsize = filesize;
-		if (get_cluster(mydata, curclust, buffer, (int)actsize) != 0) {
-			printf("Error reading cluster\n");
-			return -1;
+			idx = ext->file_clust + ext->count;
 		}
 		*gotsize += actsize;
-		return 0;
-getit:
-		if (get_cluster(mydata, curclust, buffer, (int)actsize) != 0) {
-			printf("Error reading cluster\n");
-			return -1;
-		}
-		*gotsize += (int)actsize;
 		filesize -= actsize;
 		buffer += actsize;
+	}
 
-		curclust = get_fatent(mydata, endclust);
-		if (CHECK_CLUST(curclust, mydata->fatsize)) {
-			debug("curclust: 0x%x\n", curclust);
-			printf("Invalid FAT entry\n");
-			return -1;
-		}
-		actsize = bytesperclust;
-		endclust = curclust;
-	} while (1);
+	return 0;
 }
 
 /*
@@ -1421,6 +1503,7 @@ void fat_closedir(struct fs_dir_stream *dirs)
 
 void fat_close(void)
 {
+	fat_extents_drop();
 }
 
 int fat_uuid(char *uuid_str)
@@ -443,6 +443,9 @@ static int set_fatent_value(fsdata *mydata, __u32 entry, __u32 entry_value)
 	__u32 bufnum, offset, off16;
 	__u16 val1, val2;
 
+	/* the cached cluster chain may be about to change */
+	fat_extents_drop();
+
 	switch (mydata->fatsize) {
 	case 32:
 		bufnum = entry / FAT32BUFSIZE;
@@ -932,8 +935,11 @@ set_contents(fsdata *mydata, dir_entry *dentptr, loff_t pos, __u8 *buffer,
 	unsigned int bytesperclust = mydata->clust_size * mydata->sect_size;
 	__u32 curclust = START(dentptr);
 	__u32 endclust = 0, newclust = 0;
+	struct fat_extent *ext;
+	__u32 idx, count;
 	u64 cur_pos, filesize;
 	loff_t offset, actsize, wsize;
+	int ret;
 
 	*gotsize = 0;
 	filesize = pos + maxsize;
@@ -960,59 +966,24 @@ set_contents(fsdata *mydata, dir_entry *dentptr, loff_t pos, __u8 *buffer,
 	}
 
 	/* go to cluster at pos */
-	cur_pos = bytesperclust;
-	while (1) {
-		if (pos <= cur_pos)
-			break;
-		if (IS_LAST_CLUST(curclust, mydata->fatsize))
-			break;
-
-		newclust = get_fatent(mydata, curclust);
-		if (!IS_LAST_CLUST(newclust, mydata->fatsize) &&
-		    CHECK_CLUST(newclust, mydata->fatsize)) {
-			debug("curclust: 0x%x\n", curclust);
-			debug("Invalid FAT entry\n");
-			return -1;
-		}
-
-		cur_pos += bytesperclust;
-		curclust = newclust;
-	}
-	if (IS_LAST_CLUST(curclust, mydata->fatsize)) {
-		assert(pos == cur_pos);
-		goto set_clusters;
+	idx = pos ? lldiv(pos - 1, bytesperclust) : 0;
+	if (fat_extent_find(mydata, curclust, idx, &ext)) {
+		debug("curclust: 0x%x\n", curclust);
+		debug("Invalid FAT entry\n");
+		return -1;
 	}
-
-	assert(pos < cur_pos);
-	cur_pos -= bytesperclust;
+	curclust = ext->clust + idx - ext->file_clust;
+	cur_pos = (u64)idx * bytesperclust;
 
 	/* overwrite */
-	assert(IS_LAST_CLUST(curclust, mydata->fatsize) ||
-	       !CHECK_CLUST(curclust, mydata->fatsize));
-
 	while (1) {
-		/* search for allocated consecutive clusters */
-		actsize = bytesperclust;
-		endclust = curclust;
-		while (1) {
-			if (filesize <= (cur_pos + actsize))
-				break;
-
-			newclust = get_fatent(mydata, endclust);
-
-			if (newclust != endclust + 1)
-				break;
-			if (IS_LAST_CLUST(newclust, mydata->fatsize))
-				break;
-			if (CHECK_CLUST(newclust, mydata->fatsize)) {
-				debug("curclust: 0x%x\n", curclust);
-				debug("Invalid FAT entry\n");
-				return -1;
-			}
-
-			actsize += bytesperclust;
-			endclust = newclust;
-		}
+		/* allocated consecutive clusters, as far as needed */
+		count = min_t(u64, ext->file_clust + ext->count - idx,
+			      DIV_ROUND_UP_ULL(filesize - cur_pos,
+					       bytesperclust));
+		actsize = (loff_t)count * bytesperclust;
+		endclust = curclust + count - 1;
+		idx += count;
 
 		/* overwrite to <curclust..endclust> */
 		if (pos < cur_pos)
@@ -1034,11 +1005,15 @@ set_contents(fsdata *mydata, dir_entry *dentptr, loff_t pos, __u8 *buffer,
 		if (filesize <= cur_pos)
 			break;
 
-		if (IS_LAST_CLUST(newclust, mydata->fatsize))
+		ret = fat_extent_find(mydata, START(dentptr), idx, &ext);
+		if (ret == -ENOENT)
 			/* no more clusters */
 			break;
-
-		curclust = newclust;
+		if (ret) {
+			debug("Invalid FAT entry\n");
+			return -1;
+		}
+		curclust = ext->clust;
 	}
 
 	if (filesize <= cur_pos) {
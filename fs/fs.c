@@ -39,6 +39,33 @@ static int fs_dev_part;
 static struct disk_partition fs_partition;
 static int fs_type = FS_TYPE_ANY;
 
+/**
+ * struct fs_mount - filesystem kept open between operations
+ *
+ * Probing a filesystem reads its superblock and often much more, so rather
+ * than closing it after each operation, the last one probed is kept until a
+ * different one is needed, it is written to or its block device changes.
+ *
+ * @fstype: Filesystem type, FS_TYPE_ANY if there is none
+ * @desc: Block device holding the filesystem
+ * @hwpart: Hardware partition selected on @desc
+ * @part: Partition number
+ * @start: First block of the partition
+ * @size: Number of blocks in the partition
+ * @stale: true to close the filesystem when the current operation is done
+ */
+static struct fs_mount {
+	int fstype;
+	struct blk_desc *desc;
+	int hwpart;
+	int part;
+	lbaint_t start;
+	lbaint_t size;
+	bool stale;
+} fs_mount = {
+	.fstype = FS_TYPE_ANY,
+};
+
 void fs_set_type(int type)
 {
 	fs_type = type;
@@ -418,6 +445,76 @@ const char *fs_get_type_name(void)
 	return fs_get_info(fs_type)->name;
 }
 
+/* Close the filesystem kept open from an earlier operation, if any */
+static void fs_umount(void)
+{
+	if (fs_mount.fstype == FS_TYPE_ANY)
+		return;
+
+	log_debug("Closing %s\n", fs_get_info(fs_mount.fstype)->name);
+	fs_get_info(fs_mount.fstype)->close();
+	fs_mount.fstype = FS_TYPE_ANY;
+	fs_mount.stale = false;
+}
+
+/*
+ * Use the filesystem kept open, if it is on the partition just looked up in
+ * fs_dev_desc and fs_partition. Otherwise close it, ready to probe again.
+ */
+static bool fs_mount_reuse(int fstype, int part)
+{
+	struct fs_mount *mnt = &fs_mount;
+
+	if (mnt->fstype != FS_TYPE_ANY && !mnt->stale &&
+	    (fstype == FS_TYPE_ANY || fstype == mnt->fstype) &&
+	    mnt->desc == fs_dev_desc && mnt->part == part &&
+	    mnt->hwpart == fs_dev_desc->hwpart &&
+	    mnt->start == fs_partition.start &&
+	    mnt->size == fs_partition.size) {
+		fs_type = mnt->fstype;
+		fs_dev_part = part;
+		return true;
+	}
+	fs_umount();
+
+	return false;
+}
+
+/* Record the filesystem just probed, so it can be kept open */
+static void fs_mount_set(int fstype, int part)
+{
+	struct fs_mount *mnt = &fs_mount;
+
+	fs_type = fstype;
+	fs_dev_part = part;
+
+	/* filesystems not on a block device have little to probe */
+	if (!CONFIG_IS_ENABLED(FS_MOUNT_CACHE) || !fs_dev_desc)
+		return;
+
+	mnt->fstype = fstype;
+	mnt->desc = fs_dev_desc;
+	mnt->hwpart = fs_dev_desc->hwpart;
+	mnt->part = part;
+	mnt->start = fs_partition.start;
+	mnt->size = fs_partition.size;
+	mnt->stale = false;
+}
+
+#if CONFIG_IS_ENABLED(FS_MOUNT_CACHE)
+void fs_invalidate(struct blk_desc *desc)
+{
+	if (fs_mount.fstype == FS_TYPE_ANY || (desc && desc != fs_mount.desc))
+		return;
+
+	/* don't pull the filesystem from under an operation in progress */
+	if (fs_type == FS_TYPE_ANY)
+		fs_umount();
+	else
+		fs_mount.stale = true;
+}
+#endif
+
 int fs_set_blk_dev(const char *ifname, const char *dev_part_str, int fstype)
 {
 	struct fstype_info *info;
@@ -428,6 +525,9 @@ int fs_set_blk_dev(const char *ifname, const char *dev_part_str, int fstype)
 	if (part < 0)
 		return -1;
 
+	if (fs_mount_reuse(fstype, part))
+		return 0;
+
 	for (i = 0, info = fstypes; i < ARRAY_SIZE(fstypes); i++, info++) {
 		if (fstype != FS_TYPE_ANY && info->fstype != FS_TYPE_ANY &&
 				fstype != info->fstype)
@@ -437,8 +537,7 @@ int fs_set_blk_dev(const char *ifname, const char *dev_part_str, int fstype)
 			continue;
 
 		if (!info->probe(fs_dev_desc, &fs_partition)) {
-			fs_type = info->fstype;
-			fs_dev_part = part;
+			fs_mount_set(info->fstype, part);
 			return 0;
 		}
 	}
@@ -460,10 +559,12 @@ int fs_set_blk_dev_with_part(struct blk_desc *desc, int part)
 		return ret;
 	fs_dev_desc = desc;
 
+	if (fs_mount_reuse(FS_TYPE_ANY, part))
+		return 0;
+
 	for (i = 0, info = fstypes; i < ARRAY_SIZE(fstypes); i++, info++) {
 		if (!info->probe(fs_dev_desc, &fs_partition)) {
-			fs_type = info->fstype;
-			fs_dev_part = part;
+			fs_mount_set(info->fstype, part);
 			return 0;
 		}
 	}
@@ -475,11 +576,28 @@ void fs_close(void)
 {
 	struct fstype_info *info = fs_get_info(fs_type);
 
+	if (fs_type != FS_TYPE_ANY && fs_type == fs_mount.fstype) {
+		if (!fs_mount.stale) {
+			/* keep it open for the next operation */
+			fs_type = FS_TYPE_ANY;
+			return;
+		}
+		fs_mount.fstype = FS_TYPE_ANY;
+		fs_mount.stale = false;
+	}
+
 	info->close();
 
 	fs_type = FS_TYPE_ANY;
 }
 
+/* Close the filesystem after changing it, so it is probed afresh next time */
+static void fs_close_changed(void)
+{
+	fs_mount.stale = true;
+	fs_close();
+}
+
 int fs_uuid(char *uuid_str)
 {
 	struct fstype_info *info = fs_get_info(fs_type);
@@ -535,6 +653,7 @@ static int fs_read_lmb_check(const char *filename, ulong addr, loff_t offset,
 	int ret;
 	loff_t size;
 	loff_t read_len;
+	phys_addr_t base;
 
 	/* get the actual size of the file */
 	ret = info->size(filename, &size);
@@ -553,7 +672,9 @@ static int fs_read_lmb_check(const char *filename, ulong addr, loff_t offset,
 	lmb_init_and_reserve(&lmb, gd->bd, (void *)gd->fdt_blob);
 	lmb_dump_all(&lmb);
 
-	if (lmb_alloc_addr(&lmb, addr, read_len) == addr)
+	base = lmb_alloc_addr(&lmb, addr, read_len);
+	lmb_uninit(&lmb);
+	if (base == addr)
 		return 0;
 
 	log_err("** Reading file would overwrite reserved memory **\n");
@@ -613,7 +734,7 @@ int fs_write(const char *filename, ulong addr, loff_t offset, loff_t len,
 		log_err("** Unable to write file %s **\n", filename);
 		ret = -1;
 	}
-	fs_close();
+	fs_close_changed();
 
 	return ret;
 }
@@ -678,7 +799,7 @@ int fs_unlink(const char *filename)
 
 	ret = info->unlink(filename);
 
-	fs_close();
+	fs_close_changed();
 
 	return ret;
 }
@@ -691,7 +812,7 @@ int fs_mkdir(const char *dirname)
 
 	ret = info->mkdir(dirname);
 
-	fs_close();
+	fs_close_changed();
 
 	return ret;
 }
@@ -707,7 +828,7 @@ int fs_ln(const char *fname, const char *target)
 		log_err("** Unable to create link %s -> %s **\n", fname, target);
 		ret = -1;
 	}
-	fs_close();
+	fs_close_changed();
 
 	return ret;
 }
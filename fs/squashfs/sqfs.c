@@ -1103,6 +1103,7 @@ int sqfs_probe(struct blk_desc *fs_dev_desc, struct disk_partition *fs_partition
 	/* Make sure it has a valid SquashFS magic number*/
 	if (get_unaligned_le32(&sblk->s_magic) != SQFS_MAGIC_NUMBER) {
 		debug("Bad magic number for SquashFS image.\n");
+		free(sblk);
 		ret = -EINVAL;
 		goto error;
 	}
@@ -217,6 +217,15 @@ struct global_data {
 	/** @dm_driver_rt: Dynamic info about the driver */
 	struct driver_rt *dm_driver_rt;
 # endif
+# if CONFIG_IS_ENABLED(DM_COMPAT_HASH)
+	/**
+	 * @dm_compat_hash: index of the compatible strings of all drivers,
+	 * built on first use by lists_bind_fdt() and dropped at relocation.
+	 * An error pointer if it could not be built, so drivers are searched
+	 * one by one without trying again
+	 */
+	struct dm_compat_hash *dm_compat_hash;
+# endif
 #if CONFIG_IS_ENABLED(OF_PLATDATA_RT)
 	/** @dm_udevice_rt: Dynamic info about the udevice */
 	struct udevice_rt *dm_udevice_rt;
@@ -526,6 +535,14 @@ static_assert(sizeof(struct global_data) == GD_SIZE);
 #define gd_dm_driver_rt()		NULL
 #endif
 
+#if CONFIG_IS_ENABLED(DM_COMPAT_HASH)
+#define gd_set_dm_compat_hash(hash)	gd->dm_compat_hash = hash
+#define gd_dm_compat_hash()		gd->dm_compat_hash
+#else
+#define gd_set_dm_compat_hash(hash)
+#define gd_dm_compat_hash()		NULL
+#endif
+
 #if CONFIG_IS_ENABLED(OF_PLATDATA_RT)
 #define gd_set_dm_udevice_rt(dyn)	gd->dm_udevice_rt = dyn
 #define gd_dm_udevice_rt()		gd->dm_udevice_rt
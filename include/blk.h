@@ -10,6 +10,7 @@
 #include <bouncebuf.h>
 #include <dm/uclass-id.h>
 #include <efi.h>
+#include <errno.h>
 
 #ifdef CONFIG_SYS_64BIT_LBA
 typedef uint64_t lbaint_t;
@@ -118,7 +119,10 @@ struct blk_desc {
  * @param blksz - size in bytes of each block
  * @param buffer - buffer to contain cached data
  *
- * Return: - 1 if block returned from cache, 0 otherwise.
+ * The cache may hold only the first part of the range, in which case just
+ * those leading blocks are copied to @buffer.
+ *
+ * Return: - number of leading blocks returned from cache, 0 on a miss.
  */
 int blkcache_read(int iftype, int dev,
 		  lbaint_t start, lbaint_t blkcnt,
@@ -152,10 +156,11 @@ void blkcache_invalidate(int iftype, int dev);
 /**
  * blkcache_configure() - configure block cache
  *
- * @param blocks - maximum blocks per entry
+ * @param blocks - maximum blocks per entry, rounded up to a power of two
  * @param entries - maximum entries in cache
+ * @param max_bytes - maximum bytes of data held by all entries
  */
-void blkcache_configure(unsigned blocks, unsigned entries);
+void blkcache_configure(unsigned blocks, unsigned entries, ulong max_bytes);
 
 /*
  * statistics of the block cache
@@ -166,6 +171,22 @@ struct block_cache_stats {
 	unsigned entries; /* current entry count */
 	unsigned max_blocks_per_entry;
 	unsigned max_entries;
+	unsigned partial; /* reads served partly from the cache */
+	ulong bytes; /* bytes currently allocated to entries */
+	ulong max_bytes;
+};
+
+/*
+ * per-device statistics of the block cache
+ */
+struct block_cache_dev_stats {
+	int iftype;
+	int devnum;
+	unsigned hits;
+	unsigned misses;
+	unsigned partial;
+	unsigned entries;
+	ulong bytes;
 };
 
 /**
@@ -175,6 +196,15 @@ struct block_cache_stats {
  */
 void blkcache_stats(struct block_cache_stats *stats);
 
+/**
+ * blkcache_dev_stats() - return statistics for one device and reset
+ *
+ * @param index - index of the device in the cache, starting at 0
+ * @param stats - statistics are copied here
+ * Return: 0 if OK, -ENOENT if there is no device with that index
+ */
+int blkcache_dev_stats(int index, struct block_cache_dev_stats *stats);
+
 /** blkcache_free() - free all memory allocated to the block cache */
 void blkcache_free(void);
 
@@ -259,6 +289,34 @@ struct blk_ops {
 	 */
 	int (*select_hwpart)(struct udevice *dev, int hwpart);
 
+	/**
+	 * read_async() - start reading from a block device
+	 *
+	 * This is optional. It starts a read and returns without waiting for
+	 * the data to arrive, so that the caller can do other work in the
+	 * meantime. Only one such read is outstanding on a device at a time
+	 * and no other operation is started on the device until read_wait()
+	 * has been called.
+	 *
+	 * @dev:	Device to read from
+	 * @start:	Start block number to read (0=first)
+	 * @blkcnt:	Number of blocks to read
+	 * @buffer:	Destination buffer for data read
+	 * @return 0 if the read was started, -ve on error
+	 */
+	int (*read_async)(struct udevice *dev, lbaint_t start, lbaint_t blkcnt,
+			  void *buffer);
+
+	/**
+	 * read_wait() - wait for the read started by read_async() to finish
+	 *
+	 * This must be provided if read_async() is.
+	 *
+	 * @dev:	Device to wait for
+	 * @return number of blocks read, or -ve error number
+	 */
+	long (*read_wait)(struct udevice *dev);
+
 #if IS_ENABLED(CONFIG_BOUNCE_BUFFER)
 	/**
 	 * buffer_aligned() - test memory alignment of block operation buffer
@@ -278,6 +336,8 @@ struct blk_ops {
 #endif	/* CONFIG_BOUNCE_BUFFER */
 };
 
+#define blk_get_ops(dev)	((struct blk_ops *)(dev)->driver->ops)
+
 /*
  * These functions should take struct udevice instead of struct blk_desc,
  * but this is convenient for migration to driver model. Add a 'd' prefix
@@ -328,6 +388,113 @@ long blk_write(struct udevice *dev, lbaint_t start, lbaint_t blkcnt,
  */
 long blk_erase(struct udevice *dev, lbaint_t start, lbaint_t blkcnt);
 
+/**
+ * struct blk_readahead - sequential read-ahead state of a block device
+ *
+ * This is the uclass-private data of each block device when
+ * CONFIG_BLK_READAHEAD is enabled.
+ *
+ * @size: Size of the read-ahead window in bytes, 0 if disabled
+ * @buf: Buffer holding the window, or NULL if not allocated yet
+ * @start: First block held in (or being read into) @buf
+ * @blkcnt: Number of blocks held in @buf, 0 if none
+ * @next: Block following the previous read, to detect sequential access
+ * @seq: Number of back-to-back sequential reads seen
+ * @pending: true if a read_async() into @buf has not been waited for yet
+ * @issued: Number of blocks read ahead, for statistics
+ * @hits: Number of blocks returned from @buf, for statistics
+ */
+struct blk_readahead {
+	ulong size;
+	void *buf;
+	lbaint_t start;
+	lbaint_t blkcnt;
+	lbaint_t next;
+	uint seq;
+	bool pending;
+	ulong issued;
+	ulong hits;
+};
+
+#if CONFIG_IS_ENABLED(BLK_READAHEAD)
+/**
+ * blk_readahead_read() - take blocks from the read-ahead window
+ *
+ * If the start of the range is held in the read-ahead window, the leading
+ * blocks are copied from there, waiting for the device if the window is still
+ * being read. Otherwise the window is dropped.
+ *
+ * @dev: Block device to read from
+ * @start: Start block for the read
+ * @blkcnt: Number of blocks to read
+ * @buffer: Place to put the data
+ * Return: number of leading blocks copied to @buffer
+ */
+lbaint_t blk_readahead_read(struct udevice *dev, lbaint_t start,
+			    lbaint_t blkcnt, void *buffer);
+
+/**
+ * blk_readahead_update() - record a read and start reading ahead
+ *
+ * Once the device is being read sequentially, this reads the blocks following
+ * @start + @blkcnt into the read-ahead window. The read is asynchronous if the
+ * driver provides read_async().
+ *
+ * @dev: Block device which was read
+ * @start: Start block of the read
+ * @blkcnt: Number of blocks read
+ */
+void blk_readahead_update(struct udevice *dev, lbaint_t start,
+			  lbaint_t blkcnt);
+
+/**
+ * blk_readahead_invalidate() - drop the read-ahead window of a device
+ *
+ * This waits for any outstanding read, so the device is idle afterwards.
+ *
+ * @dev: Block device to update
+ */
+void blk_readahead_invalidate(struct udevice *dev);
+
+/**
+ * blk_readahead_set_size() - set the size of the read-ahead window
+ *
+ * @dev: Block device to update
+ * @size: Window size in bytes, rounded down to whole blocks; 0 to disable
+ * Return: 0 if OK, -ENOSYS if @dev is not probed
+ */
+int blk_readahead_set_size(struct udevice *dev, ulong size);
+
+/**
+ * blk_readahead_get() - get the read-ahead state of a device
+ *
+ * @dev: Block device to check
+ * Return: read-ahead state, or NULL if @dev is not probed
+ */
+struct blk_readahead *blk_readahead_get(struct udevice *dev);
+#else
+static inline lbaint_t blk_readahead_read(struct udevice *dev, lbaint_t start,
+					  lbaint_t blkcnt, void *buffer)
+{
+	return 0;
+}
+
+static inline void blk_readahead_update(struct udevice *dev, lbaint_t start,
+					lbaint_t blkcnt) {}
+
+static inline void blk_readahead_invalidate(struct udevice *dev) {}
+
+static inline int blk_readahead_set_size(struct udevice *dev, ulong size)
+{
+	return -ENOSYS;
+}
+
+static inline struct blk_readahead *blk_readahead_get(struct udevice *dev)
+{
+	return NULL;
+}
+#endif
+
 /**
  * blk_find_device() - Find a block device
  *
@@ -541,7 +708,7 @@ static inline ulong blk_dread(struct blk_desc *block_dev, lbaint_t start,
 {
 	ulong blks_read;
 	if (blkcache_read(block_dev->uclass_id, block_dev->devnum,
-			  start, blkcnt, block_dev->blksz, buffer))
+			  start, blkcnt, block_dev->blksz, buffer) == blkcnt)
 		return blkcnt;
 
 	/*
@@ -9,6 +9,7 @@
 
 #include <linux/types.h>
 
+struct cpu_job;
 struct udevice;
 
 /**
@@ -102,6 +103,20 @@ struct cpu_ops {
 	 *         if not.
 	 */
 	int (*is_current)(struct udevice *dev);
+
+	/**
+	 * start_job() - Start running a job on a CPU
+	 *
+	 * This is only called for CPUs other than the current one. It must
+	 * return without waiting for the job, which the CPU then runs by
+	 * calling cpu_job_run(). Drivers which cannot run code on their CPU
+	 * leave this NULL.
+	 *
+	 * @dev:	Device to run the job on (UCLASS_CPU)
+	 * @job:	Job to run
+	 * @return 0 if the job was started, -ve on error
+	 */
+	int (*start_job)(struct udevice *dev, struct cpu_job *job);
 };
 
 #define cpu_get_ops(dev)        ((struct cpu_ops *)(dev)->driver->ops)
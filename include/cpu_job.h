@@ -0,0 +1,142 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Jobs run on secondary CPUs
+ *
+ * On multi-core SoCs U-Boot normally leaves all but one CPU parked. A CPU
+ * driver which can wake its CPU up and point it at a function provides the
+ * start_job() operation, allowing long-running, self-contained work such as
+ * decompression to be handed off while the boot CPU gets on with something
+ * else.
+ *
+ * A job runs with none of U-Boot's services: it must not use the console,
+ * malloc(), timers, driver model or anything else which keeps global state. It
+ * may only touch memory which the caller has handed over to it until
+ * cpu_job_wait() returns.
+ */
+
+#ifndef __CPU_JOB_H
+#define __CPU_JOB_H
+
+#include <linux/errno.h>
+#include <linux/list.h>
+#include <linux/types.h>
+
+struct udevice;
+
+/**
+ * struct cpu_job - a piece of work to run on another CPU
+ *
+ * @func: Function to run
+ * @arg: Argument passed to @func
+ * @ret: Value returned by @func, valid once @done is true
+ * @done: true once @func has returned
+ * @cpu: CPU the job was started on, NULL if it has not been started
+ * @sibling: Node in the list of jobs which are in flight
+ */
+struct cpu_job {
+	int (*func)(void *arg);
+	void *arg;
+	int ret;
+	bool done;
+	struct udevice *cpu;
+	struct list_head sibling;
+};
+
+/**
+ * cpu_job_init() - set up a job
+ *
+ * @job: Job to set up
+ * @func: Function to run
+ * @arg: Argument to pass to @func
+ */
+static inline void cpu_job_init(struct cpu_job *job, int (*func)(void *arg),
+				void *arg)
+{
+	job->func = func;
+	job->arg = arg;
+	job->ret = 0;
+	job->done = false;
+	job->cpu = NULL;
+}
+
+/**
+ * cpu_job_run() - run a job and mark it as done
+ *
+ * This is called by the CPU driver, on the CPU chosen for the job. Once it
+ * returns the CPU may go back to sleep.
+ *
+ * @job: Job to run
+ */
+static inline void cpu_job_run(struct cpu_job *job)
+{
+	job->ret = job->func(job->arg);
+
+	/* make everything the job wrote visible before it is seen as done */
+	__atomic_store_n(&job->done, true, __ATOMIC_RELEASE);
+}
+
+#if CONFIG_IS_ENABLED(CPU_JOBS)
+/**
+ * cpu_job_start() - start a job on an idle CPU
+ *
+ * This looks for a CPU, other than the current one, which supports
+ * start_job() and is not already running a job. If there is none, the job is
+ * left for cpu_job_wait() to run on this CPU.
+ *
+ * @job: Job to start, set up with cpu_job_init()
+ * Return: 0 if started on another CPU, -EBUSY if there is no CPU to run it
+ */
+int cpu_job_start(struct cpu_job *job);
+
+/**
+ * cpu_job_wait() - wait for a job to finish
+ *
+ * If the job was never started on another CPU, it is run here instead.
+ *
+ * @job: Job to wait for
+ * Return: value returned by the job's function
+ */
+int cpu_job_wait(struct cpu_job *job);
+
+/**
+ * cpu_run_jobs() - run a set of jobs in parallel
+ *
+ * Each job is started on an idle CPU where there is one. The rest are run on
+ * this CPU, while the others proceed.
+ *
+ * @jobs: Jobs to run, each set up with cpu_job_init()
+ * @count: Number of jobs
+ * Return: 0 if all jobs returned 0, else the first error returned
+ */
+int cpu_run_jobs(struct cpu_job *jobs, int count);
+#else
+static inline int cpu_job_start(struct cpu_job *job)
+{
+	return -EBUSY;
+}
+
+static inline int cpu_job_wait(struct cpu_job *job)
+{
+	if (!job->done)
+		cpu_job_run(job);
+
+	return job->ret;
+}
+
+static inline int cpu_run_jobs(struct cpu_job *jobs, int count)
+{
+	int ret = 0;
+	int i;
+
+	for (i = 0; i < count; i++) {
+		int err = cpu_job_wait(&jobs[i]);
+
+		if (err && !ret)
+			ret = err;
+	}
+
+	return ret;
+}
+#endif
+
+#endif /* __CPU_JOB_H */
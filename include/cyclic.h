@@ -14,6 +14,13 @@
 #include <linux/list.h>
 #include <asm/types.h>
 
+/*
+ * Number of buckets in each histogram of struct cyclic_info. Bucket i counts
+ * times below CYCLIC_HIST_LIMIT(i) us, the last one counts the rest.
+ */
+#define CYCLIC_HIST_BUCKETS	8
+#define CYCLIC_HIST_LIMIT(i)	(2ULL << (2 * (i)))
+
 /**
  * struct cyclic_info - Information about cyclic execution function
  *
@@ -24,8 +31,10 @@
  * @cpu_time_us: Total CPU time of this function
  * @run_cnt: Counter of executions occurances
  * @next_call: Next time in us, when the function shall be executed again
- * @list: List node
+ * @list: List node, in the list of cyclic functions ordered by @next_call
  * @already_warned: Flag that we've warned about exceeding CPU time usage
+ * @cpu_hist: Histogram of the time taken by each call
+ * @late_hist: Histogram of how late each call was, after @next_call
  *
  * When !CONFIG_CYCLIC, this struct is empty.
  */
@@ -40,6 +49,8 @@ struct cyclic_info {
 	uint64_t next_call;
 	struct hlist_node list;
 	bool already_warned;
+	u32 cpu_hist[CYCLIC_HIST_BUCKETS];
+	u32 late_hist[CYCLIC_HIST_BUCKETS];
 #endif
 };
 
@@ -79,17 +90,18 @@ int cyclic_unregister_all(void);
 /**
  * cyclic_get_list() - Get cyclic list pointer
  *
- * Return the cyclic list pointer
+ * Return the cyclic list pointer. The list is ordered by the time at which
+ * each function is next due.
  *
  * @return: pointer to cyclic_list
  */
 struct hlist_head *cyclic_get_list(void);
 
 /**
- * cyclic_run() - Interate over all registered cyclic functions
+ * cyclic_run() - Call the registered cyclic functions which are due
  *
- * Interate over all registered cyclic functions and if the it's function
- * needs to be executed, then call into these registered functions.
+ * The list is ordered by the time at which each function is next due, so
+ * this returns after checking only the first one if none is due.
  */
 void cyclic_run(void);
 
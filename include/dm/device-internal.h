@@ -192,6 +192,26 @@ int device_of_to_plat(struct udevice *dev);
  */
 int device_probe(struct udevice *dev);
 
+/**
+ * device_probe_parallel() - Probe several devices at the same time
+ *
+ * Each device is probed in its own thread (see uthread.h), so that when one
+ * driver waits, e.g. for a link to come up, the others carry on. The parents
+ * of the devices are probed first, one after another. Without CONFIG_UTHREAD
+ * the devices are simply probed in turn.
+ *
+ * The devices must be distinct and must not depend on each other; a device
+ * which needs another one in the list must be probed separately afterwards.
+ *
+ * All devices are probed even if some of them fail.
+ *
+ * @devs: Devices to probe
+ * @count: Number of devices in @devs
+ * Return: 0 if OK, else the error from the first device (in @devs order)
+ *	which failed
+ */
+int device_probe_parallel(struct udevice **devs, int count);
+
 /**
  * device_remove() - Remove a device, de-activating it
  *
@@ -12,6 +12,8 @@
 #include <dm/ofnode.h>
 #include <dm/uclass-id.h>
 
+struct udevice_id;
+
 /**
  * lists_driver_lookup_name() - Return u_boot_driver corresponding to name
  *
@@ -23,6 +25,20 @@
  */
 struct driver *lists_driver_lookup_name(const char *name);
 
+/**
+ * lists_driver_lookup_compat() - Find the driver for a compatible string
+ *
+ * If several drivers list the string, the first one in the linker list is
+ * returned. With CONFIG_DM_COMPAT_HASH this uses an index which is built on
+ * the first call.
+ *
+ * @compat: Compatible string to look up
+ * @idp: Returns the matching entry in the driver's of_match table
+ * Return: pointer to driver, or NULL if not found
+ */
+struct driver *lists_driver_lookup_compat(const char *compat,
+					  const struct udevice_id **idp);
+
 /**
  * lists_uclass_lookup() - Return uclass_driver based on ID of the class
  *
@@ -49,6 +49,12 @@ struct property {
  * @parent: Pointer to parent node, or NULL if this is the root node
  * @child: Pointer to head of child node list, or NULL if no children
  * @sibling: Pointer to the next sibling node, or NULL if this is the last
+ * @lazy: With CONFIG_OF_LIVE_LAZY, if @offset is not -1, the flat tree from
+ *	which the properties are still to be read, see of_live_get_props().
+ *	Once they are read, the memory allocated for them. NULL if the node
+ *	was not unflattened lazily or there was no memory for its properties
+ * @offset: Offset of the node in the flat tree, or -1 once the properties
+ *	are read
  */
 struct device_node {
 	const char *name;
@@ -60,6 +66,10 @@ struct device_node {
 	struct device_node *parent;
 	struct device_node *child;
 	struct device_node *sibling;
+#if CONFIG_IS_ENABLED(OF_LIVE_LAZY)
+	void *lazy;
+	int offset;
+#endif
 };
 
 #define BAD_OF_ROOT	0xdead11e3
@@ -139,6 +139,13 @@ struct dm_test_perdev_uc_pdata {
  */
 extern int dm_testdrv_op_count[DM_TEST_OP_COUNT];
 
+/*
+ * Number of slow test devices probing at present, and the most there have
+ * been at once, used to check that probes overlap
+ */
+extern int dm_test_slow_probing;
+extern int dm_test_slow_probing_max;
+
 extern struct unit_test_state global_dm_test_state;
 
 /* Declare a new driver model test */
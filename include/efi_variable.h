@@ -211,10 +211,11 @@ struct efi_var_entry *efi_var_mem_find(const efi_guid_t *guid, const u16 *name,
 void efi_var_mem_del(struct efi_var_entry *var);
 
 /**
- * efi_var_mem_ins() - append a variable to the list of variables
+ * efi_var_mem_ins() - add a variable to the list of variables
  *
- * The variable is appended without checking if a variable of the same name
- * already exists. The two data buffers are concatenated.
+ * The variable replaces any existing variable of the same name and GUID,
+ * which is only removed once the new one has been stored. The two data
+ * buffers are concatenated, and may point into the existing variable.
  *
  * @variable_name:	variable name
  * @vendor:		GUID
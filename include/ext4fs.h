@@ -158,6 +158,26 @@ int ext4fs_devread(lbaint_t sector, int byte_offset, int byte_len, char *buf);
 void ext4fs_set_blk_dev(struct blk_desc *rbdd, struct disk_partition *info);
 long int read_allocated_block(struct ext2_inode *inode, int fileblock,
 			      struct ext_block_cache *cache);
+
+/**
+ * ext4fs_map_blocks() - find where a run of file blocks is stored
+ *
+ * The extents of the last inode looked up are cached until the filesystem is
+ * closed or written, so reading a file in pieces does not walk the extent
+ * tree again for every piece.
+ *
+ * @node: File to look in
+ * @fileblock: First file block to look up
+ * @count: On entry, the most blocks wanted. On exit, the number of blocks
+ *	from @fileblock which are contiguous on disk, or which are all sparse
+ * @start: Returns the filesystem block holding @fileblock, or 0 if the blocks
+ *	are sparse and read as zeroes
+ * @cache: Cache to use when reading the extent tree
+ * Return: 0 if OK, -ve on error
+ */
+int ext4fs_map_blocks(struct ext2fs_node *node, uint32_t fileblock,
+		      uint32_t *count, uint64_t *start,
+		      struct ext_block_cache *cache);
 int ext4fs_probe(struct blk_desc *fs_dev_desc,
 		 struct disk_partition *fs_partition);
 int ext4_read_file(const char *filename, void *buf, loff_t offset, loff_t len,
@@ -87,9 +87,32 @@ int fs_set_blk_dev_with_part(struct blk_desc *desc, int part);
  * Many file functions implicitly call fs_close(), e.g. fs_closedir(),
  * fs_exist(), fs_ln(), fs_ls(), fs_mkdir(), fs_read(), fs_size(), fs_write(),
  * fs_unlink().
+ *
+ * With CONFIG_FS_MOUNT_CACHE a filesystem on a block device is kept open
+ * afterwards, so that the next operation on the same partition does not need
+ * to probe it again. It is closed when something is written to it or when
+ * another filesystem is needed.
  */
 void fs_close(void);
 
+#if CONFIG_IS_ENABLED(FS_MOUNT_CACHE)
+/**
+ * fs_invalidate() - close a filesystem kept open between operations
+ *
+ * This must be called when a block device changes other than through the
+ * filesystem layer, e.g. it is written to directly, a new medium is inserted
+ * or the device is removed. If an operation is in progress, the filesystem is
+ * closed once it completes.
+ *
+ * @desc: Block device which has changed, or NULL for any
+ */
+void fs_invalidate(struct blk_desc *desc);
+#else
+static inline void fs_invalidate(struct blk_desc *desc)
+{
+}
+#endif
+
 /**
  * fs_get_type() - Get type of current filesystem
  *
@@ -17,6 +17,7 @@
 #define _I2C_H_
 
 #include <linker_lists.h>
+#include <uthread.h>
 
 /*
  * For now there are essentially two parts to this file - driver model
@@ -120,10 +121,13 @@ struct dm_i2c_chip {
  *
  * @speed_hz: Bus speed in hertz (typically 100000)
  * @max_transaction_bytes: Maximal size of single I2C transfer
+ * @lock: Held for each transfer, so that threads probing devices on the same
+ *	bus do not interleave their transfers
  */
 struct dm_i2c_bus {
 	int speed_hz;
 	int max_transaction_bytes;
+	struct uthread_mutex lock;
 };
 
 /*
@@ -34,6 +34,7 @@ struct fdt_region;
 #include <lmb.h>
 #include <asm/u-boot.h>
 #include <command.h>
+#include <cpu_job.h>
 #include <linker_lists.h>
 
 #define IMAGE_INDENT_STRING	"   "
@@ -1022,6 +1023,64 @@ int image_decomp(int comp, ulong load, ulong image_start, int type,
 		 void *load_buf, void *image_buf, ulong image_len,
 		 uint unc_len, ulong *load_end);
 
+#ifndef USE_HOSTCC
+/**
+ * struct image_decomp_job - an image decompressed on another CPU
+ *
+ * @job:	Job which does the decompression
+ * @comp:	Compression algorithm that is used (IH_COMP_...)
+ * @load:	Destination load address in U-Boot memory
+ * @image_start: Image start address (where we are decompressing from)
+ * @type:	OS type (IH_OS_...)
+ * @load_buf:	Place to decompress to
+ * @image_buf:	Address to decompress from
+ * @image_len:	Number of bytes in @image_buf, then the number decompressed
+ * @unc_len:	Available space for decompression
+ * @workspace:	Decompressor state allocated for the job, or NULL
+ */
+struct image_decomp_job {
+	struct cpu_job job;
+	int comp;
+	ulong load;
+	ulong image_start;
+	int type;
+	void *load_buf;
+	void *image_buf;
+	ulong image_len;
+	uint unc_len;
+	void *workspace;
+};
+
+/**
+ * image_decomp_start() - start decompressing an image on another CPU
+ *
+ * This takes the same arguments as image_decomp(). Where the algorithm can run
+ * on a secondary CPU and one is idle, decompression starts there and this CPU
+ * may get on with other work, as long as it leaves @load_buf and @image_buf
+ * alone. Otherwise the whole job is left for image_decomp_wait().
+ *
+ * Either way, image_decomp_wait() must be called afterwards.
+ *
+ * @dj:		Job information to fill in
+ * Return: 0 if started on another CPU, -ve if image_decomp_wait() is to do it
+ */
+int image_decomp_start(struct image_decomp_job *dj, int comp, ulong load,
+		       ulong image_start, int type, void *load_buf,
+		       void *image_buf, ulong image_len, uint unc_len);
+
+/**
+ * image_decomp_wait() - finish decompressing an image
+ *
+ * This prints the same message as image_decomp() and either waits for the
+ * other CPU or decompresses the image itself.
+ *
+ * @dj:		Job set up by image_decomp_start()
+ * @load_end:	Returns the end of the decompressed data
+ * Return: 0 if OK, -ve on error
+ */
+int image_decomp_wait(struct image_decomp_job *dj, ulong *load_end);
+#endif
+
 /**
  * Set up properties in the FDT
  *
@@ -1339,6 +1398,85 @@ int fit_image_verify_with_data(const void *fit, int image_noffset,
 			       const void *key_blob, const void *data,
 			       size_t size);
 
+/* Maximum number of hash nodes in an image which can be streamed */
+#define FIT_HASH_STREAM_MAX	4
+
+/**
+ * struct fit_hash_stream - hashes of an image worked out as its data arrives
+ *
+ * This allows the hashes to be calculated a piece at a time, e.g. as each
+ * chunk is read from storage, instead of in a separate pass once the whole
+ * image is in memory. All the hash nodes are worked out in the same pass.
+ *
+ * @count:	Number of hash nodes being worked out
+ * @hash:	Information for each hash node
+ * @hash.noffset: Offset of the hash node
+ * @hash.algo:	Algorithm to use
+ * @hash.ctx:	Algorithm context, NULL once finished or on error
+ * @hash.value:	Hash value, once finished
+ * @hash.value_len: Length of @hash.value, -1 on error
+ */
+struct fit_hash_stream {
+	int count;
+	struct fit_hash_stream_node {
+		int noffset;
+		struct hash_algo *algo;
+		void *ctx;
+		uint8_t value[FIT_MAX_HASH_LEN];
+		int value_len;
+	} hash[FIT_HASH_STREAM_MAX];
+};
+
+/**
+ * fit_image_hash_stream_start() - start working out the hashes of an image
+ *
+ * @hs:		Stream to set up
+ * @fit:	Pointer to the FIT format image header
+ * @image_noffset: Offset in @fit of image to hash
+ * Return: 0 if OK, -ENOSYS if a hash node cannot be worked out in pieces, in
+ *	which case fit_image_verify_with_data() must be used instead
+ */
+int fit_image_hash_stream_start(struct fit_hash_stream *hs, const void *fit,
+				int image_noffset);
+
+/**
+ * fit_image_hash_stream_update() - add the next piece of image data
+ *
+ * @hs:		Stream set up by fit_image_hash_stream_start()
+ * @data:	Image data
+ * @size:	Size of @data
+ */
+void fit_image_hash_stream_update(struct fit_hash_stream *hs, const void *data,
+				  size_t size);
+
+/**
+ * fit_image_hash_stream_finish() - finish working out the hashes
+ *
+ * This is called by fit_image_verify_stream(). Callers which give up on an
+ * image must call it to free the hash contexts.
+ *
+ * @hs:		Stream set up by fit_image_hash_stream_start()
+ */
+void fit_image_hash_stream_finish(struct fit_hash_stream *hs);
+
+/**
+ * fit_image_verify_stream() - Verify an image whose hashes have been streamed
+ *
+ * This is the same as fit_image_verify_with_data() except that hash nodes
+ * covered by @hs are not calculated again. Signatures still use @data.
+ *
+ * @fit:	Pointer to the FIT format image header
+ * @image_noffset: Offset in @fit of image to verify
+ * @key_blob:	FDT containing public keys
+ * @data:	Image data to verify
+ * @size:	Size of image data
+ * @hs:		Stream with all of @data added, or NULL if none
+ * Return: 1 if the image is valid, 0 if not
+ */
+int fit_image_verify_stream(const void *fit, int image_noffset,
+			    const void *key_blob, const void *data,
+			    size_t size, struct fit_hash_stream *hs);
+
 int fit_image_verify(const void *fit, int noffset);
 #if CONFIG_IS_ENABLED(FIT_SIGNATURE)
 int fit_config_verify(const void *fit, int conf_noffset);
@@ -220,6 +220,50 @@ zstd_dctx *zstd_init_dctx(void *workspace, size_t workspace_size);
 size_t zstd_decompress_dctx(zstd_dctx *dctx, void *dst, size_t dst_capacity,
 	const void *src, size_t src_size);
 
+typedef ZSTD_DDict zstd_ddict;
+
+/**
+ * zstd_ddict_workspace_bound() - memory needed to initialize a zstd_ddict
+ * @dict_size: The size of the dictionary.
+ *
+ * Return:     A lower bound on the size of the workspace that is passed to
+ *             zstd_init_ddict().
+ */
+size_t zstd_ddict_workspace_bound(size_t dict_size);
+
+/**
+ * zstd_init_ddict() - initialize a digested decompression dictionary
+ * @workspace:      The workspace to emplace the dictionary into. It must
+ *                  outlive the returned dictionary.
+ * @workspace_size: The size of workspace. Use zstd_ddict_workspace_bound() to
+ *                  determine how large the workspace must be.
+ * @dict:           The dictionary, either in zstd format or raw content. It is
+ *                  referenced rather than copied, so it must outlive the
+ *                  returned dictionary.
+ * @dict_size:      The size of the dictionary.
+ *
+ * Return:          A zstd decompression dictionary or NULL on error.
+ */
+const zstd_ddict *zstd_init_ddict(void *workspace, size_t workspace_size,
+	const void *dict, size_t dict_size);
+
+/**
+ * zstd_decompress_using_ddict() - decompress src into dst using a dictionary
+ * @dctx:         The decompression context.
+ * @dst:          The buffer to decompress src into.
+ * @dst_capacity: The size of the destination buffer.
+ * @src:          The zstd compressed data to decompress.
+ * @src_size:     The exact size of the data to decompress.
+ * @ddict:        The dictionary to use. It is only read, so it may be shared
+ *                between contexts.
+ *
+ * Return:        The decompressed size or an error, which can be checked using
+ *                zstd_is_error().
+ */
+size_t zstd_decompress_using_ddict(zstd_dctx *dctx, void *dst,
+	size_t dst_capacity, const void *src, size_t src_size,
+	const zstd_ddict *ddict);
+
 /* ======   Streaming Buffers   ====== */
 
 /**
@@ -455,4 +499,85 @@ struct abuf;
  */
 int zstd_decompress(struct abuf *in, struct abuf *out);
 
+/**
+ * zstd_decompress_ctx() - Decompress Zstandard frames with a given context
+ *
+ * All the frames at the start of @in are decompressed, one after the other.
+ * Skippable frames, and anything after the last frame, are ignored.
+ *
+ * This neither allocates memory nor prints anything, so it is safe to call
+ * where U-Boot's services are not available, e.g. on a secondary CPU.
+ *
+ * @ctx: Context set up with zstd_init_dctx()
+ * @in: Input buffer to decompress
+ * @out: Output buffer to hold the results (must be large enough)
+ * Return: size of the decompressed data, -EINVAL if the data is corrupt or does
+ * not fit in @out
+ */
+int zstd_decompress_ctx(zstd_dctx *ctx, struct abuf *in, struct abuf *out);
+
+/**
+ * struct zstd_decomp - Zstandard decompressor which can be reused
+ *
+ * This holds a decompression context and, optionally, a dictionary, so that
+ * several images can be decompressed without setting them up each time.
+ *
+ * @dctx: Context used on this CPU
+ * @ddict: Dictionary, or NULL if none
+ * @max_jobs: Largest number of runs of frames to decompress at once, each on
+ *	its own CPU. This is set by zstd_decomp_init() from the number of CPUs
+ *	and may be lowered by the caller; 1 decompresses everything on this CPU
+ * @workspace: Memory holding @dctx
+ * @dict_workspace: Memory holding @ddict
+ * @job_workspace: Memory holding the contexts used by other CPUs
+ * @job_count: Number of contexts @job_workspace has room for
+ */
+struct zstd_decomp {
+	zstd_dctx *dctx;
+	const zstd_ddict *ddict;
+	int max_jobs;
+	void *workspace;
+	void *dict_workspace;
+	void *job_workspace;
+	int job_count;
+};
+
+/**
+ * zstd_decomp_init() - Set up a decompressor
+ *
+ * @zd: Decompressor to set up
+ * @dict: Dictionary to decompress with, in zstd format or raw content, or NULL
+ *	for none. This is not copied, so must remain valid until
+ *	zstd_decomp_uninit() is called
+ * @dict_size: Size of @dict in bytes
+ * Return: 0 if OK, -ENOMEM if out of memory, -EINVAL if @dict is not valid
+ */
+int zstd_decomp_init(struct zstd_decomp *zd, const void *dict,
+		     size_t dict_size);
+
+/**
+ * zstd_decomp_run() - Decompress Zstandard data
+ *
+ * All the frames at the start of @in are decompressed, one after the other.
+ * Skippable frames, and anything after the last frame, are ignored.
+ *
+ * Where there are several frames, each of which records its decompressed size,
+ * they are split into runs of similar compressed size which are decompressed
+ * in parallel on different CPUs, see cpu_run_jobs().
+ *
+ * @zd: Decompressor set up by zstd_decomp_init()
+ * @in: Input buffer to decompress
+ * @out: Output buffer to hold the results (must be large enough)
+ * Return: size of the decompressed data, -EINVAL if the data is corrupt or does
+ * not fit in @out, -ENOMEM if out of memory
+ */
+int zstd_decomp_run(struct zstd_decomp *zd, struct abuf *in, struct abuf *out);
+
+/**
+ * zstd_decomp_uninit() - Free the memory used by a decompressor
+ *
+ * @zd: Decompressor to free
+ */
+void zstd_decomp_uninit(struct zstd_decomp *zd);
+
 #endif  /* LINUX_ZSTD_H */
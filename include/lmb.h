@@ -41,33 +41,41 @@ struct lmb_property {
  *
  * case 1. CONFIG_LMB_USE_MAX_REGIONS is defined (legacy mode)
  *         => CONFIG_LMB_MAX_REGIONS is used to configure the region size,
- *         directly in the array lmb_region.region[], with the same
- *         configuration for memory and reserved regions.
+ *         with the same configuration for memory and reserved regions.
  *
  * case 2. CONFIG_LMB_USE_MAX_REGIONS is not defined, the size of each
  *         region is configurated *independently* with
  *         => CONFIG_LMB_MEMORY_REGIONS: struct lmb.memory_regions
  *         => CONFIG_LMB_RESERVED_REGIONS: struct lmb.reserved_regions
- *         lmb_region.region is only a pointer to the correct buffer,
- *         initialized in lmb_init(). This configuration is useful to manage
- *         more reserved memory regions with CONFIG_LMB_RESERVED_REGIONS.
+ *         This configuration is useful to manage more reserved memory
+ *         regions with CONFIG_LMB_RESERVED_REGIONS.
+ *
+ * In both cases lmb_region.region points to the buffer in struct lmb,
+ * initialized in lmb_init(). With CONFIG_LMB_GROW, a full buffer is replaced
+ * by a larger one on the heap once malloc() is available, so the size only
+ * limits the number of regions before relocation.
  */
+#if IS_ENABLED(CONFIG_LMB_USE_MAX_REGIONS)
+#define LMB_MEMORY_REGIONS	CONFIG_LMB_MAX_REGIONS
+#define LMB_RESERVED_REGIONS	CONFIG_LMB_MAX_REGIONS
+#else
+#define LMB_MEMORY_REGIONS	CONFIG_LMB_MEMORY_REGIONS
+#define LMB_RESERVED_REGIONS	CONFIG_LMB_RESERVED_REGIONS
+#endif
 
 /**
  * struct lmb_region - Description of a set of region.
  *
  * @cnt: Number of regions.
  * @max: Size of the region array, max value of cnt.
- * @region: Array of the region properties
+ * @heap: true if @region was allocated on the heap, see lmb_uninit()
+ * @region: Array of the region properties, sorted by base address
  */
 struct lmb_region {
 	unsigned long cnt;
 	unsigned long max;
-#if IS_ENABLED(CONFIG_LMB_USE_MAX_REGIONS)
-	struct lmb_property region[CONFIG_LMB_MAX_REGIONS];
-#else
+	bool heap;
 	struct lmb_property *region;
-#endif
 };
 
 /**
@@ -80,19 +88,32 @@ struct lmb_region {
  *
  * @memory: Description of memory regions.
  * @reserved: Description of reserved regions.
+ * @best_fit: Allocate from the smallest free area which is large enough,
+ *	instead of the highest one. This leaves large areas free for later
+ *	allocations. Set by lmb_init() from CONFIG_LMB_BEST_FIT.
  * @memory_regions: Array of the memory regions (statically allocated)
  * @reserved_regions: Array of the reserved regions (statically allocated)
  */
 struct lmb {
 	struct lmb_region memory;
 	struct lmb_region reserved;
-#if !IS_ENABLED(CONFIG_LMB_USE_MAX_REGIONS)
-	struct lmb_property memory_regions[CONFIG_LMB_MEMORY_REGIONS];
-	struct lmb_property reserved_regions[CONFIG_LMB_RESERVED_REGIONS];
-#endif
+	bool best_fit;
+	struct lmb_property memory_regions[LMB_MEMORY_REGIONS];
+	struct lmb_property reserved_regions[LMB_RESERVED_REGIONS];
 };
 
 void lmb_init(struct lmb *lmb);
+
+/**
+ * lmb_uninit() - free the memory used by an lmb
+ *
+ * This is only needed if regions may have been added after relocation with
+ * CONFIG_LMB_GROW, since the region arrays may then be on the heap. The lmb
+ * is left empty, as after lmb_init().
+ *
+ * @lmb:	the logical memory block struct, which must have been initialized
+ */
+void lmb_uninit(struct lmb *lmb);
 void lmb_init_and_reserve(struct lmb *lmb, struct bd_info *bd, void *fdt_blob);
 void lmb_init_and_reserve_range(struct lmb *lmb, phys_addr_t base,
 				phys_size_t size, void *fdt_blob);
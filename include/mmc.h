@@ -75,6 +75,7 @@ struct bd_info;
 
 
 #define SD_DATA_4BIT	0x00040000
+#define SD_CMD23_SUPPORT	0x00000002	/* SCR bit 33, in scr[0] */
 
 #define IS_SD(x)	((x)->version & SD_VERSION_SD)
 #define IS_MMC(x)	((x)->version & MMC_VERSION_MMC)
@@ -301,6 +302,7 @@ static inline bool mmc_is_tuning_cmd(uint cmdidx)
 #define EXT_CSD_ENH_GP(x)	(1 << ((x)+1))	/* GP part (x+1) is enhanced */
 
 #define EXT_CSD_HS_CTRL_REL	(1 << 0)	/* host controlled WR_REL_SET */
+#define EXT_CSD_EN_REL_WR	(1 << 2)	/* enhanced reliable write */
 
 #define EXT_CSD_BOOT_WP_B_SEC_WP_SEL	(0x80)	/* enable partition selector */
 #define EXT_CSD_BOOT_WP_B_PWR_WP_SEC_SEL (0x02)	/* partition selector to protect */
@@ -686,7 +688,10 @@ struct mmc {
 	uint legacy_speed; /* speed for the legacy mode provided by the card */
 	uint read_bl_len;
 	bool can_trim;
+	bool cmd23;		/* card supports SET_BLOCK_COUNT (CMD23) */
 #if CONFIG_IS_ENABLED(MMC_WRITE)
+	bool can_rel_write;	/* card supports enhanced reliable write */
+	bool rel_write;		/* use reliable writes for data */
 	uint write_bl_len;
 	uint erase_grp_size;	/* in 512-byte sectors */
 #endif
@@ -904,6 +909,34 @@ int mmc_rpmb_route_frames(struct mmc *mmc, void *req, unsigned long reqlen,
  */
 int mmc_set_bkops_enable(struct mmc *mmc, bool autobkops, bool enable);
 
+/**
+ * mmc_set_blockcount() - send SET_BLOCK_COUNT (CMD23)
+ *
+ * This starts a pre-defined multiple-block transfer, which the card ends by
+ * itself after @blockcount blocks, so no STOP_TRANSMISSION is needed.
+ *
+ * @mmc:		MMC device
+ * @blockcount:		Number of blocks in the following transfer (max 65535)
+ * @is_rel_write:	true to request a reliable write
+ * Return: 0 if OK, -ve on error
+ */
+int mmc_set_blockcount(struct mmc *mmc, unsigned int blockcount,
+		       bool is_rel_write);
+
+/**
+ * mmc_set_rel_write() - enable or disable reliable writes
+ *
+ * When enabled, data writes are sent as reliable writes, so that a block
+ * being written when power is lost keeps either its old or its new contents.
+ * This needs an eMMC card which supports enhanced reliable writes, and
+ * CONFIG_MMC_CMD23.
+ *
+ * @mmc:	MMC device
+ * @enable:	true to enable reliable writes
+ * Return: 0 if OK, -EOPNOTSUPP if the card or configuration does not support it
+ */
+int mmc_set_rel_write(struct mmc *mmc, bool enable);
+
 /**
  * Start device initialization and return immediately; it does not block on
  * polling OCR (operation condition register) status. Useful for checking
@@ -86,7 +86,9 @@ struct ip_tcp_hdr {
 #define TCP_OPT_LEN_8	0x08
 #define TCP_OPT_LEN_A	0x0a		/* Timestamp Length		*/
 #define TCP_MSS		1460		/* Max segment size		*/
-#define TCP_SCALE	0x01		/* Scale			*/
+#define TCP_SCALE	0x07		/* Scale			*/
+#define TCP_ACK_SEGMENTS 2		/* Segments acked at once	*/
+#define TCP_ACK_DELAY	10		/* ms to hold back an ACK	*/
 
 /**
  * struct tcp_mss - TCP option structure for MSS (Max segment size)
@@ -279,6 +281,56 @@ enum tcp_state {
 
 enum tcp_state tcp_get_tcp_state(void);
 void tcp_set_tcp_state(enum tcp_state new_state);
+
+/**
+ * tcp_set_rx_space() - limit the receive window to the space in a buffer
+ *
+ * The window advertised is never larger than CONFIG_PROT_TCP_RX_WINDOW, and
+ * this limits it further so that the other end never sends more than the
+ * application can store. The limit is cleared by a new connection.
+ *
+ * @tcp_seq_num: Sequence number of the first byte stored in the buffer
+ * @size: Size of the buffer, or 0 for no limit
+ */
+void tcp_set_rx_space(u32 tcp_seq_num, ulong size);
+
+/**
+ * tcp_set_delay_ack() - allow ACKs to be held back
+ *
+ * This suits an application which only receives data, since the other end
+ * waits longer to hear that its data arrived. It is cleared when a new TCP
+ * handler is set.
+ *
+ * @enable: true to hold back ACKs as tcp_delay_ack() describes
+ */
+void tcp_set_delay_ack(bool enable);
+
+/**
+ * tcp_delay_ack() - decide whether to hold back an ACK
+ *
+ * If enabled by tcp_set_delay_ack(), a bare ACK for new data in an established connection is held back until
+ * TCP_ACK_SEGMENTS segments need acknowledging, or TCP_ACK_DELAY ms have
+ * passed, so that one ACK covers several segments. Anything else is sent at
+ * once and makes an ACK held back unnecessary.
+ *
+ * @payload_len: Length of data in the packet
+ * @dport: Destination TCP port
+ * @sport: Source TCP port
+ * @action: TCP action to be performed
+ * @tcp_seq_num: TCP sequence number of this transmission
+ * @tcp_ack_num: TCP acknowledgement number
+ * Return: true if the packet is held back, false if it must be sent now
+ */
+bool tcp_delay_ack(int payload_len, int dport, int sport, u8 action,
+		   u32 tcp_seq_num, u32 tcp_ack_num);
+
+/**
+ * tcp_ack_timeout_check() - send an ACK which was held back, once it is due
+ *
+ * @now: Send it now, however long it has been held back
+ */
+void tcp_ack_timeout_check(bool now);
+
 int tcp_set_tcp_header(uchar *pkt, int dport, int sport, int payload_len,
 		       u8 action, u32 tcp_seq_num, u32 tcp_ack_num);
 
@@ -290,7 +342,8 @@ int tcp_set_tcp_header(uchar *pkt, int dport, int sport, int payload_len,
  * @sport: source TCP port
  * @tcp_seq_num: TCP sequential number
  * @tcp_ack_num: TCP acknowledgment number
- * @action: TCP action (SYN, ACK, FIN, etc)
+ * @action: TCP action (SYN, ACK, FIN, etc), or TCP_RST if the other end
+ *	reset the connection
  * @len: packet length
  */
 typedef void rxhand_tcp(uchar *pkt, u16 dport,
@@ -19,3 +19,5 @@ enum wget_state {
 #define DEBUG_WGET		0	/* Set to 1 for debug messages */
 #define WGET_RETRY_COUNT	30
 #define WGET_TIMEOUT		2000UL
+/* Times a dropped connection is opened again during one transfer */
+#define WGET_REOPEN_COUNT	5
@@ -9,8 +9,9 @@
 #ifndef _OF_LIVE_H
 #define _OF_LIVE_H
 
+#include <dm/of.h>
+
 struct abuf;
-struct device_node;
 
 /**
  * of_live_build() - build a live (hierarchical) tree from a flat DT
@@ -25,7 +26,11 @@ int of_live_build(const void *fdt_blob, struct device_node **rootp);
  * unflatten_device_tree() - create tree of device_nodes from flat blob
  *
  * Note that this allocates a single block of memory, pointed to by *mynodes.
- * To free the tree, use free(*mynodes)
+ * To free the tree, use of_live_free(*mynodes)
+ *
+ * With CONFIG_OF_LIVE_LAZY, only the nodes are created here. The properties
+ * of each node are read from @blob when first needed, so @blob must not be
+ * changed while the tree is in use.
  *
  * unflattens a device-tree, creating the
  * tree of struct device_node. It also fills the "name" and "type"
@@ -37,6 +42,38 @@ int of_live_build(const void *fdt_blob, struct device_node **rootp);
  */
 int unflatten_device_tree(const void *blob, struct device_node **mynodes);
 
+/**
+ * of_live_load_props() - Read the properties of a node from the flat tree
+ *
+ * This is used by of_live_get_props() for nodes which were unflattened lazily.
+ * If there is no memory for the properties, the node is given only a status
+ * of "fail" instead, so that it is not used, and they are not read again.
+ *
+ * @np: Node whose properties are still to be read
+ * Return: 0 if OK, -ENOMEM if out of memory
+ */
+int of_live_load_props(struct device_node *np);
+
+/**
+ * of_live_get_props() - Get the properties of a node
+ *
+ * With CONFIG_OF_LIVE_LAZY, the properties are read from the flat tree the
+ * first time this is called for a node. This must be used instead of reading
+ * @np->properties directly.
+ *
+ * @np: Node to check
+ * Return: first property of the node, or NULL if none
+ */
+static inline struct property *of_live_get_props(const struct device_node *np)
+{
+#if CONFIG_IS_ENABLED(OF_LIVE_LAZY)
+	if (np->lazy && np->offset != -1)
+		of_live_load_props((struct device_node *)np);
+#endif
+
+	return np->properties;
+}
+
 /**
  * of_live_free() - Dispose of a livetree
  *
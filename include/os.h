@@ -498,6 +498,34 @@ int os_unmap(void *buf, int size);
  */
 void *os_find_text_base(void);
 
+/**
+ * os_initjmp() - set up a jump buffer to start a function on a new stack
+ *
+ * This uses the host's context functions to run @func on the given stack the
+ * first time @jmp is passed to longjmp().
+ *
+ * @jmp:	host jump buffer to set up
+ * @func:	function to call, which must not return
+ * @stack_base:	lowest address of the stack
+ * @stack_sz:	size of the stack in bytes
+ * Return:	0 if OK, -1 on error
+ */
+int os_initjmp(void *jmp, void (*func)(void), void *stack_base,
+	       size_t stack_sz);
+
+/**
+ * os_thread_start() - run a function on a new host thread
+ *
+ * The thread runs alongside U-Boot and goes away when @func returns. Since
+ * nothing in U-Boot is thread-safe, @func must only work on memory which the
+ * caller has handed over to it.
+ *
+ * @func:	function to run
+ * @arg:	argument to pass to @func
+ * Return:	0 if OK, -ve on error
+ */
+int os_thread_start(void (*func)(void *arg), void *arg);
+
 /**
  * os_relaunch() - restart the sandbox
  *
@@ -12,6 +12,7 @@
 #include <asm-generic/gpio.h>
 #include <log.h>
 #include <phy_interface.h>
+#include <uthread.h>
 #include <dm/ofnode.h>
 #include <dm/read.h>
 #include <linux/errno.h>
@@ -78,6 +79,8 @@ struct mii_dev {
 	int reset_post_delay_us;
 	/** @reset_gpiod: Bus Reset GPIO descriptor pointer */
 	struct gpio_desc reset_gpiod;
+	/** @lock: Held for each access, so threads do not interleave them */
+	struct uthread_mutex lock;
 };
 
 /* struct phy_driver: a structure which defines PHY behavior
@@ -9,6 +9,7 @@
 #ifndef _SPI_H_
 #define _SPI_H_
 
+#include <uthread.h>
 #include <linux/bitops.h>
 
 /* SPI mode flags */
@@ -47,6 +48,8 @@
  * @max_hz:	Maximum speed that the bus can tolerate.
  * @speed:	Current bus speed. This is 0 until the bus is first claimed.
  * @mode:	Current bus mode. This is 0 until the bus is first claimed.
+ * @lock:	Held from claiming the bus until releasing it, so that threads
+ *		probing devices on the same bus do not interleave transfers
  *
  * TODO(sjg@chromium.org): Remove this and use max_hz from struct spi_slave.
  */
@@ -54,6 +57,7 @@ struct dm_spi_bus {
 	uint max_hz;
 	uint speed;
 	uint mode;
+	struct uthread_mutex lock;
 };
 
 /**
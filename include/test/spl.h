@@ -31,6 +31,8 @@ void generate_data(char *data, size_t size, const char *test_name);
  * @IMX8: i.MX8 Container images
  * @FIT_INTERNAL: FITs with internal data
  * @FIT_EXTERNAL: FITs with external data
+ * @FIT_EXTERNAL_LZMA: FITs with external data, LZMA compressed
+ * @FIT_EXTERNAL_GZIP: FITs with external data, gzip compressed
  */
 enum spl_test_image {
 	LEGACY,
@@ -38,6 +40,8 @@ enum spl_test_image {
 	IMX8,
 	FIT_INTERNAL,
 	FIT_EXTERNAL,
+	FIT_EXTERNAL_LZMA,
+	FIT_EXTERNAL_GZIP,
 };
 
 /**
@@ -135,6 +139,14 @@ static inline bool image_supported(enum spl_test_image type)
 	case FIT_EXTERNAL:
 		return IS_ENABLED(CONFIG_SPL_LOAD_FIT) ||
 		       IS_ENABLED(CONFIG_SPL_LOAD_FIT_FULL);
+	case FIT_EXTERNAL_LZMA:
+		return IS_ENABLED(CONFIG_SPL_LZMA) &&
+		       IS_ENABLED(CONFIG_SPL_LOAD_FIT) &&
+		       !IS_ENABLED(CONFIG_SPL_LOAD_FIT_FULL);
+	case FIT_EXTERNAL_GZIP:
+		return IS_ENABLED(CONFIG_SPL_GZIP) &&
+		       IS_ENABLED(CONFIG_SPL_LOAD_FIT) &&
+		       !IS_ENABLED(CONFIG_SPL_LOAD_FIT_FULL);
 	}
 
 	return false;
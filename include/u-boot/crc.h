@@ -123,4 +123,19 @@ void crc32c_init(uint32_t *crc32c_table, uint32_t pol);
 uint32_t crc32c_cal(uint32_t crc, const char *data, int length,
 		    uint32_t *crc32c_table);
 
+/**
+ * crc32c() - Calculate the CRC32C (Castagnoli) of a block of data
+ *
+ * This uses the CPU's CRC32C instruction where it is enabled (ARM64_CRC32 or
+ * X86_CRC32C), else a table-driven version which handles eight bytes at a time.
+ * There is no one's complement applied, so callers normally start with ~0 and
+ * invert the result.
+ *
+ * @crc: Previous crc
+ * @buf: Data bytes to checksum
+ * @len: Number of bytes to process
+ * Return: checksum value
+ */
+uint32_t crc32c(uint32_t crc, const void *buf, size_t len);
+
 #endif /* _UBOOT_CRC_H */
@@ -0,0 +1,155 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Cooperative threads
+ *
+ * A uthread runs on its own stack until it calls uthread_schedule(), directly
+ * or through udelay(), at which point the next runnable thread is resumed.
+ * There is no preemption, so shared state only changes hands at those points.
+ * Since any delay is such a point, a sequence which must not be interleaved
+ * with other threads, such as a bus transfer, is guarded by a uthread_mutex.
+ * This is enough to let several slow hardware initialisations wait at the
+ * same time instead of one after another.
+ */
+
+#ifndef __UTHREAD_H
+#define __UTHREAD_H
+
+#include <linux/errno.h>
+#include <linux/list.h>
+#include <linux/types.h>
+#if CONFIG_IS_ENABLED(UTHREAD)
+#include <asm/setjmp.h>
+#endif
+
+/**
+ * struct uthread - a cooperative thread
+ *
+ * @fn: Function run by the thread
+ * @arg: Argument passed to @fn
+ * @ctx: Saved context, valid while the thread is not running
+ * @stack: Stack of the thread, NULL for the main thread
+ * @done: true once @fn has returned
+ * @alloced: true if this structure was allocated by uthread_create()
+ * @grp_id: Group this thread belongs to, 0 for none
+ * @list: Node in the list of threads
+ *
+ * When !CONFIG_UTHREAD, this struct is empty.
+ */
+struct uthread {
+#if CONFIG_IS_ENABLED(UTHREAD)
+	void (*fn)(void *arg);
+	void *arg;
+	jmp_buf ctx;
+	void *stack;
+	bool done;
+	bool alloced;
+	unsigned int grp_id;
+	struct list_head list;
+#endif
+};
+
+/**
+ * struct uthread_mutex - lock which one thread holds while others run
+ *
+ * A zeroed struct is an unlocked mutex. The thread holding it may take it
+ * again, and must release it as many times.
+ *
+ * @owner: Thread holding the mutex, NULL if it is free
+ * @count: Number of times @owner has taken the mutex
+ *
+ * When !CONFIG_UTHREAD, this struct is empty.
+ */
+struct uthread_mutex {
+#if CONFIG_IS_ENABLED(UTHREAD)
+	struct uthread *owner;
+	unsigned int count;
+#endif
+};
+
+#if CONFIG_IS_ENABLED(UTHREAD)
+/**
+ * uthread_create() - create a thread
+ *
+ * The thread is added to the list of runnable threads and first runs at the
+ * next call to uthread_schedule(). Its stack is freed once @fn has returned.
+ *
+ * @uthr: Thread structure to use, or NULL to allocate one which is freed when
+ *	the thread finishes. A caller-supplied structure must stay valid until
+ *	the thread is done.
+ * @fn: Function to run
+ * @arg: Argument to pass to @fn
+ * @stack_sz: Stack size in bytes, or 0 for CONFIG_UTHREAD_STACK_SIZE
+ * @grp_id: Group to add the thread to, from uthread_grp_new_id(), or 0
+ * Return: 0 if OK, -ENOMEM if out of memory, other -ve on error
+ */
+int uthread_create(struct uthread *uthr, void (*fn)(void *), void *arg,
+		   size_t stack_sz, unsigned int grp_id);
+
+/**
+ * uthread_schedule() - switch to the next runnable thread
+ *
+ * Return: true if another thread ran, false if there is none
+ */
+bool uthread_schedule(void);
+
+/**
+ * uthread_grp_new_id() - allocate a new thread group ID
+ *
+ * Return: non-zero group ID
+ */
+unsigned int uthread_grp_new_id(void);
+
+/**
+ * uthread_grp_done() - check whether all threads in a group have finished
+ *
+ * @grp_id: Group ID to check
+ * Return: true if no thread in the group is still running
+ */
+bool uthread_grp_done(unsigned int grp_id);
+
+/**
+ * uthread_mutex_lock() - take a mutex, running other threads until it is free
+ *
+ * @mutex: Mutex to take
+ */
+void uthread_mutex_lock(struct uthread_mutex *mutex);
+
+/**
+ * uthread_mutex_unlock() - release a mutex taken by the current thread
+ *
+ * @mutex: Mutex to release
+ */
+void uthread_mutex_unlock(struct uthread_mutex *mutex);
+#else
+static inline int uthread_create(struct uthread *uthr, void (*fn)(void *),
+				 void *arg, size_t stack_sz,
+				 unsigned int grp_id)
+{
+	return -ENOSYS;
+}
+
+static inline bool uthread_schedule(void)
+{
+	return false;
+}
+
+static inline unsigned int uthread_grp_new_id(void)
+{
+	return 0;
+}
+
+static inline bool uthread_grp_done(unsigned int grp_id)
+{
+	return true;
+}
+
+static inline void uthread_mutex_lock(struct uthread_mutex *mutex)
+{
+}
+
+static inline void uthread_mutex_unlock(struct uthread_mutex *mutex)
+{
+}
+#endif
+
+#endif /* __UTHREAD_H */
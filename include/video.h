@@ -73,6 +73,23 @@ enum video_format {
 	VIDEO_X2R10G10B10,
 };
 
+/**
+ * struct video_bbox - A rectangle on the display
+ *
+ * The rectangle is empty if @x0 >= @x1
+ *
+ * @x0:	Left edge in pixels (inclusive)
+ * @y0:	Top edge in pixels (inclusive)
+ * @x1:	Right edge in pixels (exclusive)
+ * @y1:	Bottom edge in pixels (exclusive)
+ */
+struct video_bbox {
+	int x0;
+	int y0;
+	int x1;
+	int y1;
+};
+
 /**
  * struct video_priv - Device information used by the video uclass
  *
@@ -84,10 +101,17 @@ enum video_format {
  * @vidconsole_drv_name:	Driver to use for the text console, NULL to
  *		select automatically
  * @font_size:	Font size in pixels (0 to use a default value)
- * @fb:		Frame buffer
+ * @fb:		Frame buffer. This moves forward from the start of the
+ *		frame-buffer memory as the display is panned
  * @fb_size:	Frame buffer size
+ * @fb_offset:	Offset of @fb (and @copy_fb) from the start of the
+ *		frame-buffer memory, in bytes
+ * @fb_space:	Number of bytes of frame-buffer memory which the display can
+ *		pan within, or 0 if it cannot pan
  * @copy_fb:	Copy of the frame buffer to keep up to date; see struct
  *		video_uc_plat
+ * @damage:	Area of @fb which has changed since the last video_sync(),
+ *		used with CONFIG_VIDEO_DAMAGE
  * @line_length:	Length of each frame buffer line, in bytes. This can be
  *		set by the driver, but if not, the uclass will set it after
  *		probing
@@ -114,7 +138,10 @@ struct video_priv {
 	 */
 	void *fb;
 	int fb_size;
+	int fb_offset;
+	int fb_space;
 	void *copy_fb;
+	struct video_bbox damage;
 	int line_length;
 	u32 colour_fg;
 	u32 colour_bg;
@@ -130,9 +157,16 @@ struct video_priv {
  *		For these devices implement video_sync hook to call a sync
  *		function. vid is pointer to video device udevice. Function
  *		should return 0 on success video_sync and error code otherwise
+ * @set_offset: Optional. Start scanning out the display from line @line of
+ *		the frame-buffer memory, so that the console can scroll by
+ *		panning instead of moving the whole frame buffer. The memory
+ *		must be large enough to hold the display at any line up to
+ *		struct video_priv->fb_space. Returns 0 on success, or an error
+ *		code
  */
 struct video_ops {
 	int (*video_sync)(struct udevice *vid);
+	int (*set_offset)(struct udevice *vid, uint line);
 };
 
 #define video_get_ops(dev)        ((struct video_ops *)(dev)->driver->ops)
@@ -247,12 +281,65 @@ int video_fill(struct udevice *dev, u32 colour);
 int video_fill_part(struct udevice *dev, int xstart, int ystart, int xend,
 		    int yend, u32 colour);
 
+/**
+ * video_damage() - Note that part of the frame buffer has changed
+ *
+ * With CONFIG_VIDEO_DAMAGE this adds the rectangle to the area which is copied
+ * to the copy frame buffer and flushed from the cache by the next
+ * video_sync(). Without it, the rectangle is copied straight away. Parts of
+ * the rectangle outside the display are ignored.
+ *
+ * @vid:	Video device
+ * @x:		X position of the left edge, in pixels
+ * @y:		Y position of the top edge, in pixels
+ * @width:	Width in pixels
+ * @height:	Height in pixels
+ */
+void video_damage(struct udevice *vid, int x, int y, int width, int height);
+
+/**
+ * video_pan() - Scroll the display up by panning
+ *
+ * This moves the start of the frame buffer forward by @lines lines, using
+ * the driver's set_offset() method, so that the display scrolls up without
+ * copying it. The lines which appear at the bottom are cleared to the
+ * background colour. When the end of the frame-buffer memory is reached, the
+ * display is copied back to the start.
+ *
+ * @vid:	Video device
+ * @lines:	Number of pixel lines to scroll by
+ * Return: 0 if OK, -ENOSYS if the device cannot pan, other -ve on error
+ */
+int video_pan(struct udevice *vid, int lines);
+
+/**
+ * video_disable_pan() - Stop panning the display
+ *
+ * This moves the display back to the start of the frame-buffer memory and
+ * stops video_pan() from being used. It is needed when something else draws
+ * to the frame buffer at a fixed address.
+ *
+ * @vid:	Video device
+ */
+void video_disable_pan(struct udevice *vid);
+
+/**
+ * video_disable_pan_all() - Stop panning on all video devices
+ *
+ * This calls video_disable_pan() on all active video devices. It is used
+ * before handing the frame buffer over to the OS, which expects the display
+ * to start at the base address.
+ */
+void video_disable_pan_all(void);
+
 /**
  * video_sync() - Sync a device's frame buffer with its hardware
  *
  * @vid:	Device to sync
  * @force:	True to force a sync even if there was one recently (this is
- *		very expensive on sandbox)
+ *		very expensive on sandbox). With CONFIG_VIDEO_DAMAGE, this
+ *		also flushes the whole frame buffer from the data cache, not
+ *		just the damaged area
  *
  * @return: 0 on success, error code otherwise
  *
@@ -341,13 +428,16 @@ void video_set_default_colors(struct udevice *dev, bool invert);
  */
 int video_default_font_height(struct udevice *dev);
 
-#ifdef CONFIG_VIDEO_COPY
+#if defined(CONFIG_VIDEO_COPY) || defined(CONFIG_VIDEO_DAMAGE)
 /**
- * vidconsole_sync_copy() - Sync back to the copy framebuffer
+ * video_sync_copy() - Sync back to the copy framebuffer
  *
  * This ensures that the copy framebuffer has the same data as the framebuffer
  * for a particular region. It should be called after the framebuffer is updated
  *
+ * With CONFIG_VIDEO_DAMAGE the lines covering the region are marked as damaged
+ * instead, so the copy is done by the next video_sync(); see video_damage()
+ *
  * @from and @to can be in either order. The region between them is synced.
  *
  * @dev: Vidconsole device being updated
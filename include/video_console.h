@@ -529,7 +529,19 @@ void vidconsole_list_fonts(struct udevice *dev);
  */
 int vidconsole_get_font_size(struct udevice *dev, const char **name, uint *sizep);
 
-#ifdef CONFIG_VIDEO_COPY
+/**
+ * console_truetype_glyph_stats() - Get glyph-cache statistics
+ *
+ * These are for the font / size currently selected in a TrueType console
+ *
+ * @dev: TrueType console device
+ * @hitsp: Returns the number of characters drawn from the cache
+ * @missesp: Returns the number of characters which had to be rendered
+ * Return: number of characters in the cache
+ */
+int console_truetype_glyph_stats(struct udevice *dev, uint *hitsp,
+				 uint *missesp);
+
 /**
  * vidconsole_sync_copy() - Sync back to the copy framebuffer
  *
@@ -561,24 +573,5 @@ int vidconsole_sync_copy(struct udevice *dev, void *from, void *to);
  */
 int vidconsole_memmove(struct udevice *dev, void *dst, const void *src,
 		       int size);
-#else
-
-#include <string.h>
-
-static inline int vidconsole_sync_copy(struct udevice *dev, void *from,
-				       void *to)
-{
-	return 0;
-}
-
-static inline int vidconsole_memmove(struct udevice *dev, void *dst,
-				     const void *src, int size)
-{
-	memmove(dst, src, size);
-
-	return 0;
-}
-
-#endif
 
 #endif
@@ -29,6 +29,18 @@
 
 #define tole(x) cpu_to_le32(x)
 
+/*
+ * Slice-by-8 needs 7KiB of extra tables so it is optional on the target, and
+ * only done for little-endian CPUs
+ */
+#if defined(CONFIG_ARM64_CRC32) || __BYTE_ORDER != __LITTLE_ENDIAN
+#define CRC32_SLICE_BY_8	0
+#elif defined(USE_HOSTCC)
+#define CRC32_SLICE_BY_8	1
+#else
+#define CRC32_SLICE_BY_8	CONFIG_IS_ENABLED(CRC32_SLICE_BY_8)
+#endif
+
 #ifdef CONFIG_DYNAMIC_CRC_TABLE
 
 static int __efi_runtime_data crc_table_empty = 1;
@@ -168,6 +180,34 @@ const uint32_t * ZEXPORT get_crc_table()
 }
 #endif
 
+#if CRC32_SLICE_BY_8
+/*
+ * crc_table8[k][n] is the CRC of byte n followed by k + 1 zero bytes, so eight
+ * bytes can be folded into the CRC with independent lookups rather than a
+ * chain of eight dependent ones. The tables are derived from crc_table[] on
+ * first use.
+ */
+static int __efi_runtime_data crc_table8_empty = 1;
+static uint32_t __efi_runtime_data crc_table8[7][256];
+
+static void __efi_runtime make_crc_table8(void)
+{
+  uint32_t c;
+  int n, k;
+
+  for (n = 0; n < 256; n++)
+  {
+    c = crc_table[n];
+    for (k = 0; k < 7; k++)
+    {
+      c = crc_table[c & 255] ^ (c >> 8);
+      crc_table8[k][n] = c;
+    }
+  }
+  crc_table8_empty = 0;
+}
+#endif
+
 /* ========================================================================= */
 # if __BYTE_ORDER == __LITTLE_ENDIAN
 #  define DO_CRC(x) crc = tab[(crc ^ (x)) & 255] ^ (crc >> 8)
@@ -184,6 +224,11 @@ uint32_t __efi_runtime crc32_no_comp(uint32_t crc, const Bytef *buf, uInt len)
 {
 #ifdef CONFIG_ARM64_CRC32
     crc = cpu_to_le32(crc);
+    /* Align it, then use the 64-bit form of the instruction */
+    for (; len && ((ulong)buf & 7); len--)
+        crc = __builtin_aarch64_crc32b(crc, *buf++);
+    for (; len >= 8; len -= 8, buf += 8)
+        crc = __builtin_aarch64_crc32x(crc, *(const uint64_t *)buf);
     while (len--)
         crc = __builtin_aarch64_crc32b(crc, *buf++);
     return le32_to_cpu(crc);
@@ -205,6 +250,20 @@ uint32_t __efi_runtime crc32_no_comp(uint32_t crc, const Bytef *buf, uInt len)
 	 b = (uint32_t *)p;
     }
 
+#if CRC32_SLICE_BY_8
+    if (crc_table8_empty)
+      make_crc_table8();
+    for (; len >= 8; len -= 8) {
+	 uint32_t one = *b++ ^ crc;
+	 uint32_t two = *b++;
+
+	 crc = crc_table8[6][one & 255] ^ crc_table8[5][(one >> 8) & 255] ^
+	       crc_table8[4][(one >> 16) & 255] ^ crc_table8[3][one >> 24] ^
+	       crc_table8[2][two & 255] ^ crc_table8[1][(two >> 8) & 255] ^
+	       crc_table8[0][(two >> 16) & 255] ^ tab[two >> 24];
+    }
+#endif
+
     rem_len = len & 3;
     len = len >> 2;
     for (--b; len; --len) {
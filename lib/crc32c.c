@@ -11,6 +11,10 @@
  */
 
 #include <compiler.h>
+#include <u-boot/crc.h>
+
+/* Bit-reflected CRC32C (Castagnoli) polynomial */
+#define CRC32C_POLY	0x82F63B78
 
 uint32_t crc32c_cal(uint32_t crc, const char *data, int length,
 		    uint32_t *crc32c_table)
@@ -35,3 +39,88 @@ void crc32c_init(uint32_t *crc32c_table, uint32_t pol)
 		crc32c_table[i] = v;
 	}
 }
+
+#if defined(CONFIG_ARM64_CRC32)
+uint32_t crc32c(uint32_t crc, const void *buf, size_t len)
+{
+	const u8 *p = buf;
+
+	for (; len && ((ulong)p & 7); len--)
+		crc = __builtin_aarch64_crc32cb(crc, *p++);
+	for (; len >= 8; len -= 8, p += 8)
+		crc = __builtin_aarch64_crc32cx(crc, *(const u64 *)p);
+	while (len--)
+		crc = __builtin_aarch64_crc32cb(crc, *p++);
+
+	return crc;
+}
+#elif defined(CONFIG_X86_CRC32C)
+uint32_t crc32c(uint32_t crc, const void *buf, size_t len)
+{
+	const u8 *p = buf;
+	ulong c = crc;
+
+	for (; len && ((ulong)p & (sizeof(ulong) - 1)); len--)
+		asm ("crc32b %1, %k0" : "+r" (c) : "rm" (*p++));
+	for (; len >= sizeof(ulong); len -= sizeof(ulong), p += sizeof(ulong))
+#if CONFIG_IS_ENABLED(X86_64)
+		asm ("crc32q %1, %0" : "+r" (c) : "rm" (*(const ulong *)p));
+#else
+		asm ("crc32l %1, %0" : "+r" (c) : "rm" (*(const ulong *)p));
+#endif
+	while (len--)
+		asm ("crc32b %1, %k0" : "+r" (c) : "rm" (*p++));
+
+	return c;
+}
+#else
+/*
+ * Slice-by-8 tables: crc32c_table[k][n] is the CRC of byte n followed by k
+ * zero bytes, so that eight bytes can be folded in with independent lookups
+ */
+static uint32_t crc32c_table[8][256];
+static bool crc32c_table_ready;
+
+static void crc32c_make_table(void)
+{
+	uint32_t c;
+	int n, k;
+
+	crc32c_init(crc32c_table[0], CRC32C_POLY);
+	for (n = 0; n < 256; n++) {
+		c = crc32c_table[0][n];
+		for (k = 1; k < 8; k++) {
+			c = crc32c_table[0][c & 0xff] ^ (c >> 8);
+			crc32c_table[k][n] = c;
+		}
+	}
+	crc32c_table_ready = true;
+}
+
+uint32_t crc32c(uint32_t crc, const void *buf, size_t len)
+{
+	const uint32_t (*t)[256] = crc32c_table;
+	const u8 *p = buf;
+
+	if (!crc32c_table_ready)
+		crc32c_make_table();
+
+	for (; len && ((ulong)p & 3); len--)
+		crc = t[0][(crc ^ *p++) & 0xff] ^ (crc >> 8);
+
+	for (; len >= 8; len -= 8, p += 8) {
+		uint32_t one = le32_to_cpu(*(const uint32_t *)p) ^ crc;
+		uint32_t two = le32_to_cpu(*(const uint32_t *)(p + 4));
+
+		crc = t[7][one & 0xff] ^ t[6][(one >> 8) & 0xff] ^
+		      t[5][(one >> 16) & 0xff] ^ t[4][one >> 24] ^
+		      t[3][two & 0xff] ^ t[2][(two >> 8) & 0xff] ^
+		      t[1][(two >> 16) & 0xff] ^ t[0][two >> 24];
+	}
+
+	while (len--)
+		crc = t[0][(crc ^ *p++) & 0xff] ^ (crc >> 8);
+
+	return crc;
+}
+#endif
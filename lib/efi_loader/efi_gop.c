@@ -26,6 +26,7 @@ static const efi_guid_t efi_gop_guid = EFI_GRAPHICS_OUTPUT_PROTOCOL_GUID;
  * @mode:	graphical output mode
  * @bpix:	bits per pixel
  * @fb:		frame buffer
+ * @vdev:	video device
  */
 struct efi_gop_obj {
 	struct efi_object header;
@@ -35,6 +36,7 @@ struct efi_gop_obj {
 	/* Fields we only have access to during init */
 	u32 bpix;
 	void *fb;
+	struct udevice *vdev;
 };
 
 static efi_status_t EFIAPI gop_query_mode(struct efi_gop *this, u32 mode_number,
@@ -451,6 +453,16 @@ static efi_status_t EFIAPI gop_blt(struct efi_gop *this,
 	if (ret != EFI_SUCCESS)
 		return EFI_EXIT(ret);
 
+	/*
+	 * Make sure the area drawn is flushed. With CONFIG_VIDEO_COPY we draw
+	 * straight into the hardware frame buffer, so there is nothing to do
+	 */
+	if (operation != EFI_BLT_VIDEO_TO_BLT_BUFFER &&
+	    !IS_ENABLED(CONFIG_VIDEO_COPY)) {
+		struct efi_gop_obj *gopobj = container_of(this, struct efi_gop_obj, ops);
+
+		video_damage(gopobj->vdev, dx, dy, width, height);
+	}
 	video_sync_all();
 
 	return EFI_EXIT(EFI_SUCCESS);
@@ -549,6 +561,10 @@ efi_status_t efi_gop_register(void)
 	gopobj->info.pixels_per_scanline = col;
 	gopobj->bpix = bpix;
 	gopobj->fb = map_sysmem(fb_base, fb_size);
+	gopobj->vdev = vdev;
+
+	/* The frame buffer must stay at fb_base */
+	video_disable_pan(vdev);
 
 	return EFI_SUCCESS;
 }
@@ -16,7 +16,8 @@
 #include <asm/cache.h>
 #include <asm/global_data.h>
 #include <asm/sections.h>
-#include <linux/list_sort.h>
+#include <linux/log2.h>
+#include <linux/rbtree_augmented.h>
 #include <linux/sizes.h>
 
 DECLARE_GLOBAL_DATA_PTR;
@@ -24,20 +25,39 @@ DECLARE_GLOBAL_DATA_PTR;
 /* Magic number identifying memory allocated from pool */
 #define EFI_ALLOC_POOL_MAGIC 0x1fe67ddf6491caa2
 
+/* Magic number identifying a page divided into pool slots */
+#define EFI_POOL_PAGE_MAGIC 0x9c3fa4e1
+
+/* Smallest and largest slot for small pool allocations, as powers of two */
+#define EFI_POOL_SLOT_MIN_SHIFT	7
+#define EFI_POOL_SLOT_MAX_SHIFT	10
+#define EFI_POOL_SLOT_CLASSES	(EFI_POOL_SLOT_MAX_SHIFT - \
+				 EFI_POOL_SLOT_MIN_SHIFT + 1)
+
+/* Memory types which small pool allocations are grouped for */
+#define EFI_POOL_TYPES		3
+
 efi_uintn_t efi_memory_map_key;
 
-struct efi_mem_list {
-	struct list_head link;
+/**
+ * struct efi_mem_region - memory map item
+ *
+ * @rb:		node in the tree of memory map items, sorted by address
+ * @desc:	memory descriptor
+ * @free_pages:	largest number of free pages in a single item of the
+ *		subtree below and including this one
+ */
+struct efi_mem_region {
+	struct rb_node rb;
 	struct efi_mem_desc desc;
+	u64 free_pages;
 };
 
-#define EFI_CARVE_NO_OVERLAP		-1
-#define EFI_CARVE_LOOP_AGAIN		-2
-#define EFI_CARVE_OVERLAPS_NONRAM	-3
-#define EFI_CARVE_OUT_OF_RESOURCES	-4
+/* This tree contains all memory map items */
+static struct rb_root efi_mem = RB_ROOT;
 
-/* This list contains all memory map items */
-static LIST_HEAD(efi_mem);
+/* Number of items in the memory map */
+static int efi_mem_count;
 
 #ifdef CONFIG_EFI_LOADER_BOUNCE_BUFFER
 void *efi_bounce_buffer;
@@ -46,13 +66,15 @@ void *efi_bounce_buffer;
 /**
  * struct efi_pool_allocation - memory block allocated from pool
  *
- * @num_pages:	number of pages allocated
+ * @num_pages:	number of pages allocated, 0 for a slot in a pool page
  * @checksum:	checksum
  * @data:	allocated pool memory
  *
- * U-Boot services each UEFI AllocatePool() request as a separate
+ * U-Boot services each large UEFI AllocatePool() request as a separate
  * (multiple) page allocation. We have to track the number of pages
- * to be able to free the correct amount later.
+ * to be able to free the correct amount later. Small requests are
+ * served from slots in pages shared with other requests of the same
+ * memory type and size, see struct efi_pool_page.
  *
  * The checksum calculated in function checksum() is used in FreePool() to avoid
  * freeing memory not allocated by AllocatePool() and duplicate freeing.
@@ -66,6 +88,35 @@ struct efi_pool_allocation {
 	char data[] __aligned(ARCH_DMA_MINALIGN);
 };
 
+/**
+ * struct efi_pool_page - page divided into slots for small pool allocations
+ *
+ * The slots follow this header in the page. Each slot starts with a
+ * struct efi_pool_allocation and has the same power-of-two size. A free
+ * slot holds a pointer to the next free slot in its data.
+ *
+ * @link:	entry in the list of pages with free slots
+ * @magic:	EFI_POOL_PAGE_MAGIC
+ * @slot_shift:	log2 of the slot size
+ * @used:	number of slots allocated
+ * @free:	first free slot or NULL
+ * @head:	list of pages with free slots, which this page belongs to
+ */
+struct efi_pool_page {
+	struct list_head link;
+	u32 magic;
+	u16 slot_shift;
+	u16 used;
+	struct efi_pool_allocation *free;
+	struct list_head *head;
+};
+
+#define EFI_POOL_PAGE_HDR_SIZE	ALIGN(sizeof(struct efi_pool_page), \
+				      ARCH_DMA_MINALIGN)
+
+/* Pages with free slots, for each memory type and slot size */
+static struct list_head efi_pool_pages[EFI_POOL_TYPES][EFI_POOL_SLOT_CLASSES];
+
 /**
  * checksum() - calculate checksum for memory allocated from pool
  *
@@ -83,181 +134,206 @@ static u64 checksum(struct efi_pool_allocation *alloc)
 }
 
 /**
- * efi_mem_cmp() - comparator function for sorting memory map
+ * desc_get_end() - get end address of memory area
  *
- * Sorts the memory list from highest address to lowest address
+ * @desc:	memory descriptor
+ * Return:	end address + 1
+ */
+static uint64_t desc_get_end(struct efi_mem_desc *desc)
+{
+	return desc->physical_start + (desc->num_pages << EFI_PAGE_SHIFT);
+}
+
+/**
+ * efi_mem_free_pages() - get the number of free pages in a subtree
  *
- * When allocating memory we should always start from the highest
- * address chunk, so sort the memory list such that the first list
- * iterator gets the highest address and goes lower from there.
+ * This is the augmented value kept in each node of the memory map tree, so
+ * that efi_find_free_memory() can skip subtrees without enough free memory.
  *
- * @priv:	unused
- * @a:		first memory area
- * @b:		second memory area
- * Return:	1 if @a is before @b, -1 if @b is before @a, 0 if equal
+ * @mem:	memory map item at the root of the subtree
+ * Return:	largest number of free pages in a single item of the subtree
  */
-static int efi_mem_cmp(void *priv, struct list_head *a, struct list_head *b)
+static u64 efi_mem_free_pages(struct efi_mem_region *mem)
 {
-	struct efi_mem_list *mema = list_entry(a, struct efi_mem_list, link);
-	struct efi_mem_list *memb = list_entry(b, struct efi_mem_list, link);
+	u64 pages = 0;
+	int i;
 
-	if (mema->desc.physical_start == memb->desc.physical_start)
-		return 0;
-	else if (mema->desc.physical_start < memb->desc.physical_start)
-		return 1;
-	else
-		return -1;
+	if (mem->desc.type == EFI_CONVENTIONAL_MEMORY)
+		pages = mem->desc.num_pages;
+	for (i = 0; i < 2; i++) {
+		struct rb_node *child = i ? mem->rb.rb_right : mem->rb.rb_left;
+
+		if (child)
+			pages = max(pages, rb_entry(child, struct efi_mem_region,
+						    rb)->free_pages);
+	}
+
+	return pages;
 }
 
+RB_DECLARE_CALLBACKS(static, efi_mem_cb, struct efi_mem_region, rb, u64,
+		     free_pages, efi_mem_free_pages)
+
 /**
- * desc_get_end() - get end address of memory area
+ * efi_mem_next() - get the memory map item following another
  *
- * @desc:	memory descriptor
- * Return:	end address + 1
+ * @mem:	memory map item
+ * Return:	next item in ascending address order, or NULL
  */
-static uint64_t desc_get_end(struct efi_mem_desc *desc)
+static struct efi_mem_region *efi_mem_next(struct efi_mem_region *mem)
 {
-	return desc->physical_start + (desc->num_pages << EFI_PAGE_SHIFT);
+	struct rb_node *node = rb_next(&mem->rb);
+
+	return node ? rb_entry(node, struct efi_mem_region, rb) : NULL;
 }
 
 /**
- * efi_mem_sort() - sort memory map
+ * efi_mem_find() - find the memory map item at or below an address
  *
- * Sort the memory map and then try to merge adjacent memory areas.
+ * @addr:	address
+ * Return:	item with the highest start address not above @addr, or NULL.
+ *		The item does not necessarily contain @addr.
  */
-static void efi_mem_sort(void)
+static struct efi_mem_region *efi_mem_find(u64 addr)
 {
-	struct list_head *lhandle;
-	struct efi_mem_list *prevmem = NULL;
-	bool merge_again = true;
-
-	list_sort(NULL, &efi_mem, efi_mem_cmp);
-
-	/* Now merge entries that can be merged */
-	while (merge_again) {
-		merge_again = false;
-		list_for_each(lhandle, &efi_mem) {
-			struct efi_mem_list *lmem;
-			struct efi_mem_desc *prev = &prevmem->desc;
-			struct efi_mem_desc *cur;
-			uint64_t pages;
-
-			lmem = list_entry(lhandle, struct efi_mem_list, link);
-			if (!prevmem) {
-				prevmem = lmem;
-				continue;
-			}
-
-			cur = &lmem->desc;
-
-			if ((desc_get_end(cur) == prev->physical_start) &&
-			    (prev->type == cur->type) &&
-			    (prev->attribute == cur->attribute)) {
-				/* There is an existing map before, reuse it */
-				pages = cur->num_pages;
-				prev->num_pages += pages;
-				prev->physical_start -= pages << EFI_PAGE_SHIFT;
-				prev->virtual_start -= pages << EFI_PAGE_SHIFT;
-				list_del(&lmem->link);
-				free(lmem);
-
-				merge_again = true;
-				break;
-			}
-
-			prevmem = lmem;
+	struct rb_node *node = efi_mem.rb_node;
+	struct efi_mem_region *found = NULL;
+
+	while (node) {
+		struct efi_mem_region *mem;
+
+		mem = rb_entry(node, struct efi_mem_region, rb);
+		if (mem->desc.physical_start <= addr) {
+			found = mem;
+			node = node->rb_right;
+		} else {
+			node = node->rb_left;
 		}
 	}
+
+	return found;
+}
+
+/**
+ * efi_mem_insert() - add an item to the memory map tree
+ *
+ * @new:	memory map item, which must not overlap any other
+ */
+static void efi_mem_insert(struct efi_mem_region *new)
+{
+	struct rb_node **link = &efi_mem.rb_node, *parent = NULL;
+
+	while (*link) {
+		struct efi_mem_region *mem;
+
+		parent = *link;
+		mem = rb_entry(parent, struct efi_mem_region, rb);
+		if (new->desc.physical_start < mem->desc.physical_start)
+			link = &parent->rb_left;
+		else
+			link = &parent->rb_right;
+	}
+
+	rb_link_node(&new->rb, parent, link);
+	new->free_pages = efi_mem_free_pages(new);
+	efi_mem_cb_propagate(parent, NULL);
+	rb_insert_augmented(&new->rb, &efi_mem, &efi_mem_cb);
+	efi_mem_count++;
 }
 
 /**
- * efi_mem_carve_out() - unmap memory region
+ * efi_mem_remove() - remove an item from the memory map tree and free it
  *
- * @map:		memory map
- * @carve_desc:		memory region to unmap
- * @overlap_only_ram:	the carved out region may only overlap RAM
- * Return:		the number of overlapping pages which have been
- *			removed from the map,
- *			EFI_CARVE_NO_OVERLAP, if the regions don't overlap,
- *			EFI_CARVE_OVERLAPS_NONRAM, if the carve and map overlap,
- *			and the map contains anything but free ram
- *			(only when overlap_only_ram is true),
- *			EFI_CARVE_LOOP_AGAIN, if the mapping list should be
- *			traversed again, as it has been altered.
+ * @mem:	memory map item
+ */
+static void efi_mem_remove(struct efi_mem_region *mem)
+{
+	rb_erase_augmented(&mem->rb, &efi_mem, &efi_mem_cb);
+	efi_mem_count--;
+	free(mem);
+}
+
+/**
+ * efi_mem_resize() - move the start or end of a memory map item
  *
- * Unmaps all memory occupied by the carve_desc region from the list entry
- * pointed to by map.
+ * The item must not move past any other item.
  *
- * In case of EFI_CARVE_OVERLAPS_NONRAM it is the callers responsibility
- * to re-add the already carved out pages to the mapping.
+ * @mem:	memory map item
+ * @start:	new start address
+ * @end:	new end address
  */
-static s64 efi_mem_carve_out(struct efi_mem_list *map,
-			     struct efi_mem_desc *carve_desc,
-			     bool overlap_only_ram)
+static void efi_mem_resize(struct efi_mem_region *mem, u64 start, u64 end)
 {
-	struct efi_mem_list *newmap;
-	struct efi_mem_desc *map_desc = &map->desc;
-	uint64_t map_start = map_desc->physical_start;
-	uint64_t map_end = map_start + (map_desc->num_pages << EFI_PAGE_SHIFT);
-	uint64_t carve_start = carve_desc->physical_start;
-	uint64_t carve_end = carve_start +
-			     (carve_desc->num_pages << EFI_PAGE_SHIFT);
-
-	/* check whether we're overlapping */
-	if ((carve_end <= map_start) || (carve_start >= map_end))
-		return EFI_CARVE_NO_OVERLAP;
-
-	/* We're overlapping with non-RAM, warn the caller if desired */
-	if (overlap_only_ram && (map_desc->type != EFI_CONVENTIONAL_MEMORY))
-		return EFI_CARVE_OVERLAPS_NONRAM;
-
-	/* Sanitize carve_start and carve_end to lie within our bounds */
-	carve_start = max(carve_start, map_start);
-	carve_end = min(carve_end, map_end);
-
-	/* Carving at the beginning of our map? Just move it! */
-	if (carve_start == map_start) {
-		if (map_end == carve_end) {
-			/* Full overlap, just remove map */
-			list_del(&map->link);
-			free(map);
-		} else {
-			map->desc.physical_start = carve_end;
-			map->desc.virtual_start = carve_end;
-			map->desc.num_pages = (map_end - carve_end)
-					      >> EFI_PAGE_SHIFT;
-		}
+	mem->desc.physical_start = start;
+	mem->desc.virtual_start = start;
+	mem->desc.num_pages = (end - start) >> EFI_PAGE_SHIFT;
+	efi_mem_cb_propagate(&mem->rb, NULL);
+}
+
+/**
+ * efi_mem_merge() - merge a memory map item with its neighbours
+ *
+ * Adjacent items can be merged if they have the same type and attributes.
+ *
+ * @mem:	memory map item
+ */
+static void efi_mem_merge(struct efi_mem_region *mem)
+{
+	struct efi_mem_region *other;
+	struct rb_node *node;
+
+	node = rb_prev(&mem->rb);
+	other = node ? rb_entry(node, struct efi_mem_region, rb) : NULL;
+	if (other && desc_get_end(&other->desc) == mem->desc.physical_start &&
+	    other->desc.type == mem->desc.type &&
+	    other->desc.attribute == mem->desc.attribute) {
+		u64 end = desc_get_end(&mem->desc);
+
+		efi_mem_remove(mem);
+		mem = other;
+		efi_mem_resize(mem, mem->desc.physical_start, end);
+	}
+
+	other = efi_mem_next(mem);
+	if (other && desc_get_end(&mem->desc) == other->desc.physical_start &&
+	    other->desc.type == mem->desc.type &&
+	    other->desc.attribute == mem->desc.attribute) {
+		u64 end = desc_get_end(&other->desc);
 
-		return (carve_end - carve_start) >> EFI_PAGE_SHIFT;
+		efi_mem_remove(other);
+		efi_mem_resize(mem, mem->desc.physical_start, end);
 	}
+}
 
-	/*
-	 * Overlapping maps, just split the list map at carve_start,
-	 * it will get moved or removed in the next iteration.
-	 *
-	 * [ map_desc |__carve_start__| newmap ]
-	 */
+/**
+ * efi_mem_only_ram() - check that a memory area is all free RAM
+ *
+ * @start:	start address
+ * @end:	end address + 1
+ * Return:	true if items of type EFI_CONVENTIONAL_MEMORY cover the area
+ */
+static bool efi_mem_only_ram(u64 start, u64 end)
+{
+	struct efi_mem_region *mem = efi_mem_find(start);
+
+	while (start < end) {
+		if (!mem || mem->desc.physical_start > start ||
+		    desc_get_end(&mem->desc) <= start ||
+		    mem->desc.type != EFI_CONVENTIONAL_MEMORY)
+			return false;
+		start = desc_get_end(&mem->desc);
+		mem = efi_mem_next(mem);
+	}
 
-	/* Create a new map from [ carve_start ... map_end ] */
-	newmap = calloc(1, sizeof(*newmap));
-	if (!newmap)
-		return EFI_CARVE_OUT_OF_RESOURCES;
-	newmap->desc = map->desc;
-	newmap->desc.physical_start = carve_start;
-	newmap->desc.virtual_start = carve_start;
-	newmap->desc.num_pages = (map_end - carve_start) >> EFI_PAGE_SHIFT;
-	/* Insert before current entry (descending address order) */
-	list_add_tail(&newmap->link, &map->link);
-
-	/* Shrink the map to [ map_start ... carve_start ] */
-	map_desc->num_pages = (carve_start - map_start) >> EFI_PAGE_SHIFT;
-
-	return EFI_CARVE_LOOP_AGAIN;
+	return true;
 }
 
 /**
  * efi_add_memory_map_pg() - add pages to the memory map
  *
+ * Any part of the memory map overlapped by the pages is carved out, so that
+ * the pages replace it.
+ *
  * @start:		start address, must be a multiple of EFI_PAGE_SIZE
  * @pages:		number of pages to add
  * @memory_type:	type of memory added
@@ -268,10 +344,8 @@ static efi_status_t efi_add_memory_map_pg(u64 start, u64 pages,
 					  int memory_type,
 					  bool overlap_only_ram)
 {
-	struct list_head *lhandle;
-	struct efi_mem_list *newlist;
-	bool carve_again;
-	uint64_t carved_pages = 0;
+	struct efi_mem_region *newmem, *split = NULL, *mem, *next;
+	u64 end = start + (pages << EFI_PAGE_SHIFT);
 	struct efi_event *evt;
 
 	EFI_PRINT("%s: 0x%llx 0x%llx %d %s\n", __func__,
@@ -283,87 +357,73 @@ static efi_status_t efi_add_memory_map_pg(u64 start, u64 pages,
 	if (!pages)
 		return EFI_SUCCESS;
 
+	/*
+	 * The payload wanted to have RAM overlaps, but we overlapped
+	 * with an unallocated or non-RAM region. Error out.
+	 */
+	if (overlap_only_ram && !efi_mem_only_ram(start, end))
+		return EFI_NO_MAPPING;
+
 	++efi_memory_map_key;
-	newlist = calloc(1, sizeof(*newlist));
-	if (!newlist)
+	newmem = calloc(1, sizeof(*newmem));
+	if (!newmem)
 		return EFI_OUT_OF_RESOURCES;
-	newlist->desc.type = memory_type;
-	newlist->desc.physical_start = start;
-	newlist->desc.virtual_start = start;
-	newlist->desc.num_pages = pages;
+	newmem->desc.type = memory_type;
+	newmem->desc.physical_start = start;
+	newmem->desc.virtual_start = start;
+	newmem->desc.num_pages = pages;
 
 	switch (memory_type) {
 	case EFI_RUNTIME_SERVICES_CODE:
 	case EFI_RUNTIME_SERVICES_DATA:
-		newlist->desc.attribute = EFI_MEMORY_WB | EFI_MEMORY_RUNTIME;
+		newmem->desc.attribute = EFI_MEMORY_WB | EFI_MEMORY_RUNTIME;
 		break;
 	case EFI_MMAP_IO:
-		newlist->desc.attribute = EFI_MEMORY_RUNTIME;
+		newmem->desc.attribute = EFI_MEMORY_RUNTIME;
 		break;
 	default:
-		newlist->desc.attribute = EFI_MEMORY_WB;
+		newmem->desc.attribute = EFI_MEMORY_WB;
 		break;
 	}
 
-	/* Add our new map */
-	do {
-		carve_again = false;
-		list_for_each(lhandle, &efi_mem) {
-			struct efi_mem_list *lmem;
-			s64 r;
-
-			lmem = list_entry(lhandle, struct efi_mem_list, link);
-			r = efi_mem_carve_out(lmem, &newlist->desc,
-					      overlap_only_ram);
-			switch (r) {
-			case EFI_CARVE_OUT_OF_RESOURCES:
-				free(newlist);
-				return EFI_OUT_OF_RESOURCES;
-			case EFI_CARVE_OVERLAPS_NONRAM:
-				/*
-				 * The user requested to only have RAM overlaps,
-				 * but we hit a non-RAM region. Error out.
-				 */
-				free(newlist);
-				return EFI_NO_MAPPING;
-			case EFI_CARVE_NO_OVERLAP:
-				/* Just ignore this list entry */
-				break;
-			case EFI_CARVE_LOOP_AGAIN:
-				/*
-				 * We split an entry, but need to loop through
-				 * the list again to actually carve it.
-				 */
-				carve_again = true;
-				break;
-			default:
-				/* We carved a number of pages */
-				carved_pages += r;
-				carve_again = true;
-				break;
-			}
-
-			if (carve_again) {
-				/* The list changed, we need to start over */
-				break;
-			}
+	/* An item containing the new pages is split in two around them */
+	mem = efi_mem_find(start);
+	if (mem && mem->desc.physical_start < start &&
+	    desc_get_end(&mem->desc) > end) {
+		split = calloc(1, sizeof(*split));
+		if (!split) {
+			free(newmem);
+			return EFI_OUT_OF_RESOURCES;
 		}
-	} while (carve_again);
-
-	if (overlap_only_ram && (carved_pages != pages)) {
-		/*
-		 * The payload wanted to have RAM overlaps, but we overlapped
-		 * with an unallocated region. Error out.
-		 */
-		free(newlist);
-		return EFI_NO_MAPPING;
+		split->desc = mem->desc;
+		efi_mem_resize(split, end, desc_get_end(&mem->desc));
+		efi_mem_resize(mem, mem->desc.physical_start, start);
+		efi_mem_insert(split);
 	}
 
-	/* Add our new map */
-        list_add_tail(&newlist->link, &efi_mem);
+	/* Carve the new pages out of the items they overlap */
+	if (!mem)
+		mem = efi_mem.rb_node ? rb_entry(rb_first(&efi_mem),
+						 struct efi_mem_region, rb) :
+					NULL;
+	for (; mem && mem->desc.physical_start < end; mem = next) {
+		u64 mem_start = mem->desc.physical_start;
+		u64 mem_end = desc_get_end(&mem->desc);
+
+		next = efi_mem_next(mem);
+		if (mem_end <= start)
+			continue;
+		if (mem_start < start)
+			efi_mem_resize(mem, mem_start, start);
+		else if (mem_end > end)
+			efi_mem_resize(mem, end, mem_end);
+		else
+			efi_mem_remove(mem);
+	}
 
-	/* And make sure memory is listed in descending order */
-	efi_mem_sort();
+	/* Add our new map and merge it with its neighbours */
+	efi_mem_insert(newmem);
+	efi_mem_merge(newmem);
 
 	/* Notify that the memory map was changed */
 	list_for_each_entry(evt, &efi_events, link) {
@@ -417,24 +477,56 @@ efi_status_t efi_add_memory_map(u64 start, u64 size, int memory_type)
  */
 static efi_status_t efi_check_allocated(u64 addr, bool must_be_allocated)
 {
-	struct efi_mem_list *item;
-
-	list_for_each_entry(item, &efi_mem, link) {
-		u64 start = item->desc.physical_start;
-		u64 end = start + (item->desc.num_pages << EFI_PAGE_SHIFT);
-
-		if (addr >= start && addr < end) {
-			if (must_be_allocated ^
-			    (item->desc.type == EFI_CONVENTIONAL_MEMORY))
-				return EFI_SUCCESS;
-			else
-				return EFI_NOT_FOUND;
-		}
+	struct efi_mem_region *mem = efi_mem_find(addr);
+
+	if (mem && addr < desc_get_end(&mem->desc)) {
+		if (must_be_allocated ^
+		    (mem->desc.type == EFI_CONVENTIONAL_MEMORY))
+			return EFI_SUCCESS;
+		else
+			return EFI_NOT_FOUND;
 	}
 
 	return EFI_NOT_FOUND;
 }
 
+/**
+ * efi_mem_find_free() - find free memory pages in a subtree
+ *
+ * Subtrees are searched from the highest address down, skipping any without
+ * a large enough free item.
+ *
+ * @node:	root of the subtree
+ * @len:	size of memory area needed
+ * @max_addr:	highest address to allocate, page aligned
+ * Return:	highest suitable address in the subtree or 0
+ */
+static u64 efi_mem_find_free(struct rb_node *node, u64 len, u64 max_addr)
+{
+	struct efi_mem_region *mem;
+	u64 ret;
+
+	if (!node)
+		return 0;
+	mem = rb_entry(node, struct efi_mem_region, rb);
+	if (mem->free_pages < len >> EFI_PAGE_SHIFT)
+		return 0;
+
+	if (mem->desc.physical_start < max_addr) {
+		ret = efi_mem_find_free(node->rb_right, len, max_addr);
+		if (ret)
+			return ret;
+
+		/* Return the highest address in this map within bounds */
+		ret = min(max_addr, desc_get_end(&mem->desc));
+		if (mem->desc.type == EFI_CONVENTIONAL_MEMORY &&
+		    ret - mem->desc.physical_start >= len)
+			return ret - len;
+	}
+
+	return efi_mem_find_free(node->rb_left, len, max_addr);
+}
+
 /**
  * efi_find_free_memory() - find free memory pages
  *
@@ -444,44 +536,13 @@ static efi_status_t efi_check_allocated(u64 addr, bool must_be_allocated)
  */
 static uint64_t efi_find_free_memory(uint64_t len, uint64_t max_addr)
 {
-	struct list_head *lhandle;
-
 	/*
 	 * Prealign input max address, so we simplify our matching
 	 * logic below and can just reuse it as return pointer.
 	 */
 	max_addr &= ~EFI_PAGE_MASK;
 
-	list_for_each(lhandle, &efi_mem) {
-		struct efi_mem_list *lmem = list_entry(lhandle,
-			struct efi_mem_list, link);
-		struct efi_mem_desc *desc = &lmem->desc;
-		uint64_t desc_len = desc->num_pages << EFI_PAGE_SHIFT;
-		uint64_t desc_end = desc->physical_start + desc_len;
-		uint64_t curmax = min(max_addr, desc_end);
-		uint64_t ret = curmax - len;
-
-		/* We only take memory from free RAM */
-		if (desc->type != EFI_CONVENTIONAL_MEMORY)
-			continue;
-
-		/* Out of bounds for max_addr */
-		if ((ret + len) > max_addr)
-			continue;
-
-		/* Out of bounds for upper map limit */
-		if ((ret + len) > desc_end)
-			continue;
-
-		/* Out of bounds for lower map limit */
-		if (ret < desc->physical_start)
-			continue;
-
-		/* Return the highest address in this map within bounds */
-		return ret;
-	}
-
-	return 0;
+	return efi_mem_find_free(efi_mem.rb_node, len, max_addr);
 }
 
 /**
@@ -633,9 +694,134 @@ void *efi_alloc_aligned_pages(u64 len, int memory_type, size_t align)
 	return (void *)(uintptr_t)aligned_mem;
 }
 
+/**
+ * efi_pool_pages_head() - get the list of pool pages for small allocations
+ *
+ * @pool_type:	type of the pool from which memory is to be allocated
+ * @slot_shift:	log2 of the slot size
+ * Return:	list of pages with free slots, or NULL if allocations of
+ *		this type and size are not served from pool pages
+ */
+static struct list_head *efi_pool_pages_head(enum efi_memory_type pool_type,
+					     int slot_shift)
+{
+	int type;
+
+	if (slot_shift > EFI_POOL_SLOT_MAX_SHIFT)
+		return NULL;
+
+	switch (pool_type) {
+	case EFI_LOADER_DATA:
+		type = 0;
+		break;
+	case EFI_BOOT_SERVICES_DATA:
+		type = 1;
+		break;
+	case EFI_RUNTIME_SERVICES_DATA:
+		type = 2;
+		break;
+	default:
+		return NULL;
+	}
+
+	return &efi_pool_pages[type][slot_shift - EFI_POOL_SLOT_MIN_SHIFT];
+}
+
+/**
+ * efi_pool_alloc_slot() - allocate a slot in a pool page
+ *
+ * A new page is allocated if no page in the list has a free slot.
+ *
+ * @head:	list of pages with free slots, see efi_pool_pages_head()
+ * @pool_type:	type of the pool from which memory is to be allocated
+ * @slot_shift:	log2 of the slot size
+ * @allocp:	returns the allocated slot
+ * Return:	status code
+ */
+static efi_status_t efi_pool_alloc_slot(struct list_head *head,
+					enum efi_memory_type pool_type,
+					int slot_shift,
+					struct efi_pool_allocation **allocp)
+{
+	struct efi_pool_allocation *alloc;
+	struct efi_pool_page *page;
+	int i, slots;
+	efi_status_t r;
+	u64 addr;
+
+	slots = (EFI_PAGE_SIZE - EFI_POOL_PAGE_HDR_SIZE) >> slot_shift;
+	if (list_empty(head)) {
+		r = efi_allocate_pages(EFI_ALLOCATE_ANY_PAGES, pool_type, 1,
+				       &addr);
+		if (r != EFI_SUCCESS)
+			return r;
+		page = (struct efi_pool_page *)(uintptr_t)addr;
+		page->magic = EFI_POOL_PAGE_MAGIC;
+		page->slot_shift = slot_shift;
+		page->used = 0;
+		page->head = head;
+		page->free = NULL;
+		for (i = slots - 1; i >= 0; i--) {
+			alloc = (void *)page + EFI_POOL_PAGE_HDR_SIZE +
+				(i << slot_shift);
+			alloc->checksum = 0;
+			*(void **)alloc->data = page->free;
+			page->free = alloc;
+		}
+		list_add(&page->link, head);
+	}
+
+	page = list_first_entry(head, struct efi_pool_page, link);
+	alloc = page->free;
+	page->free = *(void **)alloc->data;
+	if (++page->used == slots)
+		list_del(&page->link);
+	*allocp = alloc;
+
+	return EFI_SUCCESS;
+}
+
+/**
+ * efi_pool_free_slot() - free a slot in a pool page
+ *
+ * The page is freed once none of its slots is in use.
+ *
+ * @alloc:	slot to free
+ * Return:	status code
+ */
+static efi_status_t efi_pool_free_slot(struct efi_pool_allocation *alloc)
+{
+	struct efi_pool_page *page;
+	ulong offset;
+	int slots;
+
+	page = (struct efi_pool_page *)((uintptr_t)alloc & ~EFI_PAGE_MASK);
+	offset = (uintptr_t)alloc - (uintptr_t)page;
+	if (page->magic != EFI_POOL_PAGE_MAGIC ||
+	    offset < EFI_POOL_PAGE_HDR_SIZE ||
+	    (offset - EFI_POOL_PAGE_HDR_SIZE) & ((1UL << page->slot_shift) - 1))
+		return EFI_INVALID_PARAMETER;
+
+	slots = (EFI_PAGE_SIZE - EFI_POOL_PAGE_HDR_SIZE) >> page->slot_shift;
+	if (page->used-- == slots)
+		list_add(&page->link, page->head);
+	if (!page->used) {
+		list_del(&page->link);
+		page->magic = 0;
+		return efi_free_pages((uintptr_t)page, 1);
+	}
+	*(void **)alloc->data = page->free;
+	page->free = alloc;
+
+	return EFI_SUCCESS;
+}
+
 /**
  * efi_allocate_pool - allocate memory from pool
  *
+ * Small allocations of the most common memory types share pages, see
+ * struct efi_pool_page. Anything else gets pages of its own.
+ *
  * @pool_type:	type of the pool from which memory is to be allocated
  * @size:	number of bytes to be allocated
  * @buffer:	allocated memory
@@ -646,8 +832,10 @@ efi_status_t efi_allocate_pool(enum efi_memory_type pool_type, efi_uintn_t size,
 	efi_status_t r;
 	u64 addr;
 	struct efi_pool_allocation *alloc;
+	struct list_head *head;
 	u64 num_pages = efi_size_in_pages(size +
 					  sizeof(struct efi_pool_allocation));
+	int slot_shift;
 
 	if (!buffer)
 		return EFI_INVALID_PARAMETER;
@@ -657,10 +845,21 @@ efi_status_t efi_allocate_pool(enum efi_memory_type pool_type, efi_uintn_t size,
 		return EFI_SUCCESS;
 	}
 
-	r = efi_allocate_pages(EFI_ALLOCATE_ANY_PAGES, pool_type, num_pages,
-			       &addr);
-	if (r == EFI_SUCCESS) {
+	slot_shift = EFI_POOL_SLOT_MAX_SHIFT + 1;
+	if (size < 1 << EFI_POOL_SLOT_MAX_SHIFT)
+		slot_shift = max(order_base_2(size +
+					      sizeof(struct efi_pool_allocation)),
+				 EFI_POOL_SLOT_MIN_SHIFT);
+	head = efi_pool_pages_head(pool_type, slot_shift);
+	if (head) {
+		r = efi_pool_alloc_slot(head, pool_type, slot_shift, &alloc);
+		num_pages = 0;
+	} else {
+		r = efi_allocate_pages(EFI_ALLOCATE_ANY_PAGES, pool_type,
+				       num_pages, &addr);
 		alloc = (struct efi_pool_allocation *)(uintptr_t)addr;
+	}
+	if (r == EFI_SUCCESS) {
 		alloc->num_pages = num_pages;
 		alloc->checksum = checksum(alloc);
 		*buffer = alloc->data;
@@ -712,7 +911,7 @@ efi_status_t efi_free_pool(void *buffer)
 	alloc = container_of(buffer, struct efi_pool_allocation, data);
 
 	/* Check that this memory was allocated by efi_allocate_pool() */
-	if (((uintptr_t)alloc & EFI_PAGE_MASK) ||
+	if ((alloc->num_pages && ((uintptr_t)alloc & EFI_PAGE_MASK)) ||
 	    alloc->checksum != checksum(alloc)) {
 		printf("%s: illegal free 0x%p\n", __func__, buffer);
 		return EFI_INVALID_PARAMETER;
@@ -720,7 +919,10 @@ efi_status_t efi_free_pool(void *buffer)
 	/* Avoid double free */
 	alloc->checksum = 0;
 
-	ret = efi_free_pages((uintptr_t)alloc, alloc->num_pages);
+	if (!alloc->num_pages)
+		ret = efi_pool_free_slot(alloc);
+	else
+		ret = efi_free_pages((uintptr_t)alloc, alloc->num_pages);
 
 	return ret;
 }
@@ -743,8 +945,8 @@ efi_status_t efi_get_memory_map(efi_uintn_t *memory_map_size,
 				uint32_t *descriptor_version)
 {
 	efi_uintn_t map_size = 0;
-	int map_entries = 0;
-	struct list_head *lhandle;
+	int map_entries = efi_mem_count;
+	struct rb_node *node;
 	efi_uintn_t provided_map_size;
 
 	if (!memory_map_size)
@@ -752,9 +954,6 @@ efi_status_t efi_get_memory_map(efi_uintn_t *memory_map_size,
 
 	provided_map_size = *memory_map_size;
 
-	list_for_each(lhandle, &efi_mem)
-		map_entries++;
-
 	map_size = map_entries * sizeof(struct efi_mem_desc);
 
 	*memory_map_size = map_size;
@@ -771,16 +970,10 @@ efi_status_t efi_get_memory_map(efi_uintn_t *memory_map_size,
 	if (!memory_map)
 		return EFI_INVALID_PARAMETER;
 
-	/* Copy list into array */
-	/* Return the list in ascending order */
-	memory_map = &memory_map[map_entries - 1];
-	list_for_each(lhandle, &efi_mem) {
-		struct efi_mem_list *lmem;
-
-		lmem = list_entry(lhandle, struct efi_mem_list, link);
-		*memory_map = lmem->desc;
-		memory_map--;
-	}
+	/* Copy tree into array, in ascending order */
+	for (node = rb_first(&efi_mem); node; node = rb_next(node))
+		*memory_map++ = rb_entry(node, struct efi_mem_region,
+					 rb)->desc;
 
 	if (map_key)
 		*map_key = efi_memory_map_key;
@@ -944,6 +1137,13 @@ static void add_u_boot_and_runtime(void)
 
 int efi_memory_init(void)
 {
+	int i, j;
+
+	for (i = 0; i < EFI_POOL_TYPES; i++) {
+		for (j = 0; j < EFI_POOL_SLOT_CLASSES; j++)
+			INIT_LIST_HEAD(&efi_pool_pages[i][j]);
+	}
+
 	efi_add_known_memory();
 
 	add_u_boot_and_runtime();
@@ -7,16 +7,86 @@
 
 #include <efi_loader.h>
 #include <efi_variable.h>
+#include <linux/log2.h>
 #include <u-boot/crc.h>
 
 /*
- * The variables efi_var_file and efi_var_entry must be static to avoid
+ * Deleted variables are left in place as holes: entries with no attributes
+ * and an empty name, whose length covers the whole of the space. Holes are
+ * filled by new variables once there is no room at the end of the buffer,
+ * and squeezed out by efi_var_mem_compact() once they take up more space
+ * than the variables, so deleting a variable does not move all the ones
+ * after it.
+ */
+#define EFI_VAR_HOLE_MIN	ALIGN(sizeof(struct efi_var_entry) + \
+				      sizeof(u16), 8)
+
+#define EFI_VAR_SLOT_FREE	0
+#define EFI_VAR_SLOT_DELETED	1
+
+/**
+ * struct efi_var_slot - slot in the variable index
+ *
+ * @hash:	hash of the GUID and name, see efi_var_hash()
+ * @offset:	offset of the variable from the start of efi_var_buf, or
+ *		EFI_VAR_SLOT_FREE or EFI_VAR_SLOT_DELETED
+ */
+struct efi_var_slot {
+	u32 hash;
+	u32 offset;
+};
+
+/**
+ * struct efi_var_index - hash table for finding variables by GUID and name
+ *
+ * This uses open addressing with linear probing. Offsets are stored rather
+ * than pointers so that nothing needs converting in SetVirtualAddressMap().
+ *
+ * @mask:	number of slots minus one (the number is a power of two)
+ * @used:	number of slots holding a variable
+ * @deleted:	number of slots marked EFI_VAR_SLOT_DELETED
+ * @hole_size:	number of bytes of efi_var_buf taken up by holes
+ * @slot:	slots
+ */
+struct efi_var_index {
+	u32 mask;
+	u32 used;
+	u32 deleted;
+	u32 hole_size;
+	struct efi_var_slot slot[];
+};
+
+/*
+ * The variables efi_var_buf and efi_var_index must be static to avoid
  * referencing them via the global offset table (section .got). The GOT
  * is neither mapped as EfiRuntimeServicesData nor do we support its
  * relocation during SetVirtualAddressMap().
  */
 static struct efi_var_file __efi_runtime_data *efi_var_buf;
-static struct efi_var_entry __efi_runtime_data *efi_current_var;
+static struct efi_var_index __efi_runtime_data *efi_var_index;
+
+/**
+ * efi_var_hash() - calculate the index hash of a variable
+ *
+ * This is the FNV-1a hash of the GUID and name.
+ *
+ * @guid:	GUID of the variable
+ * @name:	name of the variable
+ * Return:	hash value
+ */
+static u32 __efi_runtime efi_var_hash(const efi_guid_t *guid, const u16 *name)
+{
+	const u8 *p = (const u8 *)guid;
+	u32 hash = 2166136261U;
+	int i;
+
+	for (i = 0; i < sizeof(efi_guid_t); i++)
+		hash = (hash ^ p[i]) * 16777619;
+	for (; *name; name++)
+		hash = (hash ^ *name) * 16777619;
+
+	return hash;
+}
 
 /**
  * efi_var_mem_compare() - compare GUID and name with a variable
@@ -24,41 +94,27 @@ static struct efi_var_entry __efi_runtime_data *efi_current_var;
  * @var:	variable to compare
  * @guid:	GUID to compare
  * @name:	variable name to compare
- * @next:	pointer to next variable
  * Return:	true if match
  */
 static bool __efi_runtime
 efi_var_mem_compare(struct efi_var_entry *var, const efi_guid_t *guid,
-		    const u16 *name, struct efi_var_entry **next)
+		    const u16 *name)
 {
+	const u8 *guid1 = (u8 *)&var->guid, *guid2 = (u8 *)guid;
+	const u16 *data;
 	int i;
-	u8 *guid1, *guid2;
-	const u16 *data, *var_name;
-	bool match = true;
 
-	for (guid1 = (u8 *)&var->guid, guid2 = (u8 *)guid, i = 0;
-	     i < sizeof(efi_guid_t) && match; ++i)
-		match = (guid1[i] == guid2[i]);
+	for (i = 0; i < sizeof(efi_guid_t); ++i) {
+		if (guid1[i] != guid2[i])
+			return false;
+	}
 
-	for (data = var->name, var_name = name;; ++data) {
-		if (match)
-			match = (*data == *var_name);
+	for (data = var->name; *data == *name; ++data, ++name) {
 		if (!*data)
-			break;
-		if (*var_name)
-			++var_name;
+			return true;
 	}
 
-	++data;
-
-	if (next)
-		*next = (struct efi_var_entry *)
-			ALIGN((uintptr_t)data + var->length, 8);
-
-	if (match)
-		efi_current_var = var;
-
-	return match;
+	return false;
 }
 
 /**
@@ -78,77 +134,272 @@ u32 __efi_runtime efi_var_entry_len(struct efi_var_entry *var)
 		     var->length + sizeof(*var), 8);
 }
 
-struct efi_var_entry __efi_runtime
-*efi_var_mem_find(const efi_guid_t *guid, const u16 *name,
-		  struct efi_var_entry **next)
+static struct efi_var_entry __efi_runtime *efi_var_mem_end(void)
 {
-	struct efi_var_entry *var, *last;
+	return (void *)efi_var_buf + efi_var_buf->length;
+}
 
-	last = (struct efi_var_entry *)
-	       ((uintptr_t)efi_var_buf + efi_var_buf->length);
+static u32 __efi_runtime efi_var_mem_offset(struct efi_var_entry *var)
+{
+	return (uintptr_t)var - (uintptr_t)efi_var_buf;
+}
 
-	if (!*name) {
-		if (next) {
-			*next = efi_var_buf->var;
-			if (*next >= last)
-				*next = NULL;
+static bool __efi_runtime efi_var_is_hole(struct efi_var_entry *var)
+{
+	return !var->attr;
+}
+
+/**
+ * efi_var_make_hole() - turn part of the buffer into a hole
+ *
+ * @var:	start of the hole
+ * @len:	length of the hole, at least EFI_VAR_HOLE_MIN
+ */
+static void __efi_runtime efi_var_make_hole(struct efi_var_entry *var,
+					    u32 len)
+{
+	var->attr = 0;
+	var->length = len - sizeof(*var) - sizeof(u16);
+	var->name[0] = 0;
+}
+
+/**
+ * efi_var_mem_next() - get the next variable, skipping holes
+ *
+ * @var:	variable to start from, or NULL to get the first variable
+ * Return:	next variable, or NULL if there are no more
+ */
+static struct efi_var_entry __efi_runtime
+*efi_var_mem_next(struct efi_var_entry *var)
+{
+	struct efi_var_entry *last = efi_var_mem_end();
+
+	var = var ? (void *)var + efi_var_entry_len(var) : efi_var_buf->var;
+	while (var < last && efi_var_is_hole(var))
+		var = (void *)var + efi_var_entry_len(var);
+
+	return var < last ? var : NULL;
+}
+
+/**
+ * efi_var_index_find() - find the index slot of a variable
+ *
+ * @guid:	GUID of the variable
+ * @name:	name of the variable
+ * @hash:	hash of the GUID and name
+ * @freep:	if not NULL and the variable is not found, returns the slot a
+ *		new variable should use
+ * Return:	slot of the variable, or NULL if not found
+ */
+static struct efi_var_slot __efi_runtime
+*efi_var_index_find(const efi_guid_t *guid, const u16 *name, u32 hash,
+		    struct efi_var_slot **freep)
+{
+	struct efi_var_index *index = efi_var_index;
+	struct efi_var_slot *slot, *free = NULL;
+	u32 i;
+
+	/* there is always at least one free slot to stop the search */
+	for (i = hash & index->mask;; i = (i + 1) & index->mask) {
+		slot = &index->slot[i];
+		if (slot->offset == EFI_VAR_SLOT_FREE)
+			break;
+		if (slot->offset == EFI_VAR_SLOT_DELETED) {
+			if (!free)
+				free = slot;
+		} else if (slot->hash == hash &&
+			   efi_var_mem_compare((void *)efi_var_buf + slot->offset,
+					       guid, name)) {
+			return slot;
+		}
+	}
+	if (freep)
+		*freep = free ? free : slot;
+
+	return NULL;
+}
+
+/**
+ * efi_var_index_build() - build the index from the variables in the buffer
+ *
+ * This also clears out slots marked as deleted.
+ */
+static void __efi_runtime efi_var_index_build(void)
+{
+	struct efi_var_index *index = efi_var_index;
+	struct efi_var_entry *var, *last = efi_var_mem_end();
+	struct efi_var_slot *slot;
+	u32 i, len;
+
+	for (i = 0; i <= index->mask; i++)
+		index->slot[i].offset = EFI_VAR_SLOT_FREE;
+	index->used = 0;
+	index->deleted = 0;
+	index->hole_size = 0;
+
+	for (var = efi_var_buf->var; var < last; var = (void *)var + len) {
+		u32 hash;
+
+		len = efi_var_entry_len(var);
+		if (efi_var_is_hole(var)) {
+			index->hole_size += len;
+			continue;
+		}
+		hash = efi_var_hash(&var->guid, var->name);
+		if (!efi_var_index_find(&var->guid, var->name, hash, &slot)) {
+			slot->hash = hash;
+			slot->offset = efi_var_mem_offset(var);
+			index->used++;
 		}
-		return NULL;
 	}
-	if (efi_current_var &&
-	    efi_var_mem_compare(efi_current_var, guid, name, next)) {
-		if (next && *next >= last)
-			*next = NULL;
-		return efi_current_var;
+}
+
+/**
+ * efi_var_mem_compact() - squeeze the holes out of the buffer
+ *
+ * @ptrs:	pointers into variables in the buffer, which are updated as the
+ *		variables move
+ * @count:	number of pointers
+ */
+static void __efi_runtime efi_var_mem_compact(const void **ptrs, int count)
+{
+	struct efi_var_entry *var, *to, *last = efi_var_mem_end();
+	u32 len;
+	int i;
+
+	for (var = to = efi_var_buf->var; var < last; var = (void *)var + len) {
+		len = efi_var_entry_len(var);
+		if (efi_var_is_hole(var))
+			continue;
+		for (i = 0; i < count; i++) {
+			if (ptrs[i] >= (void *)var && ptrs[i] < (void *)var + len)
+				ptrs[i] -= (uintptr_t)var - (uintptr_t)to;
+		}
+		/* efi_memcpy_runtime() can be used because var >= to. */
+		if (to != var)
+			efi_memcpy_runtime(to, var, len);
+		to = (void *)to + len;
 	}
+	efi_var_buf->length = efi_var_mem_offset(to);
+	efi_var_index_build();
+}
 
-	var = efi_var_buf->var;
-	if (var < last) {
-		for (; var;) {
-			struct efi_var_entry *pos;
-			bool match;
-
-			match = efi_var_mem_compare(var, guid, name, &pos);
-			if (pos >= last)
-				pos = NULL;
-			if (match) {
-				if (next)
-					*next = pos;
-				return var;
-			}
-			var = pos;
+/**
+ * efi_var_mem_release() - give back the space used by a variable
+ *
+ * The space becomes a hole, merged with any holes after it, unless it is at
+ * the end of the buffer.
+ *
+ * @var:	variable, which must already be removed from the index
+ */
+static void __efi_runtime efi_var_mem_release(struct efi_var_entry *var)
+{
+	struct efi_var_entry *next, *last = efi_var_mem_end();
+	u32 len = efi_var_entry_len(var);
+
+	efi_var_index->hole_size += len;
+	for (next = (void *)var + len; next < last && efi_var_is_hole(next);
+	     next = (void *)var + len)
+		len += efi_var_entry_len(next);
+
+	if (next >= last) {
+		efi_var_buf->length = efi_var_mem_offset(var);
+		efi_var_index->hole_size -= len;
+		return;
+	}
+	efi_var_make_hole(var, len);
+
+	if (efi_var_index->hole_size > efi_var_buf->length / 2)
+		efi_var_mem_compact(NULL, 0);
+}
+
+/**
+ * efi_var_mem_alloc() - find space for a new variable
+ *
+ * The variable goes at the end of the buffer if there is room, else in the
+ * first hole it fits, else at the end once the holes are squeezed out.
+ *
+ * @len:	length of the variable entry
+ * @ptrs:	pointers into variables in the buffer, to be updated if the
+ *		variables move
+ * @count:	number of pointers
+ * Return:	space for the variable, or NULL if there is not enough
+ */
+static struct efi_var_entry __efi_runtime
+*efi_var_mem_alloc(u32 len, const void **ptrs, int count)
+{
+	struct efi_var_entry *var, *last = efi_var_mem_end();
+	u32 size;
+
+	if (efi_var_buf->length + len > EFI_VAR_BUF_SIZE &&
+	    efi_var_index->hole_size) {
+		for (var = efi_var_buf->var; var < last;
+		     var = (void *)var + size) {
+			size = efi_var_entry_len(var);
+			if (!efi_var_is_hole(var) ||
+			    (size != len && size < len + EFI_VAR_HOLE_MIN))
+				continue;
+			if (size != len)
+				efi_var_make_hole((void *)var + len, size - len);
+			efi_var_index->hole_size -= len;
+
+			return var;
 		}
+		if (efi_var_buf->length - efi_var_index->hole_size + len <=
+		    EFI_VAR_BUF_SIZE)
+			efi_var_mem_compact(ptrs, count);
 	}
+	if (efi_var_buf->length + len > EFI_VAR_BUF_SIZE)
+		return NULL;
+
+	var = efi_var_mem_end();
+	efi_var_buf->length += len;
+
+	return var;
+}
+
+struct efi_var_entry __efi_runtime
+*efi_var_mem_find(const efi_guid_t *guid, const u16 *name,
+		  struct efi_var_entry **next)
+{
+	struct efi_var_slot *slot;
+	struct efi_var_entry *var = NULL;
+
+	if (!*name) {
+		if (next)
+			*next = efi_var_mem_next(NULL);
+		return NULL;
+	}
+
+	slot = efi_var_index_find(guid, name, efi_var_hash(guid, name), NULL);
+	if (slot)
+		var = (void *)efi_var_buf + slot->offset;
 	if (next)
-		*next = NULL;
-	return NULL;
+		*next = var ? efi_var_mem_next(var) : NULL;
+
+	return var;
 }
 
 void __efi_runtime efi_var_mem_del(struct efi_var_entry *var)
 {
-	u16 *data;
-	struct efi_var_entry *next, *last;
+	struct efi_var_index *index = efi_var_index;
+	struct efi_var_slot *slot;
 
 	if (!var)
 		return;
 
-	last = (struct efi_var_entry *)
-	       ((uintptr_t)efi_var_buf + efi_var_buf->length);
-	if (var <= efi_current_var)
-		efi_current_var = NULL;
+	slot = efi_var_index_find(&var->guid, var->name,
+				  efi_var_hash(&var->guid, var->name), NULL);
+	if (slot && slot->offset == efi_var_mem_offset(var)) {
+		slot->offset = EFI_VAR_SLOT_DELETED;
+		index->used--;
+		index->deleted++;
+	}
+	efi_var_mem_release(var);
 
-	for (data = var->name; *data; ++data)
-		;
-	++data;
-	next = (struct efi_var_entry *)
-	       ALIGN((uintptr_t)data + var->length, 8);
-	efi_var_buf->length -= (uintptr_t)next - (uintptr_t)var;
-
-	/* efi_memcpy_runtime() can be used because next >= var. */
-	efi_memcpy_runtime(var, next, (uintptr_t)last - (uintptr_t)next);
-	efi_var_buf->crc32 = crc32(0, (u8 *)efi_var_buf->var,
-				   efi_var_buf->length -
-				   sizeof(struct efi_var_file));
+	/* too many deleted slots make searches slow */
+	if (index->deleted > (index->mask + 1) / 8)
+		efi_var_index_build();
 }
 
 efi_status_t __efi_runtime efi_var_mem_ins(
@@ -158,18 +409,23 @@ efi_status_t __efi_runtime efi_var_mem_ins(
 				const efi_uintn_t size2, const void *data2,
 				const u64 time)
 {
-	u16 *data;
+	struct efi_var_index *index = efi_var_index;
+	const void *ptrs[] = { data1, data2 };
+	struct efi_var_slot *slot, *free;
 	struct efi_var_entry *var;
-	u32 var_name_len;
+	u32 var_name_len, hash;
+	u16 *data;
 
-	var = (struct efi_var_entry *)
-	      ((uintptr_t)efi_var_buf + efi_var_buf->length);
 	var_name_len = u16_strlen(variable_name) + 1;
-	data = var->name + var_name_len;
-
-	if ((uintptr_t)data - (uintptr_t)efi_var_buf + size1 + size2 >
+	if (sizeof(*var) + sizeof(u16) * var_name_len + size1 + size2 >
 	    EFI_VAR_BUF_SIZE)
 		return EFI_OUT_OF_RESOURCES;
+	var = efi_var_mem_alloc(ALIGN(sizeof(*var) + sizeof(u16) * var_name_len +
+				      size1 + size2, 8),
+				ptrs, ARRAY_SIZE(ptrs));
+	if (!var)
+		return EFI_OUT_OF_RESOURCES;
+	data = var->name + var_name_len;
 
 	var->attr = attributes;
 	var->length = size1 + size2;
@@ -178,27 +434,36 @@ efi_status_t __efi_runtime efi_var_mem_ins(
 	efi_memcpy_runtime(&var->guid, vendor, sizeof(efi_guid_t));
 	efi_memcpy_runtime(var->name, variable_name,
 			   sizeof(u16) * var_name_len);
-	efi_memcpy_runtime(data, data1, size1);
-	efi_memcpy_runtime((u8 *)data + size1, data2, size2);
-
-	var = (struct efi_var_entry *)
-	      ALIGN((uintptr_t)data + var->length, 8);
-	efi_var_buf->length = (uintptr_t)var - (uintptr_t)efi_var_buf;
-	efi_var_buf->crc32 = crc32(0, (u8 *)efi_var_buf->var,
-				   efi_var_buf->length -
-				   sizeof(struct efi_var_file));
+	efi_memcpy_runtime(data, ptrs[0], size1);
+	efi_memcpy_runtime((u8 *)data + size1, ptrs[1], size2);
+
+	/* this replaces any existing variable of the same name */
+	hash = efi_var_hash(vendor, variable_name);
+	slot = efi_var_index_find(vendor, variable_name, hash, &free);
+	if (slot) {
+		struct efi_var_entry *old = (void *)efi_var_buf + slot->offset;
+
+		slot->offset = efi_var_mem_offset(var);
+		efi_var_mem_release(old);
+	} else {
+		if (free->offset == EFI_VAR_SLOT_DELETED)
+			index->deleted--;
+		free->hash = hash;
+		free->offset = efi_var_mem_offset(var);
+		index->used++;
+	}
 
 	return EFI_SUCCESS;
 }
 
 u64 __efi_runtime efi_var_mem_free(void)
 {
-	if (efi_var_buf->length + sizeof(struct efi_var_entry) >=
-	    EFI_VAR_BUF_SIZE)
+	u32 used = efi_var_buf->length - efi_var_index->hole_size;
+
+	if (used + sizeof(struct efi_var_entry) >= EFI_VAR_BUF_SIZE)
 		return 0;
 
-	return EFI_VAR_BUF_SIZE - efi_var_buf->length -
-	       sizeof(struct efi_var_entry);
+	return EFI_VAR_BUF_SIZE - used - sizeof(struct efi_var_entry);
 }
 
 /**
@@ -211,7 +476,7 @@ static void EFIAPI __efi_runtime
 efi_var_mem_notify_virtual_address_map(struct efi_event *event, void *context)
 {
 	efi_convert_pointer(0, (void **)&efi_var_buf);
-	efi_current_var = NULL;
+	efi_convert_pointer(0, (void **)&efi_var_index);
 }
 
 efi_status_t efi_var_mem_init(void)
@@ -219,6 +484,7 @@ efi_status_t efi_var_mem_init(void)
 	u64 memory;
 	efi_status_t ret;
 	struct efi_event *event;
+	u32 slots;
 
 	ret = efi_allocate_pages(EFI_ALLOCATE_ANY_PAGES,
 				 EFI_RUNTIME_SERVICES_DATA,
@@ -232,6 +498,23 @@ efi_status_t efi_var_mem_init(void)
 	efi_var_buf->length = (uintptr_t)efi_var_buf->var -
 			      (uintptr_t)efi_var_buf;
 
+	/*
+	 * Every variable takes at least EFI_VAR_HOLE_MIN bytes, so this keeps
+	 * the index no more than about 80% full
+	 */
+	slots = roundup_pow_of_two(EFI_VAR_BUF_SIZE / 32);
+	ret = efi_allocate_pages(EFI_ALLOCATE_ANY_PAGES,
+				 EFI_RUNTIME_SERVICES_DATA,
+				 efi_size_in_pages(sizeof(*efi_var_index) +
+						   slots *
+						   sizeof(struct efi_var_slot)),
+				 &memory);
+	if (ret != EFI_SUCCESS)
+		return ret;
+	efi_var_index = (struct efi_var_index *)(uintptr_t)memory;
+	efi_var_index->mask = slots - 1;
+	efi_var_index_build();
+
 	ret = efi_create_event(EVT_SIGNAL_VIRTUAL_ADDRESS_CHANGE, TPL_CALLBACK,
 			       efi_var_mem_notify_virtual_address_map, NULL,
 			       NULL, &event);
@@ -269,7 +552,7 @@ efi_var_collect_mem(struct efi_var_file *buf, efi_uintn_t *lenp, u32 mask)
 	while (var < last) {
 		u32 len = efi_var_entry_len(var);
 
-		if ((var->attr & mask) != mask) {
+		if (efi_var_is_hole(var) || (var->attr & mask) != mask) {
 			var = (void *)((uintptr_t)var + len);
 			continue;
 		}
@@ -396,4 +679,5 @@ skip:
 void efi_var_buf_update(struct efi_var_file *var_buf)
 {
 	memcpy(efi_var_buf, var_buf, EFI_VAR_BUF_SIZE);
+	efi_var_index_build();
 }
@@ -366,6 +366,7 @@ efi_status_t efi_set_variable_int(const u16 *variable_name,
 	if (delete) {
 		/* EFI_NOT_FOUND has been handled before */
 		attributes = var->attr;
+		efi_var_mem_del(var);
 		ret = EFI_SUCCESS;
 	} else if (append && var) {
 		/*
@@ -389,8 +390,6 @@ efi_status_t efi_set_variable_int(const u16 *variable_name,
 	if (ret != EFI_SUCCESS)
 		return ret;
 
-	efi_var_mem_del(var);
-
 	if (var_type == EFI_AUTH_VAR_PK)
 		ret = efi_init_secure_state();
 	else
@@ -545,6 +544,7 @@ efi_set_variable_runtime(u16 *variable_name, const efi_guid_t *vendor,
 	if (delete) {
 		/* EFI_NOT_FOUND has been handled before */
 		attributes = var->attr;
+		efi_var_mem_del(var);
 		ret = EFI_SUCCESS;
 	} else if (append && var) {
 		u16 *old_data = (void *)((uintptr_t)var->name +
@@ -560,8 +560,6 @@ efi_set_variable_runtime(u16 *variable_name, const efi_guid_t *vendor,
 
 	if (ret != EFI_SUCCESS)
 		return ret;
-	/* We are always inserting new variables, get rid of the old copy */
-	efi_var_mem_del(var);
 
 	return EFI_SUCCESS;
 }
@@ -0,0 +1,251 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * efi_selftest_memory_bench
+ *
+ * This unit test measures the following boottime services:
+ * AllocatePool, FreePool, AllocatePages, FreePages
+ *
+ * Buffers of mixed sizes are allocated, filled and freed in an order
+ * which fragments the memory map, as boot loaders do, for one second.
+ * The content of each buffer is checked before it is freed, and the
+ * memory map must have its original size at the end.
+ */
+
+#include <efi_selftest.h>
+
+/* Number of buffers allocated in each round */
+#define EFI_ST_BENCH_BUFFERS	512
+/* Largest pool allocation in bytes */
+#define EFI_ST_BENCH_POOL_MAX	2048
+/* Largest page allocation in pages */
+#define EFI_ST_BENCH_PAGES_MAX	4
+/* Time to run for, in 100 ns units */
+#define EFI_ST_BENCH_TIME	10000000
+
+/**
+ * struct efi_st_bench_buf - buffer allocated by the benchmark
+ *
+ * @buf:	start of the buffer
+ * @size:	size in bytes
+ * @pages:	number of pages, or 0 if allocated from pool
+ */
+struct efi_st_bench_buf {
+	u8 *buf;
+	efi_uintn_t size;
+	efi_uintn_t pages;
+};
+
+static struct efi_boot_services *boottime;
+static struct efi_st_bench_buf bufs[EFI_ST_BENCH_BUFFERS];
+static struct efi_event *event;
+static u32 seed;
+
+/**
+ * bench_rand() - get a pseudo-random number
+ *
+ * Return:	number between 0 and 0xffff
+ */
+static u32 bench_rand(void)
+{
+	seed = seed * 1103515245 + 12345;
+
+	return seed >> 16;
+}
+
+/**
+ * setup() - setup unit test
+ *
+ * @handle:	handle of the loaded image
+ * @systable:	system table
+ * Return:	EFI_ST_SUCCESS for success
+ */
+static int setup(const efi_handle_t handle,
+		 const struct efi_system_table *systable)
+{
+	efi_status_t ret;
+
+	boottime = systable->boottime;
+
+	ret = boottime->create_event(EVT_TIMER, TPL_CALLBACK, NULL, NULL,
+				     &event);
+	if (ret != EFI_SUCCESS) {
+		efi_st_error("could not create event\n");
+		return EFI_ST_FAILURE;
+	}
+
+	return EFI_ST_SUCCESS;
+}
+
+/**
+ * tear_down() - tear down unit test
+ *
+ * Return:	EFI_ST_SUCCESS for success
+ */
+static int tear_down(void)
+{
+	efi_status_t ret;
+
+	if (event) {
+		ret = boottime->close_event(event);
+		event = NULL;
+		if (ret != EFI_SUCCESS) {
+			efi_st_error("could not close event\n");
+			return EFI_ST_FAILURE;
+		}
+	}
+
+	return EFI_ST_SUCCESS;
+}
+
+/**
+ * get_map_size() - get the size of the memory map
+ *
+ * @map_size:	size of the memory map
+ * Return:	EFI_ST_SUCCESS for success
+ */
+static int get_map_size(efi_uintn_t *map_size)
+{
+	efi_uintn_t map_key, desc_size;
+	efi_status_t ret;
+	u32 desc_version;
+
+	*map_size = 0;
+	ret = boottime->get_memory_map(map_size, NULL, &map_key, &desc_size,
+				       &desc_version);
+	if (ret != EFI_BUFFER_TOO_SMALL) {
+		efi_st_error
+			("GetMemoryMap did not return EFI_BUFFER_TOO_SMALL\n");
+		return EFI_ST_FAILURE;
+	}
+
+	return EFI_ST_SUCCESS;
+}
+
+/**
+ * free_buf() - check the content of a buffer and free it
+ *
+ * @i:		index of the buffer
+ * Return:	EFI_ST_SUCCESS for success
+ */
+static int free_buf(int i)
+{
+	struct efi_st_bench_buf *b = &bufs[i];
+	efi_status_t ret;
+
+	if (b->buf[0] != (u8)i || b->buf[b->size - 1] != (u8)i) {
+		efi_st_error("buffer %d was overwritten\n", i);
+		return EFI_ST_FAILURE;
+	}
+	if (b->pages)
+		ret = boottime->free_pages((uintptr_t)b->buf, b->pages);
+	else
+		ret = boottime->free_pool(b->buf);
+	if (ret != EFI_SUCCESS) {
+		efi_st_error("could not free buffer %d\n", i);
+		return EFI_ST_FAILURE;
+	}
+
+	return EFI_ST_SUCCESS;
+}
+
+/**
+ * run_round() - allocate and free all buffers once
+ *
+ * One buffer in eight is allocated with AllocatePages, the rest with
+ * AllocatePool. Every other buffer is freed first, to leave holes.
+ *
+ * @pages:	incremented by the number of page allocations
+ * Return:	EFI_ST_SUCCESS for success
+ */
+static int run_round(unsigned int *pages)
+{
+	efi_status_t ret;
+	u64 addr;
+	int i;
+
+	for (i = 0; i < EFI_ST_BENCH_BUFFERS; i++) {
+		struct efi_st_bench_buf *b = &bufs[i];
+
+		if (!(i & 7)) {
+			b->pages = 1 + bench_rand() % EFI_ST_BENCH_PAGES_MAX;
+			b->size = b->pages * EFI_PAGE_SIZE;
+			ret = boottime->allocate_pages(EFI_ALLOCATE_ANY_PAGES,
+						       EFI_LOADER_DATA,
+						       b->pages, &addr);
+			b->buf = (u8 *)(uintptr_t)addr;
+			++*pages;
+		} else {
+			b->pages = 0;
+			b->size = 1 + bench_rand() % EFI_ST_BENCH_POOL_MAX;
+			ret = boottime->allocate_pool(EFI_LOADER_DATA, b->size,
+						      (void **)&b->buf);
+		}
+		if (ret != EFI_SUCCESS) {
+			efi_st_error("could not allocate buffer %d\n", i);
+			return EFI_ST_FAILURE;
+		}
+		boottime->set_mem(b->buf, b->size, i);
+	}
+
+	for (i = 1; i < EFI_ST_BENCH_BUFFERS; i += 2) {
+		if (free_buf(i) != EFI_ST_SUCCESS)
+			return EFI_ST_FAILURE;
+	}
+	for (i = EFI_ST_BENCH_BUFFERS - 2; i >= 0; i -= 2) {
+		if (free_buf(i) != EFI_ST_SUCCESS)
+			return EFI_ST_FAILURE;
+	}
+
+	return EFI_ST_SUCCESS;
+}
+
+/**
+ * execute() - execute unit test
+ *
+ * Return:	EFI_ST_SUCCESS for success
+ */
+static int execute(void)
+{
+	efi_uintn_t map_size, new_map_size;
+	unsigned int rounds = 0, pages = 0;
+	efi_status_t ret;
+
+	if (get_map_size(&map_size) != EFI_ST_SUCCESS)
+		return EFI_ST_FAILURE;
+
+	seed = 1;
+	ret = boottime->set_timer(event, EFI_TIMER_RELATIVE,
+				  EFI_ST_BENCH_TIME);
+	if (ret != EFI_SUCCESS) {
+		efi_st_error("could not set timer\n");
+		return EFI_ST_FAILURE;
+	}
+	do {
+		if (run_round(&pages) != EFI_ST_SUCCESS)
+			return EFI_ST_FAILURE;
+		++rounds;
+	} while (boottime->check_event(event) == EFI_NOT_READY);
+
+	efi_st_printf("%u AllocatePool and %u AllocatePages calls with frees in 1 s\n",
+		      rounds * EFI_ST_BENCH_BUFFERS - pages, pages);
+
+	if (get_map_size(&new_map_size) != EFI_ST_SUCCESS)
+		return EFI_ST_FAILURE;
+	if (new_map_size != map_size) {
+		efi_st_error("memory map has %u bytes, expected %u\n",
+			     (unsigned int)new_map_size,
+			     (unsigned int)map_size);
+		return EFI_ST_FAILURE;
+	}
+
+	return EFI_ST_SUCCESS;
+}
+
+EFI_UNIT_TEST(memory_bench) = {
+	.name = "memory benchmark",
+	.phase = EFI_EXECUTE_BEFORE_BOOTTIME_EXIT,
+	.setup = setup,
+	.execute = execute,
+	.teardown = tear_down,
+	.on_request = true,
+};
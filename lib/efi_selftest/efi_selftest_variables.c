@@ -12,6 +12,7 @@
 
 #define EFI_ST_MAX_DATA_SIZE 16
 #define EFI_ST_MAX_VARNAME_SIZE 80
+#define EFI_ST_MANY_VARS 200
 
 static struct efi_boot_services *boottime;
 static struct efi_runtime_services *runtime;
@@ -37,6 +38,155 @@ static int setup(const efi_handle_t img_handle,
 	return EFI_ST_SUCCESS;
 }
 
+/*
+ * Set the name of one of many variables, efi_st_many<i>
+ *
+ * @name:	buffer for the name
+ * @i:		number of the variable
+ */
+static void many_name(u16 *name, int i)
+{
+	const char *prefix = "efi_st_many";
+	int div;
+
+	while (*prefix)
+		*name++ = *prefix++;
+	for (div = 100; div; div /= 10)
+		*name++ = '0' + i / div % 10;
+	*name = 0;
+}
+
+/*
+ * Get the number of one of many variables from its name
+ *
+ * @name:	variable name
+ * Return:	number, or -1 if it is not one of the variables
+ */
+static int many_index(const u16 *name)
+{
+	u16 expect[EFI_ST_MAX_VARNAME_SIZE];
+	int i = 0, j;
+
+	for (j = 11; j < 14 && name[j] >= '0' && name[j] <= '9'; j++)
+		i = i * 10 + name[j] - '0';
+	if (i >= EFI_ST_MANY_VARS)
+		return -1;
+	many_name(expect, i);
+	for (j = 0; expect[j] == name[j]; j++) {
+		if (!name[j])
+			return i;
+	}
+
+	return -1;
+}
+
+/*
+ * Set each of many variables to its number, @count times over
+ *
+ * @i:		number of the first variable
+ * @step:	step between variables
+ * @count:	number of copies of the number to store, 0 to delete
+ * Return:	EFI_ST_SUCCESS for success
+ */
+static int many_set(int i, int step, int count)
+{
+	u16 varname[EFI_ST_MAX_VARNAME_SIZE];
+	u32 data[2];
+	efi_status_t ret;
+
+	for (; i < EFI_ST_MANY_VARS; i += step) {
+		many_name(varname, i);
+		data[0] = i;
+		data[1] = i;
+		ret = runtime->set_variable(varname, &guid_vendor0,
+					    count ?
+					    EFI_VARIABLE_BOOTSERVICE_ACCESS : 0,
+					    count * sizeof(u32), data);
+		if (ret != EFI_SUCCESS) {
+			efi_st_error("SetVariable failed for variable %d\n", i);
+			return EFI_ST_FAILURE;
+		}
+	}
+
+	return EFI_ST_SUCCESS;
+}
+
+/*
+ * Check that all of many variables can be read and are enumerated once
+ *
+ * @expect:	number of variables expected
+ * Return:	EFI_ST_SUCCESS for success
+ */
+static int many_check(int expect)
+{
+	u16 varname[EFI_ST_MAX_VARNAME_SIZE];
+	u8 seen[EFI_ST_MANY_VARS] = {};
+	efi_uintn_t len;
+	efi_status_t ret;
+	efi_guid_t guid;
+	u32 data[2];
+	int i, found = 0;
+
+	*varname = 0;
+	for (;;) {
+		len = sizeof(varname);
+		ret = runtime->get_next_variable_name(&len, varname, &guid);
+		if (ret == EFI_NOT_FOUND)
+			break;
+		if (ret != EFI_SUCCESS) {
+			efi_st_error("GetNextVariableName failed\n");
+			return EFI_ST_FAILURE;
+		}
+		i = many_index(varname);
+		if (i < 0 || memcmp(&guid, &guid_vendor0, sizeof(guid)))
+			continue;
+		if (seen[i]++) {
+			efi_st_error("Variable %d enumerated twice\n", i);
+			return EFI_ST_FAILURE;
+		}
+		len = sizeof(data);
+		ret = runtime->get_variable(varname, &guid_vendor0, NULL, &len,
+					    data);
+		if (ret != EFI_SUCCESS || !len || data[0] != i) {
+			efi_st_error("GetVariable failed for variable %d\n", i);
+			return EFI_ST_FAILURE;
+		}
+		found++;
+	}
+	if (found != expect) {
+		efi_st_error("Found %d variables, expected %d\n", found, expect);
+		return EFI_ST_FAILURE;
+	}
+
+	return EFI_ST_SUCCESS;
+}
+
+/*
+ * Check lookups in a store with many variables, as they are deleted and
+ * rewritten in different sizes
+ */
+static int execute_many(void)
+{
+	if (many_set(0, 1, 1) != EFI_ST_SUCCESS ||
+	    many_check(EFI_ST_MANY_VARS) != EFI_ST_SUCCESS)
+		return EFI_ST_FAILURE;
+
+	/* leave holes and fill them with smaller and larger variables */
+	if (many_set(0, 2, 0) != EFI_ST_SUCCESS ||
+	    many_check(EFI_ST_MANY_VARS / 2) != EFI_ST_SUCCESS ||
+	    many_set(1, 2, 2) != EFI_ST_SUCCESS ||
+	    many_set(0, 4, 1) != EFI_ST_SUCCESS ||
+	    many_set(2, 4, 2) != EFI_ST_SUCCESS ||
+	    many_check(EFI_ST_MANY_VARS) != EFI_ST_SUCCESS)
+		return EFI_ST_FAILURE;
+
+	if (many_set(0, 1, 0) != EFI_ST_SUCCESS ||
+	    many_check(0) != EFI_ST_SUCCESS)
+		return EFI_ST_FAILURE;
+
+	return EFI_ST_SUCCESS;
+}
+
 /*
  * Execute unit test.
  */
@@ -277,7 +427,7 @@ static int execute(void)
 		return EFI_ST_FAILURE;
 	}
 
-	return EFI_ST_SUCCESS;
+	return execute_many();
 }
 
 EFI_UNIT_TEST(variables) = {
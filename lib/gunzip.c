@@ -56,11 +56,12 @@ int gzip_parse_header(const unsigned char *src, unsigned long len)
 	}
 	if ((flags & EXTRA_FIELD) != 0)
 		i = 12 + src[10] + (src[11] << 8);
+	/* the header may be longer than the data passed in */
 	if ((flags & ORIG_NAME) != 0)
-		while (src[i++] != 0)
+		while (i < len && src[i++] != 0)
 			;
 	if ((flags & COMMENT) != 0)
-		while (src[i++] != 0)
+		while (i < len && src[i++] != 0)
 			;
 	if ((flags & HEAD_CRC) != 0)
 		i += 2;
@@ -95,14 +95,68 @@ static long lmb_regions_adjacent(struct lmb_region *rgn, unsigned long r1,
 
 static void lmb_remove_region(struct lmb_region *rgn, unsigned long r)
 {
-	unsigned long i;
+	memmove(&rgn->region[r], &rgn->region[r + 1],
+		(rgn->cnt - r - 1) * sizeof(*rgn->region));
+	rgn->cnt--;
+}
 
-	for (i = r; i < rgn->cnt - 1; i++) {
-		rgn->region[i].base = rgn->region[i + 1].base;
-		rgn->region[i].size = rgn->region[i + 1].size;
-		rgn->region[i].flags = rgn->region[i + 1].flags;
+/**
+ * lmb_find_region() - find the first region which ends at or above an address
+ *
+ * The regions are sorted and do not overlap, so their ends are sorted too and
+ * a binary search finds the only region which may contain @addr.
+ *
+ * @rgn:	set of regions
+ * @addr:	address
+ * Return:	index of the first region whose last byte is at or above @addr,
+ *		or rgn->cnt if there is none
+ */
+static unsigned long lmb_find_region(struct lmb_region *rgn, phys_addr_t addr)
+{
+	unsigned long lo = 0, hi = rgn->cnt;
+
+	while (lo < hi) {
+		unsigned long mid = lo + (hi - lo) / 2;
+		struct lmb_property *r = &rgn->region[mid];
+
+		if (r->base + r->size - 1 < addr)
+			lo = mid + 1;
+		else
+			hi = mid;
 	}
-	rgn->cnt--;
+
+	return lo;
+}
+
+/**
+ * lmb_grow_region() - make room for more regions
+ *
+ * With CONFIG_LMB_GROW and malloc() fully available, the region array is
+ * replaced by one twice the size on the heap.
+ *
+ * @rgn:	set of regions, which is full
+ * Return:	0 if OK, -ENOSPC if the array cannot grow, -ENOMEM if out of
+ *		memory
+ */
+static int lmb_grow_region(struct lmb_region *rgn)
+{
+	struct lmb_property *region;
+
+	if (!IS_ENABLED(CONFIG_LMB_GROW) ||
+	    !(gd->flags & GD_FLG_FULL_MALLOC_INIT))
+		return -ENOSPC;
+
+	region = malloc(2 * rgn->max * sizeof(*region));
+	if (!region)
+		return -ENOMEM;
+	memcpy(region, rgn->region, rgn->cnt * sizeof(*region));
+	if (rgn->heap)
+		free(rgn->region);
+	rgn->region = region;
+	rgn->max *= 2;
+	rgn->heap = true;
+
+	return 0;
 }
 
 /* Assumption: base addr of region 1 < base addr of region 2 */
@@ -132,17 +186,24 @@ static void lmb_fix_over_lap_regions(struct lmb_region *rgn, unsigned long r1,
 
 void lmb_init(struct lmb *lmb)
 {
-#if IS_ENABLED(CONFIG_LMB_USE_MAX_REGIONS)
-	lmb->memory.max = CONFIG_LMB_MAX_REGIONS;
-	lmb->reserved.max = CONFIG_LMB_MAX_REGIONS;
-#else
-	lmb->memory.max = CONFIG_LMB_MEMORY_REGIONS;
-	lmb->reserved.max = CONFIG_LMB_RESERVED_REGIONS;
+	lmb->memory.max = LMB_MEMORY_REGIONS;
+	lmb->reserved.max = LMB_RESERVED_REGIONS;
 	lmb->memory.region = lmb->memory_regions;
 	lmb->reserved.region = lmb->reserved_regions;
-#endif
+	lmb->memory.heap = false;
+	lmb->reserved.heap = false;
 	lmb->memory.cnt = 0;
 	lmb->reserved.cnt = 0;
+	lmb->best_fit = IS_ENABLED(CONFIG_LMB_BEST_FIT);
+}
+
+void lmb_uninit(struct lmb *lmb)
+{
+	if (lmb->memory.heap)
+		free(lmb->memory.region);
+	if (lmb->reserved.heap)
+		free(lmb->reserved.region);
+	lmb_init(lmb);
 }
 
 void arch_lmb_reserve_generic(struct lmb *lmb, ulong sp, ulong end, ulong align)
@@ -267,8 +328,18 @@ static long lmb_add_region_flags(struct lmb_region *rgn, phys_addr_t base,
 		return 0;
 	}
 
-	/* First try and coalesce this LMB with another. */
-	for (i = 0; i < rgn->cnt; i++) {
+	/*
+	 * First try and coalesce this LMB with another. Only the first region
+	 * which overlaps it or is adjacent to it needs to be checked.
+	 */
+	i = base ? lmb_find_region(rgn, base - 1) : 0;
+	if (i < rgn->cnt &&
+	    !lmb_addrs_overlap(base, size, rgn->region[i].base,
+			       rgn->region[i].size) &&
+	    !lmb_addrs_adjacent(base, size, rgn->region[i].base,
+				rgn->region[i].size))
+		i = rgn->cnt;
+	if (i < rgn->cnt) {
 		phys_addr_t rgnbase = rgn->region[i].base;
 		phys_size_t rgnsize = rgn->region[i].size;
 		phys_size_t rgnflags = rgn->region[i].flags;
@@ -284,18 +355,16 @@ static long lmb_add_region_flags(struct lmb_region *rgn, phys_addr_t base,
 
 		adjacent = lmb_addrs_adjacent(base, size, rgnbase, rgnsize);
 		if (adjacent > 0) {
-			if (flags != rgnflags)
-				break;
-			rgn->region[i].base -= size;
-			rgn->region[i].size += size;
-			coalesced++;
-			break;
+			if (flags == rgnflags) {
+				rgn->region[i].base -= size;
+				rgn->region[i].size += size;
+				coalesced++;
+			}
 		} else if (adjacent < 0) {
-			if (flags != rgnflags)
-				break;
-			rgn->region[i].size += size;
-			coalesced++;
-			break;
+			if (flags == rgnflags) {
+				rgn->region[i].size += size;
+				coalesced++;
+			}
 		} else if (lmb_addrs_overlap(base, size, rgnbase, rgnsize)) {
 			/* regions overlap */
 			return -1;
@@ -315,28 +384,18 @@ static long lmb_add_region_flags(struct lmb_region *rgn, phys_addr_t base,
 
 	if (coalesced)
 		return coalesced;
-	if (rgn->cnt >= rgn->max)
+	if (rgn->cnt >= rgn->max && lmb_grow_region(rgn))
 		return -1;
 
 	/* Couldn't coalesce the LMB, so add it to the sorted table. */
-	for (i = rgn->cnt-1; i >= 0; i--) {
-		if (base < rgn->region[i].base) {
-			rgn->region[i + 1].base = rgn->region[i].base;
-			rgn->region[i + 1].size = rgn->region[i].size;
-			rgn->region[i + 1].flags = rgn->region[i].flags;
-		} else {
-			rgn->region[i + 1].base = base;
-			rgn->region[i + 1].size = size;
-			rgn->region[i + 1].flags = flags;
-			break;
-		}
-	}
-
-	if (base < rgn->region[0].base) {
-		rgn->region[0].base = base;
-		rgn->region[0].size = size;
-		rgn->region[0].flags = flags;
-	}
+	i = lmb_find_region(rgn, base);
+	if (i < rgn->cnt && rgn->region[i].base <= base)
+		i++;
+	memmove(&rgn->region[i + 1], &rgn->region[i],
+		(rgn->cnt - i) * sizeof(*rgn->region));
+	rgn->region[i].base = base;
+	rgn->region[i].size = size;
+	rgn->region[i].flags = flags;
 
 	rgn->cnt++;
 
@@ -364,19 +423,15 @@ long lmb_free(struct lmb *lmb, phys_addr_t base, phys_size_t size)
 	phys_addr_t end = base + size - 1;
 	int i;
 
-	rgnbegin = rgnend = 0; /* supress gcc warnings */
-
 	/* Find the region where (base, size) belongs to */
-	for (i = 0; i < rgn->cnt; i++) {
-		rgnbegin = rgn->region[i].base;
-		rgnend = rgnbegin + rgn->region[i].size - 1;
-
-		if ((rgnbegin <= base) && (end <= rgnend))
-			break;
-	}
+	i = lmb_find_region(rgn, base);
+	if (i == rgn->cnt)
+		return -1;
+	rgnbegin = rgn->region[i].base;
+	rgnend = rgnbegin + rgn->region[i].size - 1;
 
 	/* Didn't find the region */
-	if (i == rgn->cnt)
+	if (rgnbegin > base || end > rgnend)
 		return -1;
 
 	/* Check to see if we are removing entire region */
@@ -423,16 +478,13 @@ long lmb_reserve(struct lmb *lmb, phys_addr_t base, phys_size_t size)
 static long lmb_overlaps_region(struct lmb_region *rgn, phys_addr_t base,
 				phys_size_t size)
 {
-	unsigned long i;
+	unsigned long i = lmb_find_region(rgn, base);
 
-	for (i = 0; i < rgn->cnt; i++) {
-		phys_addr_t rgnbase = rgn->region[i].base;
-		phys_size_t rgnsize = rgn->region[i].size;
-		if (lmb_addrs_overlap(base, size, rgnbase, rgnsize))
-			break;
-	}
+	if (i < rgn->cnt && lmb_addrs_overlap(base, size, rgn->region[i].base,
+					      rgn->region[i].size))
+		return i;
 
-	return (i < rgn->cnt) ? i : -1;
+	return -1;
 }
 
 phys_addr_t lmb_alloc(struct lmb *lmb, phys_size_t size, ulong align)
@@ -458,12 +510,79 @@ static phys_addr_t lmb_align_down(phys_addr_t addr, phys_size_t size)
 	return addr & ~(size - 1);
 }
 
+/**
+ * lmb_alloc_best_fit() - allocate from the smallest free area that fits
+ *
+ * Each free area below @max_addr is checked. Of those large enough, the
+ * smallest is used, taking the highest address of any the same size. The
+ * allocation is at the top of the area.
+ *
+ * @lmb:	the logical memory block struct
+ * @size:	size of the allocation
+ * @align:	alignment, a power of two
+ * @max_addr:	address above which nothing is allocated, or LMB_ALLOC_ANYWHERE
+ * Return:	base address of the allocation, or 0 on failure
+ */
+static phys_addr_t lmb_alloc_best_fit(struct lmb *lmb, phys_size_t size,
+				      ulong align, phys_addr_t max_addr)
+{
+	struct lmb_region *res = &lmb->reserved;
+	phys_size_t best_size = 0;
+	phys_addr_t best = 0;
+	unsigned long i, j;
+
+	for (i = 0; i < lmb->memory.cnt; i++) {
+		phys_addr_t start = lmb->memory.region[i].base;
+		phys_addr_t end = start + lmb->memory.region[i].size - 1;
+
+		if (max_addr != LMB_ALLOC_ANYWHERE) {
+			if (start >= max_addr)
+				break;
+			end = min(end, max_addr - 1);
+		}
+
+		/* Walk the free areas between the reserved regions */
+		for (j = lmb_find_region(res, start); ; j++) {
+			phys_addr_t gap_end = end, addr;
+			bool last = j >= res->cnt || res->region[j].base > end;
+
+			if (!last)
+				gap_end = res->region[j].base - 1;
+			if ((last || res->region[j].base > start) &&
+			    gap_end - start + 1 >= size) {
+				addr = lmb_align_down(gap_end - size + 1, align);
+				if (addr && addr >= start &&
+				    (!best || gap_end - start < best_size ||
+				     (gap_end - start == best_size &&
+				      addr > best))) {
+					best = addr;
+					best_size = gap_end - start;
+				}
+			}
+			if (last)
+				break;
+			gap_end = res->region[j].base + res->region[j].size - 1;
+			if (gap_end >= end)
+				break;
+			start = gap_end + 1;
+		}
+	}
+
+	if (best && lmb_add_region(res, best, size) >= 0)
+		return best;
+
+	return 0;
+}
+
 phys_addr_t __lmb_alloc_base(struct lmb *lmb, phys_size_t size, ulong align, phys_addr_t max_addr)
 {
 	long i, rgn;
 	phys_addr_t base = 0;
 	phys_addr_t res_base;
 
+	if (lmb->best_fit)
+		return lmb_alloc_best_fit(lmb, size, align, max_addr);
+
 	for (i = lmb->memory.cnt - 1; i >= 0; i--) {
 		phys_addr_t lmbbase = lmb->memory.region[i].base;
 		phys_size_t lmbsize = lmb->memory.region[i].size;
@@ -528,22 +647,20 @@ phys_addr_t lmb_alloc_addr(struct lmb *lmb, phys_addr_t base, phys_size_t size)
 /* Return number of bytes from a given address that are free */
 phys_size_t lmb_get_free_size(struct lmb *lmb, phys_addr_t addr)
 {
-	int i;
+	unsigned long i;
 	long rgn;
 
 	/* check if the requested address is in the memory regions */
 	rgn = lmb_overlaps_region(&lmb->memory, addr, 1);
 	if (rgn >= 0) {
-		for (i = 0; i < lmb->reserved.cnt; i++) {
+		i = lmb_find_region(&lmb->reserved, addr);
+		if (i < lmb->reserved.cnt) {
 			if (addr < lmb->reserved.region[i].base) {
 				/* first reserved range > requested address */
 				return lmb->reserved.region[i].base - addr;
 			}
-			if (lmb->reserved.region[i].base +
-			    lmb->reserved.region[i].size > addr) {
-				/* requested addr is in this reserved range */
-				return 0;
-			}
+			/* requested addr is in this reserved range */
+			return 0;
 		}
 		/* if we come here: no reserved ranges above requested addr */
 		return lmb->memory.region[lmb->memory.cnt - 1].base +
@@ -554,14 +671,11 @@ phys_size_t lmb_get_free_size(struct lmb *lmb, phys_addr_t addr)
 
 int lmb_is_reserved_flags(struct lmb *lmb, phys_addr_t addr, int flags)
 {
-	int i;
+	unsigned long i = lmb_find_region(&lmb->reserved, addr);
+
+	if (i < lmb->reserved.cnt && addr >= lmb->reserved.region[i].base)
+		return (lmb->reserved.region[i].flags & flags) == flags;
 
-	for (i = 0; i < lmb->reserved.cnt; i++) {
-		phys_addr_t upper = lmb->reserved.region[i].base +
-			lmb->reserved.region[i].size - 1;
-		if ((addr >= lmb->reserved.region[i].base) && (addr <= upper))
-			return (lmb->reserved.region[i].flags & flags) == flags;
-	}
 	return 0;
 }
 
@@ -11,6 +11,7 @@
 #define LOG_CATEGORY	LOGC_DT
 
 #include <abuf.h>
+#include <bootstage.h>
 #include <log.h>
 #include <linux/libfdt.h>
 #include <of_live.h>
@@ -35,6 +36,29 @@ static void *unflatten_dt_alloc(void **mem, unsigned long size,
 	return res;
 }
 
+/* Pick up the phandle of a node from one of its properties */
+static void unflatten_dt_phandle(struct device_node *np, const char *pname,
+				 const __be32 *p)
+{
+	/*
+	 * We accept flattened tree phandles either in
+	 * ePAPR-style "phandle" properties, or the
+	 * legacy "linux,phandle" properties.  If both
+	 * appear and have different values, things
+	 * will get weird.  Don't do that. */
+	if ((strcmp(pname, "phandle") == 0) ||
+	    (strcmp(pname, "linux,phandle") == 0)) {
+		if (np->phandle == 0)
+			np->phandle = be32_to_cpup(p);
+	}
+	/*
+	 * And we process the "ibm,phandle" property
+	 * used in pSeries dynamic device tree
+	 * stuff */
+	if (strcmp(pname, "ibm,phandle") == 0)
+		np->phandle = be32_to_cpup(p);
+}
+
 /**
  * unflatten_dt_node() - Alloc and populate a device_node from the flat tree
  * @blob: The parent device tree blob
@@ -62,6 +86,7 @@ static void *unflatten_dt_node(const void *blob, void *mem, int *poffset,
 	int offset;
 	int has_name = 0;
 	int new_format = 0;
+	bool lazy;
 
 	pathp = fdt_get_name(blob, *poffset, &l);
 	if (!pathp)
@@ -97,6 +122,8 @@ static void *unflatten_dt_node(const void *blob, void *mem, int *poffset,
 			allocl = fpsize;
 		}
 	}
+	/* the old format needs the name property, so is never lazy */
+	lazy = CONFIG_IS_ENABLED(OF_LIVE_LAZY) && new_format;
 
 	np = unflatten_dt_alloc(&mem, sizeof(struct device_node) + allocl,
 				__alignof__(struct device_node));
@@ -127,16 +154,23 @@ static void *unflatten_dt_node(const void *blob, void *mem, int *poffset,
 		memcpy(fn, pathp, l);
 
 		prev_pp = &np->properties;
+#if CONFIG_IS_ENABLED(OF_LIVE_LAZY)
+		np->lazy = lazy ? (void *)blob : NULL;
+		np->offset = lazy ? *poffset : -1;
+#endif
 		if (dad != NULL) {
 			np->parent = dad;
 			np->sibling = dad->child;
 			dad->child = np;
 		}
 	}
-	/* process properties */
-	for (offset = fdt_first_property_offset(blob, *poffset);
-	     (offset >= 0);
-	     (offset = fdt_next_property_offset(blob, offset))) {
+	/*
+	 * process properties. For a lazy node only the phandle and type are
+	 * needed now, which take no space
+	 */
+	offset = lazy && dryrun ? -FDT_ERR_NOTFOUND :
+		fdt_first_property_offset(blob, *poffset);
+	for (; offset >= 0; offset = fdt_next_property_offset(blob, offset)) {
 		const char *pname;
 		int sz;
 
@@ -152,26 +186,16 @@ static void *unflatten_dt_node(const void *blob, void *mem, int *poffset,
 		}
 		if (strcmp(pname, "name") == 0)
 			has_name = 1;
+		if (lazy) {
+			unflatten_dt_phandle(np, pname, p);
+			if (strcmp(pname, "device_type") == 0)
+				np->type = (const char *)p;
+			continue;
+		}
 		pp = unflatten_dt_alloc(&mem, sizeof(struct property),
 					__alignof__(struct property));
 		if (!dryrun) {
-			/*
-			 * We accept flattened tree phandles either in
-			 * ePAPR-style "phandle" properties, or the
-			 * legacy "linux,phandle" properties.  If both
-			 * appear and have different values, things
-			 * will get weird.  Don't do that. */
-			if ((strcmp(pname, "phandle") == 0) ||
-			    (strcmp(pname, "linux,phandle") == 0)) {
-				if (np->phandle == 0)
-					np->phandle = be32_to_cpup(p);
-			}
-			/*
-			 * And we process the "ibm,phandle" property
-			 * used in pSeries dynamic device tree
-			 * stuff */
-			if (strcmp(pname, "ibm,phandle") == 0)
-				np->phandle = be32_to_cpup(p);
+			unflatten_dt_phandle(np, pname, p);
 			pp->name = (char *)pname;
 			pp->length = sz;
 			pp->value = (__be32 *)p;
@@ -183,7 +207,7 @@ static void *unflatten_dt_node(const void *blob, void *mem, int *poffset,
 	 * with version 0x10 we may not have the name property, recreate
 	 * it here from the unit name if absent
 	 */
-	if (!has_name) {
+	if (!has_name && !lazy) {
 		const char *p1 = pathp, *ps = pathp, *pa = NULL;
 		int sz;
 
@@ -215,7 +239,8 @@ static void *unflatten_dt_node(const void *blob, void *mem, int *poffset,
 		*prev_pp = NULL;
 		if (!has_name)
 			np->name = of_get_property(np, "name", NULL);
-		np->type = of_get_property(np, "device_type", NULL);
+		if (!lazy)
+			np->type = of_get_property(np, "device_type", NULL);
 
 		if (!np->name)
 			np->name = "<NULL>";
@@ -338,8 +363,66 @@ int of_live_build(const void *fdt_blob, struct device_node **rootp)
 	return ret;
 }
 
+#if CONFIG_IS_ENABLED(OF_LIVE_LAZY)
+/* used for a node whose properties could not be read, so it is not bound */
+static struct property of_live_lazy_fail = {
+	.name	= "status",
+	.length	= sizeof("fail"),
+	.value	= "fail",
+};
+
+int of_live_load_props(struct device_node *np)
+{
+	const void *blob = np->lazy;
+	struct property *pp, *props;
+	const char *pname;
+	int offset, count = 0;
+
+	bootstage_start(BOOTSTAGE_ID_ACCUM_OF_LIVE_LAZY, "of_live_lazy");
+	fdt_for_each_property_offset(offset, blob, np->offset)
+		count++;
+	props = count ? malloc(count * sizeof(*props)) : NULL;
+	if (count && !props) {
+		log_err("No memory for properties of %s, disabling it\n",
+			np->full_name);
+		np->properties = &of_live_lazy_fail;
+		np->lazy = NULL;
+		np->offset = -1;
+		bootstage_accum(BOOTSTAGE_ID_ACCUM_OF_LIVE_LAZY);
+		return log_msg_ret("prp", -ENOMEM);
+	}
+
+	pp = props;
+	fdt_for_each_property_offset(offset, blob, np->offset) {
+		pp->value = (void *)fdt_getprop_by_offset(blob, offset, &pname,
+							  &pp->length);
+		pp->name = (char *)pname;
+		pp->next = pp + 1;
+		pp++;
+	}
+	if (count)
+		props[count - 1].next = NULL;
+
+	np->properties = props;
+	np->lazy = props;
+	np->offset = -1;
+	bootstage_accum(BOOTSTAGE_ID_ACCUM_OF_LIVE_LAZY);
+
+	return 0;
+}
+#endif
+
 void of_live_free(struct device_node *root)
 {
+#if CONFIG_IS_ENABLED(OF_LIVE_LAZY)
+	struct device_node *np;
+
+	/* free the properties which were read after unflattening */
+	for (np = root; np; np = of_find_all_nodes(np)) {
+		if (np->lazy && np->offset == -1)
+			free(np->lazy);
+	}
+#endif
 	/* the tree is stored as a contiguous block of memory */
 	free(root);
 }
@@ -401,7 +484,7 @@ static int flatten_node(struct abuf *buf, const struct device_node *node)
 		return log_msg_ret("beg", ret);
 
 	/* First write out the properties */
-	for (pp = node->properties; !ret && pp; pp = pp->next) {
+	for (pp = of_live_get_props(node); !ret && pp; pp = pp->next) {
 		ret = fdt_property(abuf_data(buf), pp->name, pp->value,
 				   pp->length);
 		ret = check_space(ret, buf);
@@ -12,6 +12,7 @@
 #include <spl.h>
 #include <time.h>
 #include <timer.h>
+#include <uthread.h>
 #include <watchdog.h>
 #include <div64.h>
 #include <asm/global_data.h>
@@ -190,10 +191,39 @@ void __weak __udelay(unsigned long usec)
 
 /* ------------------------------------------------------------------------- */
 
+/**
+ * udelay_yield() - let other threads run while waiting
+ *
+ * @usec: Time to wait in microseconds
+ * Return: time still to wait, non-zero if there is no other thread to run
+ */
+static ulong udelay_yield(ulong usec)
+{
+	ulong start, elapsed;
+
+	if (!uthread_schedule())
+		return usec;
+
+	start = timer_get_us();
+	for (elapsed = 0; elapsed < usec; elapsed = timer_get_us() - start) {
+		schedule();
+		if (!uthread_schedule())
+			return usec - elapsed;
+	}
+
+	return 0;
+}
+
 void udelay(unsigned long usec)
 {
 	ulong kv;
 
+	if (CONFIG_IS_ENABLED(UTHREAD)) {
+		usec = udelay_yield(usec);
+		if (!usec)
+			return;
+	}
+
 	do {
 		schedule();
 		kv = usec > CFG_WD_PERIOD ? CFG_WD_PERIOD : usec;
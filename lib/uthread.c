@@ -0,0 +1,167 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Cooperative threads
+ *
+ * Threads are kept on a ring whose head is the main thread, i.e. the one that
+ * U-Boot started on. Each call to uthread_schedule() saves the current thread
+ * with setjmp() and resumes the next one that has not finished. A thread which
+ * finishes cannot free the stack it is running on, so that is left to whichever
+ * thread runs next.
+ */
+
+#include <log.h>
+#include <malloc.h>
+#include <uthread.h>
+#include <vsprintf.h>
+#include <linux/errno.h>
+#include <linux/list.h>
+
+static struct uthread main_thread = {
+	.list = LIST_HEAD_INIT(main_thread.list),
+};
+
+static struct uthread *current = &main_thread;
+static unsigned int grp_id_next;
+
+/* Free the stacks of finished threads, other than the running one */
+static void uthread_reap(void)
+{
+	struct uthread *uthr, *tmp;
+
+	list_for_each_entry_safe(uthr, tmp, &main_thread.list, list) {
+		if (!uthr->done || uthr == current)
+			continue;
+		list_del(&uthr->list);
+		free(uthr->stack);
+		uthr->stack = NULL;
+		if (uthr->alloced)
+			free(uthr);
+	}
+}
+
+static void __noreturn uthread_trampoline(void)
+{
+	struct uthread *uthr = current;
+
+	uthread_reap();
+	uthr->fn(uthr->arg);
+	uthr->done = true;
+
+	/* the main thread is always runnable, so this does not come back */
+	uthread_schedule();
+	panic("uthread: finished thread was resumed\n");
+}
+
+int uthread_create(struct uthread *uthr, void (*fn)(void *), void *arg,
+		   size_t stack_sz, unsigned int grp_id)
+{
+	bool alloced = false;
+	int ret;
+
+	if (!stack_sz)
+		stack_sz = CONFIG_UTHREAD_STACK_SIZE;
+
+	if (!uthr) {
+		uthr = calloc(1, sizeof(*uthr));
+		if (!uthr)
+			return -ENOMEM;
+		alloced = true;
+	}
+
+	uthr->fn = fn;
+	uthr->arg = arg;
+	uthr->done = false;
+	uthr->alloced = alloced;
+	uthr->grp_id = grp_id;
+	uthr->stack = memalign(16, stack_sz);
+	if (!uthr->stack) {
+		ret = -ENOMEM;
+		goto err;
+	}
+
+	ret = initjmp(uthr->ctx, uthread_trampoline, uthr->stack, stack_sz);
+	if (ret) {
+		log_debug("Cannot set up thread context (err=%d)\n", ret);
+		free(uthr->stack);
+		uthr->stack = NULL;
+		goto err;
+	}
+
+	/* run after every thread already on the ring */
+	list_add_tail(&uthr->list, &main_thread.list);
+
+	return 0;
+
+err:
+	if (alloced)
+		free(uthr);
+
+	return ret;
+}
+
+bool uthread_schedule(void)
+{
+	struct uthread *cur = current;
+	struct uthread *next;
+
+	/* the main thread never finishes, so the walk always finds one */
+	list_for_each_entry(next, &cur->list, list) {
+		if (!next->done)
+			break;
+	}
+	if (next == cur)
+		return false;
+
+	current = next;
+	if (!setjmp(cur->ctx))
+		longjmp(next->ctx, 1);
+
+	uthread_reap();
+
+	return true;
+}
+
+unsigned int uthread_grp_new_id(void)
+{
+	/* zero means 'no group' */
+	if (!++grp_id_next)
+		++grp_id_next;
+
+	return grp_id_next;
+}
+
+bool uthread_grp_done(unsigned int grp_id)
+{
+	struct uthread *uthr;
+
+	list_for_each_entry(uthr, &main_thread.list, list) {
+		if (uthr->grp_id == grp_id && !uthr->done)
+			return false;
+	}
+
+	return true;
+}
+
+void uthread_mutex_lock(struct uthread_mutex *mutex)
+{
+	while (mutex->owner && mutex->owner != current) {
+		if (!uthread_schedule()) {
+			/* only a finished thread can hold it now */
+			log_err("uthread: mutex left held by a finished thread\n");
+			mutex->count = 0;
+			break;
+		}
+	}
+	mutex->owner = current;
+	mutex->count++;
+}
+
+void uthread_mutex_unlock(struct uthread_mutex *mutex)
+{
+	if (mutex->owner != current || !mutex->count) {
+		log_debug("Mutex released by a thread not holding it\n");
+		return;
+	}
+	if (!--mutex->count)
+		mutex->owner = NULL;
+}
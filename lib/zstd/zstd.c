@@ -6,56 +6,347 @@
 #define LOG_CATEGORY	LOGC_BOOT
 
 #include <abuf.h>
+#include <cpu_job.h>
 #include <log.h>
 #include <malloc.h>
+#include <dm/uclass.h>
 #include <linux/errno.h>
+#include <linux/kernel.h>
 #include <linux/zstd.h>
 
-int zstd_decompress(struct abuf *in, struct abuf *out)
+#if CONFIG_IS_ENABLED(CPU_JOBS)
+#define ZSTD_MAX_JOBS	CONFIG_ZSTD_JOBS
+#else
+#define ZSTD_MAX_JOBS	1
+#endif
+
+/**
+ * struct zstd_run - a run of frames decompressed by one job
+ *
+ * @dctx: Context to use, which no other job uses
+ * @ddict: Dictionary to use, or NULL if none
+ * @in: Frames to decompress
+ * @out: Where the frames decompress to, exactly as large as their content
+ */
+struct zstd_run {
+	zstd_dctx *dctx;
+	const zstd_ddict *ddict;
+	struct abuf in;
+	struct abuf out;
+};
+
+/**
+ * zstd_next_frame() - Find the size of the frame at the start of a buffer
+ *
+ * @src: Buffer to check
+ * @size: Number of bytes at @src
+ * @hdr: Returns the header of the frame
+ * Return: size of the frame in bytes, 0 if @src does not start with a frame,
+ * -EINVAL if the frame is truncated or corrupt
+ */
+static long zstd_next_frame(const void *src, size_t size,
+			    zstd_frame_header *hdr)
+{
+	size_t len;
+
+	/* this is non-zero if there is no magic, or too little for a header */
+	if (zstd_get_frame_header(hdr, src, size))
+		return 0;
+
+	len = zstd_find_frame_compressed_size(src, size);
+	if (zstd_is_error(len))
+		return -EINVAL;
+
+	return len;
+}
+
+static int zstd_decompress_frames(zstd_dctx *ctx, const zstd_ddict *ddict,
+				  struct abuf *in, struct abuf *out)
+{
+	const char *src = abuf_data(in);
+	size_t left = abuf_size(in);
+	char *dst = abuf_data(out);
+	size_t space = abuf_size(out);
+	bool found = false;
+
+	while (left) {
+		zstd_frame_header hdr;
+		size_t len;
+		long flen;
+
+		/*
+		 * Stop at the first thing which is not a frame, since there
+		 * may be junk after the last one that zstd_decompress_dctx()
+		 * can't handle.
+		 */
+		flen = zstd_next_frame(src, left, &hdr);
+		if (flen < 0)
+			return flen;
+		if (!flen)
+			break;
+
+		if (hdr.frameType != ZSTD_skippableFrame) {
+			if (ddict)
+				len = zstd_decompress_using_ddict(ctx, dst, space,
+								  src, flen,
+								  ddict);
+			else
+				len = zstd_decompress_dctx(ctx, dst, space, src,
+							   flen);
+			if (zstd_is_error(len))
+				return -EINVAL;
+			dst += len;
+			space -= len;
+		}
+		src += flen;
+		left -= flen;
+		found = true;
+	}
+	if (!found)
+		return -EINVAL;
+
+	return dst - (char *)abuf_data(out);
+}
+
+int zstd_decompress_ctx(zstd_dctx *ctx, struct abuf *in, struct abuf *out)
+{
+	return zstd_decompress_frames(ctx, NULL, in, out);
+}
+
+/**
+ * zstd_plan_runs() - Split frames into runs to decompress in parallel
+ *
+ * The runs are contiguous and have roughly the same compressed size, since
+ * that is what the time taken follows most closely. This only fills in the @in
+ * and @out members of each run.
+ *
+ * @in: Input buffer to decompress
+ * @out: Output buffer to hold the results
+ * @runs: Returns the runs
+ * @max_runs: Largest number of runs to return
+ * Return: number of runs, 0 if the data cannot be split because it has fewer
+ * than two frames or a frame does not record its decompressed size, -EINVAL if
+ * the data is corrupt or does not fit in @out
+ */
+static int zstd_plan_runs(struct abuf *in, struct abuf *out,
+			  struct zstd_run *runs, int max_runs)
+{
+	const char *start = abuf_data(in);
+	char *dst = abuf_data(out);
+	size_t used = 0, total = 0, target;
+	const char *src, *end, *run_start;
+	zstd_frame_header hdr;
+	int frames = 0;
+	int count;
+	long flen;
+
+	/* find the extent of the frames and how large they decompress to */
+	for (src = start; used < abuf_size(in); src += flen, used += flen) {
+		flen = zstd_next_frame(src, abuf_size(in) - used, &hdr);
+		if (flen < 0)
+			return flen;
+		if (!flen)
+			break;
+		if (hdr.frameType == ZSTD_skippableFrame)
+			continue;
+		if (hdr.frameContentSize == ZSTD_CONTENTSIZE_UNKNOWN)
+			return 0;
+		total += hdr.frameContentSize;
+		frames++;
+	}
+	if (frames < 2)
+		return 0;
+	if (total > abuf_size(out))
+		return -EINVAL;
+
+	count = 0;
+	max_runs = min(max_runs, frames);
+	target = used / max_runs;
+	end = start + used;
+	total = 0;
+	run_start = start;
+	for (src = start; ; src += flen) {
+		flen = src < end ? zstd_next_frame(src, end - src, &hdr) : 0;
+
+		/* a new run starts at the frame whose middle passes the share */
+		if (src == end ||
+		    (src > run_start && count < max_runs - 1 &&
+		     src + flen / 2 - start > target * (count + 1))) {
+			abuf_init_set(&runs[count].in, (void *)run_start,
+				      src - run_start);
+			abuf_init_set(&runs[count].out, dst, total);
+			dst += total;
+			total = 0;
+			run_start = src;
+			count++;
+			if (src == end)
+				break;
+		}
+		if (hdr.frameType != ZSTD_skippableFrame)
+			total += hdr.frameContentSize;
+	}
+
+	return count;
+}
+
+static int zstd_run_job(void *arg)
+{
+	struct zstd_run *run = arg;
+	int ret;
+
+	ret = zstd_decompress_frames(run->dctx, run->ddict, &run->in,
+				     &run->out);
+	if (ret < 0)
+		return ret;
+
+	/* the frame headers promised this much, so anything else is corrupt */
+	return ret == abuf_size(&run->out) ? 0 : -EINVAL;
+}
+
+/**
+ * zstd_setup_jobs() - Provide a context for each run
+ *
+ * The first run uses the decompressor's own context. Contexts for the others
+ * are allocated on first use and kept for later images.
+ *
+ * @zd: Decompressor
+ * @runs: Runs to set up
+ * @count: Number of runs
+ * Return: 0 if OK, -ENOMEM if out of memory
+ */
+static int zstd_setup_jobs(struct zstd_decomp *zd, struct zstd_run *runs,
+			   int count)
+{
+	size_t wsize = ALIGN(zstd_dctx_workspace_bound(), 8);
+	int i;
+
+	if (zd->job_count < count - 1) {
+		free(zd->job_workspace);
+		zd->job_count = 0;
+		zd->job_workspace = malloc(wsize * (count - 1));
+		if (!zd->job_workspace) {
+			debug("%s: cannot allocate %d contexts\n", __func__,
+			      count - 1);
+			return -ENOMEM;
+		}
+		zd->job_count = count - 1;
+	}
+
+	for (i = 0; i < count; i++) {
+		runs[i].dctx = zd->dctx;
+		if (i) {
+			runs[i].dctx = zstd_init_dctx(zd->job_workspace +
+						      (i - 1) * wsize, wsize);
+			if (!runs[i].dctx)
+				return -ENOMEM;
+		}
+		runs[i].ddict = zd->ddict;
+	}
+
+	return 0;
+}
+
+int zstd_decomp_run(struct zstd_decomp *zd, struct abuf *in, struct abuf *out)
+{
+	struct zstd_run runs[ZSTD_MAX_JOBS];
+	struct cpu_job jobs[ZSTD_MAX_JOBS];
+	int count = 0;
+	int ret, i;
+
+	if (ZSTD_MAX_JOBS > 1 && zd->max_jobs > 1) {
+		count = zstd_plan_runs(in, out, runs,
+				       min(zd->max_jobs, ZSTD_MAX_JOBS));
+		if (count < 0)
+			return count;
+	}
+	if (count < 2)
+		return zstd_decompress_frames(zd->dctx, zd->ddict, in, out);
+
+	ret = zstd_setup_jobs(zd, runs, count);
+	if (ret)
+		return ret;
+	for (i = 0; i < count; i++)
+		cpu_job_init(&jobs[i], zstd_run_job, &runs[i]);
+	log_debug("Decompressing in %d runs\n", count);
+	ret = cpu_run_jobs(jobs, count);
+	if (ret)
+		return ret;
+
+	return (char *)abuf_data(&runs[count - 1].out) +
+		abuf_size(&runs[count - 1].out) - (char *)abuf_data(out);
+}
+
+int zstd_decomp_init(struct zstd_decomp *zd, const void *dict,
+		     size_t dict_size)
 {
-	zstd_dctx *ctx;
-	size_t wsize, len;
-	void *workspace;
+	size_t wsize;
 	int ret;
 
+	memset(zd, '\0', sizeof(*zd));
 	wsize = zstd_dctx_workspace_bound();
-	workspace = malloc(wsize);
-	if (!workspace) {
+	zd->workspace = malloc(wsize);
+	if (!zd->workspace) {
 		debug("%s: cannot allocate workspace of size %zu\n", __func__,
 			wsize);
 		return -ENOMEM;
 	}
 
-	ctx = zstd_init_dctx(workspace, wsize);
-	if (!ctx) {
+	zd->dctx = zstd_init_dctx(zd->workspace, wsize);
+	if (!zd->dctx) {
 		log_err("%s: zstd_init_dctx() failed\n", __func__);
 		ret = -EPERM;
-		goto do_free;
+		goto err;
 	}
 
-	/*
-	 * Find out how large the frame actually is, there may be junk at
-	 * the end of the frame that zstd_decompress_dctx() can't handle.
-	 */
-	len = zstd_find_frame_compressed_size(abuf_data(in), abuf_size(in));
-	if (zstd_is_error(len)) {
-		log_err("%s: failed to detect compressed size: %d\n", __func__,
-			zstd_get_error_code(len));
-		ret = -EINVAL;
-		goto do_free;
+	if (dict) {
+		wsize = zstd_ddict_workspace_bound(dict_size);
+		zd->dict_workspace = malloc(wsize);
+		if (!zd->dict_workspace) {
+			ret = -ENOMEM;
+			goto err;
+		}
+		zd->ddict = zstd_init_ddict(zd->dict_workspace, wsize, dict,
+					    dict_size);
+		if (!zd->ddict) {
+			log_err("%s: invalid dictionary\n", __func__);
+			ret = -EINVAL;
+			goto err;
+		}
 	}
 
-	len = zstd_decompress_dctx(ctx, abuf_data(out), abuf_size(out),
-				   abuf_data(in), len);
-	if (zstd_is_error(len)) {
-		log_err("%s: failed to decompress: %d\n", __func__,
-			zstd_get_error_code(len));
-		ret = -EINVAL;
-		goto do_free;
-	}
+	zd->max_jobs = 1;
+	if (ZSTD_MAX_JOBS > 1)
+		zd->max_jobs = clamp(uclass_id_count(UCLASS_CPU), 1,
+				     ZSTD_MAX_JOBS);
+
+	return 0;
+
+err:
+	zstd_decomp_uninit(zd);
+	return ret;
+}
+
+void zstd_decomp_uninit(struct zstd_decomp *zd)
+{
+	free(zd->job_workspace);
+	free(zd->dict_workspace);
+	free(zd->workspace);
+	memset(zd, '\0', sizeof(*zd));
+}
+
+int zstd_decompress(struct abuf *in, struct abuf *out)
+{
+	struct zstd_decomp zd;
+	int ret;
+
+	ret = zstd_decomp_init(&zd, NULL, 0);
+	if (ret)
+		return ret;
+
+	ret = zstd_decomp_run(&zd, in, out);
+	if (ret < 0)
+		log_err("%s: failed to decompress: %d\n", __func__, ret);
+	zstd_decomp_uninit(&zd);
 
-	ret = len;
-do_free:
-	free(workspace);
 	return ret;
 }
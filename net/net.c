@@ -388,6 +388,8 @@ static void net_clear_handlers(void)
 
 static void net_cleanup_loop(void)
 {
+	if (IS_ENABLED(CONFIG_PROT_TCP))
+		tcp_ack_timeout_check(true);
 	net_clear_handlers();
 }
 
@@ -646,6 +648,8 @@ restart:
 		 *	errors that may have happened.
 		 */
 		eth_rx();
+		if (IS_ENABLED(CONFIG_PROT_TCP))
+			tcp_ack_timeout_check(false);
 
 		/*
 		 *	Abort if ctrl-c was pressed.
@@ -902,6 +906,10 @@ int net_send_udp_packet(uchar *ether, struct in_addr dest, int dport, int sport,
 int net_send_tcp_packet(int payload_len, int dport, int sport, u8 action,
 			u32 tcp_seq_num, u32 tcp_ack_num)
 {
+	if (tcp_delay_ack(payload_len, dport, sport, action, tcp_seq_num,
+			  tcp_ack_num))
+		return 0;
+
 	return net_send_ip_packet(net_server_ethaddr, net_server_ip, dport,
 				  sport, payload_len, IPPROTO_TCP, action,
 				  tcp_seq_num, tcp_ack_num);
@@ -22,7 +22,9 @@
 #include <env_internal.h>
 #include <errno.h>
 #include <net.h>
+#include <time.h>
 #include <net/tcp.h>
+#include <linux/sizes.h>
 
 /*
  * TCP sliding window  control used by us to request re-TX
@@ -38,6 +40,36 @@ static u32 tcp_ack_edge;
 
 static int tcp_activity_count;
 
+/* The other end sent a window scale option, so our window is scaled too */
+static bool tcp_rmt_scale;
+
+/* Sequence number just past the end of the application's buffer */
+static u32 tcp_rx_end;
+static bool tcp_rx_limited;
+
+/**
+ * struct tcp_delack - an ACK held back to cover more than one segment
+ *
+ * @enabled: The application asked for ACKs to be held back
+ * @pending: An ACK is held back
+ * @segs: Number of segments it acknowledges
+ * @start: Time it was first held back
+ * @dport: Destination TCP port
+ * @sport: Source TCP port
+ * @seq: TCP sequence number
+ * @ack: Latest acknowledgement number, sent or held back
+ */
+static struct tcp_delack {
+	bool enabled;
+	bool pending;
+	int segs;
+	ulong start;
+	int dport;
+	int sport;
+	u32 seq;
+	u32 ack;
+} tcp_delack;
+
 /*
  * Search for TCP_SACK and review the comments before the code section
  * TCP_SACK is the number of packets at the front of the stream
@@ -88,6 +120,78 @@ void tcp_set_tcp_state(enum tcp_state new_state)
 	current_tcp_state = new_state;
 }
 
+void tcp_set_rx_space(u32 tcp_seq_num, ulong size)
+{
+	/* a buffer too large to fill in one go is as good as no limit */
+	tcp_rx_limited = size && size < SZ_1G;
+	tcp_rx_end = tcp_seq_num + size;
+}
+
+/**
+ * tcp_rx_window() - work out the receive window to advertise
+ * @tcp_ack_num: Acknowledgement number sent with it
+ * @syn: The window is for a SYN, which is never scaled
+ *
+ * Return: value for the window field of the TCP header
+ */
+static u16 tcp_rx_window(u32 tcp_ack_num, bool syn)
+{
+	ulong win = CONFIG_PROT_TCP_RX_WINDOW;
+
+	if (tcp_rx_limited)
+		win = min(win, (ulong)max((s32)(tcp_rx_end - tcp_ack_num), 0));
+	if (syn || !tcp_rmt_scale)
+		return min(win, 0xffffUL);
+
+	return win >> TCP_SCALE;
+}
+
+void tcp_set_delay_ack(bool enable)
+{
+	tcp_delack.enabled = enable;
+	tcp_delack.pending = false;
+	tcp_delack.segs = 0;
+}
+
+bool tcp_delay_ack(int payload_len, int dport, int sport, u8 action,
+		   u32 tcp_seq_num, u32 tcp_ack_num)
+{
+	/* a duplicate ACK tells the other end about a lost segment */
+	bool dup = tcp_ack_num == tcp_delack.ack;
+
+	tcp_delack.ack = tcp_ack_num;
+	if (!tcp_delack.enabled || action != TCP_ACK || payload_len || dup ||
+	    current_tcp_state != TCP_ESTABLISHED ||
+	    (IS_ENABLED(CONFIG_PROT_TCP_SACK) && tcp_lost.len > TCP_OPT_LEN_2) ||
+	    ++tcp_delack.segs >= TCP_ACK_SEGMENTS) {
+		tcp_delack.pending = false;
+		tcp_delack.segs = 0;
+		return false;
+	}
+
+	if (!tcp_delack.pending)
+		tcp_delack.start = get_timer(0);
+	tcp_delack.pending = true;
+	tcp_delack.dport = dport;
+	tcp_delack.sport = sport;
+	tcp_delack.seq = tcp_seq_num;
+
+	return true;
+}
+
+void tcp_ack_timeout_check(bool now)
+{
+	if (!tcp_delack.pending ||
+	    (!now && get_timer(tcp_delack.start) < TCP_ACK_DELAY))
+		return;
+
+	tcp_delack.pending = false;
+	tcp_delack.segs = 0;
+	net_send_ip_packet(net_server_ethaddr, net_server_ip, tcp_delack.dport,
+			   tcp_delack.sport, 0, IPPROTO_TCP, TCP_ACK,
+			   tcp_delack.seq, tcp_delack.ack);
+}
+
 static void dummy_handler(uchar *pkt, u16 dport,
 			  struct in_addr sip, u16 sport,
 			  u32 tcp_seq_num, u32 tcp_ack_num,
@@ -102,6 +206,7 @@ static void dummy_handler(uchar *pkt, u16 dport,
 void tcp_set_tcp_handler(rxhand_tcp *f)
 {
 	debug_cond(DEBUG_INT_STATE, "--- net_loop TCP handler set (%p)\n", f);
+	tcp_set_delay_ack(false);
 	if (!f)
 		tcp_packet_handler = dummy_handler;
 	else
@@ -259,6 +364,9 @@ int tcp_set_tcp_header(uchar *pkt, int dport, int sport, int payload_len,
 			   &net_server_ip, &net_ip,
 			   tcp_seq_num, tcp_ack_num);
 		tcp_activity_count = 0;
+		tcp_rx_limited = false;
+		tcp_delack.pending = false;
+		tcp_delack.segs = 0;
 		net_set_syn_options(b);
 		tcp_seq_num = 0;
 		tcp_ack_num = 0;
@@ -326,20 +434,14 @@ int tcp_set_tcp_header(uchar *pkt, int dport, int sport, int payload_len,
 
 	/*
 	 * TCP window size - TCP header variable tcp_win.
-	 * Change tcp_win only if you have an understanding of network
-	 * overrun, congestion, TCP segment sizes, TCP windows, TCP scale,
-	 * queuing theory  and packet buffering. If there are too few buffers,
-	 * there will be data loss, recovery may work or the sending TCP,
-	 * the server, could abort the stream transmission.
-	 * MSS is governed by maximum Ethernet frame length.
-	 * The number of buffers is governed by the desire to have a queue of
-	 * full buffers to be processed at the destination to maximize
-	 * throughput. Temporary memory use for the boot phase on modern
-	 * SOCs is may not be considered a constraint to buffer space, if
-	 * it is, then the u-boot tftp or nfs kernel netboot should be
-	 * considered.
+	 * The window lets the other end keep sending while earlier segments
+	 * are still on their way, so it must cover the bandwidth-delay
+	 * product of the link to keep it busy. It is scaled (RFC 7323) only
+	 * if both ends offered to in their SYNs, and it never covers more
+	 * than the application has room to store.
 	 */
-	b->ip.hdr.tcp_win = htons(PKTBUFSRX * TCP_MSS >> TCP_SCALE);
+	b->ip.hdr.tcp_win = htons(tcp_rx_window(tcp_ack_num,
+						b->ip.hdr.tcp_flags & TCP_SYN));
 
 	b->ip.hdr.tcp_xsum = 0;
 	b->ip.hdr.tcp_ugr = 0;
@@ -469,33 +571,36 @@ void tcp_hole(u32 tcp_seq_num, u32 len)
 void tcp_parse_options(uchar *o, int o_len)
 {
 	struct tcp_t_opt  *tsopt;
-	uchar *p = o;
+	uchar *p = o, *end = o + o_len;
 
 	/*
-	 * NOPs are options with a zero length, and thus are special.
-	 * All other options have length fields.
+	 * END and NOP are a single byte. All other options have a length
+	 * field, which includes the kind and length bytes.
 	 */
-	for (p = o; p < (o + o_len); p = p + p[1]) {
-		if (!p[1])
+	while (p < end) {
+		if (p[0] == TCP_O_END)
 			return; /* Finished processing options */
+		if (p[0] == TCP_1_NOP) {
+			p++;
+			continue;
+		}
+		if (p + 1 >= end || p[1] < TCP_OPT_LEN_2 || p + p[1] > end)
+			return;
 
 		switch (p[0]) {
-		case TCP_O_END:
-			return;
-		case TCP_O_MSS:
 		case TCP_O_SCL:
+			tcp_rmt_scale = true;
+			break;
+		case TCP_O_MSS:
 		case TCP_P_SACK:
 		case TCP_V_SACK:
 			break;
 		case TCP_O_TS:
 			tsopt = (struct tcp_t_opt *)p;
 			rmt_timestamp = tsopt->t_snd;
-			return;
+			break;
 		}
-
-		/* Process optional NOPs */
-		if (p[0] == TCP_O_NOP)
-			p++;
+		p += p[1];
 	}
 }
 
@@ -672,6 +777,9 @@ void rxhand_tcp_f(union tcp_build_pkt *b, unsigned int pkt_len)
 	tcp_hdr_len = GET_TCP_HDR_LEN_IN_BYTES(b->ip.hdr.tcp_hlen);
 	payload_len = tcp_len - tcp_hdr_len;
 
+	/* window scaling is agreed in the SYNs only */
+	if (b->ip.hdr.tcp_flags & TCP_SYN)
+		tcp_rmt_scale = false;
 	if (tcp_hdr_len > TCP_HDR_SIZE)
 		tcp_parse_options((uchar *)b + IP_TCP_HDR_SIZE,
 				  tcp_hdr_len - TCP_HDR_SIZE);
@@ -686,6 +794,15 @@ void rxhand_tcp_f(union tcp_build_pkt *b, unsigned int pkt_len)
 	tcp_action = tcp_state_machine(b->ip.hdr.tcp_flags,
 				       tcp_seq_num, payload_len);
 
+	/* Never answer a reset, but tell the app so that it can reconnect */
+	if (b->ip.hdr.tcp_flags & TCP_RST) {
+		(*tcp_packet_handler)((uchar *)b + pkt_len - payload_len,
+				      b->ip.hdr.tcp_dst, b->ip.hdr.ip_src,
+				      b->ip.hdr.tcp_src, tcp_seq_num,
+				      tcp_ack_num, TCP_RST, 0);
+		return;
+	}
+
 	tcp_activity_count++;
 	if (tcp_activity_count > TCP_ACTIVITY) {
 		puts("| ");
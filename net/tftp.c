@@ -97,6 +97,49 @@ static ushort	tftp_windowsize;
 static ushort	tftp_next_ack;
 /* Last nack block we send */
 static ushort	tftp_last_nack;
+/*
+ * Blocks received ahead of the one expected, within the window: bit n is set
+ * if block tftp_cur_block + 1 + n is already stored
+ */
+static u64	tftp_ahead_map;
+/* Number of the last block, if it has been received ahead of time */
+static int	tftp_ahead_last;
+/* The window size asked for in this transfer */
+static ushort	tftp_window_request;
+/* The window size to ask for in the next transfer, 0 to use the option */
+static ushort	tftp_window_next;
+/* The window size option which tftp_window_next was worked out for */
+static ushort	tftp_window_next_option;
+
+/* Blocks received ahead of time which can be kept, at most */
+#define TFTP_AHEAD_MAX		64
+/* Halve the window if more than one window in this many had losses */
+#define TFTP_WINDOW_LOSS_RATIO	32
+/* Number of recent window sizes to report */
+#define TFTP_WINDOW_HISTORY	8
+
+/**
+ * struct tftp_stats - statistics for the current TFTP get
+ *
+ * @active: true while a transfer is running
+ * @acks: Number of acks sent at the end of a window
+ * @nacks: Number of acks sent to ask for blocks again
+ * @timeouts: Number of timeouts waiting for the server
+ * @ahead: Number of blocks received ahead of one which was missing
+ * @dups: Number of blocks received which were already stored
+ */
+static struct tftp_stats {
+	bool active;
+	uint acks;
+	uint nacks;
+	uint timeouts;
+	uint ahead;
+	uint dups;
+} tftp_stats;
+
+/* Window sizes used by recent transfers, oldest first */
+static ushort	tftp_window_history[TFTP_WINDOW_HISTORY];
+static int	tftp_window_history_len;
 #ifdef CONFIG_CMD_TFTPPUT
 /* 1 if writing, else 0 */
 static int	tftp_put_active;
@@ -221,6 +264,62 @@ static int load_block(unsigned block, uchar *dst, unsigned len)
 static void tftp_send(void);
 static void tftp_timeout_handler(void);
 
+static void tftp_show_stats(void)
+{
+	int i;
+
+	/* by now time_start holds how long the transfer took, in ms */
+	printf("TFTP %u bytes in %lu ms", net_boot_file_size, time_start);
+	if (time_start > 0) {
+		puts(", ");
+		print_size(net_boot_file_size / time_start * 1000, "/s");
+	}
+	putc('\n');
+	printf("TFTP window %d (asked for %d): %u acks, %u asking again, %u timeouts\n",
+	       tftp_windowsize, tftp_window_request, tftp_stats.acks,
+	       tftp_stats.nacks, tftp_stats.timeouts);
+	printf("TFTP %u blocks out of order, %u duplicates, recent windows:",
+	       tftp_stats.ahead, tftp_stats.dups);
+	for (i = 0; i < tftp_window_history_len; i++)
+		printf(" %d", tftp_window_history[i]);
+	putc('\n');
+}
+
+/*
+ * Record the window used by a TFTP get and choose the one to ask for next
+ * time, halving it if blocks were lost often or the transfer failed, and
+ * doubling it if none were lost
+ */
+static void tftp_window_done(bool failed)
+{
+	uint lost = tftp_stats.nacks + tftp_stats.timeouts;
+	uint window = tftp_window_request;
+
+	tftp_stats.active = false;
+	if (!tftp_window_request)
+		return;
+
+	if (tftp_window_history_len == TFTP_WINDOW_HISTORY) {
+		memmove(tftp_window_history, tftp_window_history + 1,
+			sizeof(tftp_window_history) -
+			sizeof(tftp_window_history[0]));
+		tftp_window_history_len--;
+	}
+	tftp_window_history[tftp_window_history_len++] = tftp_windowsize;
+	if (IS_ENABLED(CONFIG_TFTP_STATS) && !failed)
+		tftp_show_stats();
+
+	if (!IS_ENABLED(CONFIG_TFTP_WINDOWSIZE_ADAPTIVE))
+		return;
+	if (failed || lost * TFTP_WINDOW_LOSS_RATIO > tftp_stats.acks)
+		window = max(window / 2, 1U);
+	else if (!lost)
+		window = min(window * 2, (uint)tftp_window_size_option);
+	if (window != tftp_window_request)
+		debug("TFTP window size %u for next transfer\n", window);
+	tftp_window_next = window;
+}
+
 /**********************************************************************/
 
 static void show_block_marker(void)
@@ -250,6 +349,15 @@ static void show_block_marker(void)
 	}
 }
 
+/* Start a transfer again after an error */
+static void tftp_start_again(void)
+{
+	/* a transfer which is started again lost too much at this size */
+	if (tftp_stats.active)
+		tftp_window_done(true);
+	net_start_again();
+}
+
 /**
  * restart the current transfer due to an error
  *
@@ -258,7 +366,7 @@ static void show_block_marker(void)
 static void restart(const char *msg)
 {
 	printf("\n%s; starting again\n", msg);
-	net_start_again();
+	tftp_start_again();
 }
 
 /*
@@ -301,10 +409,12 @@ static void tftp_complete(void)
 			time_start * 1000, "/s");
 	}
 	puts("\ndone\n");
-	if (!tftp_put_active)
+	if (!tftp_put_active) {
+		tftp_window_done(false);
 		efi_set_bootdev("Net", "", tftp_filename,
 				map_sysmem(tftp_load_addr, 0),
 				net_boot_file_size);
+	}
 	net_set_state(NETLOOP_SUCCESS);
 }
 
@@ -359,9 +469,9 @@ static void tftp_send(void)
 		 * Implemented only for tftp get.
 		 * Don't bother sending if it's 1
 		 */
-		if (tftp_state == STATE_SEND_RRQ && tftp_window_size_option > 1)
+		if (tftp_state == STATE_SEND_RRQ && tftp_window_request > 1)
 			pkt += sprintf((char *)pkt, "windowsize%c%d%c",
-					0, tftp_window_size_option, 0);
+					0, tftp_window_request, 0);
 		len = pkt - xp;
 		break;
 
@@ -451,6 +561,52 @@ static void icmp_handler(unsigned type, unsigned code, unsigned dest,
 }
 #endif
 
+/*
+ * Ask the server to send the window again from the block after the last one
+ * received in order
+ */
+static void tftp_send_nack(void)
+{
+	/*
+	 * If one packet is dropped most likely
+	 * all other buffers in the window
+	 * that will arrive will cause a sending NACK.
+	 * This just overwellms the server, let's just send one.
+	 */
+	if (tftp_last_nack != tftp_cur_block) {
+		tftp_send();
+		tftp_stats.nacks++;
+		tftp_last_nack = tftp_cur_block;
+		tftp_next_ack = (ushort)(tftp_cur_block + tftp_windowsize);
+	}
+}
+
+/*
+ * Keep a block which arrived before the one expected, so that it need not be
+ * sent again if the expected one was only delayed. Blocks are stored straight
+ * into place, so this only needs to remember which have arrived.
+ */
+static int tftp_store_ahead(ushort block, int ahead, uchar *src,
+			    unsigned int len)
+{
+	if (tftp_ahead_map & BIT_ULL(ahead)) {
+		tftp_stats.dups++;
+	} else {
+		if (store_block(tftp_cur_block + 1 + ahead, src, len))
+			return -1;
+		tftp_ahead_map |= BIT_ULL(ahead);
+		tftp_stats.ahead++;
+		if (len < tftp_block_size)
+			tftp_ahead_last = block;
+	}
+
+	/* the server waits for an ack after the end of the window */
+	if (block == tftp_next_ack || len < tftp_block_size)
+		tftp_send_nack();
+
+	return 0;
+}
+
 static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 			 unsigned src, unsigned len)
 {
@@ -570,6 +726,8 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 		}
 
 		tftp_next_ack = tftp_windowsize;
+		/* blocks after the first may arrive before it */
+		new_transfer();
 
 #ifdef CONFIG_CMD_TFTPPUT
 		if (tftp_put_active && tftp_state == STATE_OACK) {
@@ -586,29 +744,32 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 		len -= 2;
 
 		if (ntohs(*(__be16 *)pkt) != (ushort)(tftp_cur_block + 1)) {
+			ushort block = ntohs(*(__be16 *)pkt);
+			ushort ahead = block - (ushort)(tftp_cur_block + 1);
+
 			debug("Received unexpected block: %d, expected: %d\n",
-			      ntohs(*(__be16 *)pkt),
-			      (ushort)(tftp_cur_block + 1));
+			      block, (ushort)(tftp_cur_block + 1));
+			if ((tftp_state == STATE_DATA ||
+			     tftp_state == STATE_OACK) && !tftp_put_active &&
+			    ahead < min_t(int, tftp_windowsize, TFTP_AHEAD_MAX)) {
+				if (tftp_store_ahead(block, ahead, pkt + 2,
+						     len)) {
+					eth_halt();
+					net_set_state(NETLOOP_FAIL);
+				}
+				break;
+			}
 			/*
 			 * Only ACK if the block count received is greater than
 			 * the expected block count, otherwise skip ACK.
 			 * (required to properly handle the server retransmitting
 			 *  the window)
 			 */
-			if ((ushort)(tftp_cur_block + 1) - (short)(ntohs(*(__be16 *)pkt)) > 0)
+			if ((ushort)(tftp_cur_block + 1) - (short)(ntohs(*(__be16 *)pkt)) > 0) {
+				tftp_stats.dups++;
 				break;
-			/*
-			 * If one packet is dropped most likely
-			 * all other buffers in the window
-			 * that will arrive will cause a sending NACK.
-			 * This just overwellms the server, let's just send one.
-			 */
-			if (tftp_last_nack != tftp_cur_block) {
-				tftp_send();
-				tftp_last_nack = tftp_cur_block;
-				tftp_next_ack = (ushort)(tftp_cur_block +
-							 tftp_windowsize);
 			}
+			tftp_send_nack();
 			break;
 		}
 
@@ -626,13 +787,14 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 			tftp_state = STATE_DATA;
 			tftp_remote_port = src;
 			new_transfer();
+			tftp_stats.active = true;
 
 			if (tftp_cur_block != 1) {	/* Assertion */
 				puts("\nTFTP error: ");
 				printf("First block is not block 1 (%ld)\n",
 				       tftp_cur_block);
 				puts("Starting again\n\n");
-				net_start_again();
+				tftp_start_again();
 				break;
 			}
 		}
@@ -659,13 +821,31 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 			break;
 		}
 
+		/* move past any blocks which arrived early */
+		tftp_ahead_map >>= 1;
+		while (tftp_ahead_map & 1) {
+			tftp_ahead_map >>= 1;
+			tftp_prev_block = tftp_cur_block;
+			tftp_cur_block = (tftp_cur_block + 1) %
+					 TFTP_SEQUENCE_SIZE;
+			update_block_number();
+			if ((int)tftp_cur_block == tftp_ahead_last) {
+				tftp_send();
+				tftp_complete();
+				return;
+			}
+		}
+		tftp_prev_block = tftp_cur_block;
+
 		/*
 		 *	Acknowledge the block just received, which will prompt
 		 *	the remote for the next one.
 		 */
-		if (tftp_cur_block == tftp_next_ack) {
+		if ((short)((ushort)tftp_cur_block - tftp_next_ack) >= 0) {
 			tftp_send();
-			tftp_next_ack += tftp_windowsize;
+			tftp_stats.acks++;
+			tftp_next_ack = (ushort)(tftp_cur_block +
+						 tftp_windowsize);
 		}
 		break;
 
@@ -687,7 +867,7 @@ static void tftp_handler(uchar *pkt, unsigned dest, struct in_addr sip,
 		case TFTP_ERR_FILE_ALREADY_EXISTS:
 		default:
 			puts("Starting again\n\n");
-			net_start_again();
+			tftp_start_again();
 			break;
 		}
 		break;
@@ -700,6 +880,7 @@ static void tftp_timeout_handler(void)
 		restart("Retry count exceeded");
 	} else {
 		puts("T ");
+		tftp_stats.timeouts++;
 		net_set_timeout_handler(timeout_ms, tftp_timeout_handler);
 		if (tftp_state != STATE_RECV_WRQ)
 			tftp_send();
@@ -716,6 +897,7 @@ static int tftp_init_load_addr(void)
 	lmb_init_and_reserve(&lmb, gd->bd, (void *)gd->fdt_blob);
 
 	max_size = lmb_get_free_size(&lmb, image_load_addr);
+	lmb_uninit(&lmb);
 	if (!max_size)
 		return -1;
 
@@ -811,8 +993,20 @@ void tftp_start(enum proto_t protocol)
 
 	sanitize_tftp_block_size_option(protocol);
 
+	tftp_window_request = max(tftp_window_size_option, (ushort)1);
+	/* changing the window size option starts adapting again */
+	if (tftp_window_next_option != tftp_window_request) {
+		tftp_window_next_option = tftp_window_request;
+		tftp_window_next = 0;
+	}
+	if (IS_ENABLED(CONFIG_TFTP_WINDOWSIZE_ADAPTIVE) && tftp_window_next)
+		tftp_window_request = min(tftp_window_next,
+					  tftp_window_request);
+	/* this also forgets a transfer which ended without finishing */
+	memset(&tftp_stats, '\0', sizeof(tftp_stats));
+
 	debug("TFTP blocksize = %i, TFTP windowsize = %d timeout = %ld ms\n",
-	      tftp_block_size_option, tftp_window_size_option, timeout_ms);
+	      tftp_block_size_option, tftp_window_request, timeout_ms);
 
 	if (IS_ENABLED(CONFIG_IPV6))
 		tftp_remote_ip6 = net_server_ip6;
@@ -942,6 +1136,8 @@ void tftp_start(enum proto_t protocol)
 	tftp_cur_block = 0;
 	tftp_windowsize = 1;
 	tftp_last_nack = 0;
+	tftp_ahead_map = 0;
+	tftp_ahead_last = -1;
 	/* zero out server ether in case the server ip has changed */
 	memset(net_server_ethaddr, 0, 6);
 	/* Revert tftp_block_size to dflt */
@@ -982,6 +1178,11 @@ void tftp_start_server(void)
 	tftp_our_port = WELL_KNOWN_PORT;
 	tftp_windowsize = 1;
 	tftp_next_ack = tftp_windowsize;
+	tftp_ahead_map = 0;
+	tftp_ahead_last = -1;
+	/* the sender chooses the window */
+	tftp_window_request = 0;
+	memset(&tftp_stats, '\0', sizeof(tftp_stats));
 
 #ifdef CONFIG_TFTP_TSIZE
 	tftp_tsize = 0;
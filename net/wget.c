@@ -21,13 +21,11 @@ DECLARE_GLOBAL_DATA_PTR;
 /* The default, change with environment variable 'httpdstp' */
 #define SERVER_PORT		80
 
-static const char bootfile1[] = "GET ";
-static const char bootfile3[] = " HTTP/1.0\r\n\r\n";
 static const char http_eom[] = "\r\n\r\n";
-static const char http_ok[] = "200";
 static const char content_len[] = "Content-Length";
 static const char linefeed[] = "\r\n";
 static struct in_addr web_server_ip;
+static unsigned int server_port;
 static int our_port;
 static int wget_timeout_count;
 
@@ -66,6 +64,27 @@ static int retry_len;			/* TCP retry length */
 
 static ulong wget_load_size;
 
+/* Connection left open by the last transfer, for the next one to use */
+static struct {
+	bool open;
+	struct in_addr ip;
+	unsigned int port;
+	int our_port;
+} wget_conn;
+
+/* True if this transfer uses the connection left open by the last one */
+static bool wget_reused;
+/* True if the server leaves the connection open after this response */
+static bool wget_keepalive;
+/* Offset in the file of the first byte asked for */
+static ulong wget_offset;
+/* Number of times the connection has been opened again for this transfer */
+static int wget_reopens;
+/* True if the server accepts byte ranges, so the transfer can be resumed */
+static bool wget_can_resume;
+/* ETag or Last-Modified date of the file, to check it is the same on resuming */
+static char wget_validator[80];
+
 /**
  * wget_init_max_size() - initialize maximum load size
  *
@@ -79,6 +98,7 @@ static int wget_init_load_size(void)
 	lmb_init_and_reserve(&lmb, gd->bd, (void *)gd->fdt_blob);
 
 	max_size = lmb_get_free_size(&lmb, image_load_addr);
+	lmb_uninit(&lmb);
 	if (!max_size)
 		return -1;
 
@@ -137,10 +157,7 @@ static void wget_send_stored(void)
 	int len = retry_len;
 	unsigned int tcp_ack_num = retry_tcp_seq_num + (len == 0 ? 1 : len);
 	unsigned int tcp_seq_num = retry_tcp_ack_num;
-	unsigned int server_port;
-	uchar *ptr, *offset;
-
-	server_port = env_get_ulong("httpdstp", 10, SERVER_PORT) & 0xffff;
+	char *ptr, *offset;
 
 	switch (current_wget_state) {
 	case WGET_CLOSED:
@@ -152,21 +169,29 @@ static void wget_send_stored(void)
 		break;
 	case WGET_CONNECTING:
 		pkt_q_idx = 0;
-		net_send_tcp_packet(0, server_port, our_port, action,
-				    tcp_seq_num, tcp_ack_num);
-
-		ptr = net_tx_packet + net_eth_hdr_size() +
+		/* nowhere to store the response is known until its header */
+		tcp_set_rx_space(0, 0);
+		/* a connection left open has no SYN to acknowledge */
+		if (!wget_reused)
+			net_send_tcp_packet(0, server_port, our_port, action,
+					    tcp_seq_num, tcp_ack_num);
+
+		ptr = (char *)net_tx_packet + net_eth_hdr_size() +
 			IP_TCP_HDR_SIZE + TCP_TSOPT_SIZE + 2;
 		offset = ptr;
 
-		memcpy(offset, &bootfile1, strlen(bootfile1));
-		offset += strlen(bootfile1);
-
-		memcpy(offset, image_url, strlen(image_url));
-		offset += strlen(image_url);
-
-		memcpy(offset, &bootfile3, strlen(bootfile3));
-		offset += strlen(bootfile3);
+		offset += sprintf(offset, "GET %s HTTP/1.1\r\nHost: %pI4",
+				  image_url, &web_server_ip);
+		if (server_port != SERVER_PORT)
+			offset += sprintf(offset, ":%u", server_port);
+		offset += sprintf(offset, "\r\nConnection: %s\r\n",
+				  IS_ENABLED(CONFIG_WGET_KEEPALIVE) ?
+				  "keep-alive" : "close");
+		if (wget_offset)
+			offset += sprintf(offset,
+					  "Range: bytes=%lu-\r\nIf-Range: %s\r\n",
+					  wget_offset, wget_validator);
+		offset += sprintf(offset, "\r\n");
 		net_send_tcp_packet((offset - ptr), server_port, our_port,
 				    TCP_PUSH, tcp_seq_num, tcp_ack_num);
 		current_wget_state = WGET_CONNECTED;
@@ -206,12 +231,87 @@ void wget_success(u8 action, unsigned int tcp_seq_num,
 	wget_send(action, tcp_seq_num, tcp_ack_num, len);
 }
 
+#define RANDOM_PORT_START 1024
+#define RANDOM_PORT_RANGE 0x4000
+
+/**
+ * random_port() - make port a little random (1024-17407)
+ *
+ * Return: random port number from 1024 to 17407
+ *
+ * This keeps the math somewhat trivial to compute, and seems to work with
+ * all supported protocols/clients/servers
+ */
+static unsigned int random_port(void)
+{
+	return RANDOM_PORT_START + (get_timer(0) % RANDOM_PORT_RANGE);
+}
+
+/**
+ * wget_reopen() - open the connection again after it was dropped
+ *
+ * @reset: true to reset the old connection first
+ *
+ * A connection left open by the last transfer may be closed by the server
+ * before the request reaches it, so open a new one. If the connection drops
+ * part way through the file, ask for the rest of it with a Range request if
+ * the server accepts that, or else for the whole file again.
+ *
+ * Return: true if a new connection is being opened, false to give up
+ */
+static bool wget_reopen(bool reset)
+{
+	ulong received = 0;
+	unsigned int port;
+
+	if (current_wget_state == WGET_TRANSFERRING)
+		received = next_data_seq_num - initial_data_seq_num;
+	if (received) {
+		if (!IS_ENABLED(CONFIG_WGET_RESUME) ||
+		    wget_reopens++ >= WGET_REOPEN_COUNT)
+			return false;
+		if (wget_can_resume) {
+			wget_offset += received;
+			printf("\nwget: Connection dropped, resuming at %lu\n",
+			       wget_offset);
+		} else {
+			wget_offset = 0;
+			puts("\nwget: Connection dropped, starting again\n");
+		}
+	} else if (!wget_reused) {
+		return false;
+	}
+	debug_cond(DEBUG_WGET, "wget: Opening the connection again\n");
+
+	if (reset)
+		net_send_tcp_packet(0, server_port, our_port, TCP_RST,
+				    retry_tcp_ack_num, 0);
+	tcp_set_tcp_state(TCP_CLOSED);
+	wget_reused = false;
+	wget_timeout_count = 0;
+
+	/* make sure late packets for the old connection are not mixed in */
+	port = random_port();
+	our_port = port == our_port ? port + 1 : port;
+	current_wget_state = WGET_CLOSED;
+	net_set_state(NETLOOP_CONTINUE);
+	wget_send(TCP_SYN, 0, 0, 0);
+
+	return true;
+}
+
 /*
  * Interfaces of U-BOOT
  */
 static void wget_timeout_handler(void)
 {
 	if (++wget_timeout_count > WGET_RETRY_COUNT) {
+		if (current_wget_state == WGET_TRANSFERRING &&
+		    wget_reopen(true)) {
+			net_set_timeout_handler(wget_timeout,
+						wget_timeout_handler);
+			return;
+		}
 		puts("\nRetry count exceeded; starting again\n");
 		wget_send(TCP_RST, 0, 0, 0);
 		net_start_again();
@@ -227,12 +327,138 @@ static void wget_timeout_handler(void)
 #define PKT_QUEUE_OFFSET 0x20000
 #define PKT_QUEUE_PACKET_SIZE 0x800
 
+/**
+ * wget_header() - find a field in the response header
+ *
+ * @hdr: response header, ending after the line break of the last field
+ * @name: name of the field, which is not case-sensitive
+ *
+ * Return: the value of the field, or NULL if it is not present
+ */
+static char *wget_header(char *hdr, const char *name)
+{
+	int len = strlen(name);
+	char *line = hdr;
+
+	/* this skips the status line */
+	while ((line = strstr(line, linefeed))) {
+		line += 2;
+		if (!strncasecmp(line, name, len) && line[len] == ':') {
+			for (line += len + 1; *line == ' ' || *line == '\t';)
+				line++;
+			return line;
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * wget_parse_header() - check the response header
+ *
+ * @hdr: response header
+ * @hlen: length of the header, including the blank line at the end
+ *
+ * This sets up content_length, whether the connection is kept open and, for
+ * the whole file, how to resume the transfer if the connection drops
+ *
+ * Return: 0 if the response holds the file asked for, -EPROTONOSUPPORT if it
+ * cannot be received, other -ve value if the server gave an error
+ */
+static int wget_parse_header(char *hdr, int hlen)
+{
+	char *end = hdr + hlen - 2;
+	char saved = *end;
+	bool http11;
+	ulong status;
+	char *val;
+	int len, ret;
+
+	*end = '\0';
+	http11 = !strncmp(hdr, "HTTP/1.1 ", 9);
+	val = strchr(hdr, ' ');
+	status = val ? simple_strtoul(val + 1, NULL, 10) : 0;
+
+	val = wget_header(hdr, content_len);
+	content_length = val ? simple_strtoul(val, NULL, 10) : -1;
+	debug_cond(DEBUG_WGET, "wget: Status %lu, len %lu\n", status,
+		   content_length);
+
+	/* without a length, the server must close the connection to finish */
+	val = wget_header(hdr, "Connection");
+	if (http11)
+		wget_keepalive = !val || strncasecmp(val, "close", 5);
+	else
+		wget_keepalive = val && !strncasecmp(val, "keep-alive", 10);
+	if (!IS_ENABLED(CONFIG_WGET_KEEPALIVE) || content_length == -1)
+		wget_keepalive = false;
+
+	val = wget_header(hdr, "Transfer-Encoding");
+	if (val && strncasecmp(val, "identity", 8)) {
+		puts("wget: Transfer encoding not supported\n");
+		ret = -EPROTONOSUPPORT;
+	} else if (status == 206 && wget_offset) {
+		val = wget_header(hdr, "Content-Range");
+		ret = val && !strncasecmp(val, "bytes ", 6) &&
+			simple_strtoul(val + 6, NULL, 10) == wget_offset ?
+			0 : -EINVAL;
+	} else if (status == 200) {
+		/* the whole file, perhaps because it changed since last time */
+		wget_offset = 0;
+		ret = 0;
+	} else {
+		ret = -EINVAL;
+	}
+
+	if (IS_ENABLED(CONFIG_WGET_RESUME) && !ret && !wget_offset) {
+		val = wget_header(hdr, "Accept-Ranges");
+		wget_can_resume = val && !strncasecmp(val, "bytes", 5);
+
+		/* a weak ETag cannot be used to resume */
+		val = wget_header(hdr, "ETag");
+		if (!val || !strncmp(val, "W/", 2))
+			val = wget_header(hdr, "Last-Modified");
+		len = val ? strcspn(val, linefeed) : 0;
+		if (!len || len >= sizeof(wget_validator))
+			wget_can_resume = false;
+		else
+			strlcpy(wget_validator, val, len + 1);
+	}
+	*end = saved;
+
+	return ret;
+}
+
+/* Check whether all the file has arrived, on a connection left open */
+static bool wget_complete(void)
+{
+	return wget_keepalive &&
+		next_data_seq_num - initial_data_seq_num >= content_length;
+}
+
+/*
+ * The response is complete and the server is leaving the connection open,
+ * so keep it for the next transfer
+ */
+static void wget_finish(void)
+{
+	wget_conn.open = true;
+	wget_conn.ip = web_server_ip;
+	wget_conn.port = server_port;
+	wget_conn.our_port = our_port;
+	current_wget_state = WGET_TRANSFERRED;
+	puts("\n");
+	if (wget_loop_state == NETLOOP_SUCCESS)
+		printf("Packets received %d, Transfer Successful\n", packets);
+	net_set_state(wget_loop_state);
+}
+
 static void wget_connected(uchar *pkt, unsigned int tcp_seq_num,
 			   u8 action, unsigned int tcp_ack_num, unsigned int len)
 {
 	uchar *pkt_in_q;
 	char *pos;
-	int hlen, i;
+	int hlen, i, err;
 	uchar *ptr1;
 
 	pkt[len] = '\0';
@@ -241,10 +467,10 @@ static void wget_connected(uchar *pkt, unsigned int tcp_seq_num,
 	if (!pos) {
 		debug_cond(DEBUG_WGET,
 			   "wget: Connected, data before Header %p\n", pkt);
-		pkt_in_q = (void *)image_load_addr + PKT_QUEUE_OFFSET +
-			(pkt_q_idx * PKT_QUEUE_PACKET_SIZE);
+		pkt_in_q = (void *)image_load_addr + wget_offset +
+			PKT_QUEUE_OFFSET + (pkt_q_idx * PKT_QUEUE_PACKET_SIZE);
 
-		ptr1 = map_sysmem((phys_addr_t)pkt_in_q, len);
+		ptr1 = map_sysmem((uintptr_t)pkt_in_q, len);
 		memcpy(ptr1, pkt, len);
 		unmap_sysmem(ptr1);
 
@@ -275,7 +501,13 @@ static void wget_connected(uchar *pkt, unsigned int tcp_seq_num,
 		initial_data_seq_num = tcp_seq_num + hlen;
 		next_data_seq_num    = tcp_seq_num + len;
 
-		if (strstr((char *)pkt, http_ok) == 0) {
+		err = wget_parse_header((char *)pkt, hlen);
+		if (err == -EPROTONOSUPPORT) {
+			wget_fail("wget: cannot receive file\n", tcp_seq_num,
+				  tcp_ack_num, TCP_RST);
+			net_set_state(NETLOOP_FAIL);
+			return;
+		} else if (err) {
 			debug_cond(DEBUG_WGET,
 				   "wget: Connected Bad Xfer\n");
 			wget_loop_state = NETLOOP_FAIL;
@@ -285,21 +517,15 @@ static void wget_connected(uchar *pkt, unsigned int tcp_seq_num,
 				   "wget: Connctd pkt %p  hlen %x\n",
 				   pkt, hlen);
 
-			pos = strstr((char *)pkt, content_len);
-			if (!pos) {
-				content_length = -1;
-			} else {
-				pos += sizeof(content_len) + 2;
-				strict_strtoul(pos, 10, &content_length);
-				debug_cond(DEBUG_WGET,
-					   "wget: Connected Len %lu\n",
-					   content_length);
-			}
-
-			net_boot_file_size = 0;
+			net_boot_file_size = wget_offset;
+			wget_loop_state = NETLOOP_SUCCESS;
+			if (IS_ENABLED(CONFIG_LMB))
+				tcp_set_rx_space(initial_data_seq_num,
+						 wget_load_size - wget_offset);
 
 			if (len > hlen) {
-				if (store_block(pkt + hlen, 0, len - hlen) != 0) {
+				if (store_block(pkt + hlen, wget_offset,
+						len - hlen) != 0) {
 					wget_loop_state = NETLOOP_FAIL;
 					wget_fail("wget: store error\n", tcp_seq_num, tcp_ack_num, action);
 					net_set_state(NETLOOP_FAIL);
@@ -312,12 +538,10 @@ static void wget_connected(uchar *pkt, unsigned int tcp_seq_num,
 				   pkt, hlen);
 
 			for (i = 0; i < pkt_q_idx; i++) {
-				int err;
-
 				ptr1 = map_sysmem(
-					(phys_addr_t)(pkt_q[i].pkt),
+					(uintptr_t)pkt_q[i].pkt,
 					pkt_q[i].len);
-				err = store_block(ptr1,
+				err = store_block(ptr1, wget_offset +
 					  pkt_q[i].tcp_seq_num -
 					  initial_data_seq_num,
 					  pkt_q[i].len);
@@ -335,6 +559,22 @@ static void wget_connected(uchar *pkt, unsigned int tcp_seq_num,
 		}
 	}
 	wget_send(action, tcp_seq_num, tcp_ack_num, len);
+	if (current_wget_state == WGET_TRANSFERRING && wget_complete())
+		wget_finish();
+}
+
+/* Handle a packet on the connection left open, which is not in use */
+static void wget_idle(u8 action, u32 tcp_seq_num, u32 tcp_ack_num)
+{
+	if (!wget_conn.open || !(action & (TCP_FIN | TCP_RST)))
+		return;
+
+	debug_cond(DEBUG_WGET, "wget: Server closed the open connection\n");
+	wget_conn.open = false;
+	current_wget_state = WGET_CLOSED;
+	if (action & TCP_FIN)
+		net_send_tcp_packet(0, wget_conn.port, wget_conn.our_port,
+				    action, tcp_ack_num, tcp_seq_num + 1);
 }
 
 /**
@@ -358,9 +598,24 @@ static void wget_handler(uchar *pkt, u16 dport,
 {
 	enum tcp_state wget_tcp_state = tcp_get_tcp_state();
 
+	/* this may arrive while another protocol is running */
+	if (current_wget_state == WGET_CLOSED ||
+	    (current_wget_state == WGET_TRANSFERRED && wget_conn.open)) {
+		wget_idle(action, tcp_seq_num, tcp_ack_num);
+		return;
+	}
+
 	net_set_timeout_handler(wget_timeout, wget_timeout_handler);
 	packets++;
 
+	if (action == TCP_RST) {
+		if (current_wget_state == WGET_TRANSFERRED)
+			net_set_state(wget_loop_state);
+		else if (!wget_reopen(false))
+			puts("\nwget: Connection reset by server\n");
+		return;
+	}
+
 	switch (current_wget_state) {
 	case WGET_CLOSED:
 		debug_cond(DEBUG_WGET, "wget: Handler: Error!, State wrong\n");
@@ -386,6 +641,9 @@ static void wget_handler(uchar *pkt, u16 dport,
 		debug_cond(DEBUG_WGET, "wget: Connected seq=%u, len=%x\n",
 			   tcp_seq_num, len);
 		if (!len) {
+			/* the server closed the connection left open */
+			if ((action & TCP_FIN) && wget_reopen(true))
+				break;
 			wget_fail("Image not found, no data returned\n",
 				  tcp_seq_num, tcp_ack_num, action);
 		} else {
@@ -399,11 +657,17 @@ static void wget_handler(uchar *pkt, u16 dport,
 
 		if (next_data_seq_num != tcp_seq_num) {
 			debug_cond(DEBUG_WGET, "wget: seq=%x packet was lost\n", next_data_seq_num);
+			/* a duplicate ACK gets it sent again without a timeout */
+			if (wget_tcp_state == TCP_ESTABLISHED)
+				net_send_tcp_packet(0, server_port, our_port,
+						    TCP_ACK, tcp_ack_num,
+						    next_data_seq_num);
 			return;
 		}
 		next_data_seq_num = tcp_seq_num + len;
 
-		if (store_block(pkt, tcp_seq_num - initial_data_seq_num, len) != 0) {
+		if (store_block(pkt, wget_offset + tcp_seq_num -
+				initial_data_seq_num, len) != 0) {
 			wget_fail("wget: store error\n",
 				  tcp_seq_num, tcp_ack_num, action);
 			net_set_state(NETLOOP_FAIL);
@@ -424,9 +688,14 @@ static void wget_handler(uchar *pkt, u16 dport,
 		case TCP_ESTABLISHED:
 			wget_send(TCP_ACK, tcp_seq_num, tcp_ack_num,
 				  len);
-			wget_loop_state = NETLOOP_SUCCESS;
+			if (wget_complete())
+				wget_finish();
 			break;
 		case TCP_CLOSE_WAIT:     /* End of transfer */
+			if (content_length != -1 &&
+			    next_data_seq_num - initial_data_seq_num <
+			    content_length && wget_reopen(true))
+				break;
 			current_wget_state = WGET_TRANSFERRED;
 			wget_send(action | TCP_ACK | TCP_FIN,
 				  tcp_seq_num, tcp_ack_num, len);
@@ -440,26 +709,11 @@ static void wget_handler(uchar *pkt, u16 dport,
 	}
 }
 
-#define RANDOM_PORT_START 1024
-#define RANDOM_PORT_RANGE 0x4000
-
-/**
- * random_port() - make port a little random (1024-17407)
- *
- * Return: random port number from 1024 to 17407
- *
- * This keeps the math somewhat trivial to compute, and seems to work with
- * all supported protocols/clients/servers
- */
-static unsigned int random_port(void)
-{
-	return RANDOM_PORT_START + (get_timer(0) % RANDOM_PORT_RANGE);
-}
-
 #define BLOCKSIZE 512
 
 void wget_start(void)
 {
+	server_port = env_get_ulong("httpdstp", 10, SERVER_PORT) & 0xffff;
 	image_url = strchr(net_boot_file_name, ':');
 	if (image_url > 0) {
 		web_server_ip = string_to_ip(net_boot_file_name);
@@ -508,11 +762,14 @@ void wget_start(void)
 
 	net_set_timeout_handler(wget_timeout, wget_timeout_handler);
 	tcp_set_tcp_handler(wget_handler);
+	/* this only receives, so one ACK can cover several segments */
+	tcp_set_delay_ack(true);
 
 	wget_timeout_count = 0;
-	current_wget_state = WGET_CLOSED;
-
-	our_port = random_port();
+	wget_offset = 0;
+	wget_reopens = 0;
+	wget_can_resume = false;
+	packets = 0;
 
 	/*
 	 * Zero out server ether to force arp resolution in case
@@ -522,6 +779,25 @@ void wget_start(void)
 
 	memset(net_server_ethaddr, 0, 6);
 
+	if (IS_ENABLED(CONFIG_WGET_KEEPALIVE) && wget_conn.open &&
+	    tcp_get_tcp_state() == TCP_ESTABLISHED &&
+	    wget_conn.ip.s_addr == web_server_ip.s_addr &&
+	    wget_conn.port == server_port) {
+		debug_cond(DEBUG_WGET, "wget: Using the open connection\n");
+		wget_conn.open = false;
+		wget_reused = true;
+		our_port = wget_conn.our_port;
+		current_wget_state = WGET_CONNECTING;
+		wget_send_stored();
+		return;
+	}
+
+	wget_conn.open = false;
+	wget_reused = false;
+	current_wget_state = WGET_CLOSED;
+
+	our_port = random_port();
+
 	wget_send(TCP_SYN, 0, 0, 0);
 }
 
@@ -6,6 +6,7 @@
  */
 
 #include <bootm.h>
+#include <image.h>
 #include <asm/global_data.h>
 #include <test/suites.h>
 #include <test/test.h>
@@ -238,6 +239,77 @@ static int bootm_test_subst_both(struct unit_test_state *uts)
 }
 BOOTM_TEST(bootm_test_subst_both, 0);
 
+#if CONFIG_IS_ENABLED(FIT)
+/* Add a hash node with the correct value for @data */
+static int add_hash_node(void *fit, const char *name, const char *algo,
+			 const void *data, int size)
+{
+	u8 value[FIT_MAX_HASH_LEN];
+	int value_len;
+
+	if (calculate_hash(data, size, algo, value, &value_len))
+		return -EINVAL;
+	if (fdt_begin_node(fit, name) ||
+	    fdt_property_string(fit, FIT_ALGO_PROP, algo) ||
+	    fdt_property(fit, FIT_VALUE_PROP, value, value_len) ||
+	    fdt_end_node(fit))
+		return -ENOSPC;
+
+	return 0;
+}
+
+/* Test working out the hashes of an image a piece at a time */
+static int bootm_test_hash_stream(struct unit_test_state *uts)
+{
+	struct fit_hash_stream hs;
+	char fit[BUF_SIZE];
+	u8 data[1000];
+	int node, i;
+
+	for (i = 0; i < sizeof(data); i++)
+		data[i] = i * 7;
+
+	ut_assertok(fdt_create(fit, sizeof(fit)));
+	ut_assertok(fdt_finish_reservemap(fit));
+	ut_assertok(fdt_begin_node(fit, ""));
+	ut_assertok(fdt_begin_node(fit, FIT_IMAGES_PATH + 1));
+	ut_assertok(fdt_begin_node(fit, "kernel"));
+	ut_assertok(add_hash_node(fit, "hash-1", "sha256", data,
+				  sizeof(data)));
+	ut_assertok(add_hash_node(fit, "hash-2", "crc32", data,
+				  sizeof(data)));
+	ut_assertok(fdt_end_node(fit));
+	ut_assertok(fdt_end_node(fit));
+	ut_assertok(fdt_end_node(fit));
+	ut_assertok(fdt_finish(fit));
+	node = fdt_path_offset(fit, FIT_IMAGES_PATH "/kernel");
+	ut_assert(node > 0);
+
+	ut_asserteq(1, fit_image_verify_with_data(fit, node, gd_fdt_blob(),
+						  data, sizeof(data)));
+
+	/* both hashes are worked out in the same pass, in odd-sized pieces */
+	ut_assertok(fit_image_hash_stream_start(&hs, fit, node));
+	ut_asserteq(2, hs.count);
+	for (i = 0; i < sizeof(data); i += 33)
+		fit_image_hash_stream_update(&hs, data + i,
+					     min_t(int, 33, sizeof(data) - i));
+	ut_asserteq(1, fit_image_verify_stream(fit, node, gd_fdt_blob(), data,
+					       sizeof(data), &hs));
+
+	/* what was streamed is checked, not what ended up in the buffer */
+	ut_assertok(fit_image_hash_stream_start(&hs, fit, node));
+	data[500]++;
+	fit_image_hash_stream_update(&hs, data, sizeof(data));
+	data[500]--;
+	ut_asserteq(0, fit_image_verify_stream(fit, node, gd_fdt_blob(), data,
+					       sizeof(data), &hs));
+
+	return 0;
+}
+BOOTM_TEST(bootm_test_hash_stream, 0);
+#endif
+
 int do_ut_bootm(struct cmd_tbl *cmdtp, int flag, int argc, char *const argv[])
 {
 	struct unit_test *tests = UNIT_TEST_SUITE_START(bootm_test);
@@ -0,0 +1,258 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for TFTP windows, using a fake server behind the sandbox Ethernet
+ * device
+ */
+
+#include <command.h>
+#include <dm.h>
+#include <env.h>
+#include <mapmem.h>
+#include <net.h>
+#include <asm/eth.h>
+#include <asm/unaligned.h>
+#include <test/lib.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+#define TFTP_TEST_PORT		1069
+#define TFTP_TEST_BLKSIZE	512
+#define TFTP_TEST_BLOCKS	42
+#define TFTP_TEST_SIZE		(TFTP_TEST_BLKSIZE * (TFTP_TEST_BLOCKS - 1) + 100)
+/* Blocks sent for each ack, leaving room in the sandbox receive queue */
+#define TFTP_TEST_WINDOW	(PKTBUFSRX - 1)
+#define TFTP_TEST_ADDR		0x20000
+
+/**
+ * struct tftp_test_server - the fake TFTP server
+ *
+ * @data: File to send
+ * @asked_window: Window size asked for in the last request, 1 if none
+ * @window: Window size agreed
+ * @window_end: Last block of the window being sent
+ * @client_port: UDP port used by U-Boot
+ * @reorder: Send the first two blocks of each window the wrong way round
+ * @drop: Drop each block whose number is a multiple of this, the first time
+ *	it is sent, or 0 to drop none
+ * @dropped: Blocks which have been dropped
+ * @nacks: Number of acks which did not follow the end of a window
+ */
+struct tftp_test_server {
+	u8 data[TFTP_TEST_SIZE];
+	int asked_window;
+	int window;
+	int window_end;
+	int client_port;
+	bool reorder;
+	int drop;
+	bool dropped[TFTP_TEST_BLOCKS + 1];
+	int nacks;
+};
+
+static struct tftp_test_server tftp_server;
+
+static void tftp_test_reply(struct udevice *dev, void *packet,
+			    const void *buf, int len)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	struct ethernet_hdr *eth = packet;
+	struct ip_udp_hdr *ip = packet + ETHER_HDR_SIZE;
+	struct ethernet_hdr *eth_send;
+	struct ip_udp_hdr *ip_send;
+
+	/* Don't allow the buffer to overrun */
+	if (priv->recv_packets >= PKTBUFSRX)
+		return;
+
+	eth_send = (void *)priv->recv_packet_buffer[priv->recv_packets];
+	memcpy(eth_send->et_dest, eth->et_src, ARP_HLEN);
+	memcpy(eth_send->et_src, priv->fake_host_hwaddr, ARP_HLEN);
+	eth_send->et_protlen = htons(PROT_IP);
+	ip_send = (void *)eth_send + ETHER_HDR_SIZE;
+	memcpy(ip_send + 1, buf, len);
+	net_set_ip_header((uchar *)ip_send, ip->ip_src, ip->ip_dst,
+			  IP_UDP_HDR_SIZE + len, IPPROTO_UDP);
+	ip_send->udp_src = htons(TFTP_TEST_PORT);
+	ip_send->udp_dst = htons(tftp_server.client_port);
+	ip_send->udp_len = htons(UDP_HDR_SIZE + len);
+	ip_send->udp_xsum = 0;
+
+	priv->recv_packet_length[priv->recv_packets] =
+		ETHER_HDR_SIZE + IP_UDP_HDR_SIZE + len;
+	++priv->recv_packets;
+}
+
+/*
+ * Forget blocks up to @block which are still waiting to be received, since
+ * U-Boot has them already. This stands in for a network dropping duplicates,
+ * so that resending a window does not overflow the small receive queue.
+ */
+static void tftp_test_purge(struct udevice *dev, int block)
+{
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	int i, j;
+
+	/* the first packet is the one being handled, so leave it */
+	for (i = 1, j = 1; i < priv->recv_packets; i++) {
+		uchar *pkt = priv->recv_packet_buffer[i];
+		uchar *msg = pkt + ETHER_HDR_SIZE + IP_UDP_HDR_SIZE;
+
+		if (get_unaligned_be16(msg) == 3 &&
+		    get_unaligned_be16(msg + 2) <= block)
+			continue;
+		if (i != j) {
+			memcpy(priv->recv_packet_buffer[j], pkt,
+			       priv->recv_packet_length[i]);
+			priv->recv_packet_length[j] =
+				priv->recv_packet_length[i];
+		}
+		j++;
+	}
+	priv->recv_packets = j;
+}
+
+static void tftp_test_send_block(struct udevice *dev, void *packet, int block)
+{
+	struct tftp_test_server *srv = &tftp_server;
+	int ofs = (block - 1) * TFTP_TEST_BLKSIZE;
+	u8 buf[4 + TFTP_TEST_BLKSIZE];
+	int len;
+
+	if (srv->drop && !(block % srv->drop) && !srv->dropped[block]) {
+		srv->dropped[block] = true;
+		return;
+	}
+	len = min(TFTP_TEST_SIZE - ofs, TFTP_TEST_BLKSIZE);
+	put_unaligned_be16(3, buf);	/* DATA */
+	put_unaligned_be16(block, buf + 2);
+	memcpy(buf + 4, srv->data + ofs, len);
+	tftp_test_reply(dev, packet, buf, 4 + len);
+}
+
+static int tftp_test_handler(struct udevice *dev, void *packet,
+			     unsigned int len)
+{
+	struct tftp_test_server *srv = &tftp_server;
+	struct ethernet_hdr *eth = packet;
+	struct ip_udp_hdr *ip = packet + ETHER_HDR_SIZE;
+	char *msg = (char *)(ip + 1), *end = (char *)packet + len;
+	int block, last, i;
+	char oack[40];
+
+	if (ntohs(eth->et_protlen) == PROT_ARP)
+		return sandbox_eth_arp_req_to_reply(dev, packet, len);
+	if (ntohs(eth->et_protlen) != PROT_IP || ip->ip_p != IPPROTO_UDP)
+		return 0;
+
+	switch (get_unaligned_be16(msg)) {
+	case 1: /* RRQ: skip the filename and mode, then look for a window */
+		srv->client_port = ntohs(ip->udp_src);
+		srv->asked_window = 1;
+		msg += 2;
+		for (i = 0; msg < end && *msg; i++, msg += strlen(msg) + 1) {
+			if (i >= 2 && !(i & 1) && !strcmp(msg, "windowsize"))
+				srv->asked_window = dectoul(msg + 11, NULL);
+		}
+		srv->window = min(srv->asked_window, TFTP_TEST_WINDOW);
+		srv->window_end = 0;
+		len = 2 + sprintf(oack + 2, "blksize%c%d%cwindowsize%c%d", 0,
+				  TFTP_TEST_BLKSIZE, 0, 0, srv->window) + 1;
+		put_unaligned_be16(6, oack);	/* OACK */
+		tftp_test_reply(dev, packet, oack, len);
+		break;
+	case 4: /* ACK: send the next window */
+		block = get_unaligned_be16(msg + 2);
+		if (block != srv->window_end)
+			srv->nacks++;
+		tftp_test_purge(dev, block);
+		last = min(block + srv->window, TFTP_TEST_BLOCKS);
+		srv->window_end = last;
+		if (srv->reorder && block + 2 < last) {
+			tftp_test_send_block(dev, packet, block + 2);
+			tftp_test_send_block(dev, packet, block + 1);
+			block += 2;
+		}
+		while (block < last)
+			tftp_test_send_block(dev, packet, ++block);
+		break;
+	}
+
+	return 0;
+}
+
+/* Fetch the file and check it arrived intact */
+static int tftp_test_get(struct unit_test_state *uts, bool reorder, int drop)
+{
+	struct tftp_test_server *srv = &tftp_server;
+	void *buf = map_sysmem(TFTP_TEST_ADDR, TFTP_TEST_SIZE);
+
+	srv->reorder = reorder;
+	srv->drop = drop;
+	memset(srv->dropped, '\0', sizeof(srv->dropped));
+	srv->nacks = 0;
+	memset(buf, '\0', TFTP_TEST_SIZE);
+
+	ut_assertok(run_commandf("tftpboot %x 1.1.2.2:file.bin",
+				 TFTP_TEST_ADDR));
+	ut_asserteq(TFTP_TEST_SIZE, env_get_hex("filesize", 0));
+	ut_asserteq_mem(srv->data, buf, TFTP_TEST_SIZE);
+	unmap_sysmem(buf);
+
+	return 0;
+}
+
+static int tftp_test_window(struct unit_test_state *uts)
+{
+	struct tftp_test_server *srv = &tftp_server;
+	int i;
+
+	for (i = 0; i < TFTP_TEST_SIZE; i++)
+		srv->data[i] = i * 7 + (i >> 8);
+
+	/* changing the window size starts adapting again */
+	env_set("tftpwindowsize", "1");
+	ut_assertok(tftp_test_get(uts, false, 0));
+	ut_asserteq(1, srv->asked_window);
+	env_set("tftpwindowsize", simple_itoa(TFTP_TEST_WINDOW));
+
+	/* blocks which arrive out of order do not need to be sent again */
+	ut_assertok(tftp_test_get(uts, true, 0));
+	ut_asserteq(TFTP_TEST_WINDOW, srv->asked_window);
+	ut_asserteq(0, srv->nacks);
+
+	/* a lost block is asked for again, without losing the ones after */
+	ut_assertok(tftp_test_get(uts, false, 4));
+	ut_asserteq(TFTP_TEST_WINDOW, srv->asked_window);
+	ut_asserteq(TFTP_TEST_BLOCKS / 4, srv->nacks);
+
+	/* after losing that many, the window halves, then doubles again */
+	ut_assertok(tftp_test_get(uts, false, 0));
+	ut_asserteq(TFTP_TEST_WINDOW / 2, srv->asked_window);
+	for (i = TFTP_TEST_WINDOW / 2; i < TFTP_TEST_WINDOW; i *= 2) {
+		ut_assertok(tftp_test_get(uts, false, 0));
+		ut_asserteq(min(i * 2, TFTP_TEST_WINDOW), srv->asked_window);
+	}
+	ut_asserteq(0, srv->nacks);
+
+	return 0;
+}
+
+static int net_test_tftp_window(struct unit_test_state *uts)
+{
+	int ret;
+
+	sandbox_eth_set_tx_handler(0, tftp_test_handler);
+	env_set("ethact", "eth@10002000");
+	env_set("ethrotate", "no");
+	env_set("tftpblocksize", simple_itoa(TFTP_TEST_BLKSIZE));
+
+	/* put things back even if a check fails, so later tests are not upset */
+	ret = tftp_test_window(uts);
+
+	sandbox_eth_set_tx_handler(0, NULL);
+	env_set("tftpwindowsize", NULL);
+	env_set("tftpblocksize", NULL);
+
+	return ret;
+}
+LIB_TEST(net_test_tftp_window, 0);
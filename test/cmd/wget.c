@@ -12,6 +12,7 @@
 #include <fdtdec.h>
 #include <log.h>
 #include <malloc.h>
+#include <mapmem.h>
 #include <net.h>
 #include <net/tcp.h>
 #include <net/wget.h>
@@ -203,3 +204,320 @@ static int net_test_wget(struct unit_test_state *uts)
 }
 
 LIB_TEST(net_test_wget, 0);
+
+#define HTTP_TEST_PORT		8080
+#define HTTP_TEST_SIZE		10000
+#define HTTP_TEST_SEGMENT	1024
+#define HTTP_TEST_ADDR		0x20000
+#define HTTP_TEST_DATE		"Tue, 01 Oct 2024 12:00:00 GMT"
+
+/**
+ * struct http_test_server - a fake HTTP/1.1 server which keeps connections
+ * open and accepts byte ranges
+ *
+ * It sends @burst segments each time U-Boot acknowledges everything sent so
+ * far, so that the sandbox receive queue never overflows.
+ *
+ * @data: File to send
+ * @syns: Number of connections opened
+ * @requests: Number of requests received
+ * @range_start: Start of the range asked for in the last request, or -1
+ * @reset_at: Reset the connection after sending this much of the file, or 0
+ * @reset_idle: Reset the connection when the next request arrives, as if it
+ *	had been closed while idle
+ * @port: Client port of the open connection, or 0 if none
+ * @seq: Sequence number of the next byte to send
+ * @client_seq: Sequence number of the next byte expected from U-Boot
+ * @sent: Offset in the file of the next byte to send
+ * @burst: Number of segments to send for each acknowledgement, 1 if 0
+ * @scale: Offer to scale windows in the SYN-ACK
+ * @syn_win: Window in U-Boot's last SYN
+ * @syn_scale: Window scale offered in U-Boot's last SYN, or -1 if none
+ * @win: Window in U-Boot's last acknowledgement
+ * @acks: Number of acknowledgements for the file
+ */
+struct http_test_server {
+	u8 data[HTTP_TEST_SIZE];
+	int syns;
+	int requests;
+	int range_start;
+	int reset_at;
+	bool reset_idle;
+	u16 port;
+	u32 seq;
+	u32 client_seq;
+	int sent;
+	int burst;
+	bool scale;
+	int syn_win;
+	int syn_scale;
+	int win;
+	int acks;
+};
+
+static struct http_test_server http_server;
+
+static void http_test_send(struct udevice *dev, void *packet, u8 flags,
+			   const void *buf, int len)
+{
+	struct http_test_server *srv = &http_server;
+	struct eth_sandbox_priv *priv = dev_get_priv(dev);
+	struct ethernet_hdr *eth = packet;
+	struct ip_tcp_hdr *tcp = packet + ETHER_HDR_SIZE;
+	struct ethernet_hdr *eth_send;
+	struct ip_tcp_hdr *tcp_send;
+	u8 opts[] = { TCP_1_NOP, TCP_O_SCL, TCP_OPT_LEN_3, TCP_SCALE };
+	int opt_len = (flags & TCP_SYN) && srv->scale ? sizeof(opts) : 0;
+	int pkt_len = IP_TCP_HDR_SIZE + opt_len + len;
+
+	/* Don't allow the buffer to overrun */
+	if (priv->recv_packets >= PKTBUFSRX)
+		return;
+
+	eth_send = (void *)priv->recv_packet_buffer[priv->recv_packets];
+	memcpy(eth_send->et_dest, eth->et_src, ARP_HLEN);
+	memcpy(eth_send->et_src, priv->fake_host_hwaddr, ARP_HLEN);
+	eth_send->et_protlen = htons(PROT_IP);
+	tcp_send = (void *)eth_send + ETHER_HDR_SIZE;
+	memcpy((void *)tcp_send + IP_TCP_HDR_SIZE, opts, opt_len);
+	memcpy((void *)tcp_send + IP_TCP_HDR_SIZE + opt_len, buf, len);
+	tcp_send->tcp_src = tcp->tcp_dst;
+	tcp_send->tcp_dst = tcp->tcp_src;
+	tcp_send->tcp_seq = htonl(srv->seq);
+	tcp_send->tcp_ack = htonl(srv->client_seq);
+	tcp_send->tcp_hlen = SHIFT_TO_TCPHDRLEN_FIELD(LEN_B_TO_DW(TCP_HDR_SIZE +
+								  opt_len));
+	tcp_send->tcp_flags = flags;
+	tcp_send->tcp_win = htons(PKTBUFSRX * TCP_MSS >> TCP_SCALE);
+	tcp_send->tcp_xsum = 0;
+	tcp_send->tcp_ugr = 0;
+	tcp_send->tcp_xsum = tcp_set_pseudo_header((uchar *)tcp_send,
+						   tcp->ip_src, tcp->ip_dst,
+						   pkt_len - IP_HDR_SIZE,
+						   pkt_len);
+	net_set_ip_header((uchar *)tcp_send, tcp->ip_src, tcp->ip_dst,
+			  pkt_len, IPPROTO_TCP);
+	srv->seq += len + (flags & TCP_SYN ? 1 : 0);
+
+	priv->recv_packet_length[priv->recv_packets] = ETHER_HDR_SIZE + pkt_len;
+	++priv->recv_packets;
+}
+
+/* Answer a GET request, starting at the range asked for if it is still valid */
+static void http_test_request(struct udevice *dev, void *packet, char *req)
+{
+	struct http_test_server *srv = &http_server;
+	char hdr[256], *range, *if_range;
+	int len;
+
+	srv->requests++;
+	range = strstr(req, "\r\nRange: bytes=");
+	if_range = strstr(req, "\r\nIf-Range: " HTTP_TEST_DATE "\r\n");
+	srv->range_start = range ? dectoul(range + 15, NULL) : -1;
+	if (range && if_range) {
+		srv->sent = srv->range_start;
+		len = sprintf(hdr, "HTTP/1.1 206 Partial Content\r\n"
+			      "Content-Range: bytes %d-%d/%d\r\n",
+			      srv->sent, HTTP_TEST_SIZE - 1, HTTP_TEST_SIZE);
+	} else {
+		srv->sent = 0;
+		len = sprintf(hdr, "HTTP/1.1 200 OK\r\n");
+	}
+	len += sprintf(hdr + len, "Content-Length: %d\r\n"
+		       "Accept-Ranges: bytes\r\n"
+		       "Last-Modified: " HTTP_TEST_DATE "\r\n\r\n",
+		       HTTP_TEST_SIZE - srv->sent);
+	http_test_send(dev, packet, TCP_ACK | TCP_PUSH, hdr, len);
+}
+
+static int http_test_handler(struct udevice *dev, void *packet,
+			     unsigned int len)
+{
+	struct http_test_server *srv = &http_server;
+	struct ethernet_hdr *eth = packet;
+	struct ip_tcp_hdr *tcp = packet + ETHER_HDR_SIZE;
+	u8 *opt = (u8 *)(tcp + 1);
+	char *payload;
+	int payload_len, i;
+
+	if (ntohs(eth->et_protlen) == PROT_ARP)
+		return sandbox_eth_arp_req_to_reply(dev, packet, len);
+	if (ntohs(eth->et_protlen) != PROT_IP || tcp->ip_p != IPPROTO_TCP ||
+	    ntohs(tcp->tcp_dst) != HTTP_TEST_PORT)
+		return 0;
+	payload = (void *)tcp + IP_HDR_SIZE + (tcp->tcp_hlen >> 4) * 4;
+	payload_len = (char *)tcp + ntohs(tcp->ip_len) - payload;
+
+	if (tcp->tcp_flags == TCP_SYN) {
+		srv->syn_win = ntohs(tcp->tcp_win);
+		srv->syn_scale = -1;
+		while (opt < (u8 *)payload && *opt != TCP_O_END) {
+			if (*opt == TCP_1_NOP) {
+				opt++;
+				continue;
+			}
+			if (*opt == TCP_O_SCL)
+				srv->syn_scale = opt[2];
+			opt += opt[1];
+		}
+		srv->syns++;
+		srv->port = ntohs(tcp->tcp_src);
+		srv->seq = srv->syns * 100000;
+		srv->client_seq = ntohl(tcp->tcp_seq) + 1;
+		srv->sent = HTTP_TEST_SIZE;
+		http_test_send(dev, packet, TCP_SYN | TCP_ACK, NULL, 0);
+		return 0;
+	}
+	if (ntohs(tcp->tcp_src) != srv->port || (tcp->tcp_flags & TCP_RST))
+		return 0;
+
+	if (payload_len > 0 && ntohl(tcp->tcp_seq) == srv->client_seq) {
+		srv->client_seq += payload_len;
+		payload[payload_len] = '\0';
+		if (srv->reset_idle) {
+			srv->reset_idle = false;
+			srv->port = 0;
+			http_test_send(dev, packet, TCP_RST, NULL, 0);
+		} else {
+			http_test_request(dev, packet, payload);
+		}
+	} else if (!payload_len && ntohl(tcp->tcp_ack) == srv->seq &&
+		   srv->sent < HTTP_TEST_SIZE) {
+		if (tcp->tcp_flags == TCP_ACK) {
+			srv->win = ntohs(tcp->tcp_win);
+			srv->acks++;
+		}
+		for (i = 0; i < max(srv->burst, 1); i++) {
+			if (srv->reset_at && srv->sent >= srv->reset_at) {
+				srv->reset_at = 0;
+				srv->port = 0;
+				http_test_send(dev, packet, TCP_RST, NULL, 0);
+				break;
+			}
+			len = min(HTTP_TEST_SIZE - srv->sent,
+				  HTTP_TEST_SEGMENT);
+			http_test_send(dev, packet, TCP_ACK,
+				       srv->data + srv->sent, len);
+			srv->sent += len;
+			if (srv->sent == HTTP_TEST_SIZE)
+				break;
+		}
+	} else if (!payload_len && tcp->tcp_flags == TCP_ACK &&
+		   srv->sent == HTTP_TEST_SIZE &&
+		   ntohl(tcp->tcp_ack) == srv->seq) {
+		srv->win = ntohs(tcp->tcp_win);
+		srv->acks++;
+	}
+
+	return 0;
+}
+
+/* Fetch the file and check it arrived intact */
+static int http_test_get(struct unit_test_state *uts)
+{
+	struct http_test_server *srv = &http_server;
+	void *buf = map_sysmem(HTTP_TEST_ADDR, HTTP_TEST_SIZE);
+
+	memset(buf, '\0', HTTP_TEST_SIZE);
+	ut_assertok(run_commandf("wget %x 1.1.2.2:/file.bin", HTTP_TEST_ADDR));
+	ut_asserteq(HTTP_TEST_SIZE, env_get_hex("filesize", 0));
+	ut_asserteq_mem(srv->data, buf, HTTP_TEST_SIZE);
+	unmap_sysmem(buf);
+
+	return 0;
+}
+
+static int net_test_wget_keepalive(struct unit_test_state *uts)
+{
+	struct http_test_server *srv = &http_server;
+	int i;
+
+	memset(srv, '\0', sizeof(*srv));
+	for (i = 0; i < HTTP_TEST_SIZE; i++)
+		srv->data[i] = i * 7 + (i >> 8);
+
+	sandbox_eth_set_tx_handler(0, http_test_handler);
+	env_set("ethact", "eth@10002000");
+	env_set("ethrotate", "no");
+	env_set_ulong("httpdstp", HTTP_TEST_PORT);
+
+	/* the second file uses the connection opened for the first */
+	ut_assertok(http_test_get(uts));
+	ut_assertok(http_test_get(uts));
+	ut_asserteq(1, srv->syns);
+	ut_asserteq(2, srv->requests);
+	ut_asserteq(-1, srv->range_start);
+
+	/* if the server closed it meanwhile, a new one is opened */
+	srv->reset_idle = true;
+	ut_assertok(http_test_get(uts));
+	ut_asserteq(2, srv->syns);
+	ut_asserteq(-1, srv->range_start);
+
+	/* a transfer which is cut off carries on from where it stopped */
+	srv->reset_at = 5 * HTTP_TEST_SEGMENT;
+	ut_assertok(http_test_get(uts));
+	ut_asserteq(3, srv->syns);
+	ut_asserteq(5 * HTTP_TEST_SEGMENT, srv->range_start);
+
+	sandbox_eth_set_tx_handler(0, NULL);
+	env_set("httpdstp", NULL);
+
+	return 0;
+}
+LIB_TEST(net_test_wget_keepalive, 0);
+
+static int net_test_wget_window(struct unit_test_state *uts)
+{
+	struct http_test_server *srv = &http_server;
+	int segs = DIV_ROUND_UP(HTTP_TEST_SIZE, HTTP_TEST_SEGMENT);
+	int i;
+
+	memset(srv, '\0', sizeof(*srv));
+	for (i = 0; i < HTTP_TEST_SIZE; i++)
+		srv->data[i] = i * 3 + (i >> 9);
+
+	sandbox_eth_set_tx_handler(0, http_test_handler);
+	env_set("ethact", "eth@10002000");
+	env_set("ethrotate", "no");
+	env_set_ulong("httpdstp", HTTP_TEST_PORT);
+
+	/* the window in the SYN is never scaled; later ones are if agreed */
+	tcp_set_tcp_state(TCP_CLOSED);
+	srv->scale = true;
+	srv->burst = TCP_ACK_SEGMENTS;
+	ut_assertok(http_test_get(uts));
+	ut_asserteq(TCP_SCALE, srv->syn_scale);
+	ut_asserteq(min(CONFIG_PROT_TCP_RX_WINDOW, 0xffff), srv->syn_win);
+	ut_asserteq(CONFIG_PROT_TCP_RX_WINDOW >> TCP_SCALE, srv->win);
+
+	/* one acknowledgement covers each burst of segments */
+	ut_asserteq(DIV_ROUND_UP(segs, TCP_ACK_SEGMENTS), srv->acks);
+
+	/* a server which does not scale windows sees them unscaled */
+	tcp_set_tcp_state(TCP_CLOSED);
+	srv->scale = false;
+	srv->burst = 1;
+	srv->acks = 0;
+	ut_assertok(http_test_get(uts));
+	ut_asserteq(min(CONFIG_PROT_TCP_RX_WINDOW, 0xffff), srv->win);
+
+	/* a single segment is still acknowledged, just a little later */
+	ut_asserteq(segs, srv->acks);
+
+	/* other users of TCP, such as fastboot, acknowledge every segment */
+	tcp_set_tcp_handler(NULL);
+	tcp_set_tcp_state(TCP_ESTABLISHED);
+	ut_assert(!tcp_delay_ack(0, HTTP_TEST_PORT, 1000, TCP_ACK, 1, 100));
+	ut_assert(!tcp_delay_ack(0, HTTP_TEST_PORT, 1000, TCP_ACK, 1, 200));
+	tcp_set_delay_ack(true);
+	ut_assert(tcp_delay_ack(0, HTTP_TEST_PORT, 1000, TCP_ACK, 1, 300));
+	tcp_set_tcp_handler(NULL);
+	tcp_set_tcp_state(TCP_CLOSED);
+
+	sandbox_eth_set_tx_handler(0, NULL);
+	env_set("httpdstp", NULL);
+
+	return 0;
+}
+LIB_TEST(net_test_wget_window, 0);
@@ -37,3 +37,65 @@ static int dm_test_cyclic_running(struct unit_test_state *uts)
 	return 0;
 }
 COMMON_TEST(dm_test_cyclic_running, 0);
+
+static struct cyclic_test cyclic_often, cyclic_rarely, cyclic_once;
+
+static void test_cb_once(struct cyclic_info *c)
+{
+	test_cb(c);
+	cyclic_unregister(c);
+}
+
+static u32 hist_sum(const u32 *hist)
+{
+	u32 sum = 0;
+	int i;
+
+	for (i = 0; i < CYCLIC_HIST_BUCKETS; i++)
+		sum += hist[i];
+
+	return sum;
+}
+
+/* Test that only the functions which are due are called */
+static int dm_test_cyclic_due(struct unit_test_state *uts)
+{
+	cyclic_register(&cyclic_rarely.cyclic, test_cb, 3600ULL * 1000000,
+			"cyclic_rarely");
+	cyclic_register(&cyclic_often.cyclic, test_cb, 0, "cyclic_often");
+	cyclic_register(&cyclic_once.cyclic, test_cb_once, 0, "cyclic_once");
+
+	/* All are called the first time */
+	cyclic_rarely.called = false;
+	cyclic_often.called = false;
+	cyclic_once.called = false;
+	schedule();
+	ut_asserteq(true, cyclic_rarely.called);
+	ut_asserteq(true, cyclic_often.called);
+	ut_asserteq(true, cyclic_once.called);
+
+	/* The one with the shortest delay is now first in the list */
+	ut_asserteq_ptr(&cyclic_often.cyclic.list, cyclic_get_list()->first);
+
+	cyclic_rarely.called = false;
+	cyclic_often.called = false;
+	cyclic_once.called = false;
+	schedule();
+	ut_asserteq(false, cyclic_rarely.called);
+	ut_asserteq(true, cyclic_often.called);
+	ut_asserteq(false, cyclic_once.called);
+
+	/* Each call is in the histograms, except the first for lateness */
+	ut_asserteq(2, cyclic_often.cyclic.run_cnt);
+	ut_asserteq(2, hist_sum(cyclic_often.cyclic.cpu_hist));
+	ut_asserteq(1, hist_sum(cyclic_often.cyclic.late_hist));
+	ut_asserteq(1, cyclic_rarely.cyclic.run_cnt);
+	ut_asserteq(1, hist_sum(cyclic_rarely.cyclic.cpu_hist));
+	ut_asserteq(0, hist_sum(cyclic_rarely.cyclic.late_hist));
+
+	cyclic_unregister(&cyclic_often.cyclic);
+	cyclic_unregister(&cyclic_rarely.cyclic);
+
+	return 0;
+}
+COMMON_TEST(dm_test_cyclic_due, 0);
@@ -11,6 +11,7 @@
 #include <log.h>
 #include <malloc.h>
 #include <mapmem.h>
+#include <time.h>
 #include <asm/io.h>
 
 #include <u-boot/lz4.h>
@@ -139,6 +140,76 @@ static const char zstd_compressed[] =
 	"\x01\xe4\xf4\x6e\xfa";
 static const unsigned long zstd_compressed_size = sizeof(zstd_compressed) - 1;
 
+/*
+ * A skippable frame holding "boot", then the first three lines and the rest of
+ * /tmp/plain.txt compressed as separate frames:
+ * zstd -19 -c /tmp/plain1.txt >> /tmp/multi.zst
+ * zstd -19 -c /tmp/plain2.txt >> /tmp/multi.zst
+ */
+static const char zstd_multi_compressed[] =
+	"\x50\x2a\x4d\x18\x04\x00\x00\x00\x62\x6f\x6f\x74\x28\xb5\x2f\xfd"
+	"\x24\x78\x8d\x01\x00\x94\x02\x49\x20\x61\x6d\x20\x61\x20\x68\x69"
+	"\x67\x68\x6c\x79\x20\x63\x6f\x6d\x70\x72\x65\x73\x73\x61\x62\x6c"
+	"\x65\x20\x62\x69\x74\x20\x6f\x66\x20\x74\x65\x78\x74\x2e\x0a\x49"
+	"\x01\x00\xe1\x85\xaa\x32\x32\x1c\x96\x9a\x28\xb5\x2f\xfd\x24\xe6"
+	"\xed\x04\x00\x52\xcc\x21\x17\x90\x3b\x07\x40\x5b\x13\x8b\xa7\x65"
+	"\x34\x12\x21\x4b\x60\x73\x76\x5d\xd1\x75\x93\x9b\xbd\x04\x49\xd0"
+	"\x27\xa9\x7a\x97\xf6\xf9\x1a\x81\xbe\x4a\xa8\x45\x08\x17\xbf\xc9"
+	"\x75\xc3\x70\xad\x31\xbf\x2c\xe9\xa5\xd8\x72\x52\x00\xa5\x13\xc0"
+	"\xa8\x79\x2d\x73\xbc\x9a\x6f\xde\xc1\xc2\x55\xb6\xc5\xab\x91\x21"
+	"\x7e\xcc\x77\x4e\x1e\x53\x7d\x5c\x1c\x54\xe9\x31\x5f\xdf\xd5\x4b"
+	"\x31\xce\x37\xbc\xc0\x3b\x1a\x03\x9d\x75\x10\xbf\x11\x2e\x35\xf4"
+	"\x1c\x13\x46\x88\x24\xfc\x31\x67\x65\xfe\x83\x56\xb6\xd6\xcb\x18"
+	"\x0e\xee\x7c\x85\x35\x43\x2f\x9d\x1f\xd3\x8f\x5f\x45\x06\x00\x18"
+	"\x1b\x65\x51\xd4\x83\x19\xe2\xcd\x45\x89\xe0\xfb\x54\x5b\x05\x05"
+	"\x2f\xcd\xb1\x6e";
+static const unsigned long zstd_multi_compressed_size =
+	sizeof(zstd_multi_compressed) - 1;
+
+/* /tmp/plain.txt with its first three lines moved to the end */
+static const char zstd_dict_plain[] =
+	"There are many like me, but this one is mine.\n"
+	"If I were any shorter, there wouldn't be much sense in\n"
+	"compressing me in the first place. At least with lzo, anyway,\n"
+	"which appears to behave poorly in the face of short text\n"
+	"messages.\n"
+	"I am a highly compressable bit of text.\n"
+	"I am a highly compressable bit of text.\n"
+	"I am a highly compressable bit of text.\n";
+
+/* zstd -19 -D /tmp/plain.txt -c /tmp/swapped.txt > /tmp/dict.zst */
+static const char zstd_dict_compressed[] =
+	"\x28\xb5\x2f\xfd\x64\x5e\x00\x6d\x00\x00\x10\x54\x49\x02\x00\xf4"
+	"\x88\xa4\x22\x4e\x53\xe6\x0a\x9b\xf8\xa5\x7a";
+static const unsigned long zstd_dict_compressed_size =
+	sizeof(zstd_dict_compressed) - 1;
+
+/* Number of copies of /tmp/plain.txt in zstd_bench_compressed[] */
+#define ZSTD_BENCH_REPEAT	1024
+
+/* Number of times zstd_bench_compressed[] is repeated for the benchmark */
+#define ZSTD_BENCH_FRAMES	16
+
+/* /tmp/plain.txt repeated ZSTD_BENCH_REPEAT times, zstd -19 */
+static const char zstd_bench_compressed[] =
+	"\x28\xb5\x2f\xfd\xa4\x00\x78\x05\x00\xd4\x05\x00\x52\x4e\x26\x17"
+	"\x80\x6d\x0e\x00\x10\x12\x93\xa0\xe5\x3f\xd1\x9e\x20\xf2\xc4\x30"
+	"\xe6\x6f\x74\x95\x0d\xd7\x03\xc0\xa0\x5f\x50\xf5\x0c\x50\x9c\x8f"
+	"\xa0\xb4\x9e\x73\x8d\xff\xa0\xfa\x61\xb7\xd6\x87\x6f\x1a\xb4\x42"
+	"\x52\x41\x80\x20\x21\x24\xb8\x69\x59\x6d\x42\x5e\xc5\x2f\x2f\xe1"
+	"\xe1\x08\xae\xc6\xab\x2f\x15\x5f\xad\x5b\xfa\xcc\x4b\x4b\xa0\xa5"
+	"\xaf\xed\x6a\x85\x38\xcc\x3f\xbc\x41\x4b\x96\xe3\xa0\xb5\xf0\xbe"
+	"\xcf\x29\xf5\xdf\x21\x17\x56\x0a\x60\x78\x4b\x66\x4d\xbf\x39\x6b"
+	"\xaa\xf5\x3a\x87\x85\x33\x9f\xc9\x65\xa9\x21\xf3\x1f\xfa\xef\xca"
+	"\x00\x86\x8d\xbe\x56\x9c\x37\x0f\x7f\x1d\xa8\xfa\xd7\x30\x87\x58"
+	"\x5a\x6a\x49\x65\x34\x43\x17\x01\x09\x00\x9f\xfe\x61\x9b\x1d\x6c"
+	"\x22\x60\x6c\x94\x45\x51\xaf\x66\x84\xa2\xc0\x08\x23\xe1\x3a\x42"
+	"\x65\x41\xf4\x42\x55\x19\x54\x00\x00\x00\x01\x00\xfd\xff\x57\xff"
+	"\xb9\x06\x02\x45\x00\x00\x00\x01\x00\xfd\x77\x39\x00\x02\x10\x3b"
+	"\xcb\xa0";
+static const unsigned long zstd_bench_compressed_size =
+	sizeof(zstd_bench_compressed) - 1;
+
 #define TEST_BUFFER_SIZE	512
 
 typedef int (*mutate_func)(struct unit_test_state *uts, void *, unsigned long,
@@ -506,6 +577,156 @@ static int compression_test_zstd(struct unit_test_state *uts)
 }
 COMPRESSION_TEST(compression_test_zstd, 0);
 
+/* Check that all the frames are decompressed, whether in parallel or not */
+static int compression_test_zstd_frames(struct unit_test_state *uts)
+{
+	char in[sizeof(zstd_multi_compressed) + 4];
+	char out[TEST_BUFFER_SIZE];
+	struct abuf in_buf, out_buf;
+	struct zstd_decomp zd;
+	int size = strlen(plain);
+	int jobs;
+
+	/* the frames followed by some bytes which are not a frame */
+	memcpy(in, zstd_multi_compressed, zstd_multi_compressed_size);
+	memcpy(in + zstd_multi_compressed_size, "junk", 4);
+
+	ut_assertok(zstd_decomp_init(&zd, NULL, 0));
+	for (jobs = 1; jobs <= 2; jobs++) {
+		zd.max_jobs = jobs;
+
+		memset(out, 'A', sizeof(out));
+		abuf_init_set(&in_buf, (void *)zstd_multi_compressed,
+			      zstd_multi_compressed_size);
+		abuf_init_set(&out_buf, out, sizeof(out));
+		ut_asserteq(size, zstd_decomp_run(&zd, &in_buf, &out_buf));
+		ut_asserteq_mem(plain, out, size);
+		ut_asserteq('A', out[size]);
+
+		/* trailing garbage is ignored */
+		abuf_init_set(&in_buf, in, zstd_multi_compressed_size + 4);
+		ut_asserteq(size, zstd_decomp_run(&zd, &in_buf, &out_buf));
+
+		/* a truncated frame is not */
+		abuf_init_set(&in_buf, (void *)zstd_multi_compressed,
+			      zstd_multi_compressed_size - 1);
+		ut_asserteq(-EINVAL, zstd_decomp_run(&zd, &in_buf, &out_buf));
+
+		/* nor is running out of space */
+		memset(out, 'A', sizeof(out));
+		abuf_init_set(&in_buf, (void *)zstd_multi_compressed,
+			      zstd_multi_compressed_size);
+		abuf_init_set(&out_buf, out, size - 1);
+		ut_asserteq(-EINVAL, zstd_decomp_run(&zd, &in_buf, &out_buf));
+		ut_asserteq('A', out[size - 1]);
+	}
+	zstd_decomp_uninit(&zd);
+
+	/* the one-shot function handles several frames too */
+	abuf_init_set(&in_buf, (void *)zstd_multi_compressed,
+		      zstd_multi_compressed_size);
+	abuf_init_set(&out_buf, out, sizeof(out));
+	ut_asserteq(size, zstd_decompress(&in_buf, &out_buf));
+	ut_asserteq_mem(plain, out, size);
+
+	return 0;
+}
+COMPRESSION_TEST(compression_test_zstd_frames, 0);
+
+/* Check that a dictionary can be used for more than one image */
+static int compression_test_zstd_dict(struct unit_test_state *uts)
+{
+	int size = strlen(zstd_dict_plain);
+	struct abuf in_buf, out_buf;
+	char out[TEST_BUFFER_SIZE];
+	struct zstd_decomp zd;
+	int i;
+
+	ut_assertok(zstd_decomp_init(&zd, plain, strlen(plain)));
+	for (i = 0; i < 2; i++) {
+		memset(out, '\0', sizeof(out));
+		abuf_init_set(&in_buf, (void *)zstd_dict_compressed,
+			      zstd_dict_compressed_size);
+		abuf_init_set(&out_buf, out, sizeof(out));
+		ut_asserteq(size, zstd_decomp_run(&zd, &in_buf, &out_buf));
+		ut_asserteq_mem(zstd_dict_plain, out, size);
+	}
+	zstd_decomp_uninit(&zd);
+
+	/* without the dictionary the data cannot be decompressed */
+	ut_assert(zstd_decompress(&in_buf, &out_buf) < 0);
+
+	return 0;
+}
+COMPRESSION_TEST(compression_test_zstd_dict, 0);
+
+/**
+ * zstd_bench_run() - Decompress the benchmark data and check it
+ *
+ * @zd: Decompressor to use
+ * @in: Compressed data
+ * @out: Buffer for the decompressed data
+ * @timep: Returns the time taken in microseconds
+ * Return: 0 if OK, non-zero on failure
+ */
+static int zstd_bench_run(struct unit_test_state *uts, struct zstd_decomp *zd,
+			  struct abuf *in, struct abuf *out, ulong *timep)
+{
+	int size = strlen(plain);
+	char *ptr;
+	ulong start;
+	int i;
+
+	memset(abuf_data(out), '\0', abuf_size(out));
+	start = timer_get_us();
+	ut_asserteq(abuf_size(out), zstd_decomp_run(zd, in, out));
+	*timep = timer_get_us() - start;
+
+	ptr = abuf_data(out);
+	for (i = 0; i < ZSTD_BENCH_FRAMES * ZSTD_BENCH_REPEAT; i++) {
+		ut_asserteq_mem(plain, ptr, size);
+		ptr += size;
+	}
+
+	return 0;
+}
+
+/* Time decompressing many frames on one CPU and on as many as there are */
+static int compression_test_zstd_bench(struct unit_test_state *uts)
+{
+	ulong out_size = ZSTD_BENCH_FRAMES * ZSTD_BENCH_REPEAT * strlen(plain);
+	ulong in_size = ZSTD_BENCH_FRAMES * zstd_bench_compressed_size;
+	ulong serial_us, parallel_us;
+	struct abuf in_buf, out_buf;
+	struct zstd_decomp zd;
+	int i, max_jobs;
+
+	abuf_init(&in_buf);
+	abuf_init(&out_buf);
+	ut_assert(abuf_realloc(&in_buf, in_size));
+	ut_assert(abuf_realloc(&out_buf, out_size));
+	for (i = 0; i < ZSTD_BENCH_FRAMES; i++)
+		memcpy(abuf_data(&in_buf) + i * zstd_bench_compressed_size,
+		       zstd_bench_compressed, zstd_bench_compressed_size);
+
+	ut_assertok(zstd_decomp_init(&zd, NULL, 0));
+	max_jobs = zd.max_jobs;
+	zd.max_jobs = 1;
+	ut_assertok(zstd_bench_run(uts, &zd, &in_buf, &out_buf, &serial_us));
+	zd.max_jobs = max_jobs;
+	ut_assertok(zstd_bench_run(uts, &zd, &in_buf, &out_buf, &parallel_us));
+	zstd_decomp_uninit(&zd);
+
+	printf("zstd: %d frames, %lu KiB: %lu us on 1 CPU, %lu us on up to %d\n",
+	       ZSTD_BENCH_FRAMES, out_size >> 10, serial_us, parallel_us,
+	       max_jobs);
+	abuf_uninit(&out_buf);
+	abuf_uninit(&in_buf);
+
+	return 0;
+}
+COMPRESSION_TEST(compression_test_zstd_bench, 0);
+
 static int compress_using_none(struct unit_test_state *uts,
 			       void *in, unsigned long in_size,
 			       void *out, unsigned long out_max,
@@ -528,6 +749,7 @@ static int compress_using_none(struct unit_test_state *uts,
 static int run_bootm_test(struct unit_test_state *uts, int comp_type,
 			  mutate_func compress)
 {
+	struct image_decomp_job dj;
 	ulong compress_size = 1024;
 	void *compress_buff;
 	int unc_len;
@@ -546,6 +768,16 @@ static int run_bootm_test(struct unit_test_state *uts, int comp_type,
 			   compress_buff, compress_size, unc_len,
 			   &load_end);
 	ut_assertok(err);
+
+	/* the same again, on another CPU if the algorithm allows it */
+	memset(map_sysmem(load_addr, 0), '\0', unc_len);
+	image_decomp_start(&dj, comp_type, load_addr, image_start,
+			   IH_TYPE_KERNEL, map_sysmem(load_addr, 0),
+			   compress_buff, compress_size, unc_len);
+	ut_assertok(image_decomp_wait(&dj, &load_end));
+	ut_asserteq(load_addr + unc_len, load_end);
+	ut_asserteq_mem(plain, map_sysmem(load_addr, 0), unc_len);
+
 	err = image_decomp(comp_type, load_addr, image_start,
 			   IH_TYPE_KERNEL, map_sysmem(load_addr, 0),
 			   compress_buff, compress_size, unc_len - 1,
@@ -5,11 +5,14 @@
 
 #include <blk.h>
 #include <dm.h>
+#include <malloc.h>
+#include <os.h>
 #include <part.h>
 #include <sandbox_host.h>
 #include <usb.h>
 #include <asm/global_data.h>
 #include <asm/state.h>
+#include <dm/device-internal.h>
 #include <dm/test.h>
 #include <test/test.h>
 #include <test/ut.h>
@@ -334,3 +337,154 @@ static int dm_test_blk_foreach(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_blk_foreach, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
+
+/* Test the block cache with partial hits, merging and eviction */
+static int dm_test_blk_cache(struct unit_test_state *uts)
+{
+	struct block_cache_dev_stats dstats;
+	struct block_cache_stats stats;
+	char data[40 * 512], buf[40 * 512];
+	int i;
+
+	for (i = 0; i < sizeof(data); i++)
+		data[i] = i * 7 + (i >> 9);
+
+	blkcache_free();
+	blkcache_configure(8, 16, 16 * 8 * 512);
+	blkcache_stats(&stats);
+	ut_asserteq(0, stats.entries);
+
+	/* Blocks 4..11 span two chunks */
+	blkcache_fill(UCLASS_HOST, 3, 4, 8, 512, data + 4 * 512);
+	blkcache_stats(&stats);
+	ut_asserteq(2, stats.entries);
+	ut_asserteq(2 * 8 * 512, stats.bytes);
+
+	ut_asserteq(8, blkcache_read(UCLASS_HOST, 3, 4, 8, 512, buf));
+	ut_asserteq_mem(data + 4 * 512, buf, 8 * 512);
+	ut_asserteq(2, blkcache_read(UCLASS_HOST, 3, 9, 2, 512, buf));
+	ut_asserteq_mem(data + 9 * 512, buf, 2 * 512);
+
+	/* Only the leading part of this range is present */
+	ut_asserteq(4, blkcache_read(UCLASS_HOST, 3, 8, 8, 512, buf));
+	ut_asserteq_mem(data + 8 * 512, buf, 4 * 512);
+	ut_asserteq(0, blkcache_read(UCLASS_HOST, 3, 2, 4, 512, buf));
+
+	/* Another device or block size does not match */
+	ut_asserteq(0, blkcache_read(UCLASS_HOST, 4, 4, 8, 512, buf));
+	ut_asserteq(0, blkcache_read(UCLASS_HOST, 3, 4, 1, 4096, buf));
+
+	/* An adjacent fill extends the existing chunk */
+	blkcache_fill(UCLASS_HOST, 3, 12, 4, 512, data + 12 * 512);
+	ut_asserteq(12, blkcache_read(UCLASS_HOST, 3, 4, 12, 512, buf));
+	ut_asserteq_mem(data + 4 * 512, buf, 12 * 512);
+
+	blkcache_stats(&stats);
+	ut_asserteq(2, stats.entries);
+	ut_asserteq(3, stats.hits);
+	ut_asserteq(1, stats.partial);
+	ut_asserteq(3, stats.misses);
+
+	ut_assertok(blkcache_dev_stats(0, &dstats));
+	ut_asserteq(UCLASS_HOST, dstats.iftype);
+	ut_asserteq(3, dstats.devnum);
+	ut_asserteq(3, dstats.hits);
+	ut_asserteq(1, dstats.partial);
+	ut_asserteq(2, dstats.misses);
+	ut_asserteq(2, dstats.entries);
+	ut_asserteq(-ENOENT, blkcache_dev_stats(1, &dstats));
+
+	/* Large reads are not cached */
+	blkcache_fill(UCLASS_HOST, 3, 64, 40, 512, data);
+	blkcache_stats(&stats);
+	ut_asserteq(2, stats.entries);
+
+	/* Filling past the byte budget drops the least recently used */
+	for (i = 0; i < 20; i++)
+		blkcache_fill(UCLASS_HOST, 5, i * 8, 1, 512, data);
+	blkcache_stats(&stats);
+	ut_asserteq(16, stats.entries);
+	ut_asserteq(16 * 8 * 512, stats.bytes);
+	ut_asserteq(0, blkcache_read(UCLASS_HOST, 3, 4, 1, 512, buf));
+	ut_asserteq(1, blkcache_read(UCLASS_HOST, 5, 19 * 8, 1, 512, buf));
+	ut_asserteq(0, blkcache_read(UCLASS_HOST, 5, 3 * 8, 1, 512, buf));
+
+	blkcache_invalidate(UCLASS_HOST, 5);
+	blkcache_stats(&stats);
+	ut_asserteq(0, stats.entries);
+	ut_asserteq(0, stats.bytes);
+
+	/* the device's statistics outlast its entries, until read */
+	ut_assertok(blkcache_dev_stats(0, &dstats));
+	ut_asserteq(5, dstats.devnum);
+	ut_asserteq(1, dstats.hits);
+	ut_asserteq(1, dstats.misses);
+	ut_asserteq(0, dstats.entries);
+	ut_assertok(blkcache_dev_stats(0, &dstats));
+	ut_asserteq(0, dstats.hits);
+	ut_asserteq(0, dstats.misses);
+
+	blkcache_configure(8, 32, CONFIG_BLOCK_CACHE_SIZE);
+
+	return 0;
+}
+DM_TEST(dm_test_blk_cache, 0);
+
+/* Test sequential read-ahead */
+static int dm_test_blk_readahead(struct unit_test_state *uts)
+{
+	struct blk_readahead *ra;
+	struct udevice *dev, *blk;
+	char fname[256];
+	char *expect, *buf;
+	int i;
+
+	ut_assertok(os_persistent_file(fname, sizeof(fname), "2MB.ext2.img"));
+	ut_assertok(host_create_device("test0", false, DEFAULT_BLKSZ, &dev));
+	ut_assertok(host_attach_file(dev, fname));
+	ut_assertok(blk_get_from_parent(dev, &blk));
+	ut_assertok(device_probe(blk));
+
+	ra = blk_readahead_get(blk);
+	ut_assertnonnull(ra);
+	ut_asserteq(CONFIG_BLK_READAHEAD_SIZE, ra->size);
+
+	expect = malloc(1024 * 512);
+	buf = malloc(1024 * 512);
+	ut_assertnonnull(expect);
+	ut_assertnonnull(buf);
+
+	/* probing may already have read ahead while scanning partitions */
+	ut_assertok(blk_readahead_set_size(blk, 0));
+	ra->issued = 0;
+	ra->hits = 0;
+	ut_asserteq(1024, blk_read(blk, 0, 1024, expect));
+	ut_asserteq(0, ra->issued);
+
+	/*
+	 * Once two reads have followed on from the previous one, the rest
+	 * comes from the window
+	 */
+	ut_assertok(blk_readahead_set_size(blk, 128 * 512 + 100));
+	ut_asserteq(128 * 512, ra->size);
+	for (i = 0; i < 1024; i += 16)
+		ut_asserteq(16, blk_read(blk, i, 16, buf + i * 512));
+	ut_asserteq_mem(expect, buf, 1024 * 512);
+	ut_asserteq(1024 - 48, ra->hits);
+	ut_asserteq(8 * 128, ra->issued);
+	ut_asserteq(48 + 7 * 128, ra->start);
+	ut_asserteq(128, ra->blkcnt);
+
+	/* A read elsewhere drops the window */
+	ut_asserteq(1, blk_read(blk, 2000, 1, buf));
+	ut_asserteq(0, ra->blkcnt);
+	ut_asserteq(1024 - 48, ra->hits);
+
+	free(buf);
+	free(expect);
+	ut_assertok(host_detach_file(dev));
+	ut_assertok(device_unbind(dev));
+
+	return 0;
+}
+DM_TEST(dm_test_blk_readahead, UT_TESTF_SCAN_FDT);
@@ -10,12 +10,15 @@
 #include <fdtdec.h>
 #include <log.h>
 #include <malloc.h>
+#include <time.h>
 #include <asm/global_data.h>
 #include <dm/device-internal.h>
+#include <dm/lists.h>
 #include <dm/root.h>
 #include <dm/util.h>
 #include <dm/test.h>
 #include <dm/uclass-internal.h>
+#include <linux/err.h>
 #include <test/test.h>
 #include <test/ut.h>
 
@@ -63,6 +66,11 @@ static struct driver_info driver_info_manual = {
 	.plat = &test_pdata_manual,
 };
 
+static struct driver_info driver_info_slow = {
+	.name = "test_slow_drv",
+	.plat = &test_pdata_manual,
+};
+
 static struct driver_info driver_info_pre_reloc = {
 	.name = "test_pre_reloc_drv",
 	.plat = &test_pdata_pre_reloc,
@@ -1351,3 +1359,96 @@ static int dm_test_dev_get_mem(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_dev_get_mem, UT_TESTF_SCAN_FDT);
+
+/* Test that looking up a compatible string finds the first driver listing it */
+static int dm_test_lists_compat(struct unit_test_state *uts)
+{
+	struct driver *driver = ll_entry_start(struct driver, driver);
+	const int n_ents = ll_entry_count(struct driver, driver);
+	const struct udevice_id *of_match, *id, *first_id;
+	struct driver *entry, *first;
+	int count = 0;
+
+	for (entry = driver; entry != driver + n_ents; entry++) {
+		for (of_match = entry->of_match;
+		     of_match && of_match->compatible; of_match++) {
+			/* find the first driver with this string, the slow way */
+			first_id = NULL;
+			for (first = driver; first != entry + 1; first++) {
+				for (first_id = first->of_match;
+				     first_id && first_id->compatible;
+				     first_id++) {
+					if (!strcmp(first_id->compatible,
+						    of_match->compatible))
+						break;
+				}
+				if (first_id && first_id->compatible)
+					break;
+			}
+
+			id = NULL;
+			ut_asserteq_ptr(first, lists_driver_lookup_compat(
+					of_match->compatible, &id));
+			ut_asserteq_ptr(first_id, id);
+			count++;
+		}
+	}
+	ut_assert(count > 0);
+
+	ut_assertnull(lists_driver_lookup_compat("no-such,compatible", &id));
+
+	/* if the hash cannot be built, drivers are searched one by one */
+	if (CONFIG_IS_ENABLED(DM_COMPAT_HASH)) {
+		struct dm_compat_hash *hash = gd_dm_compat_hash(), *failed;
+
+		/* it is not built again either */
+		gd_set_dm_compat_hash(ERR_PTR(-ENOMEM));
+		entry = lists_driver_lookup_compat("denx,u-boot-fdt-test", &id);
+		failed = gd_dm_compat_hash();
+		gd_set_dm_compat_hash(hash);
+		ut_asserteq_ptr(ERR_PTR(-ENOMEM), failed);
+		ut_assertnonnull(entry);
+		ut_asserteq_str("denx,u-boot-fdt-test", id->compatible);
+	}
+
+	return 0;
+}
+DM_TEST(dm_test_lists_compat, 0);
+
+/* Test probing several slow devices at once */
+static int dm_test_probe_parallel(struct unit_test_state *uts)
+{
+	struct udevice *devs[4];
+	int probe_count;
+	int i;
+
+	/* the uclass normally needs each device's predecessor to be probed */
+	uts->skip_post_probe = 1;
+	for (i = 0; i < ARRAY_SIZE(devs); i++)
+		ut_assertok(device_bind_by_name(uts->root, false,
+						&driver_info_slow, &devs[i]));
+
+	/* a failure is reported, but the other devices are still probed */
+	uts->force_fail_alloc = 1;
+	probe_count = dm_testdrv_op_count[DM_TEST_OP_PROBE];
+	ut_asserteq(-ENOMEM, device_probe_parallel(devs, ARRAY_SIZE(devs)));
+	ut_asserteq(probe_count + ARRAY_SIZE(devs),
+		    dm_testdrv_op_count[DM_TEST_OP_PROBE]);
+	uts->force_fail_alloc = 0;
+
+	probe_count = dm_testdrv_op_count[DM_TEST_OP_PROBE];
+	dm_test_slow_probing_max = 0;
+	ut_assertok(device_probe_parallel(devs, ARRAY_SIZE(devs)));
+	for (i = 0; i < ARRAY_SIZE(devs); i++)
+		ut_assert(device_active(devs[i]));
+	ut_asserteq(probe_count + ARRAY_SIZE(devs),
+		    dm_testdrv_op_count[DM_TEST_OP_PROBE]);
+	ut_asserteq(0, dm_test_slow_probing);
+
+	/* each probe waits in mdelay(), so they should all overlap */
+	ut_asserteq(CONFIG_IS_ENABLED(UTHREAD) ? ARRAY_SIZE(devs) : 1,
+		    dm_test_slow_probing_max);
+
+	return 0;
+}
+DM_TEST(dm_test_probe_parallel, UT_TESTF_SCAN_PDATA);
@@ -9,6 +9,8 @@
 #include <dm/test.h>
 #include <dm/uclass-internal.h>
 #include <cpu.h>
+#include <cpu_job.h>
+#include <asm/cpu.h>
 #include <test/test.h>
 #include <test/ut.h>
 
@@ -47,3 +49,93 @@ static int dm_test_cpu(struct unit_test_state *uts)
 }
 
 DM_TEST(dm_test_cpu, UT_TESTF_SCAN_FDT);
+
+#if CONFIG_IS_ENABLED(CPU_JOBS)
+static bool cpu_test_release;
+
+/* Spin until the test lets the job go, which only works on another CPU */
+static int cpu_test_held_job(void *arg)
+{
+	ulong i;
+
+	for (i = 0; i < 1UL << 34; i++) {
+		if (__atomic_load_n(&cpu_test_release, __ATOMIC_ACQUIRE))
+			return (ulong)arg;
+	}
+
+	return -ETIMEDOUT;
+}
+
+/* Let the held jobs go, which they can only see if this runs first */
+static int cpu_test_release_job(void *arg)
+{
+	__atomic_store_n(&cpu_test_release, true, __ATOMIC_RELEASE);
+
+	return 0;
+}
+
+static int cpu_test_job(void *arg)
+{
+	int *val = arg;
+
+	*val *= 2;
+
+	return *val == 6 ? -EINVAL : 0;
+}
+
+static int dm_test_cpu_jobs(struct unit_test_state *uts)
+{
+	/* static, since the CPUs may still refer to them if a check fails */
+	static struct cpu_job held[3], jobs[4];
+	static int vals[4];
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(vals); i++)
+		vals[i] = i + 1;
+
+	/* cpu@1 is current, leaving two CPUs to run jobs */
+	cpu_test_release = false;
+	for (i = 0; i < ARRAY_SIZE(held); i++)
+		cpu_job_init(&held[i], cpu_test_held_job, (void *)(ulong)i);
+	ut_assertok(cpu_job_start(&held[0]));
+	ut_assertok(cpu_job_start(&held[1]));
+	ut_asserteq(-EBUSY, cpu_job_start(&held[2]));
+	ut_assertnonnull(held[0].cpu);
+	ut_assertnonnull(held[1].cpu);
+	ut_assert(held[0].cpu != held[1].cpu);
+	ut_assert(cpu_is_current(held[0].cpu) != 1);
+	ut_assert(!__atomic_load_n(&held[0].done, __ATOMIC_ACQUIRE));
+
+	__atomic_store_n(&cpu_test_release, true, __ATOMIC_RELEASE);
+	ut_asserteq(0, cpu_job_wait(&held[0]));
+	ut_asserteq(1, cpu_job_wait(&held[1]));
+
+	/* the one which found no CPU runs here */
+	ut_asserteq(2, cpu_job_wait(&held[2]));
+
+	/* the third job fails, but the others still run */
+	for (i = 0; i < ARRAY_SIZE(jobs); i++)
+		cpu_job_init(&jobs[i], cpu_test_job, &vals[i]);
+	ut_asserteq(-EINVAL, cpu_run_jobs(jobs, ARRAY_SIZE(jobs)));
+	for (i = 0; i < ARRAY_SIZE(jobs); i++)
+		ut_asserteq((i + 1) * 2, vals[i]);
+
+	/* jobs left for this CPU run before waiting for the others */
+	cpu_test_release = false;
+	cpu_job_init(&held[0], cpu_test_held_job, NULL);
+	cpu_job_init(&held[1], cpu_test_held_job, NULL);
+	cpu_job_init(&held[2], cpu_test_release_job, NULL);
+	ut_assertok(cpu_run_jobs(held, ARRAY_SIZE(held)));
+
+	/* with no CPU to take them, everything runs here */
+	cpu_sandbox_set_jobs(false);
+	cpu_job_init(&jobs[0], cpu_test_job, &vals[0]);
+	ut_asserteq(-EBUSY, cpu_job_start(&jobs[0]));
+	ut_assertok(cpu_run_jobs(jobs, 1));
+	ut_asserteq(4, vals[0]);
+	cpu_sandbox_set_jobs(true);
+
+	return 0;
+}
+DM_TEST(dm_test_cpu_jobs, UT_TESTF_SCAN_FDT);
+#endif
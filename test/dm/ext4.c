@@ -0,0 +1,374 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for looking up names in ext4 directories
+ */
+
+#include <blk.h>
+#include <dm.h>
+#include <ext4fs.h>
+#include <fs.h>
+#include <malloc.h>
+#include <os.h>
+#include <part.h>
+#include <sandbox_host.h>
+#include <dm/device-internal.h>
+#include <dm/test.h>
+#include <test/test.h>
+#include <test/ut.h>
+#include "../../fs/ext4/ext4_common.h"
+
+#define LONG_NAME	"a_very_long_file_name_which_needs_two_blocks_of_md4"
+
+/* Layout of the index root, after the '.' and '..' entries */
+#define ROOT_HASH_VERSION	28
+#define ROOT_INFO_LENGTH	29
+#define ROOT_ENTRIES		32
+
+/* Superblock flag for names hashed as unsigned chars */
+#define FLAGS_UNSIGNED_HASH	2
+
+/* Hashes for each DX_HASH_... version, as given by 'debugfs -R dx_hash' */
+static const struct {
+	const char *name;
+	bool seeded;
+	u32 hash[6];
+} dirhash_tests[] = {
+	{ "hello", false, { 0x32252546, 0x1746da32, 0x6f5bb1a8,
+			    0x32252546, 0x1746da32, 0x6f5bb1a8 } },
+	/* the top bit of the last character is where signedness matters */
+	{ "caf\xe9", false, { 0x65f23bce, 0x9be4a372, 0x84b3a194,
+			      0x7c3849d0, 0xab408964, 0xe665cc26 } },
+	{ LONG_NAME, false, { 0x1e2dc266, 0x4ed085b4, 0xb6fbc160,
+			      0x1e2dc266, 0x4ed085b4, 0xb6fbc160 } },
+	/* seed efbeadde-3412-7856-9abc-def012345678, unused by legacy */
+	{ LONG_NAME, true, { 0x1e2dc266, 0xfb69548e, 0xf9b918c8,
+			     0x1e2dc266, 0xfb69548e, 0xf9b918c8 } },
+};
+
+/* Check that names hash as they do in Linux */
+static int dm_test_ext4_dirhash(struct unit_test_state *uts)
+{
+	const __le32 seed[4] = {
+		cpu_to_le32(0xdeadbeef), cpu_to_le32(0x56781234),
+		cpu_to_le32(0xf0debc9a), cpu_to_le32(0x78563412),
+	};
+	const __le32 zero_seed[4] = {};
+	u32 hash;
+	int i, version;
+
+	for (i = 0; i < ARRAY_SIZE(dirhash_tests); i++) {
+		const char *name = dirhash_tests[i].name;
+
+		for (version = DX_HASH_LEGACY; version <= DX_HASH_TEA_UNSIGNED;
+		     version++) {
+			ut_assertok(ext4fs_dirhash(name, strlen(name), version,
+						   dirhash_tests[i].seeded ?
+						   seed : NULL, &hash));
+			ut_asserteq(dirhash_tests[i].hash[version], hash);
+		}
+	}
+
+	/* an empty seed means the default one */
+	ut_assertok(ext4fs_dirhash("hello", 5, DX_HASH_HALF_MD4, zero_seed,
+				   &hash));
+	ut_asserteq(0x1746da32, hash);
+
+	ut_asserteq(-EPROTONOSUPPORT, ext4fs_dirhash("hello", 5,
+						     DX_HASH_TEA_UNSIGNED + 1,
+						     NULL, &hash));
+
+	return 0;
+}
+DM_TEST(dm_test_ext4_dirhash, 0);
+
+/* Look up a directory in the filesystem, which must be open */
+static int ext4_test_find_dir(struct unit_test_state *uts,
+			      struct blk_desc *desc, const char *path,
+			      struct ext2fs_node **dirp)
+{
+	ut_assertok(fs_set_blk_dev_with_part(desc, 0));
+	ut_asserteq(1, ext4fs_find_file(path, &ext4fs_root->diropen, dirp,
+					FILETYPE_DIRECTORY));
+
+	/* this is normally read when the directory is first searched */
+	ut_asserteq(1, ext4fs_read_inode(ext4fs_root, (*dirp)->ino,
+					 &(*dirp)->inode));
+	(*dirp)->inode_read = 1;
+
+	return 0;
+}
+
+/* Check that a file in the test image can be found */
+static int ext4_test_size(struct unit_test_state *uts, struct blk_desc *desc,
+			  const char *dir, const char *name)
+{
+	char path[40];
+	loff_t size;
+
+	snprintf(path, sizeof(path), "%s/%s", dir, name);
+	ut_assertok(fs_set_blk_dev_with_part(desc, 0));
+	ut_assertok(fs_size(path, &size));
+
+	/* each file holds its own name */
+	ut_asserteq(strlen(name), size);
+
+	return 0;
+}
+
+/* Check looking up names in a directory with a hash-tree index */
+static int dm_test_ext4_htree(struct unit_test_state *uts)
+{
+	static char label[] = "test";
+	/* the first entry holds the limit and count in its hash */
+	struct dx_entry {
+		__le32 hash;
+		__le32 block;
+	} *entries;
+	struct udevice *dev, *blk;
+	struct ext2fs_node *dir;
+	struct blk_desc *desc;
+	char fname[256], name[20];
+	int blksz, first, found, version, i, ret;
+	loff_t actread, size;
+	lbaint_t sector;
+	bool more;
+	char *buf;
+	u32 hash;
+
+	/* the index is changed below, so use a private copy of the image */
+	ut_assertok(os_persistent_file(fname, sizeof(fname),
+				       "4MB.htree.ext4.img"));
+	ut_assertok(os_read_file(fname, (void **)&buf, &ret));
+	strlcat(fname, ".tmp", sizeof(fname));
+	ret = os_write_file(fname, buf, ret);
+	os_free(buf);
+	ut_assertok(ret);
+
+	ut_assertok(host_create_device(label, true, DEFAULT_BLKSZ, &dev));
+	ut_assertok(host_attach_file(dev, fname));
+	ut_assertok(blk_get_from_parent(dev, &blk));
+	ut_assertok(device_probe(blk));
+	desc = dev_get_uclass_plat(blk);
+
+	/* names in the indexed directory are found in the right leaf */
+	ut_assertok(ext4_test_find_dir(uts, desc, "/big", &dir));
+	ut_assert(le32_to_cpu(dir->inode.flags) & EXT4_INDEX_FL);
+	ret = ext4fs_htree_lookup(dir, "file123", &more);
+	ut_assert(ret > 0);
+	ut_asserteq(false, more);
+	ext4fs_free_node(dir, &ext4fs_root->diropen);
+	for (i = 0; i < 500; i += 37) {
+		snprintf(name, sizeof(name), "file%d", i);
+		ut_assertok(ext4_test_size(uts, desc, "/big", name));
+	}
+	ut_assertok(ext4_test_size(uts, desc, "/big", "file499"));
+	ut_assertok(fs_set_blk_dev_with_part(desc, 0));
+	ut_assert(fs_size("/big/file500", &size));
+
+	/* a directory without an index is searched from start to end */
+	ut_assertok(ext4_test_find_dir(uts, desc, "/small", &dir));
+	ut_asserteq(-ENOENT, ext4fs_htree_lookup(dir, "a", &more));
+	ext4fs_free_node(dir, &ext4fs_root->diropen);
+	ut_assertok(ext4_test_size(uts, desc, "/small", "a"));
+
+	/* find a name which is not in the first leaf */
+	ut_assertok(ext4_test_find_dir(uts, desc, "/big", &dir));
+	blksz = EXT2_BLOCK_SIZE(dir->data);
+	buf = malloc(blksz);
+	ut_assertnonnull(buf);
+	ut_assertok(ext4fs_read_file(dir, 0, blksz, buf, &actread));
+	ut_asserteq(blksz, actread);
+	entries = (struct dx_entry *)(buf + ROOT_ENTRIES);
+	first = le32_to_cpu(entries[0].block);
+	for (i = 0; i < 500; i++) {
+		snprintf(name, sizeof(name), "file%d", i);
+		found = ext4fs_htree_lookup(dir, name, &more);
+		if (found != first)
+			break;
+	}
+	ut_assert(found > 0 && found != first);
+
+	version = buf[ROOT_HASH_VERSION];
+	if (le32_to_cpu(ext4fs_root->sblock.flags) & FLAGS_UNSIGNED_HASH)
+		version += DX_HASH_LEGACY_UNSIGNED;
+	ut_assertok(ext4fs_dirhash(name, strlen(name), version,
+				   ext4fs_root->sblock.hash_seed, &hash));
+	sector = read_allocated_block(&dir->inode, 0, NULL) * blksz /
+		desc->blksz;
+	ext4fs_free_node(dir, &ext4fs_root->diropen);
+
+	/*
+	 * Point the index at the first leaf, with the next entry starting at
+	 * the same hash. That says the name may carry on into the next leaf,
+	 * so the whole directory is searched
+	 */
+	entries[0].hash = cpu_to_le32(2 << 16 |
+				      (le32_to_cpu(entries[0].hash) & 0xffff));
+	entries[1].hash = cpu_to_le32(hash | 1);
+	entries[1].block = cpu_to_le32(found);
+	ut_asserteq(blksz / desc->blksz,
+		    blk_dwrite(desc, sector, blksz / desc->blksz, buf));
+	ut_assertok(ext4_test_find_dir(uts, desc, "/big", &dir));
+	ut_asserteq(first, ext4fs_htree_lookup(dir, name, &more));
+	ut_asserteq(true, more);
+	ext4fs_free_node(dir, &ext4fs_root->diropen);
+	ut_assertok(ext4_test_size(uts, desc, "/big", name));
+
+	/* without that, only the first leaf is searched */
+	entries[1].hash = cpu_to_le32(hash + 2);
+	ut_asserteq(blksz / desc->blksz,
+		    blk_dwrite(desc, sector, blksz / desc->blksz, buf));
+	ut_assertok(ext4_test_find_dir(uts, desc, "/big", &dir));
+	ut_asserteq(first, ext4fs_htree_lookup(dir, name, &more));
+	ut_asserteq(false, more);
+	ext4fs_free_node(dir, &ext4fs_root->diropen);
+	ut_assertok(fs_set_blk_dev_with_part(desc, 0));
+	snprintf(fname, sizeof(fname), "/big/%s", name);
+	ut_assert(fs_size(fname, &size));
+
+	/* an index which does not look valid is ignored */
+	buf[ROOT_INFO_LENGTH] = 0;
+	ut_asserteq(blksz / desc->blksz,
+		    blk_dwrite(desc, sector, blksz / desc->blksz, buf));
+	ut_assertok(ext4_test_find_dir(uts, desc, "/big", &dir));
+	ut_asserteq(-EINVAL, ext4fs_htree_lookup(dir, name, &more));
+	ext4fs_free_node(dir, &ext4fs_root->diropen);
+	ut_assertok(ext4_test_size(uts, desc, "/big", name));
+	ut_assertok(ext4_test_size(uts, desc, "/big", "file0"));
+
+	free(buf);
+	ut_assertok(host_detach_file(dev));
+	ut_assertok(device_unbind(dev));
+	ut_assertok(os_persistent_file(fname, sizeof(fname),
+				       "4MB.htree.ext4.img"));
+	strlcat(fname, ".tmp", sizeof(fname));
+	ut_assertok(os_unlink(fname));
+
+	return 0;
+}
+DM_TEST(dm_test_ext4_htree, UT_TESTF_SCAN_FDT);
+
+/* Attach a private copy of the test image, to be changed by the test */
+static int ext4_test_attach_copy(struct unit_test_state *uts, char *label,
+				 const char *suffix, struct udevice **devp,
+				 struct blk_desc **descp)
+{
+	struct udevice *blk;
+	char fname[256];
+	char *buf;
+	int ret;
+
+	ut_assertok(os_persistent_file(fname, sizeof(fname),
+				       "4MB.htree.ext4.img"));
+	ut_assertok(os_read_file(fname, (void **)&buf, &ret));
+	strlcat(fname, suffix, sizeof(fname));
+	ret = os_write_file(fname, buf, ret);
+	os_free(buf);
+	ut_assertok(ret);
+
+	ut_assertok(host_create_device(label, true, DEFAULT_BLKSZ, devp));
+	ut_assertok(host_attach_file(*devp, fname));
+	ut_assertok(blk_get_from_parent(*devp, &blk));
+	ut_assertok(device_probe(blk));
+	*descp = dev_get_uclass_plat(blk);
+
+	return 0;
+}
+
+/* Detach and remove an image attached by ext4_test_attach_copy() */
+static int ext4_test_detach_copy(struct unit_test_state *uts,
+				 const char *suffix, struct udevice *dev)
+{
+	char fname[256];
+
+	ut_assertok(host_detach_file(dev));
+	ut_assertok(device_unbind(dev));
+	ut_assertok(os_persistent_file(fname, sizeof(fname),
+				       "4MB.htree.ext4.img"));
+	strlcat(fname, suffix, sizeof(fname));
+	ut_assertok(os_unlink(fname));
+
+	return 0;
+}
+
+/* Mount a device directly, as SPL does, without closing the last one */
+static int ext4_test_mount_direct(struct unit_test_state *uts,
+				  struct blk_desc *desc,
+				  struct disk_partition *info)
+{
+	ut_assertok(part_get_info_whole_disk(desc, info));
+	ext4fs_set_blk_dev(desc, info);
+	ut_asserteq(1, ext4fs_mount());
+
+	return 0;
+}
+
+/* Check that extents read from one device are not used on another */
+static int dm_test_ext4_extents_dev(struct unit_test_state *uts)
+{
+	static char label_a[] = "exta", label_b[] = "extb";
+	struct disk_partition info_a, info_b;
+	struct blk_desc *desc_a, *desc_b;
+	struct udevice *dev_a, *dev_b;
+	struct ext4_extent *extent;
+	struct ext2_data *root_a;
+	struct ext2_inode root;
+	loff_t len, actread;
+	int blksz, pos, size;
+	ulong old, new;
+	char *buf, ch;
+
+	ut_assertok(ext4_test_attach_copy(uts, label_a, ".a", &dev_a,
+					  &desc_a));
+	ut_assertok(ext4_test_attach_copy(uts, label_b, ".b", &dev_b,
+					  &desc_b));
+
+	/* move the root directory in the second image to its last block */
+	ut_assertok(fs_set_blk_dev_with_part(desc_a, 0));
+	ut_asserteq(1, ext4fs_read_inode(ext4fs_root, EXT2_ROOT_INO, &root));
+	blksz = EXT2_BLOCK_SIZE(ext4fs_root);
+	ut_assert(le32_to_cpu(root.flags) & EXT4_EXTENTS_FL);
+	extent = (struct ext4_extent *)((struct ext4_extent_header *)
+					root.b.blocks.dir_blocks + 1);
+	ut_asserteq(1, le16_to_cpu(extent->ee_len));
+	size = desc_b->lba * desc_b->blksz;
+	buf = malloc(size);
+	ut_assertnonnull(buf);
+	ut_asserteq(desc_b->lba, blk_dread(desc_b, 0, desc_b->lba, buf));
+	old = le32_to_cpu(extent->ee_start_lo);
+	new = size / blksz - 1;
+	for (pos = 0; pos < blksz; pos++)
+		ut_asserteq(0, buf[new * blksz + pos]);
+	for (pos = 0; pos < size; pos += sizeof(root)) {
+		if (!memcmp(buf + pos, &root, sizeof(root)))
+			break;
+	}
+	ut_assert(pos < size);
+	memcpy(buf + new * blksz, buf + old * blksz, blksz);
+	memset(buf + old * blksz, '\0', blksz);
+	extent->ee_start_lo = cpu_to_le32(new);
+	memcpy(buf + pos, &root, sizeof(root));
+	ut_asserteq(desc_b->lba, blk_dwrite(desc_b, 0, desc_b->lba, buf));
+	free(buf);
+
+	/* a failed lookup leaves the root directory's extents behind */
+	ut_assertok(ext4_test_mount_direct(uts, desc_a, &info_a));
+	ut_asserteq(-1, ext4fs_open("/missing", &len));
+	root_a = ext4fs_root;
+
+	/* so they must not be used when the second image is mounted */
+	ut_assertok(ext4_test_mount_direct(uts, desc_b, &info_b));
+	free(root_a);
+	ut_assertok(ext4fs_open("/small/a", &len));
+	ut_asserteq(1, len);
+	ut_assertok(ext4fs_read(&ch, 0, len, &actread));
+	ut_asserteq(1, actread);
+	ut_asserteq('a', ch);
+	ext4fs_close();
+
+	ut_assertok(ext4_test_detach_copy(uts, ".a", dev_a));
+	ut_assertok(ext4_test_detach_copy(uts, ".b", dev_b));
+
+	return 0;
+}
+DM_TEST(dm_test_ext4_extents_dev, UT_TESTF_SCAN_FDT);
@@ -7,6 +7,7 @@
 #include <blk.h>
 #include <dm.h>
 #include <fs.h>
+#include <mapmem.h>
 #include <os.h>
 #include <sandbox_host.h>
 #include <asm/test.h>
@@ -74,6 +75,94 @@ static int dm_test_host(struct unit_test_state *uts)
 }
 DM_TEST(dm_test_host, UT_TESTF_SCAN_FDT);
 
+/* Wipe the superblock of a filesystem and check what the fs layer notices */
+static int host_fs_mount_wipe(struct unit_test_state *uts,
+			      struct blk_desc *desc, int fd, const char *sb)
+{
+	char zero[1024];
+	loff_t size;
+
+	/* change the device behind the back of the block layer */
+	memset(zero, '\0', sizeof(zero));
+	ut_asserteq(1024, os_lseek(fd, 1024, OS_SEEK_SET));
+	ut_asserteq(sizeof(zero), os_write(fd, zero, sizeof(zero)));
+	blkcache_invalidate(desc->uclass_id, desc->devnum);
+
+	/* the filesystem is still open, so this does not notice */
+	ut_assertok(fs_set_blk_dev_with_part(desc, 0));
+	ut_assertok(fs_size("/mount", &size));
+
+	/* once the change is reported, it is probed again */
+	fs_invalidate(desc);
+	ut_asserteq(-1, fs_set_blk_dev_with_part(desc, 0));
+
+	/* a write through the block layer is noticed straight away */
+	ut_asserteq(2, blk_dwrite(desc, 2, 2, sb));
+	ut_assertok(fs_set_blk_dev_with_part(desc, 0));
+	ut_assertok(fs_size("/mount", &size));
+	ut_asserteq(2, blk_dwrite(desc, 2, 2, zero));
+	ut_asserteq(-1, fs_set_blk_dev_with_part(desc, 0));
+
+	return 0;
+}
+
+/* Check that a filesystem is kept open only while its device is unchanged */
+static int dm_test_host_fs_mount(struct unit_test_state *uts)
+{
+	static char label[] = "test";
+	struct udevice *dev, *blk, *part;
+	struct blk_desc *desc;
+	char fname[256], sb[1024];
+	loff_t actwrite, size;
+	ulong mem_start;
+	void *buf;
+	int fd, ret;
+
+	if (!CONFIG_IS_ENABLED(FS_MOUNT_CACHE))
+		return -EAGAIN;
+
+	/* the image is shared with other tests, so change a private copy */
+	ut_assertok(os_persistent_file(fname, sizeof(fname), "2MB.ext2.img"));
+	ut_assertok(os_read_file(fname, &buf, &ret));
+	memcpy(sb, buf + 1024, sizeof(sb));
+	strlcat(fname, ".mount", sizeof(fname));
+	ret = os_write_file(fname, buf, ret);
+	os_free(buf);
+	ut_assertok(ret);
+
+	/* set up the uclasses so they are not counted below */
+	ut_asserteq(-ENODEV, uclass_first_device_err(UCLASS_HOST, &dev));
+	ut_asserteq(-ENODEV, uclass_first_device_err(UCLASS_PARTITION, &part));
+	mem_start = ut_check_delta(0);
+	ut_assertok(host_create_device(label, true, DEFAULT_BLKSZ, &dev));
+	ut_assertok(host_attach_file(dev, fname));
+	ut_assertok(blk_get_from_parent(dev, &blk));
+	ut_assertok(device_probe(blk));
+	desc = dev_get_uclass_plat(blk);
+
+	memset(map_sysmem(0x1000, 0x1000), 0xa5, 0x1000);
+	ut_assertok(fs_set_blk_dev_with_part(desc, 0));
+	ut_assertok(fs_write("/mount", 0x1000, 0, 0x1000, &actwrite));
+	ut_assertok(fs_set_blk_dev_with_part(desc, 0));
+	ut_assertok(fs_size("/mount", &size));
+	ut_asserteq(0x1000, size);
+
+	fd = os_open(fname, OS_O_RDWR);
+	ut_assert(fd >= 0);
+	ret = host_fs_mount_wipe(uts, desc, fd, sb);
+	os_close(fd);
+	ut_assertok(ret);
+
+	/* removing the device closes the filesystem kept open on it */
+	ut_assertok(host_detach_file(dev));
+	ut_assertok(device_unbind(dev));
+	ut_asserteq(0, ut_check_delta(mem_start));
+	ut_assertok(os_unlink(fname));
+
+	return 0;
+}
+DM_TEST(dm_test_host_fs_mount, UT_TESTF_SCAN_FDT);
+
 /* reusing the same label should work */
 static int dm_test_host_dup(struct unit_test_state *uts)
 {
@@ -51,3 +51,39 @@ static int dm_test_mmc_blk(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_mmc_blk, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
+
+/* Test multiple-block transfers with and without SET_BLOCK_COUNT */
+static int dm_test_mmc_cmd23(struct unit_test_state *uts)
+{
+	struct blk_desc *dev_desc;
+	struct udevice *dev;
+	struct mmc *mmc;
+	char write[16 * 512], read[16 * 512];
+	int i;
+
+	ut_assertok(uclass_get_device(UCLASS_MMC, 0, &dev));
+	ut_assertok(blk_get_device_by_str("mmc", "0", &dev_desc));
+	mmc = mmc_get_mmc_dev(dev);
+	ut_assert(mmc->cmd23);
+
+	/* the emulator rejects a STOP_TRANSMISSION after a CMD23 transfer */
+	for (i = 0; i < sizeof(write); i++)
+		write[i] = i * 3;
+	ut_asserteq(16, blk_dwrite(dev_desc, 8, 16, write));
+	ut_asserteq(16, blk_dread(dev_desc, 8, 16, read));
+	ut_asserteq_mem(write, read, sizeof(write));
+
+	mmc->cmd23 = false;
+	memset(read, '\0', sizeof(read));
+	ut_asserteq(16, blk_dwrite(dev_desc, 32, 16, write));
+	ut_asserteq(16, blk_dread(dev_desc, 32, 16, read));
+	ut_asserteq_mem(write, read, sizeof(write));
+	mmc->cmd23 = true;
+
+	/* reliable writes are only available on eMMC */
+	ut_asserteq(-EOPNOTSUPP, mmc_set_rel_write(mmc, true));
+	ut_assertok(mmc_set_rel_write(mmc, false));
+
+	return 0;
+}
+DM_TEST(dm_test_mmc_cmd23, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
@@ -0,0 +1,71 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for the NVMe driver, using the sandbox emulator
+ */
+
+#include <blk.h>
+#include <dm.h>
+#include <malloc.h>
+#include <dm/device-internal.h>
+#include <dm/lists.h>
+#include <dm/root.h>
+#include <dm/test.h>
+#include <asm/test.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+/* Transfers which need many commands, all in flight together */
+static int dm_test_nvme_multi(struct unit_test_state *uts)
+{
+	struct udevice *dev, *blk;
+	struct blk_desc *desc;
+	int io_count, max_batch, bad_completes, start;
+	const int count = 500;
+	char *buf, *out;
+	int i;
+
+	sandbox_set_enable_memio(true);
+	ut_assertok(device_bind_driver(dm_root(), "sandbox_nvme", "nvme-test",
+				       &dev));
+	ut_assertok(device_probe(dev));
+	ut_assertok(device_find_first_child_by_uclass(dev, UCLASS_BLK, &blk));
+	desc = dev_get_uclass_plat(blk);
+	ut_asserteq(512, desc->blksz);
+	ut_asserteq(2048, desc->lba);
+
+	/* start part-way through a page, so that PRP lists are needed */
+	buf = memalign(4096, (count + 1) * 512);
+	out = memalign(4096, (count + 1) * 512);
+	ut_assertnonnull(buf);
+	ut_assertnonnull(out);
+	for (i = 0; i < count * 512; i++)
+		buf[8 + i] = i * 7 + i / 512;
+
+	/* probing read the partition table, so count from here */
+	sandbox_nvme_get_stats(dev, &start, &max_batch, &bad_completes);
+	ut_asserteq(count, blk_write(blk, 10, count, buf + 8));
+	ut_asserteq(count, blk_read(blk, 10, count, out + 8));
+	ut_asserteq_mem(buf + 8, out + 8, count * 512);
+
+	/*
+	 * Each command carries up to 32 blocks, so each transfer needs 16.
+	 * They all go to the controller at once and complete out of order.
+	 * Probing may have sent a larger batch
+	 */
+	sandbox_nvme_get_stats(dev, &io_count, &max_batch, &bad_completes);
+	ut_asserteq(32, io_count - start);
+	ut_assert(max_batch >= 16);
+	ut_asserteq(0, bad_completes);
+
+	/* a short read at the end of the namespace */
+	ut_asserteq(3, blk_read(blk, 2045, 3, out));
+	ut_asserteq(0, blk_read(blk, 2048, 1, out));
+
+	free(out);
+	free(buf);
+	ut_assertok(device_remove(dev, DM_REMOVE_NORMAL));
+	ut_assertok(device_unbind(dev));
+
+	return 0;
+}
+DM_TEST(dm_test_nvme_multi, UT_TESTF_SCAN_FDT);
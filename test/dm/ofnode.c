@@ -19,6 +19,7 @@
 #include <abuf.h>
 #include <dm.h>
 #include <log.h>
+#include <malloc.h>
 #include <of_live.h>
 #include <dm/device-internal.h>
 #include <dm/lists.h>
@@ -89,7 +90,7 @@ int get_oftree(struct unit_test_state *uts, void *fdt, oftree *treep)
 void free_oftree(oftree tree)
 {
 	if (of_live_active())
-		free(tree.np);
+		of_live_free(tree.np);
 }
 
 /* test ofnode_device_is_compatible() */
@@ -1365,6 +1366,60 @@ static int dm_test_livetree_ensure(struct unit_test_state *uts)
 }
 DM_TEST(dm_test_livetree_ensure, UT_TESTF_SCAN_FDT);
 
+#if CONFIG_IS_ENABLED(OF_LIVE_LAZY)
+/* check that the properties of a node are only read when first used */
+static int dm_test_livetree_lazy(struct unit_test_state *uts)
+{
+	oftree tree = get_other_oftree(uts);
+	struct device_node *np;
+	ofnode node;
+
+	/* finding a node does not need its properties */
+	node = oftree_path(tree, "/node/subnode");
+	ut_assert(ofnode_valid(node));
+	np = ofnode_to_np(node);
+	ut_assertnonnull(np->lazy);
+	ut_assert(np->offset != -1);
+	ut_assertnull(np->properties);
+
+	ut_asserteq_str("other", ofnode_read_string(node, "str-prop"));
+	ut_asserteq(-1, np->offset);
+	ut_assertnonnull(np->properties);
+	ut_asserteq_ptr(np->lazy, np->properties);
+	ut_asserteq_str("compatible", np->properties->name);
+	ut_asserteq_str("str-prop", np->properties->next->name);
+	ut_assertnull(np->properties->next->next);
+
+	/* the phandle and type are known before the properties are read */
+	np = ofnode_to_np(oftree_path(tree, "/target"));
+	ut_assert(np->offset != -1);
+	ut_assert(np->phandle);
+	ut_asserteq_str("<NULL>", np->type);
+
+	/* writing a property reads the others first */
+	node = oftree_path(tree, "/node/subnode2");
+	ut_assertok(ofnode_write_string(node, "str-prop", "new"));
+	np = ofnode_to_np(node);
+	ut_asserteq(-1, np->offset);
+	ut_asserteq_str("new", ofnode_read_string(node, "str-prop"));
+
+	/* a node whose properties cannot be read is disabled */
+	node = oftree_path(tree, "/node");
+	np = ofnode_to_np(node);
+	malloc_enable_testing(0);
+	ut_assert(!ofnode_is_enabled(node));
+	malloc_disable_testing();
+	ut_asserteq(-1, np->offset);
+	ut_assertnull(np->lazy);
+	ut_assert(!ofnode_is_enabled(node));
+	ut_assertnull(ofnode_get_property(node, "target", NULL));
+
+	return 0;
+}
+DM_TEST(dm_test_livetree_lazy, UT_TESTF_SCAN_FDT | UT_TESTF_LIVE_TREE |
+	UT_TESTF_OTHER_FDT);
+#endif
+
 static int dm_test_oftree_new(struct unit_test_state *uts)
 {
 	ofnode node, subnode, check;
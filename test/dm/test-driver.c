@@ -13,10 +13,13 @@
 #include <asm/io.h>
 #include <dm/device-internal.h>
 #include <dm/test.h>
+#include <linux/delay.h>
 #include <test/test.h>
 #include <test/ut.h>
 
 int dm_testdrv_op_count[DM_TEST_OP_COUNT];
+int dm_test_slow_probing;
+int dm_test_slow_probing_max;
 
 static int testdrv_ping(struct udevice *dev, int pingval, int *pingret)
 {
@@ -197,3 +200,25 @@ U_BOOT_DRIVER(test_act_dma_vital_clk_drv) = {
 	.unbind	= test_manual_unbind,
 	.flags	= DM_FLAG_VITAL | DM_FLAG_ACTIVE_DMA,
 };
+
+static int test_slow_probe(struct udevice *dev)
+{
+	/* stand in for hardware which takes a while to come up */
+	dm_test_slow_probing++;
+	dm_test_slow_probing_max = max(dm_test_slow_probing,
+				       dm_test_slow_probing_max);
+	mdelay(50);
+	dm_test_slow_probing--;
+
+	return test_manual_probe(dev);
+}
+
+U_BOOT_DRIVER(test_slow_drv) = {
+	.name	= "test_slow_drv",
+	.id	= UCLASS_TEST,
+	.ops	= &test_manual_ops,
+	.bind	= test_manual_bind,
+	.probe	= test_slow_probe,
+	.remove	= test_manual_remove,
+	.unbind	= test_manual_unbind,
+};
@@ -81,8 +81,12 @@ static int compress_frame_buffer(struct unit_test_state *uts,
 	if (ret)
 		return ret;
 
-	/* Check here that the copy frame buffer is working correctly */
+	/*
+	 * Check here that the copy frame buffer is working correctly. With
+	 * damage tracking it is only updated by a sync
+	 */
 	if (IS_ENABLED(CONFIG_VIDEO_COPY)) {
+		ut_assertok(video_sync(dev, false));
 		ut_assertf(!memcmp(uc_priv->fb, uc_priv->copy_fb,
 				   uc_priv->fb_size),
 				   "Copy framebuffer does not match fb");
@@ -213,6 +217,68 @@ static int dm_test_video_text_12x22(struct unit_test_state *uts)
 }
 DM_TEST(dm_test_video_text_12x22, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
 
+/* Test that only the area drawn is synced and that scrolling pans */
+static int dm_test_video_damage(struct unit_test_state *uts)
+{
+	struct video_priv *priv;
+	struct udevice *dev, *con;
+	void *base, *fb;
+	int i;
+
+	ut_assertok(select_vidconsole(uts, "vidconsole0"));
+	ut_assertok(video_get_nologo(uts, &dev));
+	ut_assertok(uclass_get_device(UCLASS_VIDEO_CONSOLE, 0, &con));
+	ut_assertok(vidconsole_select_font(con, "8x16", 0));
+	priv = dev_get_uclass_priv(dev);
+	ut_asserteq(46, compress_frame_buffer(uts, dev));
+	ut_asserteq(0, priv->damage.x1);
+
+	vidconsole_putc_xy(con, VID_TO_POS(16), 32, 'a');
+	if (IS_ENABLED(CONFIG_VIDEO_DAMAGE)) {
+		ut_asserteq(16, priv->damage.x0);
+		ut_asserteq(32, priv->damage.y0);
+		ut_asserteq(24, priv->damage.x1);
+		ut_asserteq(48, priv->damage.y1);
+	}
+	ut_assert(compress_frame_buffer(uts, dev) > 46);
+	ut_asserteq(0, priv->damage.x1);
+
+	/* scrolling moves the frame buffer along by a line of text */
+	base = priv->fb;
+	ut_assert(priv->fb_space);
+	for (i = 0; i < priv->ysize / 16; i++)
+		vidconsole_put_string(con, "\n");
+	ut_asserteq(16 * priv->line_length, priv->fb_offset);
+	ut_asserteq_ptr(base + priv->fb_offset, priv->fb);
+
+	/* moving part of the frame buffer does not pan */
+	fb = priv->fb;
+	ut_assertok(vidconsole_memmove(con, priv->fb, priv->fb +
+				       16 * priv->line_length,
+				       priv->line_length));
+	ut_asserteq_ptr(fb, priv->fb);
+
+	/* once it reaches the end of the memory it goes back to the start */
+	for (i = 0; priv->fb_offset && i < priv->fb_space / priv->line_length;
+	     i++)
+		vidconsole_put_string(con, "\n");
+	ut_asserteq_ptr(base, priv->fb);
+	ut_asserteq(46, compress_frame_buffer(uts, dev));
+
+	/* once panning is disabled for the OS, the frame buffer stays put */
+	vidconsole_put_string(con, "\n");
+	ut_assert(priv->fb_offset);
+	video_disable_pan_all();
+	ut_asserteq_ptr(base, priv->fb);
+	ut_asserteq(0, priv->fb_space);
+	vidconsole_put_string(con, "\n");
+	ut_asserteq_ptr(base, priv->fb);
+	ut_asserteq(46, compress_frame_buffer(uts, dev));
+
+	return 0;
+}
+DM_TEST(dm_test_video_damage, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
+
 /* Test handling of special characters in the console */
 static int dm_test_video_chars(struct unit_test_state *uts)
 {
@@ -556,7 +622,7 @@ static int dm_test_video_truetype(struct unit_test_state *uts)
 	ut_assertok(video_get_nologo(uts, &dev));
 	ut_assertok(uclass_get_device(UCLASS_VIDEO_CONSOLE, 0, &con));
 	vidconsole_put_string(con, test_string);
-	ut_asserteq(12174, compress_frame_buffer(uts, dev));
+	ut_asserteq(8870, compress_frame_buffer(uts, dev));
 
 	return 0;
 }
@@ -577,7 +643,7 @@ static int dm_test_video_truetype_scroll(struct unit_test_state *uts)
 	ut_assertok(video_get_nologo(uts, &dev));
 	ut_assertok(uclass_get_device(UCLASS_VIDEO_CONSOLE, 0, &con));
 	vidconsole_put_string(con, test_string);
-	ut_asserteq(34287, compress_frame_buffer(uts, dev));
+	ut_asserteq(28206, compress_frame_buffer(uts, dev));
 
 	return 0;
 }
@@ -598,8 +664,34 @@ static int dm_test_video_truetype_bs(struct unit_test_state *uts)
 	ut_assertok(video_get_nologo(uts, &dev));
 	ut_assertok(uclass_get_device(UCLASS_VIDEO_CONSOLE, 0, &con));
 	vidconsole_put_string(con, test_string);
-	ut_asserteq(29471, compress_frame_buffer(uts, dev));
+	ut_asserteq(24608, compress_frame_buffer(uts, dev));
 
 	return 0;
 }
 DM_TEST(dm_test_video_truetype_bs, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
+
+/* Test that TrueType characters are rendered once and then cached */
+static int dm_test_video_truetype_cache(struct unit_test_state *uts)
+{
+	const char *test_string = "Cached glyphs";
+	struct udevice *dev, *con;
+	uint hits, misses, hits2, misses2;
+	int count;
+
+	ut_assertok(video_get_nologo(uts, &dev));
+	ut_assertok(uclass_get_device(UCLASS_VIDEO_CONSOLE, 0, &con));
+	vidconsole_put_string(con, test_string);
+	count = console_truetype_glyph_stats(con, &hits, &misses);
+	ut_asserteq(strlen(test_string), hits + misses);
+	ut_asserteq(misses, count);
+
+	/* the same text at the same positions needs nothing rendering */
+	vidconsole_put_string(con, "\n");
+	vidconsole_put_string(con, test_string);
+	ut_asserteq(count, console_truetype_glyph_stats(con, &hits2, &misses2));
+	ut_asserteq(misses, misses2);
+	ut_asserteq(hits + strlen(test_string), hits2);
+
+	return 0;
+}
+DM_TEST(dm_test_video_truetype_cache, UT_TESTF_SCAN_PDATA | UT_TESTF_SCAN_FDT);
@@ -41,6 +41,7 @@ void *board_spl_fit_buffer_addr(ulong fit_size, int sectors, int bl_len)
 /* Local flags for spl_image; start from the "top" to avoid conflicts */
 #define SPL_IMX_CONTAINER	0x80000000
 #define SPL_COMP_LZMA		0x40000000
+#define SPL_COMP_GZIP		0x20000000
 
 void generate_data(char *data, size_t size, const char *test_name)
 {
@@ -163,7 +164,7 @@ static size_t start_fit(void *dst, size_t fit_size, size_t data_size,
 static size_t create_fit(void *dst, struct spl_image_info *spl_image,
 			 size_t *data_offset, bool external)
 {
-	size_t prop_size = 596, total_size = prop_size + spl_image->size;
+	size_t prop_size = 608, total_size = prop_size + spl_image->size;
 	size_t off, size;
 
 	if (external) {
@@ -191,7 +192,10 @@ static size_t create_fit(void *dst, struct spl_image_info *spl_image,
 		return 0;
 	if (fdt_property_string(dst, FIT_TYPE_PROP, "firmware"))
 		return 0;
-	if (fdt_property_string(dst, FIT_COMP_PROP, "none"))
+	if (fdt_property_string(dst, FIT_COMP_PROP,
+				spl_image->flags & SPL_COMP_LZMA ? "lzma" :
+				spl_image->flags & SPL_COMP_GZIP ? "gzip" :
+								   "none"))
 		return 0;
 	if (fdt_property_u32(dst, FIT_DATA_SIZE_PROP, spl_image->size))
 		return 0;
@@ -258,6 +262,10 @@ size_t create_image(void *dst, enum spl_test_image type,
 	case IMX8:
 		info->flags = SPL_IMX_CONTAINER;
 		return create_imx8(dst, info, data_offset);
+	case FIT_EXTERNAL_LZMA:
+	case FIT_EXTERNAL_GZIP:
+		info->flags = type == FIT_EXTERNAL_LZMA ? SPL_COMP_LZMA :
+							  SPL_COMP_GZIP;
 	case FIT_EXTERNAL:
 		/*
 		 * spl_fit_append_fdt will clobber external images with U-Boot's
@@ -268,7 +276,7 @@ size_t create_image(void *dst, enum spl_test_image type,
 			info->os = IH_OS_TEE;
 		external = true;
 	case FIT_INTERNAL:
-		info->flags = SPL_FIT_FOUND;
+		info->flags |= SPL_FIT_FOUND;
 		return create_fit(dst, info, data_offset, external);
 	}
 
@@ -297,7 +305,7 @@ int check_image_info(struct unit_test_state *uts, struct spl_image_info *info1,
 		ut_asserteq(info1->load_addr, info2->load_addr);
 		if (info1->flags & SPL_IMX_CONTAINER)
 			ut_asserteq(0, info2->size);
-		else if (!(info1->flags & SPL_COMP_LZMA))
+		else if (!(info1->flags & (SPL_COMP_LZMA | SPL_COMP_GZIP)))
 			ut_asserteq(info1->size, info2->size);
 	} else {
 		ut_asserteq(info1->load_addr - sizeof(struct legacy_img_hdr),
@@ -316,6 +324,98 @@ static ulong spl_test_read(struct spl_load_info *load, ulong sector,
 	return count;
 }
 
+/**
+ * struct gzip_writer - state for writing a deflate stream
+ * @p: Next byte to write, or %NULL to only count the bytes
+ * @bits: Bits waiting to be written, the first in bit 0
+ * @nbits: Number of bits in @bits
+ * @size: Number of bytes written
+ */
+struct gzip_writer {
+	u8 *p;
+	u32 bits;
+	int nbits;
+	size_t size;
+};
+
+static void gzip_put_byte(struct gzip_writer *gw, u8 val)
+{
+	if (gw->p)
+		*gw->p++ = val;
+	gw->size++;
+}
+
+static void gzip_put_bits(struct gzip_writer *gw, u32 val, int count)
+{
+	gw->bits |= val << gw->nbits;
+	gw->nbits += count;
+	for (; gw->nbits >= 8; gw->nbits -= 8, gw->bits >>= 8)
+		gzip_put_byte(gw, gw->bits);
+}
+
+/* Huffman codes are packed starting with their most significant bit */
+static void gzip_put_code(struct gzip_writer *gw, u32 code, int count)
+{
+	while (count--)
+		gzip_put_bits(gw, code >> count & 1, 1);
+}
+
+static void gzip_put_le32(struct gzip_writer *gw, u32 val)
+{
+	int i;
+
+	for (i = 0; i < 4; i++)
+		gzip_put_byte(gw, val >> (i * 8));
+}
+
+/**
+ * create_gzip() - Compress data into a gzip stream
+ * @dst: Where to write the stream, or %NULL to just work out its size
+ * @name: File name to put in the gzip header
+ * @data: Data to compress
+ * @size: Size of @data
+ *
+ * Unlike LZMA, gzip is simple enough to generate on the fly. Each byte is
+ * coded as a literal in a single block with fixed Huffman codes (RFC 1951),
+ * which take 8 or 9 bits each. This does not make the data any smaller, but the
+ * codes end up straddling every possible chunk boundary.
+ *
+ * Return: Size of the stream
+ */
+static size_t create_gzip(void *dst, const char *name, const char *data,
+			  size_t size)
+{
+	static const u8 header[] = { 0x1f, 0x8b, 8, 8, 0, 0, 0, 0, 0, 3 };
+	struct gzip_writer gw = { .p = dst };
+	size_t i;
+
+	for (i = 0; i < sizeof(header); i++)
+		gzip_put_byte(&gw, header[i]);
+	do {
+		gzip_put_byte(&gw, *name);
+	} while (*name++);
+
+	/* last block, fixed Huffman codes */
+	gzip_put_bits(&gw, 1, 1);
+	gzip_put_bits(&gw, 1, 2);
+	for (i = 0; i < size; i++) {
+		u8 val = data[i];
+
+		if (val < 144)
+			gzip_put_code(&gw, 0x30 + val, 8);
+		else
+			gzip_put_code(&gw, 0x190 + val - 144, 9);
+	}
+	/* end of block, then pad out the last byte */
+	gzip_put_code(&gw, 0, 7);
+	gzip_put_bits(&gw, 0, 7);
+
+	gzip_put_le32(&gw, crc32(0, (const u8 *)data, size));
+	gzip_put_le32(&gw, size);
+
+	return gw.size;
+}
+
 static int spl_test_image(struct unit_test_state *uts, const char *test_name,
 			  enum spl_test_image type)
 {
@@ -324,16 +424,37 @@ static int spl_test_image(struct unit_test_state *uts, const char *test_name,
 		.name = test_name,
 		.size = data_size,
 	}, info_read = { };
-	char *data;
+	char *data, *plain = NULL;
 	void *img;
 
+	if (type == FIT_EXTERNAL_LZMA || type == FIT_EXTERNAL_GZIP) {
+		plain = malloc(data_size);
+		ut_assertnonnull(plain);
+	}
+	if (type == FIT_EXTERNAL_LZMA) {
+		generate_data(plain, data_size, "lzma");
+		info_write.size = lzma_compressed_size;
+	} else if (type == FIT_EXTERNAL_GZIP) {
+		generate_data(plain, data_size, test_name);
+		info_write.size = create_gzip(NULL, test_name, plain,
+					      data_size);
+	}
+
 	img_size = create_image(NULL, type, &info_write, &img_data);
 	ut_assert(img_size);
 	img = calloc(img_size, 1);
 	ut_assertnonnull(img);
 
-	data = img + img_data;
-	generate_data(data, data_size, test_name);
+	if (type == FIT_EXTERNAL_LZMA) {
+		memcpy(img + img_data, lzma_compressed, lzma_compressed_size);
+		data = plain;
+	} else if (type == FIT_EXTERNAL_GZIP) {
+		create_gzip(img + img_data, test_name, plain, data_size);
+		data = plain;
+	} else {
+		data = img + img_data;
+		generate_data(data, data_size, test_name);
+	}
 	ut_asserteq(img_size, create_image(img, type, &info_write, NULL));
 
 	if (type == LEGACY) {
@@ -357,10 +478,13 @@ static int spl_test_image(struct unit_test_state *uts, const char *test_name,
 							img));
 		if (check_image_info(uts, &info_write, &info_read))
 			return CMD_RET_FAILURE;
+		if (plain)
+			ut_asserteq(data_size, info_read.size);
 		ut_asserteq_mem(data, phys_to_virt(info_write.load_addr),
 				data_size);
 	}
 
+	free(plain);
 	free(img);
 	return 0;
 }
@@ -368,6 +492,73 @@ SPL_IMG_TEST(spl_test_image, LEGACY, 0);
 SPL_IMG_TEST(spl_test_image, IMX8, 0);
 SPL_IMG_TEST(spl_test_image, FIT_INTERNAL, 0);
 SPL_IMG_TEST(spl_test_image, FIT_EXTERNAL, 0);
+SPL_IMG_TEST(spl_test_image, FIT_EXTERNAL_LZMA, 0);
+SPL_IMG_TEST(spl_test_image, FIT_EXTERNAL_GZIP, 0);
+
+#if CONFIG_IS_ENABLED(FIT_DECOMP_STREAM) && CONFIG_IS_ENABLED(GZIP)
+/* Load a gzip FIT whose header has a file name of @name_len bytes */
+static int spl_test_gzip_name(struct unit_test_state *uts, size_t name_len,
+			      int *retp)
+{
+	size_t img_size, img_data, data_size = SPL_TEST_DATA_SIZE;
+	struct spl_image_info info_write = {
+		.name = "gzip",
+	}, info_read = { };
+	struct spl_load_info load;
+	char *name, *plain;
+	void *img;
+
+	name = malloc(name_len + 1);
+	plain = malloc(data_size);
+	ut_assertnonnull(name);
+	ut_assertnonnull(plain);
+	memset(name, 'n', name_len);
+	name[name_len] = '\0';
+	generate_data(plain, data_size, "gzip");
+	info_write.size = create_gzip(NULL, name, plain, data_size);
+
+	img_size = create_image(NULL, FIT_EXTERNAL_GZIP, &info_write,
+				&img_data);
+	ut_assert(img_size);
+	img = calloc(img_size, 1);
+	ut_assertnonnull(img);
+	create_gzip(img + img_data, name, plain, data_size);
+	ut_asserteq(img_size, create_image(img, FIT_EXTERNAL_GZIP, &info_write,
+					   NULL));
+
+	memset(phys_to_virt(info_write.load_addr), '\0', data_size);
+	spl_set_bl_len(&load, 1);
+	load.priv = img;
+	load.read = spl_test_read;
+	*retp = spl_load_simple_fit(&info_read, &load, 0, img);
+	if (!*retp)
+		ut_asserteq_mem(plain, phys_to_virt(info_write.load_addr),
+				data_size);
+
+	free(img);
+	free(plain);
+	free(name);
+	return 0;
+}
+
+/* Check the gzip header against the first chunk read */
+static int spl_test_gzip_header(struct unit_test_state *uts)
+{
+	const size_t chunk = CONFIG_VAL(FIT_DECOMP_STREAM_CHUNK);
+	int ret;
+
+	/* the header takes up most of the first chunk */
+	ut_assertok(spl_test_gzip_name(uts, chunk - 20, &ret));
+	ut_assertok(ret);
+
+	/* one which goes past it is rejected, without reading past the end */
+	ut_assertok(spl_test_gzip_name(uts, chunk + 20, &ret));
+	ut_assert(ret);
+
+	return 0;
+}
+SPL_TEST(spl_test_gzip_header, 0);
+#endif
 
 /*
  * LZMA is too complex to generate on the fly, so let's use some data I put in
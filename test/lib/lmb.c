@@ -699,12 +699,20 @@ static int lib_test_lmb_max_regions(struct unit_test_state *uts)
 	ut_asserteq(lmb.memory.cnt, CONFIG_LMB_MAX_REGIONS);
 	ut_asserteq(lmb.reserved.cnt, 0);
 
-	/*  error for the (CONFIG_LMB_MAX_REGIONS + 1) memory regions */
+	/*
+	 * the (CONFIG_LMB_MAX_REGIONS + 1) memory region only fits if the
+	 * array can grow
+	 */
 	offset = ram + 2 * (CONFIG_LMB_MAX_REGIONS + 1) * ram_size;
 	ret = lmb_add(&lmb, offset, ram_size);
-	ut_asserteq(ret, -1);
-
-	ut_asserteq(lmb.memory.cnt, CONFIG_LMB_MAX_REGIONS);
+	if (IS_ENABLED(CONFIG_LMB_GROW)) {
+		ut_asserteq(ret, 0);
+		ut_asserteq(lmb.memory.cnt, CONFIG_LMB_MAX_REGIONS + 1);
+		ut_assert(lmb.memory.max > CONFIG_LMB_MAX_REGIONS);
+	} else {
+		ut_asserteq(ret, -1);
+		ut_asserteq(lmb.memory.cnt, CONFIG_LMB_MAX_REGIONS);
+	}
 	ut_asserteq(lmb.reserved.cnt, 0);
 
 	/*  reserve CONFIG_LMB_MAX_REGIONS regions */
@@ -714,16 +722,18 @@ static int lib_test_lmb_max_regions(struct unit_test_state *uts)
 		ut_asserteq(ret, 0);
 	}
 
-	ut_asserteq(lmb.memory.cnt, CONFIG_LMB_MAX_REGIONS);
 	ut_asserteq(lmb.reserved.cnt, CONFIG_LMB_MAX_REGIONS);
 
-	/*  error for the 9th reserved blocks */
+	/*  the (CONFIG_LMB_MAX_REGIONS + 1) reserved block likewise */
 	offset = ram + 2 * (CONFIG_LMB_MAX_REGIONS + 1) * blk_size;
 	ret = lmb_reserve(&lmb, offset, blk_size);
-	ut_asserteq(ret, -1);
-
-	ut_asserteq(lmb.memory.cnt, CONFIG_LMB_MAX_REGIONS);
-	ut_asserteq(lmb.reserved.cnt, CONFIG_LMB_MAX_REGIONS);
+	if (IS_ENABLED(CONFIG_LMB_GROW)) {
+		ut_asserteq(ret, 0);
+		ut_asserteq(lmb.reserved.cnt, CONFIG_LMB_MAX_REGIONS + 1);
+	} else {
+		ut_asserteq(ret, -1);
+		ut_asserteq(lmb.reserved.cnt, CONFIG_LMB_MAX_REGIONS);
+	}
 
 	/*  check each regions */
 	for (i = 0; i < CONFIG_LMB_MAX_REGIONS; i++)
@@ -732,11 +742,115 @@ static int lib_test_lmb_max_regions(struct unit_test_state *uts)
 	for (i = 0; i < CONFIG_LMB_MAX_REGIONS; i++)
 		ut_asserteq(lmb.reserved.region[i].base, ram + 2 * i * blk_size);
 
+	lmb_uninit(&lmb);
+
 	return 0;
 }
 LIB_TEST(lib_test_lmb_max_regions, 0);
 #endif
 
+#ifdef CONFIG_LMB_GROW
+/* Reserve many more regions than fit in struct lmb, in a random order */
+static int lib_test_lmb_grow(struct unit_test_state *uts)
+{
+	const phys_addr_t ram = 0x40000000;
+	const phys_size_t ram_size = 0x10000000;
+	const phys_size_t blk_size = 0x1000;
+	const int count = 1000;
+	phys_addr_t offset;
+	struct lmb lmb;
+	int ret, i;
+
+	lmb_init(&lmb);
+
+	ret = lmb_add(&lmb, ram, ram_size);
+	ut_asserteq(ret, 0);
+
+	/* 397 is prime, so this visits every block once */
+	for (i = 0; i < count; i++) {
+		offset = ram + 2 * ((i * 397) % count) * blk_size;
+		ret = lmb_reserve(&lmb, offset, blk_size);
+		ut_asserteq(ret, 0);
+	}
+	ut_asserteq(lmb.reserved.cnt, count);
+	ut_assert(lmb.reserved.heap);
+
+	for (i = 0; i < count; i++) {
+		ut_asserteq(lmb.reserved.region[i].base,
+			    ram + 2 * i * blk_size);
+		ut_asserteq(lmb.reserved.region[i].size, blk_size);
+	}
+	ut_assert(lmb_is_reserved_flags(&lmb, ram + 2 * 500 * blk_size,
+					LMB_NONE));
+	ut_assert(!lmb_is_reserved_flags(&lmb, ram + 1001 * blk_size,
+					 LMB_NONE));
+
+	/* filling a gap joins its neighbours into one region */
+	for (i = 0; i < count - 1; i++) {
+		offset = ram + (2 * i + 1) * blk_size;
+		ret = lmb_reserve(&lmb, offset, blk_size);
+		ut_asserteq(ret, 2);
+	}
+	ASSERT_LMB(&lmb, ram, ram_size, 1, ram, (2 * count - 1) * blk_size,
+		   0, 0, 0, 0);
+
+	lmb_uninit(&lmb);
+	ut_asserteq(lmb.reserved.cnt, 0);
+	ut_assert(!lmb.reserved.heap);
+
+	return 0;
+}
+LIB_TEST(lib_test_lmb_grow, 0);
+#endif
+
+/* Best fit takes the smallest gap which is large enough */
+static int lib_test_lmb_best_fit(struct unit_test_state *uts)
+{
+	const phys_addr_t ram = 0x40000000;
+	const phys_size_t ram_size = 0x20000000;
+	phys_addr_t a;
+	struct lmb lmb;
+	long ret;
+
+	lmb_init(&lmb);
+	lmb.best_fit = true;
+
+	ret = lmb_add(&lmb, ram, ram_size);
+	ut_asserteq(ret, 0);
+
+	/* leave gaps of 0x10000 at 0x40100000 and 0x4000 at 0x40210000 */
+	ret = lmb_reserve(&lmb, ram, 0x100000);
+	ut_asserteq(ret, 0);
+	ret = lmb_reserve(&lmb, 0x40110000, 0x100000);
+	ut_asserteq(ret, 0);
+	ret = lmb_reserve(&lmb, 0x40214000, 0x100000);
+	ut_asserteq(ret, 0);
+	ASSERT_LMB(&lmb, ram, ram_size, 3, ram, 0x100000,
+		   0x40110000, 0x100000, 0x40214000, 0x100000);
+
+	/* the small gap is filled from the top */
+	a = lmb_alloc(&lmb, 0x1000, 0x1000);
+	ut_asserteq(a, 0x40213000);
+
+	/* too large for the small gap, so the medium one is used */
+	a = lmb_alloc(&lmb, 0x8000, 0x1000);
+	ut_asserteq(a, 0x40108000);
+
+	/* only the end of memory is left for this one */
+	a = lmb_alloc(&lmb, 0x10000, 0x1000);
+	ut_asserteq(a, ram + ram_size - 0x10000);
+
+	/* a top-down allocation would take the end of memory again */
+	lmb.best_fit = false;
+	a = lmb_alloc(&lmb, 0x1000, 0x1000);
+	ut_asserteq(a, ram + ram_size - 0x11000);
+
+	lmb_uninit(&lmb);
+
+	return 0;
+}
+LIB_TEST(lib_test_lmb_best_fit, 0);
+
 static int lib_test_lmb_flags(struct unit_test_state *uts)
 {
 	const phys_addr_t ram = 0x40000000;
@@ -0,0 +1,165 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Unit tests and benchmark for crc32 and crc32c
+ */
+
+#include <malloc.h>
+#include <time.h>
+#include <test/lib.h>
+#include <test/test.h>
+#include <test/ut.h>
+#include <u-boot/crc.h>
+#include <linux/sizes.h>
+
+#define CRC32_POLY	0xedb88320
+#define CRC32C_POLY	0x82f63b78
+
+static const char crc_check_str[] = "123456789";
+
+/* Fill a buffer with a repeatable pattern which is not all the same byte */
+static void crc_test_fill(u8 *buf, int size)
+{
+	u32 seed = 1;
+	int i;
+
+	for (i = 0; i < size; i++) {
+		seed = seed * 1103515245 + 12345;
+		buf[i] = seed >> 16;
+	}
+}
+
+/*
+ * Set up the table for the byte-at-a-time reference version; this is kept
+ * here so that the tests do not depend on CONFIG_CRC32C
+ */
+static void crc_test_init(u32 *table, u32 poly)
+{
+	u32 v;
+	int i, j;
+
+	for (i = 0; i < 256; i++) {
+		v = i;
+		for (j = 0; j < 8; j++)
+			v = (v >> 1) ^ ((v & 1) ? poly : 0);
+		table[i] = v;
+	}
+}
+
+static u32 crc_test_bytewise(const u32 *table, u32 crc, const u8 *buf,
+			     uint len)
+{
+	while (len--)
+		crc = table[(u8)(crc ^ *buf++)] ^ (crc >> 8);
+
+	return crc;
+}
+
+/*
+ * Check a CRC implementation against the byte-at-a-time table version, over
+ * every alignment and all the lengths around the eight-byte loop boundaries
+ */
+static int crc_test_compare(struct unit_test_state *uts, u32 poly,
+			    u32 (*calc)(u32 crc, const u8 *buf, uint len))
+{
+	u32 table[256];
+	u8 buf[256];
+	int ofs, len;
+
+	crc_test_init(table, poly);
+	crc_test_fill(buf, sizeof(buf));
+	for (ofs = 0; ofs < 8; ofs++) {
+		for (len = 0; len + ofs <= sizeof(buf); len++) {
+			u32 expect;
+
+			expect = crc_test_bytewise(table, ~0, buf + ofs, len);
+			ut_asserteq(expect, calc(~0, buf + ofs, len));
+		}
+	}
+
+	return 0;
+}
+
+static u32 crc_test_crc32(u32 crc, const u8 *buf, uint len)
+{
+	return crc32_no_comp(crc, buf, len);
+}
+
+static int lib_crc32(struct unit_test_state *uts)
+{
+	const u8 *str = (const u8 *)crc_check_str;
+
+	ut_asserteq(0xcbf43926, crc32(0, str, strlen(crc_check_str)));
+
+	/* a CRC can be continued from where it left off */
+	ut_asserteq(0xcbf43926, crc32(crc32(0, str, 4), str + 4,
+				      strlen(crc_check_str) - 4));
+
+	ut_assertok(crc_test_compare(uts, CRC32_POLY, crc_test_crc32));
+
+	return 0;
+}
+LIB_TEST(lib_crc32, 0);
+
+#if CONFIG_IS_ENABLED(CRC32C)
+static u32 crc_test_crc32c(u32 crc, const u8 *buf, uint len)
+{
+	return crc32c(crc, buf, len);
+}
+
+static int lib_crc32c(struct unit_test_state *uts)
+{
+	ut_asserteq(0xe3069283, ~crc32c(~0, crc_check_str,
+					strlen(crc_check_str)));
+	ut_assertok(crc_test_compare(uts, CRC32C_POLY, crc_test_crc32c));
+
+	return 0;
+}
+LIB_TEST(lib_crc32c, 0);
+#endif
+
+static u32 crc_bench_table[256];
+
+static u32 crc_bench_bytewise(u32 crc, const u8 *buf, uint len)
+{
+	return crc_test_bytewise(crc_bench_table, crc, buf, len);
+}
+
+static void crc_bench_one(const char *name, const u8 *buf, uint size,
+			  u32 (*calc)(u32 crc, const u8 *buf, uint len))
+{
+	u64 start, us;
+	u32 crc = ~0;
+	int i;
+
+	start = get_timer_us(0);
+	for (i = 0; i < 16; i++)
+		crc = calc(crc, buf, size);
+	us = get_timer_us(start);
+
+	printf("%-20s %8lld us  %6lld MB/s  (crc %08x)\n", name, us,
+	       us ? (16ULL * size) / us : 0, crc);
+}
+
+/* Compare the speed of the byte-at-a-time tables with the library versions */
+static int lib_crc32_bench_norun(struct unit_test_state *uts)
+{
+	const uint size = SZ_1M;
+	u8 *buf;
+
+	buf = malloc(size);
+	ut_assertnonnull(buf);
+	crc_test_fill(buf, size);
+
+	crc_test_init(crc_bench_table, CRC32_POLY);
+	crc_bench_one("crc32 bytewise", buf, size, crc_bench_bytewise);
+	crc_bench_one("crc32", buf, size, crc_test_crc32);
+#if CONFIG_IS_ENABLED(CRC32C)
+	crc_test_init(crc_bench_table, CRC32C_POLY);
+	crc_bench_one("crc32c bytewise", buf, size, crc_bench_bytewise);
+	crc_bench_one("crc32c", buf, size, crc_test_crc32c);
+#endif
+	free(buf);
+
+	return 0;
+}
+LIB_TEST(lib_crc32_bench_norun, UT_TESTF_MANUAL);
@@ -0,0 +1,131 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Test cooperative threads
+ */
+
+#include <uthread.h>
+#include <linux/kernel.h>
+#include <test/lib.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+#define UTHREAD_TEST_LOOPS	5
+
+static void uthread_test_worker(void *arg)
+{
+	int *count = arg;
+	int i;
+
+	for (i = 0; i < UTHREAD_TEST_LOOPS; i++) {
+		(*count)++;
+		uthread_schedule();
+	}
+}
+
+/* Test that threads take turns, and that groups finish */
+static int lib_test_uthread(struct unit_test_state *uts)
+{
+	struct uthread uthr;
+	unsigned int grp_id, other_id;
+	int count[3] = {};
+	int i;
+
+	ut_assert(!uthread_schedule());
+
+	grp_id = uthread_grp_new_id();
+	other_id = uthread_grp_new_id();
+	ut_assert(grp_id);
+	ut_assert(grp_id != other_id);
+	ut_assertok(uthread_create(NULL, uthread_test_worker, &count[0], 0,
+				   grp_id));
+	ut_assertok(uthread_create(NULL, uthread_test_worker, &count[1], 0,
+				   grp_id));
+	ut_assertok(uthread_create(&uthr, uthread_test_worker, &count[2], 0,
+				   other_id));
+
+	/* nothing runs until this thread yields */
+	ut_asserteq(0, count[0] + count[1] + count[2]);
+	ut_assert(!uthread_grp_done(grp_id));
+
+	/* each thread gets one turn per round */
+	for (i = 1; i <= UTHREAD_TEST_LOOPS; i++) {
+		ut_assert(uthread_schedule());
+		ut_asserteq(i, count[0]);
+		ut_asserteq(i, count[1]);
+		ut_asserteq(i, count[2]);
+	}
+
+	/* one more round lets them all return */
+	ut_assert(!uthread_grp_done(grp_id));
+	ut_assert(uthread_schedule());
+	ut_assert(uthread_grp_done(grp_id));
+	ut_assert(uthread_grp_done(other_id));
+	ut_assert(uthr.done);
+
+	/* the finished threads have been reaped */
+	ut_assert(!uthread_schedule());
+	ut_asserteq(UTHREAD_TEST_LOOPS, count[0]);
+
+	return 0;
+}
+LIB_TEST(lib_test_uthread, 0);
+
+struct uthread_mutex_test {
+	struct uthread_mutex mutex;
+	int inside;
+	int max_inside;
+	int done;
+};
+
+static void uthread_mutex_test_worker(void *arg)
+{
+	struct uthread_mutex_test *mt = arg;
+	int i;
+
+	for (i = 0; i < UTHREAD_TEST_LOOPS; i++) {
+		uthread_mutex_lock(&mt->mutex);
+		/* the holder may take it again */
+		uthread_mutex_lock(&mt->mutex);
+		mt->max_inside = max(mt->max_inside, ++mt->inside);
+		uthread_schedule();
+		mt->inside--;
+		uthread_mutex_unlock(&mt->mutex);
+		uthread_schedule();
+		uthread_mutex_unlock(&mt->mutex);
+		mt->done++;
+		uthread_schedule();
+	}
+}
+
+/* Test that a mutex keeps other threads out while its holder yields */
+static int lib_test_uthread_mutex(struct unit_test_state *uts)
+{
+	struct uthread_mutex_test mt = {};
+	unsigned int grp_id;
+	int i;
+
+	grp_id = uthread_grp_new_id();
+	for (i = 0; i < 3; i++)
+		ut_assertok(uthread_create(NULL, uthread_mutex_test_worker,
+					   &mt, 0, grp_id));
+
+	/* while this thread holds it, the others cannot get in */
+	uthread_mutex_lock(&mt.mutex);
+	for (i = 0; i < UTHREAD_TEST_LOOPS; i++)
+		ut_assert(uthread_schedule());
+	ut_asserteq(0, mt.max_inside);
+	uthread_mutex_unlock(&mt.mutex);
+
+	while (!uthread_grp_done(grp_id))
+		uthread_schedule();
+	ut_asserteq(1, mt.max_inside);
+	ut_asserteq(3 * UTHREAD_TEST_LOOPS, mt.done);
+
+	/* a free mutex can be taken at once */
+	uthread_mutex_lock(&mt.mutex);
+	uthread_mutex_unlock(&mt.mutex);
+	ut_assert(!uthread_schedule());
+
+	return 0;
+}
+LIB_TEST(lib_test_uthread_mutex, 0);
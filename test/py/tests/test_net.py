@@ -8,7 +8,10 @@ import pytest
 import u_boot_utils
 import uuid
 import datetime
+import http.server
 import re
+import threading
+import zlib
 
 """
 Note: This test relies on boardenv_* containing configuration values to define
@@ -86,6 +89,17 @@ env__net_pxe_readable_file = {
 # be tested. If router advertisement testing is not possible or desired, this
 variable may be omitted or set to False.
 env__router_on_net = True
+
+# Details of an HTTP server which the wget test starts on the host running the
+# tests. The board must be able to reach the host at this address. This
+# variable may be omitted or set to None if wget testing is not possible or
+# desired.
+env__net_wget_server = {
+    'ip': '10.0.0.1',
+    'port': 8080,
+    'addr': 0x10000000,
+    'size': 4 * 1024 * 1024,
+}
 """
 
 net_set_up = False
@@ -456,3 +470,101 @@ def test_net_tftpput(u_boot_console):
 
     output = u_boot_console.run_command("crc32 $fileaddr $filesize")
     assert expected_tftpb_crc in output
+
+WGET_DATE = 'Tue, 01 Oct 2024 12:00:00 GMT'
+
+class WgetHandler(http.server.BaseHTTPRequestHandler):
+    """Serve one file over HTTP/1.1, with keep-alive and byte ranges
+
+    The server counts the connections and requests, and can close the
+    connection part way through the file once, to check that wget resumes.
+    """
+    protocol_version = 'HTTP/1.1'
+
+    def setup(self):
+        self.server.connections += 1
+        super().setup()
+
+    def do_GET(self):
+        srv = self.server
+        data = srv.data
+        start = 0
+        rng = self.headers.get('Range')
+        srv.ranges.append(rng)
+        if (rng and rng.startswith('bytes=') and
+                self.headers.get('If-Range') == WGET_DATE):
+            start = int(rng[6:].split('-')[0])
+            self.send_response(206)
+            self.send_header('Content-Range', 'bytes %d-%d/%d' %
+                             (start, len(data) - 1, len(data)))
+        else:
+            self.send_response(200)
+        self.send_header('Content-Length', str(len(data) - start))
+        self.send_header('Accept-Ranges', 'bytes')
+        self.send_header('Last-Modified', WGET_DATE)
+        self.end_headers()
+        if srv.cut_at:
+            self.wfile.write(data[start:srv.cut_at])
+            srv.cut_at = 0
+            self.close_connection = True
+        else:
+            self.wfile.write(data[start:])
+
+    def log_message(self, *args):
+        pass
+
+@pytest.mark.buildconfigspec('cmd_wget')
+@pytest.mark.buildconfigspec('wget_keepalive')
+@pytest.mark.buildconfigspec('wget_resume')
+def test_net_wget(u_boot_console):
+    """Test that wget keeps its connection open and resumes transfers.
+
+    An HTTP server is started on the host; the details are provided by the
+    boardenv_* file, see the comment at the beginning of this file.
+    """
+
+    if not net_set_up:
+        pytest.skip('Network not initialized')
+
+    f = u_boot_console.config.env.get('env__net_wget_server', None)
+    if not f:
+        pytest.skip('No HTTP server address for wget')
+
+    size = f.get('size', 4 * 1024 * 1024)
+    server = http.server.ThreadingHTTPServer(('', f['port']), WgetHandler)
+    server.data = bytes((i * 7 + (i >> 8)) & 0xff for i in range(size))
+    server.connections = 0
+    server.ranges = []
+    server.cut_at = 0
+    thread = threading.Thread(target=server.serve_forever, daemon=True)
+    thread.start()
+
+    expected = 'Bytes transferred = %d' % size
+    crc = '%08x' % zlib.crc32(server.data)
+    cmd = 'wget %x %s:/file.bin' % (f['addr'], f['ip'])
+    try:
+        u_boot_console.run_command('setenv httpdstp %d' % f['port'])
+
+        # the second transfer uses the connection left by the first
+        for i in range(2):
+            output = u_boot_console.run_command(cmd)
+            assert expected in output
+        assert server.connections == 1
+        assert server.ranges == [None, None]
+
+        # a transfer which is cut off carries on where it stopped
+        server.cut_at = size // 2
+        output = u_boot_console.run_command(cmd)
+        assert 'resuming at' in output
+        assert expected in output
+        assert server.connections == 2
+        assert server.ranges[-1].startswith('bytes=')
+
+        if u_boot_console.config.buildconfig.get('config_cmd_crc32',
+                                                 'n') == 'y':
+            output = u_boot_console.run_command('crc32 $fileaddr $filesize')
+            assert crc in output
+    finally:
+        u_boot_console.run_command('setenv httpdstp')
+        server.shutdown()
+        server.server_close()
@@ -512,6 +512,35 @@ def setup_cedit_file(cons):
     u_boot_utils.run_and_log(
         cons, f'{expo_tool} -e {inhname} -l {infname} -o {outfname}')
 
+def setup_htree_image(cons):
+    """Create an ext4 image with a directory large enough to be indexed
+
+    The 'big' directory holds 500 files, each containing its own name. The
+    'small' directory has just one, so is not indexed.
+
+    Args:
+        cons (ConsoleBase): Console to use
+    """
+    fname = os.path.join(cons.config.persistent_data_dir, '4MB.htree.ext4.img')
+    srcdir = os.path.join(cons.config.persistent_data_dir, 'htree')
+    mkdir_cond(srcdir)
+    mkdir_cond(os.path.join(srcdir, 'big'))
+    mkdir_cond(os.path.join(srcdir, 'small'))
+    for i in range(500):
+        with open(os.path.join(srcdir, 'big', f'file{i}'), 'w') as outf:
+            outf.write(f'file{i}')
+    with open(os.path.join(srcdir, 'small', 'a'), 'w') as outf:
+        outf.write('a')
+
+    u_boot_utils.run_and_log(cons, f'rm -f {fname}')
+    u_boot_utils.run_and_log(cons, f'truncate -s 4M {fname}')
+    u_boot_utils.run_and_log(
+        cons, f'mkfs.ext4 -q -b 1024 -N 1024 -O ^metadata_csum -d {srcdir} {fname}')
+
+    # mkfs does not index directories, but e2fsck does when asked
+    u_boot_utils.run_and_log(cons, f'e2fsck -fyD {fname}', ignore_errors=True)
+    u_boot_utils.run_and_log(cons, f'rm -rf {srcdir}')
+
 @pytest.mark.buildconfigspec('ut_dm')
 def test_ut_dm_init(u_boot_console):
     """Initialize data for ut dm tests."""
@@ -540,6 +569,7 @@ def test_ut_dm_init(u_boot_console):
 
     fs_helper.mk_fs(u_boot_console.config, 'ext2', 0x200000, '2MB')
     fs_helper.mk_fs(u_boot_console.config, 'fat32', 0x100000, '1MB')
+    setup_htree_image(u_boot_console)
 
     mmc_dev = 6
     fn = os.path.join(u_boot_console.config.source_dir, f'mmc{mmc_dev}.img')